@@ -0,0 +1,540 @@
+/*
+ * jpeg12bench.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This program decodes and re-encodes a set of JPEG files repeatedly and
+ * reports the throughput in megapixels per second, the latency percentiles
+ * of the single runs and the peak resident memory of the process.
+ * jpeg12gen writes a suitable corpus.
+ *
+ * The files are read into memory first, and decoded from and encoded to
+ * memory, so that no file I/O is measured.  Decoding runs the whole
+ * pipeline up to jpeg12_read_scanlines(), as the plugin does; encoding
+ * compresses the decoded pixels with the settings of the source file.
+ */
+
+#include "cdjpeg.h"		/* Common decls for cjpeg/djpeg applications */
+#include <dirent.h>
+#include <time.h>
+#include <sys/resource.h>
+
+
+/* Settings from the command line */
+
+static int iterations = 10;	/* timed runs per image */
+static int warmup = 1;		/* untimed runs before them */
+static boolean do_decode = TRUE;
+static boolean do_encode = TRUE;
+static int entropy_threads = 0;
+static boolean window_output = FALSE;
+static int window_min, window_max;
+static boolean show_stages = FALSE;
+static const char * progname;
+
+
+LOCAL(void)
+usage (void)
+{
+  fprintf(stderr, "usage: %s [switches] file|directory ...\n", progname);
+  fprintf(stderr, "Switches (names may be abbreviated):\n");
+  fprintf(stderr, "  -iterations N  Timed runs per image (default 10)\n");
+  fprintf(stderr, "  -warmup N      Untimed runs before them (default 1)\n");
+  fprintf(stderr, "  -nodecode      Only time encoding\n");
+  fprintf(stderr, "  -noencode      Only time decoding\n");
+  fprintf(stderr, "  -threads N     Entropy decoding threads, if supported\n");
+  fprintf(stderr, "  -window MIN,MAX  Decode to windowed 8-bit output\n");
+  fprintf(stderr, "  -stages        Show where the decoding time goes\n");
+  exit(EXIT_FAILURE);
+}
+
+
+LOCAL(int)
+parse_switches (int argc, char **argv)
+/* Returns the index of the first file argument. */
+{
+  int argn;
+  char * arg;
+  char ch;
+
+  for (argn = 1; argn < argc; argn++) {
+    arg = argv[argn];
+    if (*arg != '-')
+      break;			/* done with switches */
+    arg++;			/* advance past switch marker character */
+
+    if (keymatch(arg, "iterations", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d%c", &iterations, &ch) != 1 ||
+	  iterations < 1)
+	usage();
+    } else if (keymatch(arg, "warmup", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d%c", &warmup, &ch) != 1 || warmup < 0)
+	usage();
+    } else if (keymatch(arg, "nodecode", 3)) {
+      do_decode = FALSE;
+    } else if (keymatch(arg, "noencode", 3)) {
+      do_encode = FALSE;
+    } else if (keymatch(arg, "threads", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d%c", &entropy_threads, &ch) != 1 ||
+	  entropy_threads < 0)
+	usage();
+    } else if (keymatch(arg, "window", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d,%d%c",
+		 &window_min, &window_max, &ch) != 2 ||
+	  window_min >= window_max)
+	usage();
+      window_output = TRUE;
+    } else if (keymatch(arg, "stages", 1)) {
+      show_stages = TRUE;
+    } else {
+      usage();
+    }
+  }
+  if (argn >= argc || (! do_decode && ! do_encode))
+    usage();
+  return argn;
+}
+
+
+/*
+ * Wall clock, in seconds.
+ */
+
+LOCAL(double)
+read_clock (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1.0e-9;
+#endif
+  return (double) clock() / (double) CLOCKS_PER_SEC;
+}
+
+
+/*
+ * Peak resident set size of the process, in megabytes.
+ */
+
+LOCAL(double)
+peak_rss_mb (void)
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+#ifdef __APPLE__
+  return (double) usage.ru_maxrss / 1048576.0; /* bytes */
+#else
+  return (double) usage.ru_maxrss / 1024.0; /* kilobytes */
+#endif
+}
+
+
+/*
+ * Latencies of the timed runs of one image and operation.
+ */
+
+typedef struct {
+  double * seconds;		/* one per run */
+  int count, allocated;
+  double total;
+} latency_list;
+
+/* Over all images, per megapixel, so that the sizes mix */
+static latency_list all_decodes, all_encodes;
+
+
+LOCAL(void)
+add_latency (latency_list * list, double seconds)
+{
+  if (list->count == list->allocated) {
+    list->allocated = list->allocated ? list->allocated * 2 : 64;
+    list->seconds = (double *)
+      realloc(list->seconds, (size_t) list->allocated * SIZEOF(double));
+    if (list->seconds == NULL) {
+      fprintf(stderr, "%s: out of memory\n", progname);
+      exit(EXIT_FAILURE);
+    }
+  }
+  list->seconds[list->count++] = seconds;
+  list->total += seconds;
+}
+
+
+LOCAL(int)
+compare_double (const void * a, const void * b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+
+/* The p'th percentile, nearest rank; sorts the list. */
+
+LOCAL(double)
+percentile (latency_list * list, int p)
+{
+  int rank;
+
+  if (list->count == 0)
+    return 0.0;
+  qsort(list->seconds, (size_t) list->count, SIZEOF(double), compare_double);
+  rank = (p * list->count + 99) / 100;
+  if (rank < 1)
+    rank = 1;
+  return list->seconds[rank - 1];
+}
+
+
+LOCAL(void)
+print_latencies (const char * name, const char * operation,
+		 latency_list * list, double megapixels)
+{
+  printf("%-28s %-6s %8.1f MP/s  p50 %8.2f  p90 %8.2f  p99 %8.2f ms\n",
+	 name, operation,
+	 list->total > 0.0 ? megapixels * list->count / list->total : 0.0,
+	 percentile(list, 50) * 1e3, percentile(list, 90) * 1e3,
+	 percentile(list, 99) * 1e3);
+}
+
+
+/*
+ * One image, as read from its file and as decoded.
+ */
+
+typedef struct {
+  const char * name;
+  unsigned char * data;		/* the file */
+  unsigned long size;
+  JSAMPLE * pixels;		/* the decoded image, for encoding */
+  JDIMENSION width, height;
+  int components;
+  J_COLOR_SPACE color_space;	/* of the pixels */
+  int h_samp[MAX_COMPONENTS], v_samp[MAX_COMPONENTS];
+  boolean progressive, arith;
+  unsigned int restart_interval;
+} bench_image;
+
+
+LOCAL(boolean)
+load_file (bench_image * image, const char * filename)
+{
+  FILE * infile;
+  long size;
+
+  if ((infile = fopen(filename, READ_BINARY)) == NULL) {
+    fprintf(stderr, "%s: can't open %s\n", progname, filename);
+    return FALSE;
+  }
+  if (fseek(infile, 0L, SEEK_END) != 0 || (size = ftell(infile)) <= 0 ||
+      fseek(infile, 0L, SEEK_SET) != 0 ||
+      (image->data = (unsigned char *) malloc((size_t) size)) == NULL ||
+      JFREAD(infile, image->data, size) != (size_t) size) {
+    fprintf(stderr, "%s: can't read %s\n", progname, filename);
+    free(image->data);
+    fclose(infile);
+    return FALSE;
+  }
+  fclose(infile);
+  image->name = strrchr(filename, '/') != NULL ?
+		strrchr(filename, '/') + 1 : filename;
+  image->size = (unsigned long) size;
+  return TRUE;
+}
+
+
+/*
+ * Decode the image once.  With keep, the pixels and settings are saved
+ * for encoding.
+ */
+
+LOCAL(void)
+decode_image (bench_image * image, boolean keep,
+	      jpeg12_decode_timing * timing)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  JSAMPROW row;
+  JSAMPARRAY buffer;
+  size_t row_size;
+  int ci;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_decompress(&cinfo);
+  jpeg12_mem_src(&cinfo, image->data, image->size);
+  (void) jpeg12_read_header(&cinfo, TRUE);
+  cinfo.entropy_threads = entropy_threads;
+  cinfo.timing = timing;
+  if (window_output && ! keep) {
+    cinfo.window_output = TRUE;
+    cinfo.window_min = window_min;
+    cinfo.window_max = window_max;
+  }
+  jpeg12_start_decompress(&cinfo);
+
+  if (keep) {
+    image->width = cinfo.output_width;
+    image->height = cinfo.output_height;
+    image->components = cinfo.output_components;
+    image->color_space = cinfo.out_color_space;
+    for (ci = 0; ci < cinfo.num_components && ci < MAX_COMPONENTS; ci++) {
+      image->h_samp[ci] = cinfo.comp_info[ci].h_samp_factor;
+      image->v_samp[ci] = cinfo.comp_info[ci].v_samp_factor;
+    }
+    image->progressive = cinfo.progressive_mode;
+    image->arith = cinfo.arith_code;
+    image->restart_interval = cinfo.restart_interval;
+    row_size = (size_t) cinfo.output_width * cinfo.output_components;
+    image->pixels = (JSAMPLE *)
+      malloc(row_size * cinfo.output_height * SIZEOF(JSAMPLE));
+    if (image->pixels == NULL) {
+      fprintf(stderr, "%s: out of memory\n", progname);
+      exit(EXIT_FAILURE);
+    }
+    while (cinfo.output_scanline < cinfo.output_height) {
+      row = image->pixels + row_size * cinfo.output_scanline;
+      (void) jpeg12_read_scanlines(&cinfo, &row, (JDIMENSION) 1);
+    }
+  } else {
+    /* Windowed output has 1 byte per component and a 4th for RGBA */
+    row_size = (size_t) cinfo.output_width *
+      (window_output && cinfo.output_components == 3 ? 4 :
+       cinfo.output_components);
+    buffer = (*cinfo.mem->j12_alloc_sarray)
+      ((j12_common_ptr) &cinfo, JPOOL_IMAGE, (JDIMENSION) row_size,
+       (JDIMENSION) cinfo.rec_outbuf_height);
+    while (cinfo.output_scanline < cinfo.output_height)
+      (void) jpeg12_read_scanlines(&cinfo, buffer,
+				   (JDIMENSION) cinfo.rec_outbuf_height);
+  }
+
+  (void) jpeg12_finish_decompress(&cinfo);
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+/*
+ * Encode the decoded pixels once, like the source file.
+ */
+
+LOCAL(void)
+encode_image (bench_image * image)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  unsigned char * outbuffer = NULL;
+  unsigned long outsize = 0;
+  JSAMPROW row;
+  size_t row_size = (size_t) image->width * image->components;
+  int ci;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  jpeg12_mem_dest(&cinfo, &outbuffer, &outsize);
+
+  cinfo.image_width = image->width;
+  cinfo.image_height = image->height;
+  cinfo.input_components = image->components;
+  cinfo.in_color_space = image->color_space;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_quality(&cinfo, 90, TRUE);
+  for (ci = 0; ci < cinfo.num_components && ci < MAX_COMPONENTS; ci++) {
+    cinfo.comp_info[ci].h_samp_factor = image->h_samp[ci];
+    cinfo.comp_info[ci].v_samp_factor = image->v_samp[ci];
+  }
+  cinfo.arith_code = image->arith;
+  if (cinfo.arith_code)		/* it adapts; there are no tables to optimize */
+    cinfo.optimize_coding = FALSE;
+  cinfo.restart_interval = image->restart_interval;
+  if (image->progressive)
+    jpeg12_simple_progression(&cinfo);
+
+  jpeg12_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    row = image->pixels + row_size * cinfo.next_scanline;
+    (void) jpeg12_write_scanlines(&cinfo, &row, (JDIMENSION) 1);
+  }
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  free(outbuffer);
+}
+
+
+LOCAL(void)
+print_stages (jpeg12_decode_timing * timing)
+{
+  static const char * const names[JPEG12_TIMING_STAGES] = {
+    "markers", "entropy", "idct", "upsample", "color", "quantize", "output"
+  };
+  double total = 0.0;
+  int i;
+
+  for (i = 0; i < JPEG12_TIMING_STAGES; i++)
+    total += timing->seconds[i];
+  printf("%28s", "");
+  for (i = 0; i < JPEG12_TIMING_STAGES; i++)
+    if (timing->calls[i] > 0)
+      printf(" %s %.0f%%", names[i],
+	     total > 0.0 ? 100.0 * timing->seconds[i] / total : 0.0);
+  printf("\n");
+}
+
+
+/*
+ * Benchmark one file.
+ */
+
+LOCAL(void)
+bench_file (const char * filename)
+{
+  bench_image image;
+  latency_list decodes, encodes;
+  jpeg12_decode_timing timing;
+  double megapixels, start;
+  int i;
+
+  MEMZERO(&image, SIZEOF(image));
+  if (! load_file(&image, filename))
+    return;
+  decode_image(&image, TRUE, (jpeg12_decode_timing *) NULL);
+  megapixels = (double) image.width * (double) image.height / 1e6;
+
+  MEMZERO(&decodes, SIZEOF(decodes));
+  MEMZERO(&encodes, SIZEOF(encodes));
+  (void) jpeg12_init_decode_timing(&timing);
+
+  if (do_decode) {
+    for (i = 0; i < warmup; i++)
+      decode_image(&image, FALSE, (jpeg12_decode_timing *) NULL);
+    for (i = 0; i < iterations; i++) {
+      start = read_clock();
+      decode_image(&image, FALSE, show_stages ? &timing :
+		   (jpeg12_decode_timing *) NULL);
+      add_latency(&decodes, read_clock() - start);
+      add_latency(&all_decodes, decodes.seconds[i] / megapixels);
+    }
+    print_latencies(image.name, "decode", &decodes, megapixels);
+    if (show_stages)
+      print_stages(&timing);
+  }
+  if (do_encode) {
+    for (i = 0; i < warmup; i++)
+      encode_image(&image);
+    for (i = 0; i < iterations; i++) {
+      start = read_clock();
+      encode_image(&image);
+      add_latency(&encodes, read_clock() - start);
+      add_latency(&all_encodes, encodes.seconds[i] / megapixels);
+    }
+    print_latencies(image.name, "encode", &encodes, megapixels);
+  }
+
+  free(decodes.seconds);
+  free(encodes.seconds);
+  free(image.pixels);
+  free(image.data);
+}
+
+
+/*
+ * Benchmark the JPEG files in a directory, in name order.
+ */
+
+LOCAL(int)
+compare_names (const void * a, const void * b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+
+LOCAL(boolean)
+is_jpeg_name (const char * name)
+{
+  size_t len = strlen(name);
+
+  return (len > 4 && (strcmp(name + len - 4, ".jpg") == 0 ||
+		      strcmp(name + len - 4, ".JPG") == 0)) ||
+	 (len > 5 && (strcmp(name + len - 5, ".jpeg") == 0 ||
+		      strcmp(name + len - 5, ".JPEG") == 0));
+}
+
+
+LOCAL(boolean)
+bench_directory (const char * dirname)
+{
+  DIR * dir;
+  struct dirent * entry;
+  char ** names = NULL;
+  int count = 0, allocated = 0, i;
+
+  if ((dir = opendir(dirname)) == NULL)
+    return FALSE;		/* not a directory */
+  while ((entry = readdir(dir)) != NULL) {
+    if (! is_jpeg_name(entry->d_name))
+      continue;
+    if (count == allocated) {
+      allocated = allocated ? allocated * 2 : 32;
+      names = (char **) realloc(names, (size_t) allocated * SIZEOF(char *));
+      if (names == NULL) {
+	fprintf(stderr, "%s: out of memory\n", progname);
+	exit(EXIT_FAILURE);
+      }
+    }
+    names[count] = (char *)
+      malloc(strlen(dirname) + strlen(entry->d_name) + 2);
+    if (names[count] == NULL) {
+      fprintf(stderr, "%s: out of memory\n", progname);
+      exit(EXIT_FAILURE);
+    }
+    sprintf(names[count++], "%s/%s", dirname, entry->d_name);
+  }
+  closedir(dir);
+
+  qsort(names, (size_t) count, SIZEOF(char *), compare_names);
+  for (i = 0; i < count; i++) {
+    bench_file(names[i]);
+    free(names[i]);
+  }
+  free(names);
+  return TRUE;
+}
+
+
+int
+main (int argc, char **argv)
+{
+  int first, argn;
+
+  progname = argv[0];
+  if (progname == NULL || progname[0] == 0)
+    progname = "jpeg12bench";	/* in case C library doesn't provide it */
+
+  first = parse_switches(argc, argv);
+
+  for (argn = first; argn < argc; argn++)
+    if (! bench_directory(argv[argn]))
+      bench_file(argv[argn]);
+
+  printf("\n");
+  if (do_decode && all_decodes.count > 0)
+    print_latencies("all images (per MP)", "decode", &all_decodes, 1.0);
+  if (do_encode && all_encodes.count > 0)
+    print_latencies("all images (per MP)", "encode", &all_encodes, 1.0);
+  printf("peak RSS %.1f MB\n", peak_rss_mb());
+
+  exit(EXIT_SUCCESS);
+  return 0;			/* suppress no-return-value warnings */
+}
@@ -0,0 +1,258 @@
+/*
+ * jpeg12gen.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This program writes a corpus of synthetic 12-bit JPEG files for
+ * jpeg12bench: the same reproducible image content, encoded baseline,
+ * progressive, arithmetic and with restart intervals, in grayscale and in
+ * color with 4:4:4, 4:2:2 and 4:2:0 subsampling.
+ *
+ * The image looks a bit like a radiograph: a smooth body with dense
+ * structures, sharp-edged implants and sensor noise, so that both the
+ * entropy coder and the IDCT see realistic data.  The content depends only
+ * on the size and the seed.
+ */
+
+#include "cdjpeg.h"		/* Common decls for cjpeg/djpeg applications */
+#include <math.h>
+
+
+/* The corpus.  Each variant gives the luma sampling factors; the chroma
+ * components always use 1x1.
+ */
+
+typedef struct {
+  const char * name;		/* file name, without ".jpg" */
+  int components;		/* 1 = grayscale, 3 = color */
+  int h_samp, v_samp;		/* luma sampling factors */
+  boolean progressive;		/* progressive scans */
+  boolean arith;		/* arithmetic coding */
+  int restart_rows;		/* restart interval in MCU rows, or 0 */
+} corpus_variant;
+
+static const corpus_variant variants[] = {
+  { "gray_baseline",		1, 1, 1, FALSE, FALSE, 0 },
+  { "gray_progressive",		1, 1, 1, TRUE,  FALSE, 0 },
+  { "gray_arith",		1, 1, 1, FALSE, TRUE,  0 },
+  { "gray_arith_progressive",	1, 1, 1, TRUE,  TRUE,  0 },
+  { "gray_restart",		1, 1, 1, FALSE, FALSE, 1 },
+  { "color444_baseline",	3, 1, 1, FALSE, FALSE, 0 },
+  { "color422_baseline",	3, 2, 1, FALSE, FALSE, 0 },
+  { "color420_baseline",	3, 2, 2, FALSE, FALSE, 0 },
+  { "color420_progressive",	3, 2, 2, TRUE,  FALSE, 0 },
+  { "color420_arith",		3, 2, 2, FALSE, TRUE,  0 },
+  { "color420_restart",		3, 2, 2, FALSE, FALSE, 1 },
+};
+
+#define NUM_VARIANTS	((int) (SIZEOF(variants) / SIZEOF(variants[0])))
+
+
+/* Settings from the command line */
+
+static JDIMENSION image_width = 1024;
+static JDIMENSION image_height = 1024;
+static unsigned long seed = 1;
+static int quality = 90;
+static const char * outdir = NULL;
+static const char * progname;
+
+
+LOCAL(void)
+usage (void)
+{
+  fprintf(stderr, "usage: %s [switches] outputdir\n", progname);
+  fprintf(stderr, "Switches (names may be abbreviated):\n");
+  fprintf(stderr, "  -size WxH      Image size (default 1024x1024)\n");
+  fprintf(stderr, "  -seed N        Seed for the image content (default 1)\n");
+  fprintf(stderr, "  -quality N     Compression quality (default 90)\n");
+  exit(EXIT_FAILURE);
+}
+
+
+LOCAL(void)
+parse_switches (int argc, char **argv)
+{
+  int argn;
+  char * arg;
+  char ch;
+
+  for (argn = 1; argn < argc; argn++) {
+    arg = argv[argn];
+    if (*arg != '-') {
+      if (outdir != NULL || argn != argc - 1)
+	usage();
+      outdir = arg;
+      continue;
+    }
+    arg++;			/* advance past switch marker character */
+
+    if (keymatch(arg, "size", 1)) {
+      unsigned int w, h;
+
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%ux%u%c", &w, &h, &ch) != 2 ||
+	  w < 1 || h < 1 ||
+	  w > JPEG12_MAX_DIMENSION || h > JPEG12_MAX_DIMENSION)
+	usage();
+      image_width = (JDIMENSION) w;
+      image_height = (JDIMENSION) h;
+    } else if (keymatch(arg, "seed", 2)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%lu%c", &seed, &ch) != 1)
+	usage();
+    } else if (keymatch(arg, "quality", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d%c", &quality, &ch) != 1 ||
+	  quality < 0 || quality > 100)
+	usage();
+    } else {
+      usage();
+    }
+  }
+  if (outdir == NULL)
+    usage();
+}
+
+
+/*
+ * The random numbers come from our own generator, so that the corpus is
+ * the same on every platform.
+ */
+
+LOCAL(unsigned long)
+next_random (unsigned long * state)
+{
+  *state = (*state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+  return *state >> 8;		/* 24 useful bits */
+}
+
+
+/*
+ * Fill one row of the image, with samples interleaved by component.
+ * The components of a color image share the structures at different
+ * intensities, so that the chroma isn't flat.
+ */
+
+LOCAL(void)
+make_row (JSAMPROW row, JDIMENSION y, int components, unsigned long * state)
+{
+  double cx = image_width * 0.5, cy = image_height * 0.55;
+  double rx = image_width * 0.42, ry = image_height * 0.48;
+  double dy = ((double) y - cy) / ry;
+  JDIMENSION x;
+  int ci;
+
+  for (x = 0; x < image_width; x++) {
+    double dx = ((double) x - cx) / rx;
+    double r2 = dx * dx + dy * dy;
+    double value = 300.0;	/* background */
+    long sample;
+
+    if (r2 < 1.0)		/* the body, denser towards its middle */
+      value += 2400.0 * sqrt(1.0 - r2);
+    /* ribs: periodic structures inside the body */
+    if (r2 < 0.8)
+      value += 500.0 * (0.5 + 0.5 * sin(((double) y + 40.0 * dx * dx) * 0.06));
+    /* an implant: a hard-edged bright rectangle */
+    if (x > image_width / 5 && x < image_width / 3 &&
+	y > image_height / 3 && y < image_height / 2)
+      value = 3900.0;
+    /* a marker disc, partly outside the body */
+    if ((dx - 0.9) * (dx - 0.9) + (dy + 0.8) * (dy + 0.8) < 0.01)
+      value = 4000.0;
+
+    for (ci = 0; ci < components; ci++) {
+      double noise = (double) (next_random(state) & 0xFF) - 127.5;
+
+      sample = (long) (value * (1.0 - 0.15 * ci) + noise * 0.25);
+      if (sample < 0)
+	sample = 0;
+      else if (sample > MAXJSAMPLE)
+	sample = MAXJSAMPLE;
+      *row++ = (JSAMPLE) sample;
+    }
+  }
+}
+
+
+/*
+ * Encode one variant of the image.
+ */
+
+LOCAL(void)
+write_variant (const corpus_variant * variant)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  char filename[1024];
+  FILE * outfile;
+  JSAMPARRAY buffer;
+  unsigned long state = seed;
+
+  sprintf(filename, "%.1000s/%s.jpg", outdir, variant->name);
+  if ((outfile = fopen(filename, WRITE_BINARY)) == NULL) {
+    fprintf(stderr, "%s: can't open %s\n", progname, filename);
+    exit(EXIT_FAILURE);
+  }
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  jpeg12_stdio_dest(&cinfo, outfile);
+
+  cinfo.image_width = image_width;
+  cinfo.image_height = image_height;
+  cinfo.input_components = variant->components;
+  cinfo.in_color_space = variant->components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_quality(&cinfo, quality, TRUE);
+  cinfo.comp_info[0].h_samp_factor = variant->h_samp;
+  cinfo.comp_info[0].v_samp_factor = variant->v_samp;
+  cinfo.arith_code = variant->arith;
+  if (cinfo.arith_code)		/* it adapts; there are no tables to optimize */
+    cinfo.optimize_coding = FALSE;
+  cinfo.restart_in_rows = variant->restart_rows;
+  if (variant->progressive)
+    jpeg12_simple_progression(&cinfo);
+
+  jpeg12_start_compress(&cinfo, TRUE);
+  buffer = (*cinfo.mem->j12_alloc_sarray)
+    ((j12_common_ptr) &cinfo, JPOOL_IMAGE,
+     image_width * (JDIMENSION) variant->components, (JDIMENSION) 1);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    make_row(buffer[0], cinfo.next_scanline, variant->components, &state);
+    (void) jpeg12_write_scanlines(&cinfo, buffer, (JDIMENSION) 1);
+  }
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+
+  if (fclose(outfile) != 0) {
+    fprintf(stderr, "%s: can't write %s\n", progname, filename);
+    exit(EXIT_FAILURE);
+  }
+  printf("%s\n", filename);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  int i;
+
+  progname = argv[0];
+  if (progname == NULL || progname[0] == 0)
+    progname = "jpeg12gen";	/* in case C library doesn't provide it */
+
+  parse_switches(argc, argv);
+
+  for (i = 0; i < NUM_VARIANTS; i++)
+    write_variant(&variants[i]);
+
+  exit(EXIT_SUCCESS);
+  return 0;			/* suppress no-return-value warnings */
+}
@@ -0,0 +1,1192 @@
+/*
+ * jpeg12kernels.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This program times the library's inner loops one by one and checks
+ * their results:
+ *
+ *   - every inverse and forward DCT, against double-precision arithmetic
+ *     (there is one implementation of each, so this checks accuracy);
+ *   - Huffman decoding, serial against multi-threaded and the progressive
+ *     refinement fast path against the suspending path, bit for bit;
+ *   - Huffman encoding, by decoding its output again, bit for bit;
+ *   - the upsamplers and color converters, each vectorized version against
+ *     the C code, bit for bit.
+ *
+ * The DCTs and the entropy coder are fed with the coefficients or samples
+ * of a real image (the -file given, else a synthetic one) and with random
+ * ones; the sample kernels with a smooth image and with noise.  Each kernel
+ * is run a number of times and the fastest run is reported.  The exit
+ * status is nonzero if any check fails.
+ *
+ * This program looks inside the library (jpegint.h, jdct.h, jsimd.h), so
+ * it must be built together with it.
+ */
+
+#define JPEG12_INTERNALS
+#include "cdjpeg.h"		/* Common decls for cjpeg/djpeg applications */
+#include "jdct.h"
+#include "jsimd.h"
+#include <math.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI  3.14159265358979323846
+#endif
+
+
+/* Settings from the command line */
+
+static int iterations = 20;	/* runs per kernel; the fastest counts */
+static const char * filename = NULL; /* real-world input, or NULL */
+static const char * filter = NULL; /* only kernels whose name has this */
+static const char * progname;
+
+static int failures = 0;	/* checks failed */
+
+
+LOCAL(void)
+usage (void)
+{
+  fprintf(stderr, "usage: %s [switches]\n", progname);
+  fprintf(stderr, "Switches (names may be abbreviated):\n");
+  fprintf(stderr, "  -iterations N  Runs per kernel (default 20)\n");
+  fprintf(stderr, "  -file F        JPEG file for real-world input\n");
+  fprintf(stderr, "  -kernel NAME   Only kernels whose name contains NAME\n");
+  exit(EXIT_FAILURE);
+}
+
+
+LOCAL(void)
+parse_switches (int argc, char **argv)
+{
+  int argn;
+  char * arg;
+  char ch;
+
+  for (argn = 1; argn < argc; argn++) {
+    arg = argv[argn];
+    if (*arg != '-')
+      usage();
+    arg++;			/* advance past switch marker character */
+
+    if (keymatch(arg, "iterations", 1)) {
+      if (++argn >= argc)
+	usage();
+      if (sscanf(argv[argn], "%d%c", &iterations, &ch) != 1 ||
+	  iterations < 1)
+	usage();
+    } else if (keymatch(arg, "file", 1)) {
+      if (++argn >= argc)
+	usage();
+      filename = argv[argn];
+    } else if (keymatch(arg, "kernel", 1)) {
+      if (++argn >= argc)
+	usage();
+      filter = argv[argn];
+    } else {
+      usage();
+    }
+  }
+}
+
+
+LOCAL(boolean)
+selected (const char * name)
+{
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+
+LOCAL(void *)
+alloc_or_die (size_t size)
+{
+  void * ptr = calloc(1, size);
+
+  if (ptr == NULL) {
+    fprintf(stderr, "%s: out of memory\n", progname);
+    exit(EXIT_FAILURE);
+  }
+  return ptr;
+}
+
+
+/*
+ * Timing: wall clock, in seconds.
+ */
+
+LOCAL(double)
+read_clock (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1.0e-9;
+#endif
+  return (double) clock() / (double) CLOCKS_PER_SEC;
+}
+
+
+/*
+ * One line of the report: the kernel, its input, the implementation,
+ * the throughput in millions of items (blocks, pixels or bytes) per second
+ * ("-" if it was not run), and the outcome of the check.
+ */
+
+LOCAL(void)
+report (const char * kernel, const char * input, const char * variant,
+	double items, const char * unit, double seconds, const char * check)
+{
+  if (items <= 0.0)		/* not run */
+    printf("%-18s %-7s %-5s %15s  %s\n", kernel, input, variant, "-", check);
+  else
+    printf("%-18s %-7s %-5s %9.1f M%s/s  %s\n", kernel, input, variant,
+	   seconds > 0.0 ? items / seconds / 1e6 : 0.0, unit, check);
+}
+
+
+/*
+ * Our own random numbers, so that the inputs are the same everywhere.
+ */
+
+static unsigned long random_state = 1;
+
+LOCAL(long)
+random_range (long limit)
+/* A random number in -limit..limit. */
+{
+  random_state = (random_state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+  return (long) ((random_state >> 8) % (unsigned long) (2 * limit + 1)) - limit;
+}
+
+
+/****************************** Test image ******************************/
+
+/*
+ * The real-world input: the given file, or a synthetic grayscale image
+ * like jpeg12gen's, held in memory.
+ */
+
+static JOCTET * image_data;
+static unsigned long image_size;
+
+#define SYNTH_SIZE  512
+
+
+LOCAL(void)
+load_image (void)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  JSAMPROW row;
+  JDIMENSION x, y;
+  FILE * infile;
+  long size;
+
+  if (filename != NULL) {
+    if ((infile = fopen(filename, READ_BINARY)) == NULL) {
+      fprintf(stderr, "%s: can't open %s\n", progname, filename);
+      exit(EXIT_FAILURE);
+    }
+    if (fseek(infile, 0L, SEEK_END) != 0 || (size = ftell(infile)) <= 0 ||
+	fseek(infile, 0L, SEEK_SET) != 0) {
+      fprintf(stderr, "%s: can't read %s\n", progname, filename);
+      exit(EXIT_FAILURE);
+    }
+    image_data = (JOCTET *) alloc_or_die((size_t) size);
+    if (JFREAD(infile, image_data, size) != (size_t) size) {
+      fprintf(stderr, "%s: can't read %s\n", progname, filename);
+      exit(EXIT_FAILURE);
+    }
+    fclose(infile);
+    image_size = (unsigned long) size;
+    return;
+  }
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  jpeg12_mem_dest(&cinfo, &image_data, &image_size);
+  cinfo.image_width = SYNTH_SIZE;
+  cinfo.image_height = SYNTH_SIZE;
+  cinfo.input_components = 1;
+  cinfo.in_color_space = JCS_GRAYSCALE;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_quality(&cinfo, 90, TRUE);
+  jpeg12_start_compress(&cinfo, TRUE);
+  row = (JSAMPROW) alloc_or_die(SYNTH_SIZE * SIZEOF(JSAMPLE));
+  for (y = 0; y < SYNTH_SIZE; y++) {
+    for (x = 0; x < SYNTH_SIZE; x++) {
+      double dx = (x - SYNTH_SIZE / 2.0) / (SYNTH_SIZE * 0.4);
+      double dy = (y - SYNTH_SIZE / 2.0) / (SYNTH_SIZE * 0.45);
+      double r2 = dx * dx + dy * dy;
+      long value = 300 + random_range(30);
+
+      if (r2 < 1.0)
+	value += (long) (2400.0 * sqrt(1.0 - r2) +
+			 400.0 * sin(y * 0.07 + 30.0 * dx * dx));
+      if (x > SYNTH_SIZE / 5 && x < SYNTH_SIZE / 3 &&
+	  y > SYNTH_SIZE / 3 && y < SYNTH_SIZE / 2)
+	value = 3900 + random_range(30);
+      row[x] = (JSAMPLE) (value < 0 ? 0 : value > MAXJSAMPLE ?
+			  MAXJSAMPLE : value);
+    }
+    (void) jpeg12_write_scanlines(&cinfo, &row, (JDIMENSION) 1);
+  }
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  free(row);
+}
+
+
+/*
+ * Start decompressing the test image, with the given DCT method.
+ * The caller finishes with jpeg12_destroy_decompress().
+ */
+
+LOCAL(void)
+open_image (j12_decompress_ptr cinfo, struct jpeg12_error_mgr * jerr)
+{
+  cinfo->err = jpeg12_std_error(jerr);
+  jpeg12_create_decompress(cinfo);
+  jpeg12_mem_src(cinfo, image_data, image_size);
+  (void) jpeg12_read_header(cinfo, TRUE);
+}
+
+
+/*
+ * The coefficients of the first component of the test image, and its
+ * samples (grayscale), for the DCT kernels.
+ */
+
+#define NUM_BLOCKS  4096	/* blocks per DCT run */
+
+static JBLOCK * real_blocks;	/* NUM_BLOCKS blocks, repeated if need be */
+static JSAMPLE * real_samples;	/* the decoded image */
+static JDIMENSION real_width, real_height;
+
+
+LOCAL(void)
+load_real_input (void)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  JBLOCKARRAY buffer;
+  JDIMENSION row, col;
+  JSAMPROW rowptr;
+  int n = 0, total;
+
+  open_image(&cinfo, &jerr);
+  coef_arrays = jpeg12_read_coefficients(&cinfo);
+  compptr = cinfo.comp_info;
+  total = (int) (compptr->height_in_blocks * compptr->width_in_blocks);
+  real_blocks = (JBLOCK *) alloc_or_die(NUM_BLOCKS * SIZEOF(JBLOCK));
+  while (n < NUM_BLOCKS) {
+    for (row = 0; row < compptr->height_in_blocks && n < NUM_BLOCKS; row++) {
+      buffer = (*cinfo.mem->j12_access_virt_barray)
+	((j12_common_ptr) &cinfo, coef_arrays[0], row, (JDIMENSION) 1, FALSE);
+      for (col = 0; col < compptr->width_in_blocks && n < NUM_BLOCKS; col++)
+	MEMCOPY(real_blocks[n++], buffer[0][col], SIZEOF(JBLOCK));
+    }
+    if (total == 0)
+      break;
+  }
+  jpeg12_destroy_decompress(&cinfo);
+
+  open_image(&cinfo, &jerr);
+  cinfo.out_color_space = JCS_GRAYSCALE;
+  jpeg12_start_decompress(&cinfo);
+  real_width = cinfo.output_width;
+  real_height = cinfo.output_height;
+  real_samples = (JSAMPLE *)
+    alloc_or_die((size_t) real_width * real_height * SIZEOF(JSAMPLE));
+  while (cinfo.output_scanline < cinfo.output_height) {
+    rowptr = real_samples + (size_t) real_width * cinfo.output_scanline;
+    (void) jpeg12_read_scanlines(&cinfo, &rowptr, (JDIMENSION) 1);
+  }
+  jpeg12_finish_decompress(&cinfo);
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+/****************************** DCT kernels ******************************/
+
+/*
+ * The scaling used by the fast integer and float DCTs (see jddctmgr.c).
+ */
+
+static const double aanscalefactor[DCTSIZE] = {
+  1.0, 1.387039845, 1.306562965, 1.175875602,
+  1.0, 0.785694958, 0.541196100, 0.275899379
+};
+
+
+/* C(u)/2 cos((2x+1)u pi / 2N), the N-point DCT basis with 8-point scaling,
+ * tabulated for N = 1..16 by init_dct_basis().
+ */
+
+static double dct_basis[17][16][DCTSIZE];
+
+
+LOCAL(void)
+init_dct_basis (void)
+{
+  int n, x, u;
+
+  for (n = 1; n <= 16; n++)
+    for (x = 0; x < n; x++)
+      for (u = 0; u < DCTSIZE; u++)
+	dct_basis[n][x][u] = (u == 0 ? 0.5 / sqrt(2.0) : 0.5) *
+	  cos((2 * x + 1) * u * M_PI / (2.0 * n));
+}
+
+
+typedef struct {
+  const char * name;
+  int width, height;		/* output block size of an IDCT, input of FDCT */
+  J_DCT_METHOD method;		/* which multiplier table / output scaling */
+  inverse_DCT_method_ptr idct;
+  forward_DCT_method_ptr fdct;
+  float_DCT_method_ptr float_fdct;
+  double tolerance;		/* acceptable max error */
+} dct_kernel;
+
+#define IDCT(n,w,h,t)  { "idct_" #n, w, h, JDCT_ISLOW, jpeg12_idct_##n, \
+			 NULL, NULL, t }
+#define FDCT(n,w,h,t)  { "fdct_" #n, w, h, JDCT_ISLOW, NULL, \
+			 jpeg12_fdct_##n, NULL, t }
+
+static const dct_kernel dct_kernels[] = {
+  { "idct_islow", 8, 8, JDCT_ISLOW, jpeg12_idct_islow, NULL, NULL, 1.0 },
+  { "idct_ifast", 8, 8, JDCT_IFAST, jpeg12_idct_ifast, NULL, NULL, 8.0 },
+  { "idct_float", 8, 8, JDCT_FLOAT, jpeg12_idct_float, NULL, NULL, 1.0 },
+  IDCT(1x1, 1, 1, 1.0), IDCT(2x2, 2, 2, 1.0), IDCT(3x3, 3, 3, 1.0),
+  IDCT(4x4, 4, 4, 1.0), IDCT(5x5, 5, 5, 1.0), IDCT(6x6, 6, 6, 1.0),
+  IDCT(7x7, 7, 7, 1.0), IDCT(9x9, 9, 9, 1.0), IDCT(10x10, 10, 10, 1.0),
+  IDCT(11x11, 11, 11, 1.0), IDCT(12x12, 12, 12, 1.0),
+  IDCT(13x13, 13, 13, 1.0), IDCT(14x14, 14, 14, 1.0),
+  IDCT(15x15, 15, 15, 1.0), IDCT(16x16, 16, 16, 1.0),
+  IDCT(16x8, 16, 8, 1.0), IDCT(14x7, 14, 7, 1.0), IDCT(12x6, 12, 6, 1.0),
+  IDCT(10x5, 10, 5, 1.0), IDCT(8x4, 8, 4, 1.0), IDCT(6x3, 6, 3, 1.0),
+  IDCT(4x2, 4, 2, 1.0), IDCT(2x1, 2, 1, 1.0), IDCT(8x16, 8, 16, 1.0),
+  IDCT(7x14, 7, 14, 1.0), IDCT(6x12, 6, 12, 1.0), IDCT(5x10, 5, 10, 1.0),
+  IDCT(4x8, 4, 8, 1.0), IDCT(3x6, 3, 6, 1.0), IDCT(2x4, 2, 4, 1.0),
+  IDCT(1x2, 1, 2, 1.0),
+  { "fdct_islow", 8, 8, JDCT_ISLOW, NULL, jpeg12_fdct_islow, NULL, 1.0 },
+  { "fdct_ifast", 8, 8, JDCT_IFAST, NULL, jpeg12_fdct_ifast, NULL, 64.0 },
+  { "fdct_float", 8, 8, JDCT_FLOAT, NULL, NULL, jpeg12_fdct_float, 1.0 },
+  FDCT(1x1, 1, 1, 1.5), FDCT(2x2, 2, 2, 1.5), FDCT(3x3, 3, 3, 1.5),
+  FDCT(4x4, 4, 4, 1.5), FDCT(5x5, 5, 5, 1.5), FDCT(6x6, 6, 6, 1.5),
+  FDCT(7x7, 7, 7, 1.5), FDCT(9x9, 9, 9, 1.5), FDCT(10x10, 10, 10, 1.5),
+  FDCT(11x11, 11, 11, 1.5), FDCT(12x12, 12, 12, 1.5),
+  FDCT(13x13, 13, 13, 1.5), FDCT(14x14, 14, 14, 1.5),
+  FDCT(15x15, 15, 15, 1.5), FDCT(16x16, 16, 16, 1.5),
+  FDCT(16x8, 16, 8, 1.5), FDCT(14x7, 14, 7, 1.5), FDCT(12x6, 12, 6, 1.5),
+  FDCT(10x5, 10, 5, 1.5), FDCT(8x4, 8, 4, 1.5), FDCT(6x3, 6, 3, 1.5),
+  FDCT(4x2, 4, 2, 1.5), FDCT(2x1, 2, 1, 1.5), FDCT(8x16, 8, 16, 1.5),
+  FDCT(7x14, 7, 14, 1.5), FDCT(6x12, 6, 12, 1.5), FDCT(5x10, 5, 10, 1.5),
+  FDCT(4x8, 4, 8, 1.5), FDCT(3x6, 3, 6, 1.5), FDCT(2x4, 2, 4, 1.5),
+  FDCT(1x2, 1, 2, 1.5),
+};
+
+#define NUM_DCT_KERNELS  ((int) (SIZEOF(dct_kernels) / SIZEOF(dct_kernels[0])))
+
+
+/*
+ * Time an inverse DCT over NUM_BLOCKS blocks and compare its output with
+ * the exact IDCT of the dequantized coefficients, rounded and clamped.
+ * The decompressor supplies the multiplier table and range limit table.
+ */
+
+LOCAL(void)
+bench_idct (const dct_kernel * kernel, JBLOCK * blocks, const char * input)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  jpeg12_component_info * compptr;
+  JSAMPARRAY output;
+  JQUANT_TBL * qtbl;
+  double best = 0.0, start, elapsed, max_error = 0.0, sum;
+  char check[80];
+  int b, i, x, y, u, v;
+
+  open_image(&cinfo, &jerr);
+  cinfo.dct_method = kernel->method;
+  cinfo.out_color_space = JCS_GRAYSCALE;
+  jpeg12_start_decompress(&cinfo);
+  compptr = cinfo.comp_info;
+  qtbl = compptr->quant_table;
+  output = (*cinfo.mem->j12_alloc_sarray)
+    ((j12_common_ptr) &cinfo, JPOOL_IMAGE, (JDIMENSION) (16 * NUM_BLOCKS),
+     (JDIMENSION) 16);
+
+  for (i = 0; i < iterations; i++) {
+    start = read_clock();
+    for (b = 0; b < NUM_BLOCKS; b++)
+      (*kernel->idct) (&cinfo, compptr, (JCOEFPTR) blocks[b], output,
+		       (JDIMENSION) (b * 16));
+    elapsed = read_clock() - start;
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+  }
+
+  for (b = 0; b < NUM_BLOCKS; b++) {
+    for (y = 0; y < kernel->height; y++) {
+      for (x = 0; x < kernel->width; x++) {
+	sum = CENTERJSAMPLE;
+	for (v = 0; v < DCTSIZE && v < kernel->height; v++)
+	  for (u = 0; u < DCTSIZE && u < kernel->width; u++)
+	    sum += (double) blocks[b][v * DCTSIZE + u] *
+	      qtbl->quantval[v * DCTSIZE + u] *
+	      dct_basis[kernel->width][x][u] * dct_basis[kernel->height][y][v];
+	sum = floor(sum + 0.5);
+	if (sum < 0.0)
+	  sum = 0.0;
+	else if (sum > MAXJSAMPLE)
+	  sum = MAXJSAMPLE;
+	sum = fabs(sum - GETJSAMPLE(output[y][b * 16 + x]));
+	if (sum > max_error)
+	  max_error = sum;
+      }
+    }
+  }
+  jpeg12_destroy_decompress(&cinfo);
+
+  sprintf(check, "max error %.0f%s", max_error,
+	  max_error > kernel->tolerance ? "  FAILED" : "");
+  if (max_error > kernel->tolerance)
+    failures++;
+  report(kernel->name, input, "C", (double) NUM_BLOCKS, "blk", best, check);
+}
+
+
+/*
+ * Time a forward DCT over NUM_BLOCKS blocks of samples, laid out side by
+ * side in 16 rows, and compare its output with the exact DCT.  The scaled
+ * DCTs take width x height samples and deliver 8x8 coefficients like the
+ * 8x8 DCT; all outputs are scaled up by 8, and those of the fast integer
+ * and float DCTs also by the AA&N factors.
+ */
+
+LOCAL(void)
+bench_fdct (const dct_kernel * kernel, JSAMPARRAY samples, const char * input)
+{
+  DCTELEM * data;
+  FAST_FLOAT * float_data;
+  double best = 0.0, start, elapsed, max_error = 0.0, sum, scale, value;
+  char check[80];
+  int b, i, x, y, u, v;
+
+  data = (DCTELEM *) alloc_or_die(NUM_BLOCKS * DCTSIZE2 * SIZEOF(DCTELEM));
+  float_data = (FAST_FLOAT *)
+    alloc_or_die(NUM_BLOCKS * DCTSIZE2 * SIZEOF(FAST_FLOAT));
+
+  for (i = 0; i < iterations; i++) {
+    start = read_clock();
+    if (kernel->float_fdct != NULL) {
+      for (b = 0; b < NUM_BLOCKS; b++)
+	(*kernel->float_fdct) (float_data + b * DCTSIZE2, samples,
+			       (JDIMENSION) (b * 16));
+    } else {
+      for (b = 0; b < NUM_BLOCKS; b++)
+	(*kernel->fdct) (data + b * DCTSIZE2, samples, (JDIMENSION) (b * 16));
+    }
+    elapsed = read_clock() - start;
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+  }
+
+  for (b = 0; b < NUM_BLOCKS; b++) {
+    for (v = 0; v < DCTSIZE; v++) {
+      for (u = 0; u < DCTSIZE; u++) {
+	sum = 0.0;
+	if (u < kernel->width && v < kernel->height) {
+	  for (y = 0; y < kernel->height; y++)
+	    for (x = 0; x < kernel->width; x++)
+	      sum += ((double) GETJSAMPLE(samples[y][b * 16 + x]) -
+		      CENTERJSAMPLE) *
+		dct_basis[kernel->width][x][u] *
+		dct_basis[kernel->height][y][v];
+	  sum *= 64.0 / (kernel->width * kernel->height);
+	}
+	scale = 8.0;
+	if (kernel->method != JDCT_ISLOW)
+	  scale *= aanscalefactor[u] * aanscalefactor[v];
+	if (kernel->float_fdct != NULL)
+	  value = float_data[b * DCTSIZE2 + v * DCTSIZE + u] / scale;
+	else
+	  value = data[b * DCTSIZE2 + v * DCTSIZE + u] / scale;
+	if (fabs(value - sum) > max_error)
+	  max_error = fabs(value - sum);
+      }
+    }
+  }
+  free(data);
+  free(float_data);
+
+  sprintf(check, "max error %.2f%s", max_error,
+	  max_error > kernel->tolerance ? "  FAILED" : "");
+  if (max_error > kernel->tolerance)
+    failures++;
+  report(kernel->name, input, "C", (double) NUM_BLOCKS, "blk", best, check);
+}
+
+
+LOCAL(void)
+bench_dcts (void)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  JBLOCK * random_blocks;
+  JSAMPARRAY real_strip, random_strip;
+  JQUANT_TBL * qtbl;
+  long limit;
+  int b, k, x, y, bx, by, blocks_per_row, block_rows;
+
+  init_dct_basis();
+
+  /* Random coefficients: dequantized values up to +-1024, so that the
+   * samples stay within the range the range limit table clamps correctly.
+   */
+  open_image(&cinfo, &jerr);
+  (void) jpeg12_read_coefficients(&cinfo);
+  qtbl = cinfo.comp_info[0].quant_table;
+  random_blocks = (JBLOCK *) alloc_or_die(NUM_BLOCKS * SIZEOF(JBLOCK));
+  for (b = 0; b < NUM_BLOCKS; b++) {
+    for (k = 0; k < DCTSIZE2; k++) {
+      limit = 1024L / qtbl->quantval[k];
+      random_blocks[b][k] = (JCOEF) (limit > 0 ? random_range(limit) : 0);
+    }
+  }
+  jpeg12_destroy_decompress(&cinfo);
+
+  /* Sample strips for the forward DCTs: tiles of the real image, and noise */
+  real_strip = (JSAMPARRAY) alloc_or_die(16 * SIZEOF(JSAMPROW));
+  random_strip = (JSAMPARRAY) alloc_or_die(16 * SIZEOF(JSAMPROW));
+  blocks_per_row = (int) (real_width / 16);
+  block_rows = (int) (real_height / 16);
+  for (y = 0; y < 16; y++) {
+    real_strip[y] = (JSAMPROW) alloc_or_die(16 * NUM_BLOCKS * SIZEOF(JSAMPLE));
+    random_strip[y] = (JSAMPROW)
+      alloc_or_die(16 * NUM_BLOCKS * SIZEOF(JSAMPLE));
+    for (b = 0; b < NUM_BLOCKS; b++) {
+      bx = blocks_per_row > 0 ? b % blocks_per_row : 0;
+      by = blocks_per_row > 0 && block_rows > 0 ?
+	   (b / blocks_per_row) % block_rows : 0;
+      for (x = 0; x < 16; x++) {
+	real_strip[y][b * 16 + x] = (bx * 16 + x < (int) real_width &&
+				     by * 16 + y < (int) real_height) ?
+	  real_samples[(size_t) (by * 16 + y) * real_width + bx * 16 + x] : 0;
+	random_strip[y][b * 16 + x] = (JSAMPLE)
+	  (CENTERJSAMPLE + random_range(CENTERJSAMPLE - 1));
+      }
+    }
+  }
+
+  for (k = 0; k < NUM_DCT_KERNELS; k++) {
+    if (! selected(dct_kernels[k].name))
+      continue;
+    if (dct_kernels[k].idct != NULL) {
+      bench_idct(&dct_kernels[k], real_blocks, "real");
+      bench_idct(&dct_kernels[k], random_blocks, "random");
+    } else {
+      bench_fdct(&dct_kernels[k], real_strip, "real");
+      bench_fdct(&dct_kernels[k], random_strip, "random");
+    }
+  }
+
+  for (y = 0; y < 16; y++) {
+    free(real_strip[y]);
+    free(random_strip[y]);
+  }
+  free(real_strip);
+  free(random_strip);
+  free(random_blocks);
+}
+
+
+/**************************** Entropy coding ****************************/
+
+/*
+ * A source manager handing out the input in small pieces, which keeps the
+ * Huffman decoder on its suspending (reference) path.
+ */
+
+#define CHUNK_SIZE  100
+
+typedef struct {
+  struct jpeg12_source_mgr pub;
+  const JOCTET * data;
+  unsigned long size, offset;
+} chunk_source_mgr;
+
+static const JOCTET fake_eoi[2] = { 0xFF, JPEG12_EOI };
+
+
+METHODDEF(void)
+chunk_init_source (j12_decompress_ptr cinfo)
+{
+  /* no work */
+}
+
+METHODDEF(boolean)
+chunk_fill_input_buffer (j12_decompress_ptr cinfo)
+{
+  chunk_source_mgr * src = (chunk_source_mgr *) cinfo->src;
+  unsigned long n = src->size - src->offset;
+
+  if (n == 0) {			/* insert a fake EOI, like jdatasrc.c */
+    src->pub.next_input_byte = fake_eoi;
+    src->pub.bytes_in_buffer = 2;
+    return TRUE;
+  }
+  if (n > CHUNK_SIZE)
+    n = CHUNK_SIZE;
+  src->pub.next_input_byte = src->data + src->offset;
+  src->pub.bytes_in_buffer = (size_t) n;
+  src->offset += n;
+  return TRUE;
+}
+
+METHODDEF(void)
+chunk_skip_input_data (j12_decompress_ptr cinfo, long num_bytes)
+{
+  struct jpeg12_source_mgr * src = cinfo->src;
+
+  if (num_bytes > 0) {
+    while (num_bytes > (long) src->bytes_in_buffer) {
+      num_bytes -= (long) src->bytes_in_buffer;
+      (void) (*src->j12_fill_input_buffer) (cinfo);
+    }
+    src->next_input_byte += (size_t) num_bytes;
+    src->bytes_in_buffer -= (size_t) num_bytes;
+  }
+}
+
+METHODDEF(void)
+chunk_term_source (j12_decompress_ptr cinfo)
+{
+  /* no work */
+}
+
+
+/*
+ * Decode all coefficients of a JPEG datastream, from memory or in chunks,
+ * with the given number of entropy decoding threads.  Returns them as one
+ * array, block after block of each component in turn.
+ */
+
+LOCAL(JCOEF *)
+decode_coefficients (const JOCTET * data, unsigned long size,
+		     boolean chunked, int threads, long * num_blocks)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  chunk_source_mgr * src;
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  JBLOCKARRAY buffer;
+  JCOEF * coefs, * ptr;
+  JDIMENSION row;
+  long total = 0;
+  int ci;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_decompress(&cinfo);
+  if (chunked) {
+    src = (chunk_source_mgr *) (*cinfo.mem->j12_alloc_small)
+      ((j12_common_ptr) &cinfo, JPOOL_PERMANENT, SIZEOF(chunk_source_mgr));
+    src->pub.j12_init_source = chunk_init_source;
+    src->pub.j12_fill_input_buffer = chunk_fill_input_buffer;
+    src->pub.j12_skip_input_data = chunk_skip_input_data;
+    src->pub.j12_resync_to_restart = jpeg12_j12_resync_to_restart;
+    src->pub.j12_term_source = chunk_term_source;
+    src->pub.bytes_in_buffer = 0;
+    src->pub.next_input_byte = NULL;
+    src->data = data;
+    src->size = size;
+    src->offset = 0;
+    cinfo.src = &src->pub;
+  } else
+    jpeg12_mem_src(&cinfo, (unsigned char *) data, size);
+  (void) jpeg12_read_header(&cinfo, TRUE);
+  cinfo.entropy_threads = threads;
+  coef_arrays = jpeg12_read_coefficients(&cinfo);
+
+  for (ci = 0, compptr = cinfo.comp_info; ci < cinfo.num_components;
+       ci++, compptr++)
+    total += (long) compptr->height_in_blocks * compptr->width_in_blocks;
+  ptr = coefs = (JCOEF *) alloc_or_die((size_t) total * SIZEOF(JBLOCK));
+  for (ci = 0, compptr = cinfo.comp_info; ci < cinfo.num_components;
+       ci++, compptr++) {
+    for (row = 0; row < compptr->height_in_blocks; row++) {
+      buffer = (*cinfo.mem->j12_access_virt_barray)
+	((j12_common_ptr) &cinfo, coef_arrays[ci], row, (JDIMENSION) 1, FALSE);
+      MEMCOPY(ptr, buffer[0], compptr->width_in_blocks * SIZEOF(JBLOCK));
+      ptr += compptr->width_in_blocks * DCTSIZE2;
+    }
+  }
+  jpeg12_destroy_decompress(&cinfo);
+  *num_blocks = total;
+  return coefs;
+}
+
+
+/*
+ * Transcode the test image (Huffman, optimized tables) into memory,
+ * sequential or progressive.  The caller frees *outbuffer.
+ */
+
+LOCAL(void)
+encode_coefficients (boolean progressive, unsigned char ** outbuffer,
+		     unsigned long * outsize)
+{
+  struct jpeg12_decompress_struct dinfo;
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr djerr, cjerr;
+  jvirt_barray_ptr * coef_arrays;
+
+  open_image(&dinfo, &djerr);
+  coef_arrays = jpeg12_read_coefficients(&dinfo);
+
+  cinfo.err = jpeg12_std_error(&cjerr);
+  jpeg12_create_compress(&cinfo);
+  jpeg12_copy_critical_parameters(&dinfo, &cinfo);
+  cinfo.optimize_coding = TRUE;
+  cinfo.arith_code = FALSE;
+  if (progressive)
+    jpeg12_simple_progression(&cinfo);
+  *outbuffer = NULL;
+  *outsize = 0;
+  jpeg12_mem_dest(&cinfo, outbuffer, outsize);
+  jpeg12_write_coefficients(&cinfo, coef_arrays);
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  jpeg12_destroy_decompress(&dinfo);
+}
+
+
+/* Compare two coefficient arrays and describe the outcome. */
+
+LOCAL(const char *)
+compare_coefficients (const JCOEF * a, long a_blocks,
+		      const JCOEF * b, long b_blocks)
+{
+  if (a_blocks == b_blocks &&
+      memcmp(a, b, (size_t) a_blocks * SIZEOF(JBLOCK)) == 0)
+    return "bit-exact";
+  failures++;
+  return "MISMATCH  FAILED";
+}
+
+
+/*
+ * Time decoding a datastream with the given settings, and check the
+ * coefficients against the reference ones.
+ */
+
+LOCAL(void)
+bench_decode (const char * kernel, const char * input,
+	      const JOCTET * data, unsigned long size,
+	      boolean chunked, int threads, const char * variant,
+	      const JCOEF * reference, long reference_blocks)
+{
+  JCOEF * coefs = NULL;
+  long num_blocks = 0;
+  double best = 0.0, start, elapsed;
+  const char * check;
+  int i;
+
+  for (i = 0; i < iterations; i++) {
+    free(coefs);
+    start = read_clock();
+    coefs = decode_coefficients(data, size, chunked, threads, &num_blocks);
+    elapsed = read_clock() - start;
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+  }
+  check = reference == NULL ? "reference" :
+    compare_coefficients(reference, reference_blocks, coefs, num_blocks);
+  report(kernel, input, variant, (double) size, "B", best, check);
+  free(coefs);
+}
+
+
+LOCAL(void)
+bench_entropy (void)
+{
+  JCOEF * reference, * coefs;
+  long reference_blocks, num_blocks;
+  unsigned char * encoded = NULL;
+  unsigned long encoded_size = 0;
+  double best, start, elapsed;
+  int i, progressive;
+
+  if (! selected("huffman"))
+    return;
+
+  /* The coefficients of the test image, decoded the plain way */
+  reference = decode_coefficients(image_data, image_size, TRUE, 0,
+				  &reference_blocks);
+
+  /* Sequential decoding: from memory, in chunks, and on 4 threads
+   * (the latter only applies without restart markers).
+   */
+  bench_decode("huffman_decode", "real", image_data, image_size,
+	       TRUE, 0, "chunk", (const JCOEF *) NULL, 0L);
+  bench_decode("huffman_decode", "real", image_data, image_size,
+	       FALSE, 0, "C", reference, reference_blocks);
+  bench_decode("huffman_decode", "real", image_data, image_size,
+	       FALSE, 4, "4thr", reference, reference_blocks);
+
+  for (progressive = 0; progressive <= 1; progressive++) {
+    /* Encoding: two passes, gathering statistics first */
+    best = 0.0;
+    for (i = 0; i < iterations; i++) {
+      free(encoded);
+      start = read_clock();
+      encode_coefficients((boolean) progressive, &encoded, &encoded_size);
+      elapsed = read_clock() - start;
+      if (i == 0 || elapsed < best)
+	best = elapsed;
+    }
+    coefs = decode_coefficients(encoded, encoded_size, FALSE, 0, &num_blocks);
+    report(progressive ? "huffman_encode_pr" : "huffman_encode", "real", "C",
+	   (double) encoded_size, "B", best,
+	   compare_coefficients(reference, reference_blocks,
+				coefs, num_blocks));
+    free(coefs);
+
+    if (progressive) {
+      /* In memory, refinement scans take the fast path; in small chunks,
+       * the suspending one.
+       */
+      bench_decode("huffman_decode_pr", "real", encoded, encoded_size,
+		   TRUE, 0, "chunk", reference, reference_blocks);
+      bench_decode("huffman_decode_pr", "real", encoded, encoded_size,
+		   FALSE, 0, "C", reference, reference_blocks);
+    }
+  }
+  free(encoded);
+  free(reference);
+}
+
+
+/************************ Upsampling and color ************************/
+
+/*
+ * The sample kernels are reached through the decompressor's own method
+ * pointers.  For each kernel we start a decompressor on a small image with
+ * the right color space and sampling while the vectorized kernels are
+ * masked off, which so installs the C code; then, for each instruction set
+ * that has a version of the kernel, one started under that set's mask.
+ * (A module picks its method once, at initialization, and falls back to
+ * the C code when the capability query says no, so changing the mask
+ * afterwards would not test anything else.)
+ */
+
+#define SAMPLE_WIDTH   1003	/* odd, to exercise the tails */
+#define SAMPLE_HEIGHT  64
+
+typedef struct {
+  const char * name;
+  J_COLOR_SPACE in_space;	/* color space of the samples to encode */
+  J_COLOR_SPACE jpeg_space;	/* JPEG color space */
+  J_COLOR_SPACE out_space;	/* requested output */
+  int h_samp, v_samp;		/* luma sampling factors */
+  boolean color_only;		/* call the color converter only */
+  boolean (*simd_usable) JPP((void)); /* its j12_simd_can_xxx() query */
+} sample_kernel;
+
+static const sample_kernel sample_kernels[] = {
+  { "upsample_h2v1", JCS_RGB, JCS_YCbCr, JCS_YCbCr, 2, 1, FALSE,
+    j12_simd_can_h2v1_upsample },
+  { "upsample_h2v2", JCS_RGB, JCS_YCbCr, JCS_YCbCr, 2, 2, FALSE,
+    j12_simd_can_h2v2_upsample },
+  { "merged_h2v1", JCS_RGB, JCS_YCbCr, JCS_RGB, 2, 1, FALSE,
+    j12_simd_can_h2v1_merged_upsample },
+  { "merged_h2v2", JCS_RGB, JCS_YCbCr, JCS_RGB, 2, 2, FALSE,
+    j12_simd_can_h2v2_merged_upsample },
+  { "color_ycc_rgb", JCS_RGB, JCS_YCbCr, JCS_RGB, 1, 1, TRUE,
+    j12_simd_can_ycc_rgb },
+  { "color_rgb1_rgb", JCS_RGB, JCS_RGB, JCS_RGB, 1, 1, TRUE,
+    j12_simd_can_rgb1_rgb },
+  { "color_ycck_cmyk", JCS_CMYK, JCS_YCCK, JCS_CMYK, 1, 1, TRUE,
+    j12_simd_can_ycck_cmyk },
+};
+
+#define NUM_SAMPLE_KERNELS \
+	((int) (SIZEOF(sample_kernels) / SIZEOF(sample_kernels[0])))
+
+
+/* Encode a blank image with the kernel's color space and sampling. */
+
+LOCAL(void)
+make_header (const sample_kernel * kernel, unsigned char ** outbuffer,
+	     unsigned long * outsize)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  JSAMPROW row;
+  int ci;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  *outbuffer = NULL;
+  *outsize = 0;
+  jpeg12_mem_dest(&cinfo, outbuffer, outsize);
+  cinfo.image_width = SAMPLE_WIDTH;
+  cinfo.image_height = SAMPLE_HEIGHT;
+  cinfo.input_components = kernel->in_space == JCS_CMYK ? 4 : 3;
+  cinfo.in_color_space = kernel->in_space;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_colorspace(&cinfo, kernel->jpeg_space);
+  if (kernel->jpeg_space == JCS_RGB)
+    cinfo.color_transform = JCT_SUBTRACT_GREEN;
+  for (ci = 0; ci < cinfo.num_components; ci++) {
+    cinfo.comp_info[ci].h_samp_factor = 1;	/* YCCK subsamples K too */
+    cinfo.comp_info[ci].v_samp_factor = 1;
+  }
+  cinfo.comp_info[0].h_samp_factor = kernel->h_samp;
+  cinfo.comp_info[0].v_samp_factor = kernel->v_samp;
+  jpeg12_start_compress(&cinfo, TRUE);
+  row = (JSAMPROW) alloc_or_die(SAMPLE_WIDTH * 4 * SIZEOF(JSAMPLE));
+  while (cinfo.next_scanline < cinfo.image_height)
+    (void) jpeg12_write_scanlines(&cinfo, &row, (JDIMENSION) 1);
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  free(row);
+}
+
+
+LOCAL(void)
+start_sample_kernel (j12_decompress_ptr cinfo, struct jpeg12_error_mgr * jerr,
+		     const sample_kernel * kernel, unsigned char * header,
+		     unsigned long header_size, unsigned int mask)
+{
+  cinfo->err = jpeg12_std_error(jerr);
+  jpeg12_create_decompress(cinfo);
+  jpeg12_mem_src(cinfo, header, header_size);
+  (void) jpeg12_read_header(cinfo, TRUE);
+  cinfo->out_color_space = kernel->out_space;
+  cinfo->do_fancy_upsampling = FALSE;
+  j12_simd_set_mask(mask);
+  jpeg12_start_decompress(cinfo);
+  j12_simd_set_mask(~0U);
+}
+
+
+/*
+ * Input samples for the kernels: per component, enough rows for the whole
+ * image at the component's size, padded on the right.
+ */
+
+LOCAL(JSAMPIMAGE)
+make_samples (j12_decompress_ptr cinfo, boolean smooth)
+{
+  JSAMPIMAGE image;
+  JDIMENSION rows, cols, x, y;
+  int ci;
+
+  image = (JSAMPIMAGE) alloc_or_die(cinfo->num_components * SIZEOF(JSAMPARRAY));
+  for (ci = 0; ci < cinfo->num_components; ci++) {
+    rows = (JDIMENSION) SAMPLE_HEIGHT * cinfo->comp_info[ci].v_samp_factor /
+	   cinfo->max_v_samp_factor;
+    cols = (JDIMENSION) SAMPLE_WIDTH * cinfo->comp_info[ci].h_samp_factor /
+	   cinfo->max_h_samp_factor + 64;
+    image[ci] = (JSAMPARRAY) alloc_or_die(rows * SIZEOF(JSAMPROW));
+    for (y = 0; y < rows; y++) {
+      image[ci][y] = (JSAMPROW) alloc_or_die(cols * SIZEOF(JSAMPLE));
+      for (x = 0; x < cols; x++) {
+	if (smooth)
+	  image[ci][y][x] = (JSAMPLE) ((x * 4 + y * 16 + ci * 1000 +
+				       random_range(8) + 8) % (MAXJSAMPLE + 1));
+	else
+	  image[ci][y][x] = (JSAMPLE)
+	    (CENTERJSAMPLE + random_range(CENTERJSAMPLE - 1));
+      }
+    }
+  }
+  return image;
+}
+
+
+LOCAL(void)
+free_samples (j12_decompress_ptr cinfo, JSAMPIMAGE image)
+{
+  JDIMENSION rows, y;
+  int ci;
+
+  for (ci = 0; ci < cinfo->num_components; ci++) {
+    rows = (JDIMENSION) SAMPLE_HEIGHT * cinfo->comp_info[ci].v_samp_factor /
+	   cinfo->max_v_samp_factor;
+    for (y = 0; y < rows; y++)
+      free(image[ci][y]);
+    free(image[ci]);
+  }
+  free(image);
+}
+
+
+/* Run the kernel over the whole image once, into output. */
+
+LOCAL(void)
+run_sample_kernel (j12_decompress_ptr cinfo, const sample_kernel * kernel,
+		   JSAMPIMAGE input, JSAMPARRAY output)
+{
+  JDIMENSION in_row_group_ctr = 0, out_row_ctr = 0;
+
+  if (kernel->color_only) {
+    (*cinfo->cconvert->j12_color_convert) (cinfo, input, (JDIMENSION) 0,
+					   output, SAMPLE_HEIGHT);
+    return;
+  }
+  (*cinfo->j12_upsample->j12_start_pass) (cinfo);
+  while (out_row_ctr < SAMPLE_HEIGHT)
+    (*cinfo->j12_upsample->j12_upsample) (cinfo, input, &in_row_group_ctr,
+				      (JDIMENSION) SAMPLE_HEIGHT /
+				      cinfo->max_v_samp_factor,
+				      output, &out_row_ctr,
+				      (JDIMENSION) SAMPLE_HEIGHT);
+}
+
+
+LOCAL(double)
+time_sample_kernel (j12_decompress_ptr cinfo, const sample_kernel * kernel,
+		    JSAMPIMAGE input, JSAMPARRAY output)
+{
+  double best = 0.0, start, elapsed;
+  int i;
+
+  for (i = 0; i < iterations; i++) {
+    start = read_clock();
+    run_sample_kernel(cinfo, kernel, input, output);
+    elapsed = read_clock() - start;
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+
+LOCAL(void)
+bench_sample_kernel (const sample_kernel * kernel, boolean smooth)
+{
+  static const struct {
+    const char * name;
+    unsigned int mask;
+  } simd_sets[] = {
+    { "SSE2", JSIMD_SSE2 }, { "AVX2", JSIMD_AVX2 }, { "NEON", JSIMD_NEON }
+  };
+  struct jpeg12_decompress_struct c_info, simd_info;
+  struct jpeg12_error_mgr c_err, simd_err;
+  unsigned char * header;
+  unsigned long header_size;
+  JSAMPIMAGE input;
+  JSAMPARRAY c_output, simd_output;
+  const char * input_name = smooth ? "smooth" : "random";
+  size_t row_bytes;
+  double seconds;
+  boolean usable;
+  int s;
+  JDIMENSION y;
+
+  make_header(kernel, &header, &header_size);
+  start_sample_kernel(&c_info, &c_err, kernel, header, header_size, 0U);
+
+  input = make_samples(&c_info, smooth);
+  c_output = (*c_info.mem->j12_alloc_sarray)
+    ((j12_common_ptr) &c_info, JPOOL_IMAGE,
+     (JDIMENSION) (SAMPLE_WIDTH + 64) * 4, (JDIMENSION) SAMPLE_HEIGHT);
+  row_bytes = (size_t) c_info.output_width * c_info.out_color_components *
+	      SIZEOF(JSAMPLE);
+
+  seconds = time_sample_kernel(&c_info, kernel, input, c_output);
+  report(kernel->name, input_name, "C",
+	 (double) SAMPLE_WIDTH * SAMPLE_HEIGHT, "px", seconds, "reference");
+
+  for (s = 0; s < (int) (SIZEOF(simd_sets) / SIZEOF(simd_sets[0])); s++) {
+    if ((j12_simd_available() & simd_sets[s].mask) == 0)
+      continue;
+    j12_simd_set_mask(simd_sets[s].mask);
+    usable = (*kernel->simd_usable) ();
+    j12_simd_set_mask(~0U);
+    if (! usable) {
+      /* The decompressor would run the C code again */
+      report(kernel->name, input_name, simd_sets[s].name, 0.0, "px", 0.0,
+	     "n/a (no kernel for this set)");
+      continue;
+    }
+
+    start_sample_kernel(&simd_info, &simd_err, kernel, header, header_size,
+			simd_sets[s].mask);
+    simd_output = (*simd_info.mem->j12_alloc_sarray)
+      ((j12_common_ptr) &simd_info, JPOOL_IMAGE,
+       (JDIMENSION) (SAMPLE_WIDTH + 64) * 4, (JDIMENSION) SAMPLE_HEIGHT);
+    for (y = 0; y < SAMPLE_HEIGHT; y++)
+      MEMZERO(simd_output[y], row_bytes);
+    j12_simd_set_mask(simd_sets[s].mask);
+    seconds = time_sample_kernel(&simd_info, kernel, input, simd_output);
+    j12_simd_set_mask(~0U);
+    for (y = 0; y < SAMPLE_HEIGHT; y++)
+      if (memcmp(c_output[y], simd_output[y], row_bytes) != 0)
+	break;
+    if (y < SAMPLE_HEIGHT)
+      failures++;
+    report(kernel->name, input_name, simd_sets[s].name,
+	   (double) SAMPLE_WIDTH * SAMPLE_HEIGHT, "px", seconds,
+	   y < SAMPLE_HEIGHT ? "MISMATCH  FAILED" : "bit-exact");
+    jpeg12_destroy_decompress(&simd_info);
+  }
+
+  free_samples(&c_info, input);
+  jpeg12_destroy_decompress(&c_info);
+  free(header);
+}
+
+
+LOCAL(void)
+bench_samples (void)
+{
+  int k;
+
+  for (k = 0; k < NUM_SAMPLE_KERNELS; k++) {
+    if (! selected(sample_kernels[k].name))
+      continue;
+    bench_sample_kernel(&sample_kernels[k], TRUE);
+    bench_sample_kernel(&sample_kernels[k], FALSE);
+  }
+}
+
+
+int
+main (int argc, char **argv)
+{
+  progname = argv[0];
+  if (progname == NULL || progname[0] == 0)
+    progname = "jpeg12kernels";	/* in case C library doesn't provide it */
+
+  parse_switches(argc, argv);
+  load_image();
+  load_real_input();
+
+  bench_dcts();
+  bench_entropy();
+  bench_samples();
+
+  free(real_blocks);
+  free(real_samples);
+  free(image_data);
+
+  if (failures > 0) {
+    fprintf(stderr, "%s: %d check(s) failed\n", progname, failures);
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+  return 0;			/* suppress no-return-value warnings */
+}
@@ -208,6 +208,12 @@ default_decompress_parms (j12_decompress_ptr cinfo)
   cinfo->enable_1pass_quant = FALSE;
   cinfo->enable_external_quant = FALSE;
   cinfo->enable_2pass_quant = FALSE;
+  /* Full-range window, in case application only sets window_output. */
+  cinfo->window_output = FALSE;
+  cinfo->window_min = 0;
+  cinfo->window_max = MAXJSAMPLE;
+  cinfo->voi_lut = NULL;
+  cinfo->entropy_threads = 0;
 }
 
 
@@ -296,6 +302,8 @@ jpeg12_j12_consume_input (j12_decompress_ptr cinfo)
     (*cinfo->inputctl->j12_reset_input_controller) (cinfo);
     /* Initialize application's data source module */
     (*cinfo->src->j12_init_source) (cinfo);
+    TIMING_START(cinfo);
+    TIMING_TRACE(cinfo, JTRACE_HEADER, TRUE);
     cinfo->global_state = DSTATE_INHEADER;
     /*FALLTHROUGH*/
   case DSTATE_INHEADER:
@@ -306,6 +314,8 @@ jpeg12_j12_consume_input (j12_decompress_ptr cinfo)
       /* Set global state: ready for start_decompress */
       cinfo->global_state = DSTATE_READY;
     }
+    if (retcode != JPEG12_SUSPENDED)
+      TIMING_TRACE(cinfo, JTRACE_HEADER, FALSE);
     break;
   case DSTATE_READY:
     /* Can't advance past first SOS until start_decompress is called */
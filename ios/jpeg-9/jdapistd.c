@@ -172,6 +172,7 @@ jpeg12_read_scanlines (j12_decompress_ptr cinfo, JSAMPARRAY scanlines,
   row_ctr = 0;
   (*cinfo->main->j12_process_data) (cinfo, scanlines, &row_ctr, max_lines);
   cinfo->output_scanline += row_ctr;
+  TIMING_COUNT(cinfo, output_rows, row_ctr);
   return row_ctr;
 }
 
@@ -67,9 +67,11 @@ get_byte (j12_decompress_ptr cinfo)
 {
   struct jpeg12_source_mgr * src = cinfo->src;
 
-  if (src->bytes_in_buffer == 0)
+  if (src->bytes_in_buffer == 0) {
     if (! (*src->j12_fill_input_buffer) (cinfo))
       ERREXIT(cinfo, JERR_CANT_SUSPEND);
+    TIMING_FILLED(cinfo);
+  }
   src->bytes_in_buffer--;
   return GETJOCTET(*src->next_input_byte++);
 }
@@ -8,6 +8,9 @@
  *
  * This file contains decompression data source routines for the case of
  * reading JPEG data from memory or from a file (or any stdio stream).
+ * The memory may also be a list of segments, for data that comes in
+ * fragments (e.g. DICOM encapsulated pixel data); the segments are read one
+ * after the other, so nothing needs to be copied to make them contiguous.
  * While these routines are sufficient for most applications,
  * some will want to use a different source manager.
  * IMPORTANT: we assume that fread() will correctly transcribe an array of
@@ -36,6 +39,22 @@ typedef my_source_mgr * my_src_ptr;
 #define INPUT_BUF_SIZE  4096	/* choose an efficiently fread'able size */
 
 
+/* Expanded data source object for segmented memory input.
+ * jpeg12_mem_src allocates objects of this size as well, so that the same
+ * JPEG object can be switched between the two memory sources.
+ */
+
+typedef struct {
+  struct jpeg12_source_mgr pub;	/* public fields */
+
+  const jpeg12_segment * segments; /* the segments */
+  int num_segments;
+  int next_segment;		/* index of the segment to read next */
+} my_segment_mgr;
+
+typedef my_segment_mgr * my_segment_ptr;
+
+
 /*
  * Initialize source --- called by jpeg12_read_header
  * before any data is actually read.
@@ -139,6 +158,29 @@ fill_mem_input_buffer (j12_decompress_ptr cinfo)
   return TRUE;
 }
 
+METHODDEF(boolean)
+fill_segment_input_buffer (j12_decompress_ptr cinfo)
+{
+  my_segment_ptr src = (my_segment_ptr) cinfo->src;
+  const jpeg12_segment * segment;
+
+  /* Go on with the next segment that isn't empty.  Markers and entropy-
+   * coded data may straddle segments: the decoder reads them byte by byte
+   * across buffer reloads anyway.
+   */
+  while (src->next_segment < src->num_segments) {
+    segment = &src->segments[src->next_segment++];
+    if (segment->size > 0) {
+      src->pub.next_input_byte = segment->data;
+      src->pub.bytes_in_buffer = (size_t) segment->size;
+      return TRUE;
+    }
+  }
+
+  /* Past the last segment: same as past the end of a single buffer */
+  return fill_mem_input_buffer(cinfo);
+}
+
 
 /*
  * Skip data --- used to skip over a potentially large amount of
@@ -175,6 +217,30 @@ j12_skip_input_data (j12_decompress_ptr cinfo, long num_bytes)
 }
 
 
+METHODDEF(void)
+skip_segment_input_data (j12_decompress_ptr cinfo, long num_bytes)
+{
+  my_segment_ptr src = (my_segment_ptr) cinfo->src;
+
+  /* Whole segments are passed over without looking at them.  A skip
+   * beyond the last segment leaves the buffer empty, so that the next read
+   * gets the fake EOI marker (once).
+   */
+  if (num_bytes > 0) {
+    while (num_bytes > (long) src->pub.bytes_in_buffer) {
+      num_bytes -= (long) src->pub.bytes_in_buffer;
+      if (src->next_segment >= src->num_segments) {
+	src->pub.bytes_in_buffer = 0;
+	return;
+      }
+      (void) fill_segment_input_buffer(cinfo);
+    }
+    src->pub.next_input_byte += (size_t) num_bytes;
+    src->pub.bytes_in_buffer -= (size_t) num_bytes;
+  }
+}
+
+
 /*
  * An additional method that can be provided by data source modules is the
  * j12_resync_to_restart method for error recovery in the presence of RST markers.
@@ -256,12 +322,12 @@ jpeg12_mem_src (j12_decompress_ptr cinfo,
 
   /* The source object is made permanent so that a series of JPEG images
    * can be read from the same buffer by calling jpeg12_mem_src only before
-   * the first one.
+   * the first one.  It is big enough for jpeg12_segments_src to reuse.
    */
   if (cinfo->src == NULL) {	/* first time for this JPEG object? */
     cinfo->src = (struct jpeg12_source_mgr *)
       (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_PERMANENT,
-				  SIZEOF(struct jpeg12_source_mgr));
+				  SIZEOF(my_segment_mgr));
   }
 
   src = cinfo->src;
@@ -273,3 +339,47 @@ jpeg12_mem_src (j12_decompress_ptr cinfo,
   src->bytes_in_buffer = (size_t) insize;
   src->next_input_byte = (JOCTET *) inbuffer;
 }
+
+
+/*
+ * Prepare for input from num_segments memory segments, read in order as
+ * if they were one buffer.  The segments (and the array describing them)
+ * must stay valid until decompression is finished.  Empty segments are
+ * allowed, but not all of them may be empty.
+ *
+ * Some parts of the library can work faster if the whole datastream is in
+ * one buffer (see jdscans.c); with segments they work the normal way.
+ */
+
+GLOBAL(void)
+jpeg12_segments_src (j12_decompress_ptr cinfo,
+		     const jpeg12_segment * segments, int num_segments)
+{
+  my_segment_ptr src;
+  unsigned long insize = 0;
+  int i;
+
+  for (i = 0; segments != NULL && i < num_segments; i++)
+    insize += segments[i].size;
+  if (insize == 0)		/* Treat empty input as fatal error */
+    ERREXIT(cinfo, JERR_INPUT_EMPTY);
+
+  /* As for jpeg12_mem_src, the source object is made permanent */
+  if (cinfo->src == NULL) {	/* first time for this JPEG object? */
+    cinfo->src = (struct jpeg12_source_mgr *)
+      (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(my_segment_mgr));
+  }
+
+  src = (my_segment_ptr) cinfo->src;
+  src->pub.j12_init_source = init_mem_source;
+  src->pub.j12_fill_input_buffer = fill_segment_input_buffer;
+  src->pub.j12_skip_input_data = skip_segment_input_data;
+  src->pub.j12_resync_to_restart = jpeg12_j12_resync_to_restart; /* use default method */
+  src->pub.j12_term_source = j12_term_source;
+  src->segments = segments;
+  src->num_segments = num_segments;
+  src->next_segment = 0;
+  src->pub.bytes_in_buffer = 0; /* forces a fill on first read */
+  src->pub.next_input_byte = NULL; /* until buffer loaded */
+}
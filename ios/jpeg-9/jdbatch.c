@@ -0,0 +1,1035 @@
+/*
+ * jdbatch.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains an application interface routine that decodes a batch
+ * of independent images (typically the slices of a CT or MR series) on a
+ * bounded set of worker threads.
+ *
+ * Each worker owns one decompression object and reuses it for every image
+ * it takes from the batch.  Errors are caught per image with setjmp/longjmp
+ * (see example.c), so a broken image only fails its own item.
+ *
+ * jpeg12_decode_volume() uses the same machinery to decode the slices of a
+ * series straight into their places in one contiguous volume.
+ *
+ * A decode that is no longer wanted (the user has scrolled on to another
+ * slice) can be cancelled through the progress monitor hook: the monitor
+ * of jpeg12_cancel_monitor() checks a flag that the application may set
+ * from any thread, and errors out when it is set.  The decoder calls the
+ * monitor once per iMCU row, so the work in vain is a row at most.
+ * A negative flag pauses the decode at the monitor instead, keeping its
+ * state, until jpeg12_set_cancel_flag() resumes or cancels it; so lower
+ * priority work can give way without being thrown away.
+ *
+ * An item can name a plane file (jdpcache.c).  If the file is there, the
+ * image is copied from it without decoding anything; otherwise the image
+ * is decoded and the file written for next time.
+ *
+ * A cine (jpeg12_create_cine()) plays the frames of a multi-frame series
+ * in a loop.  Its workers stay up for the life of the cine and decode the
+ * frames ahead of the application into a ring of planes allocated once.
+ * They keep at most one ring ahead of the frame the application asks for
+ * next, so decoding proceeds at the pace the frames are played.
+ *
+ * If the system has no POSIX threads (HAVE_PTHREAD_H not defined in
+ * jconfig.h), the batch is simply decoded on the calling thread, and so
+ * is each frame of a cine when it is asked for.  A pause is then ignored.
+ */
+
+/* this is not a core library module, so it doesn't define JPEG12_INTERNALS */
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jerror.h"
+#include <setjmp.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+#define MAX_BATCH_THREADS	64	/* upper limit on workers per batch */
+
+
+/* Error manager that returns control to the worker */
+
+typedef struct {
+  struct jpeg12_error_mgr pub;	/* "public" fields */
+  jmp_buf setjmp_buffer;	/* for return to caller */
+} my_error_mgr;
+
+typedef my_error_mgr * my_error_ptr;
+
+
+/* State shared by the workers of one batch */
+
+typedef struct {
+  jpeg12_batch_item * items;
+  int num_items;
+  int num_threads;
+  int next_item;		/* next item to hand out */
+  int num_failed;
+  jpeg12_batch_done done;	/* completion callback, or NULL */
+  void * context;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;		/* protects next_item and num_failed */
+#endif
+} batch_state;
+
+
+METHODDEF(noreturn_t)
+batch_error_exit (j12_common_ptr cinfo)
+{
+  my_error_ptr myerr = (my_error_ptr) cinfo->err;
+
+  longjmp(myerr->setjmp_buffer, 1);
+}
+
+
+METHODDEF(void)
+batch_output_message (j12_common_ptr cinfo)
+{
+  /* Warnings are not reported; errors end up in the item's message */
+}
+
+
+/*
+ * Cancellation.  Paused decodes of all flags wait on one condition, which
+ * is signalled whenever a flag is changed through jpeg12_set_cancel_flag().
+ */
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t pause_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pause_changed = PTHREAD_COND_INITIALIZER;
+#endif
+
+
+METHODDEF(void)
+cancel_monitor (j12_common_ptr cinfo)
+{
+  jpeg12_cancel_mgr * mgr = (jpeg12_cancel_mgr *) cinfo->progress;
+
+#ifdef HAVE_PTHREAD_H
+  if (*mgr->cancel < 0) {
+    pthread_mutex_lock(&pause_lock);
+    while (*mgr->cancel < 0)
+      pthread_cond_wait(&pause_changed, &pause_lock);
+    pthread_mutex_unlock(&pause_lock);
+  }
+#endif
+  if (*mgr->cancel > 0)
+    ERREXIT(cinfo, JERR_CANCELLED);
+}
+
+
+GLOBAL(void)
+jpeg12_cancel_monitor (j12_common_ptr cinfo, jpeg12_cancel_mgr * mgr,
+		       volatile int * cancel)
+{
+  MEMZERO(mgr, SIZEOF(jpeg12_cancel_mgr));
+  mgr->pub.j12_progress_monitor = cancel_monitor;
+  mgr->cancel = cancel;
+  cinfo->progress = &mgr->pub;
+}
+
+
+GLOBAL(void)
+jpeg12_set_cancel_flag (volatile int * cancel, int value)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock(&pause_lock);
+  *cancel = value;
+  pthread_cond_broadcast(&pause_changed);
+  pthread_mutex_unlock(&pause_lock);
+#else
+  *cancel = value;
+#endif
+}
+
+
+/*
+ * Copy rows of samples, through lut if it is not NULL.  src and dest may
+ * be the same.
+ */
+
+LOCAL(void)
+copy_rows (const JSAMPLE * src, JDIMENSION src_stride, JSAMPROW dest,
+	   JDIMENSION dest_stride, JDIMENSION width, JDIMENSION height,
+	   const UINT16 * lut)
+{
+  UINT16 * outptr;
+  JDIMENSION x, y;
+
+  for (y = 0; y < height; y++) {
+    if (lut == NULL) {
+      if (src != dest)
+	MEMCOPY(dest, src, width * SIZEOF(JSAMPLE));
+    } else {
+      outptr = (UINT16 *) dest;
+      for (x = 0; x < width; x++)
+	outptr[x] = lut[GETJSAMPLE(src[x])];
+    }
+    src += src_stride;
+    dest += dest_stride;
+  }
+}
+
+
+/*
+ * Take the image of an item from its plane file.  Returns FALSE if there
+ * is no usable file, or the image doesn't fit the item; decoding it then
+ * does the rest, including reporting any error.
+ */
+
+LOCAL(boolean)
+read_plane_file (jpeg12_batch_item * item, const jpeg12_source_id * id,
+		 const UINT16 * lut)
+{
+  jpeg12_plane_file file;
+  JDIMENSION width, height, row_stride;
+  unsigned long needed;
+
+  if (! jpeg12_map_plane_file(item->cache_file, id, &file))
+    return FALSE;
+  width = file.width[0];
+  height = file.height[0];
+  row_stride = item->row_stride != 0 ? item->row_stride : width;
+  needed = (unsigned long) row_stride * height;
+  if ((item->plane_width != 0 && item->plane_width != width) ||
+      (item->plane_height != 0 && item->plane_height != height) ||
+      row_stride < width ||
+      (item->plane != NULL && item->plane_samples < needed)) {
+    jpeg12_unmap_plane_file(&file);
+    return FALSE;
+  }
+  if (item->plane == NULL) {
+    item->plane = (JSAMPROW) malloc(needed * SIZEOF(JSAMPLE));
+    if (item->plane == NULL) {
+      jpeg12_unmap_plane_file(&file);
+      return FALSE;
+    }
+  }
+
+  copy_rows(file.plane[0], width, item->plane, row_stride, width, height,
+	    lut);
+  if (item->stats != NULL)
+    jpeg12_plane_file_stats(&file, item->stats);
+  item->output_width = width;
+  item->output_height = height;
+  item->output_components = 1;
+  jpeg12_unmap_plane_file(&file);
+  return TRUE;
+}
+
+
+/*
+ * Decode one item with the worker's decompression object.
+ */
+
+LOCAL(void)
+decode_item (j12_decompress_ptr cinfo, jpeg12_batch_item * item)
+{
+  my_error_ptr myerr = (my_error_ptr) cinfo->err;
+  JSAMPROW volatile allocated = NULL;
+  JDIMENSION row_stride, num_samples;
+  unsigned long needed;
+  UINT16 lut[MAXJSAMPLE+1];
+  const UINT16 * map;
+  jpeg12_cancel_mgr canceller;
+  jpeg12_segment whole;
+  jpeg12_source_id id;
+  boolean write_file;
+
+  item->status = 0;
+  item->message[0] = '\0';
+  item->output_width = 0;
+  item->output_height = 0;
+  item->output_components = 0;
+
+  if (setjmp(myerr->setjmp_buffer)) {
+    item->status = myerr->pub.msg_code;
+    (*myerr->pub.j12_format_message) ((j12_common_ptr) cinfo, item->message);
+    jpeg12_abort_decompress(cinfo);
+    cinfo->progress = NULL;
+    if (allocated != NULL) {
+      free(allocated);
+      item->plane = NULL;
+    }
+    return;
+  }
+
+  /* The monitor lives on our stack, so it is removed again below */
+  cinfo->progress = NULL;
+  if (item->cancel != NULL) {
+    jpeg12_cancel_monitor((j12_common_ptr) cinfo, &canceller, item->cancel);
+    cancel_monitor((j12_common_ptr) cinfo); /* don't even start if too late */
+  }
+
+  map = NULL;
+  if (item->rescale) {
+    jpeg12_build_rescale_lut(lut, item->slope, item->intercept);
+    map = lut;
+  }
+  if (item->cache_file != NULL) {
+    if (item->num_segments > 0)
+      jpeg12_identify_source(&id, item->segments, item->num_segments);
+    else {
+      whole.data = item->data;
+      whole.size = item->size;
+      jpeg12_identify_source(&id, &whole, 1);
+    }
+    if (read_plane_file(item, &id, map)) {
+      cinfo->progress = NULL;
+      return;
+    }
+  }
+
+  if (item->num_segments > 0)
+    jpeg12_segments_src(cinfo, item->segments, item->num_segments);
+  else
+    jpeg12_mem_src(cinfo, (unsigned char *) item->data, item->size);
+  (void) jpeg12_read_header(cinfo, TRUE);
+  (void) jpeg12_start_decompress(cinfo);
+
+  item->output_width = cinfo->output_width;
+  item->output_height = cinfo->output_height;
+  item->output_components = cinfo->output_components;
+
+  num_samples = cinfo->output_width * (JDIMENSION) cinfo->output_components;
+  if ((item->plane_width != 0 && item->plane_width != num_samples) ||
+      (item->plane_height != 0 && item->plane_height != cinfo->output_height))
+    ERREXIT4(cinfo, JERR_BAD_PLANE_SIZE, (int) num_samples,
+	     (int) cinfo->output_height, (int) item->plane_width,
+	     (int) item->plane_height);
+
+  row_stride = item->row_stride;
+  if (row_stride == 0)
+    row_stride = num_samples;
+  needed = (unsigned long) row_stride * cinfo->output_height;
+
+  if (item->plane == NULL) {
+    allocated = (JSAMPROW) malloc(needed * SIZEOF(JSAMPLE));
+    if (allocated == NULL)
+      ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 10);
+    item->plane = allocated;
+  } else if (item->plane_samples < needed)
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+
+  /* The file gets the samples before rescaling, which is done afterwards */
+  write_file = (item->cache_file != NULL && cinfo->output_components == 1);
+  if (jpeg12_read_plane_mapped(cinfo, item->plane, row_stride, item->stats,
+			       write_file ? (const UINT16 *) NULL : map) !=
+      cinfo->output_height)
+    ERREXIT(cinfo, JERR_INPUT_EMPTY);
+  (void) jpeg12_finish_decompress(cinfo);
+  cinfo->progress = NULL;
+
+  if (write_file) {
+    (void) jpeg12_write_plane_file(item->cache_file, &id, item->plane,
+				   row_stride, num_samples, cinfo->output_height,
+				   item->cache_levels > 0 ?
+				   item->cache_levels : 1);
+    if (map != NULL)
+      copy_rows(item->plane, row_stride, item->plane, row_stride,
+		num_samples, cinfo->output_height, map);
+  }
+}
+
+
+/*
+ * Worker body: take items until none are left.
+ */
+
+LOCAL(void)
+run_worker (batch_state * batch)
+{
+  struct jpeg12_decompress_struct cinfo;
+  my_error_mgr jerr;
+  int index;
+
+  cinfo.err = jpeg12_std_error(&jerr.pub);
+  jerr.pub.j12_error_exit = batch_error_exit;
+  jerr.pub.j12_output_message = batch_output_message;
+  if (setjmp(jerr.setjmp_buffer)) {
+    /* Could not even create the object; leave the items to other workers */
+    return;
+  }
+  jpeg12_create_decompress(&cinfo);
+
+  for (;;) {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&batch->lock);
+#endif
+    index = batch->next_item++;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&batch->lock);
+#endif
+    if (index >= batch->num_items)
+      break;
+    decode_item(&cinfo, &batch->items[index]);
+    if (batch->items[index].status != 0) {
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock(&batch->lock);
+#endif
+      batch->num_failed++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock(&batch->lock);
+#endif
+    }
+  }
+
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+LOCAL(void *)
+worker_thread (void * arg)
+{
+  run_worker((batch_state *) arg);
+  return NULL;
+}
+
+#endif
+
+
+/*
+ * Run a whole batch: start the extra workers, work on the calling thread
+ * as well, and wait for the others.
+ */
+
+LOCAL(int)
+run_batch (batch_state * batch)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_t threads[MAX_BATCH_THREADS];
+  int i, started = 0;
+
+  for (i = 1; i < batch->num_threads; i++) {
+    if (pthread_create(&threads[started], NULL, worker_thread, batch) != 0)
+      break;			/* go on with fewer workers */
+    started++;
+  }
+  run_worker(batch);
+  for (i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+#else
+  run_worker(batch);
+#endif
+  /* Items nobody could take (only if decoders could not be created) */
+  if (batch->next_item < batch->num_items)
+    batch->num_failed += batch->num_items - batch->next_item;
+  return batch->num_failed;
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+LOCAL(void *)
+batch_thread (void * arg)
+{
+  batch_state * batch = (batch_state *) arg;
+
+  run_batch(batch);
+  (*batch->done) (batch->context, batch->items, batch->num_items,
+		  batch->num_failed);
+  pthread_mutex_destroy(&batch->lock);
+  free(batch);
+  return NULL;
+}
+
+#endif
+
+
+/*
+ * Decode num_items independent images using up to num_threads threads
+ * (0 or less = one per CPU).
+ *
+ * For each item, the application supplies the compressed data (in one
+ * buffer, or in segments as for jpeg12_segments_src()) and either a plane
+ * of plane_samples samples to decode into, or NULL, in which case a plane
+ * is allocated with malloc() (release it with free()).  row_stride
+ * is in samples; 0 means rows are packed.  If stats is not NULL, sample
+ * statistics are added to it.  On return, status is 0 for each image that
+ * was decoded, or else the error's message code, with its text in message.
+ * If plane_width or plane_height is nonzero, an image of any other size
+ * (in samples per row and rows) fails with JERR_BAD_PLANE_SIZE.  If rescale
+ * is TRUE, the plane receives UINT16 values as described for
+ * jpeg12_build_rescale_lut(); statistics still count the decoded samples.
+ *
+ * If done is NULL, the batch is decoded before returning, and the result
+ * is the number of failed items.  Otherwise the function returns 0 at once
+ * (or -1 if no thread could be started), and done is called from a worker
+ * thread when the whole batch is finished.  The items must stay valid
+ * until then.
+ */
+
+GLOBAL(int)
+jpeg12_decode_batch (jpeg12_batch_item * items, int num_items,
+		     int num_threads, jpeg12_batch_done done, void * context)
+{
+  batch_state * batch;
+  int result;
+
+  if (num_threads <= 0) {
+#if defined(HAVE_PTHREAD_H) && defined(_SC_NPROCESSORS_ONLN)
+    num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (num_threads <= 0)
+      num_threads = 1;
+  }
+  if (num_threads > MAX_BATCH_THREADS)
+    num_threads = MAX_BATCH_THREADS;
+  if (num_threads > num_items)
+    num_threads = num_items;
+
+  batch = (batch_state *) malloc(SIZEOF(batch_state));
+  if (batch == NULL)
+    return -1;
+  batch->items = items;
+  batch->num_items = num_items;
+  batch->num_threads = num_threads;
+  batch->next_item = 0;
+  batch->num_failed = 0;
+  batch->done = done;
+  batch->context = context;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&batch->lock, NULL);
+
+  if (done != NULL) {
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, batch_thread, batch) != 0) {
+      pthread_mutex_destroy(&batch->lock);
+      free(batch);
+      return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+  }
+#endif
+
+  result = run_batch(batch);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&batch->lock);
+#endif
+  free(batch);
+  if (done != NULL) {		/* no threads: call back synchronously */
+    (*done) (context, items, num_items, result);
+    result = 0;
+  }
+  return result;
+}
+
+
+/*
+ * Decode the depth slices of a series into volume, which holds depth
+ * slices of height rows of width samples each, slice z starting at
+ * volume + z * width * height.  Every scanline is written straight to its
+ * final place; there is no per-slice buffer.
+ *
+ * The application fills in data and size for each of the depth items, and
+ * optionally stats and the rescale fields (e.g. from the slice's DICOM
+ * Rescale Slope and Intercept).  The plane fields are set here.  Slices
+ * whose size is not width x height single-component samples fail without
+ * touching the rest of the volume.  Without rescaling, the volume receives
+ * the plain 12-bit samples.
+ *
+ * Returns the number of failed slices, as jpeg12_decode_batch() does.
+ */
+
+GLOBAL(int)
+jpeg12_decode_volume (jpeg12_batch_item * items, int depth, UINT16 * volume,
+		      JDIMENSION width, JDIMENSION height, int num_threads)
+{
+  unsigned long slice_samples = (unsigned long) width * height;
+  int z;
+
+  if (SIZEOF(UINT16) != SIZEOF(JSAMPLE))
+    return depth;		/* samples can't be stored in place */
+
+  for (z = 0; z < depth; z++) {
+    items[z].plane = (JSAMPROW) (volume + (size_t) z * slice_samples);
+    items[z].plane_samples = slice_samples;
+    items[z].row_stride = width;
+    items[z].plane_width = width;
+    items[z].plane_height = height;
+  }
+  return jpeg12_decode_batch(items, depth, num_threads,
+			     (jpeg12_batch_done) NULL, (void *) NULL);
+}
+
+
+/*
+ * Cine loops.
+ *
+ * Frames are played in an endless sequence, sequence number s showing
+ * frame s % num_frames.  Each slot of the ring holds the plane of one
+ * sequence number.  A slot goes from free to decoding (a worker has it) to
+ * ready, is lent to the application by jpeg12_cine_acquire(), and is free
+ * again after jpeg12_cine_release().  Ready frames the application has
+ * passed by are dropped, and decodes of such frames are cancelled.
+ */
+
+#define SLOT_FREE	0
+#define SLOT_DECODING	1
+#define SLOT_READY	2
+#define SLOT_LENT	3
+
+typedef struct {
+  int state;
+  long sequence;		/* sequence number held, if not free */
+  volatile int cancel;		/* set when the frame is no longer wanted */
+  jpeg12_batch_item item;	/* decode of the frame, into the slot plane */
+  jpeg12_plane_stats stats;	/* statistics of the frame */
+} cine_slot;
+
+struct jpeg12_cine_struct {
+  const JOCTET ** data;		/* compressed frames */
+  unsigned long * sizes;
+  int num_frames;
+  JDIMENSION width;		/* samples per row of every frame */
+  JDIMENSION height;		/* rows of every frame */
+  int ring_size;
+  cine_slot * slots;
+  JSAMPROW planes;		/* ring_size planes of width x height */
+  long wanted;			/* sequence the application wants next */
+  long next_sequence;		/* next candidate for decoding */
+  jpeg12_cine_stats stats;
+  struct jpeg12_decompress_struct cinfo; /* decoder of the calling thread */
+  my_error_mgr jerr;
+  int num_threads;		/* workers running */
+#ifdef HAVE_PTHREAD_H
+  boolean stopping;		/* tells the workers to quit */
+  pthread_t threads[MAX_BATCH_THREADS];
+  pthread_mutex_t lock;		/* protects everything but the planes */
+  pthread_cond_t changed;	/* signalled whenever there may be work */
+#endif
+};
+
+
+#ifdef HAVE_PTHREAD_H
+#define LOCK_CINE(cine)		pthread_mutex_lock(&(cine)->lock)
+#define UNLOCK_CINE(cine)	pthread_mutex_unlock(&(cine)->lock)
+#else
+#define LOCK_CINE(cine)
+#define UNLOCK_CINE(cine)
+#endif
+
+
+/*
+ * Find the slot holding a sequence number, leaving out decodes being
+ * cancelled.  Caller holds the lock.
+ */
+
+LOCAL(cine_slot *)
+find_slot (jpeg12_cine * cine, long sequence)
+{
+  int i;
+
+  for (i = 0; i < cine->ring_size; i++) {
+    if (cine->slots[i].state != SLOT_FREE && ! cine->slots[i].cancel &&
+	cine->slots[i].sequence == sequence)
+      return &cine->slots[i];
+  }
+  return NULL;
+}
+
+
+/*
+ * Take a free slot for the next frame to decode, if there is a free slot
+ * and the frame is less than a ring ahead of the application.  Caller
+ * holds the lock.
+ */
+
+LOCAL(cine_slot *)
+claim_slot (jpeg12_cine * cine)
+{
+  cine_slot * slot = NULL;
+  long limit = cine->wanted + cine->ring_size;
+  int i;
+
+  for (i = 0; i < cine->ring_size; i++) {
+    if (cine->slots[i].state == SLOT_FREE) {
+      slot = &cine->slots[i];
+      break;
+    }
+  }
+  if (slot == NULL)
+    return NULL;
+  while (cine->next_sequence < limit &&
+	 find_slot(cine, cine->next_sequence) != NULL)
+    cine->next_sequence++;	/* decoded or being decoded already */
+  if (cine->next_sequence >= limit)
+    return NULL;
+
+  slot->state = SLOT_DECODING;
+  slot->sequence = cine->next_sequence++;
+  slot->cancel = 0;
+  return slot;
+}
+
+
+/*
+ * Decode the frame of a claimed slot.  Called without the lock: nobody
+ * else touches a decoding slot, except to set its cancel flag.
+ */
+
+LOCAL(void)
+decode_slot (j12_decompress_ptr cinfo, jpeg12_cine * cine, cine_slot * slot)
+{
+  jpeg12_batch_item * item = &slot->item;
+  int frame = (int) (slot->sequence % cine->num_frames);
+
+  item->data = cine->data[frame];
+  item->size = cine->sizes[frame];
+  jpeg12_init_plane_stats(&slot->stats);
+  decode_item(cinfo, item);
+}
+
+
+/*
+ * Put a decoded slot on offer, or free it again if the application has
+ * moved on meanwhile.  Caller holds the lock.
+ */
+
+LOCAL(void)
+finish_slot (jpeg12_cine * cine, cine_slot * slot)
+{
+  if (slot->cancel) {
+    slot->state = SLOT_FREE;
+    cine->stats.frames_discarded++;
+    return;
+  }
+  slot->state = SLOT_READY;
+  cine->stats.frames_decoded++;
+  if (slot->item.status != 0)
+    cine->stats.frames_failed++;
+}
+
+
+/*
+ * Make sequence the one the application wants next: drop the frames
+ * outside the ring's worth from there on, and have the workers go on from
+ * it (claim_slot() passes over the frames they already have).  Caller
+ * holds the lock.
+ */
+
+LOCAL(void)
+set_position (jpeg12_cine * cine, long sequence)
+{
+  cine_slot * slot;
+  int i;
+
+  if (sequence == cine->wanted)
+    return;
+  cine->wanted = sequence;
+  for (i = 0; i < cine->ring_size; i++) {
+    slot = &cine->slots[i];
+    if (slot->sequence >= sequence &&
+	slot->sequence < sequence + cine->ring_size)
+      continue;
+    if (slot->state == SLOT_READY) {
+      slot->state = SLOT_FREE;
+      cine->stats.frames_discarded++;
+    } else if (slot->state == SLOT_DECODING)
+      slot->cancel = 1;		/* counted when the worker is done */
+  }
+  cine->next_sequence = sequence;
+#ifdef HAVE_PTHREAD_H
+  pthread_cond_broadcast(&cine->changed);
+#endif
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+/*
+ * Worker body: decode frames while there is room ahead, sleep otherwise.
+ */
+
+LOCAL(void *)
+cine_thread (void * arg)
+{
+  jpeg12_cine * cine = (jpeg12_cine *) arg;
+  struct jpeg12_decompress_struct cinfo;
+  my_error_mgr jerr;
+  cine_slot * slot;
+
+  cinfo.err = jpeg12_std_error(&jerr.pub);
+  jerr.pub.j12_error_exit = batch_error_exit;
+  jerr.pub.j12_output_message = batch_output_message;
+  if (setjmp(jerr.setjmp_buffer))
+    return NULL;		/* could not create the object; others will do */
+  jpeg12_create_decompress(&cinfo);
+
+  LOCK_CINE(cine);
+  while (! cine->stopping) {
+    slot = claim_slot(cine);
+    if (slot == NULL) {
+      pthread_cond_wait(&cine->changed, &cine->lock);
+      continue;
+    }
+    UNLOCK_CINE(cine);
+    decode_slot(&cinfo, cine, slot);
+    LOCK_CINE(cine);
+    finish_slot(cine, slot);
+  }
+  UNLOCK_CINE(cine);
+
+  jpeg12_destroy_decompress(&cinfo);
+  return NULL;
+}
+
+#endif
+
+
+/*
+ * Create a cine over num_frames compressed frames, which must stay valid
+ * until jpeg12_destroy_cine().  Every frame must have the dimensions of the
+ * first, which are stored in *width (samples per row) and *height; frames
+ * that don't fail with JERR_BAD_PLANE_SIZE.  ring_size frames (at least 2)
+ * are decoded ahead on up to num_threads workers (0 or less = one per
+ * CPU, but no more than ring_size - 1, so one slot can be lent while the
+ * others are being filled).  Returns NULL if the first frame can't be read
+ * or memory is short.
+ */
+
+GLOBAL(jpeg12_cine *)
+jpeg12_create_cine (const JOCTET * const * data, const unsigned long * sizes,
+		    int num_frames, int ring_size, int num_threads,
+		    JDIMENSION * width, JDIMENSION * height)
+{
+  jpeg12_cine * cine;
+  jpeg12_batch_item * item;
+  unsigned long plane_samples;
+  int i;
+
+  if (num_frames <= 0)
+    return NULL;
+  if (ring_size < 2)
+    ring_size = 2;
+
+  cine = (jpeg12_cine *) malloc(SIZEOF(jpeg12_cine));
+  if (cine == NULL)
+    return NULL;
+  MEMZERO(cine, SIZEOF(jpeg12_cine));
+
+  /* Size the ring from the first frame */
+  cine->cinfo.err = jpeg12_std_error(&cine->jerr.pub);
+  cine->jerr.pub.j12_error_exit = batch_error_exit;
+  cine->jerr.pub.j12_output_message = batch_output_message;
+  if (setjmp(cine->jerr.setjmp_buffer)) {
+    jpeg12_destroy_decompress(&cine->cinfo);
+    free(cine);
+    return NULL;
+  }
+  jpeg12_create_decompress(&cine->cinfo);
+  jpeg12_mem_src(&cine->cinfo, (unsigned char *) data[0], sizes[0]);
+  (void) jpeg12_read_header(&cine->cinfo, TRUE);
+  jpeg12_calc_output_dimensions(&cine->cinfo);
+  cine->width = cine->cinfo.output_width *
+		(JDIMENSION) cine->cinfo.output_components;
+  cine->height = cine->cinfo.output_height;
+  jpeg12_abort_decompress(&cine->cinfo);
+
+  plane_samples = (unsigned long) cine->width * cine->height;
+  cine->data = (const JOCTET **) malloc(num_frames * SIZEOF(JOCTET *));
+  cine->sizes = (unsigned long *) malloc(num_frames * SIZEOF(unsigned long));
+  cine->slots = (cine_slot *) malloc(ring_size * SIZEOF(cine_slot));
+  cine->planes = (JSAMPROW) malloc((size_t) ring_size * plane_samples *
+				   SIZEOF(JSAMPLE));
+  if (cine->data == NULL || cine->sizes == NULL || cine->slots == NULL ||
+      cine->planes == NULL) {
+    free((void *) cine->data);
+    free(cine->sizes);
+    free(cine->slots);
+    free(cine->planes);
+    jpeg12_destroy_decompress(&cine->cinfo);
+    free(cine);
+    return NULL;
+  }
+  for (i = 0; i < num_frames; i++) {
+    cine->data[i] = data[i];
+    cine->sizes[i] = sizes[i];
+  }
+  cine->num_frames = num_frames;
+  cine->ring_size = ring_size;
+
+  MEMZERO(cine->slots, ring_size * SIZEOF(cine_slot));
+  for (i = 0; i < ring_size; i++) {
+    cine->slots[i].state = SLOT_FREE;
+    cine->slots[i].sequence = -1;
+    item = &cine->slots[i].item;
+    item->plane = cine->planes + (size_t) i * plane_samples;
+    item->plane_samples = plane_samples;
+    item->row_stride = cine->width;
+    item->plane_width = cine->width;
+    item->plane_height = cine->height;
+    item->stats = &cine->slots[i].stats;
+    item->cancel = &cine->slots[i].cancel;
+  }
+  cine->wanted = 0;
+  cine->next_sequence = 0;
+
+#ifdef HAVE_PTHREAD_H
+  if (num_threads <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (num_threads <= 0)
+      num_threads = 1;
+  }
+  if (num_threads > ring_size - 1)
+    num_threads = ring_size - 1;
+  if (num_threads > MAX_BATCH_THREADS)
+    num_threads = MAX_BATCH_THREADS;
+
+  pthread_mutex_init(&cine->lock, NULL);
+  pthread_cond_init(&cine->changed, NULL);
+  for (i = 0; i < num_threads; i++) {
+    if (pthread_create(&cine->threads[cine->num_threads], NULL, cine_thread,
+		       cine) != 0)
+      break;			/* go on with fewer workers */
+    cine->num_threads++;
+  }
+#endif
+
+  *width = cine->width;
+  *height = cine->height;
+  return cine;
+}
+
+
+/*
+ * Lend the frame of a sequence number to the application, which must give
+ * it back with jpeg12_cine_release() before asking for another.  Asking for
+ * a sequence number also tells the cine where playback is: frames before
+ * it (and a ring or more after it) are dropped, and decoding goes on from
+ * there.  Returns FALSE if the frame is not decoded yet; with no workers,
+ * it is then decoded on the spot.
+ *
+ * A frame that could not be decoded is lent all the same, with its error
+ * in status and message; its plane is then undefined.
+ */
+
+GLOBAL(boolean)
+jpeg12_cine_acquire (jpeg12_cine * cine, long sequence,
+		     jpeg12_cine_frame * frame)
+{
+  cine_slot * slot;
+
+  if (sequence < 0)
+    return FALSE;
+  LOCK_CINE(cine);
+  set_position(cine, sequence);
+  slot = find_slot(cine, sequence);
+  if (slot == NULL && cine->num_threads == 0) {
+    slot = claim_slot(cine);
+    if (slot != NULL) {
+      decode_slot(&cine->cinfo, cine, slot);
+      finish_slot(cine, slot);
+    }
+  }
+  if (slot == NULL || slot->state != SLOT_READY) {
+    UNLOCK_CINE(cine);
+    return FALSE;
+  }
+  slot->state = SLOT_LENT;
+  UNLOCK_CINE(cine);
+
+  frame->sequence = sequence;
+  frame->frame = (int) (sequence % cine->num_frames);
+  frame->slot = (int) (slot - cine->slots);
+  frame->plane = slot->item.plane;
+  frame->width = cine->width;
+  frame->height = cine->height;
+  frame->min_value = slot->stats.min_value;
+  frame->max_value = slot->stats.max_value;
+  frame->status = slot->item.status;
+  frame->message = slot->item.message;
+  return TRUE;
+}
+
+
+/*
+ * Give back a frame lent by jpeg12_cine_acquire().  The application is
+ * taken to want the following frame next.
+ */
+
+GLOBAL(void)
+jpeg12_cine_release (jpeg12_cine * cine, jpeg12_cine_frame * frame)
+{
+  cine_slot * slot = &cine->slots[frame->slot];
+
+  LOCK_CINE(cine);
+  slot->state = SLOT_FREE;
+  if (cine->wanted <= slot->sequence)
+    cine->wanted = slot->sequence + 1;
+  slot->sequence = -1;
+#ifdef HAVE_PTHREAD_H
+  pthread_cond_broadcast(&cine->changed);
+#endif
+  UNLOCK_CINE(cine);
+  frame->plane = NULL;
+}
+
+
+/*
+ * Move playback to a sequence number without taking a frame, e.g. to have
+ * the frames after a jump decoded while the last one is still shown.
+ */
+
+GLOBAL(void)
+jpeg12_cine_seek (jpeg12_cine * cine, long sequence)
+{
+  if (sequence < 0)
+    return;
+  LOCK_CINE(cine);
+  set_position(cine, sequence);
+  UNLOCK_CINE(cine);
+}
+
+
+GLOBAL(void)
+jpeg12_cine_get_stats (jpeg12_cine * cine, jpeg12_cine_stats * stats)
+{
+  LOCK_CINE(cine);
+  *stats = cine->stats;
+  UNLOCK_CINE(cine);
+}
+
+
+/*
+ * Stop the workers and free everything.  No frame may be lent.
+ */
+
+GLOBAL(void)
+jpeg12_destroy_cine (jpeg12_cine * cine)
+{
+#ifdef HAVE_PTHREAD_H
+  int i;
+
+  LOCK_CINE(cine);
+  cine->stopping = TRUE;
+  for (i = 0; i < cine->ring_size; i++)
+    cine->slots[i].cancel = 1;
+  pthread_cond_broadcast(&cine->changed);
+  UNLOCK_CINE(cine);
+  for (i = 0; i < cine->num_threads; i++)
+    pthread_join(cine->threads[i], NULL);
+  pthread_cond_destroy(&cine->changed);
+  pthread_mutex_destroy(&cine->lock);
+#endif
+  jpeg12_destroy_decompress(&cine->cinfo);
+  free((void *) cine->data);
+  free(cine->sizes);
+  free(cine->slots);
+  free(cine->planes);
+  free(cine);
+}
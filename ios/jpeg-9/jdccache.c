@@ -0,0 +1,559 @@
+/*
+ * jdccache.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains application interface routines that keep the
+ * entropy-decoded coefficients of grayscale images, and decode them again
+ * at any scale or crop without running the entropy decoder.  A viewer that
+ * zooms or pans only pays for the IDCT of the blocks in view.
+ *
+ * jpeg12_save_coefficients() copies the coefficient arrays read by
+ * jpeg12_read_coefficients() into storage that outlives the decompression
+ * object.  In compact form, only the coefficients up to the last nonzero
+ * one in zigzag order are kept for each block, which usually shrinks the
+ * data considerably.  jpeg12_read_coef_image() then feeds the blocks
+ * covering a region to the IDCT of the requested size in jidctint.c, so
+ * the result is the same as that of a full decode with scale_num = scale,
+ * scale_denom = 8 (and the default JDCT_ISLOW method), cropped.
+ *
+ * A jpeg12_coef_cache holds such images under a byte budget, evicting the
+ * least recently used ones.  Images are reference counted, so an image in
+ * use is not freed when it is evicted.  The cache may be shared between
+ * threads (if HAVE_PTHREAD_H is defined in jconfig.h).
+ */
+
+#define JPEG12_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+#define MAX_SCALE	16	/* largest IDCT output block size */
+
+
+struct jpeg12_coef_cache_struct {
+  unsigned long max_bytes;	/* budget */
+  unsigned long bytes;		/* held by the cached images */
+  jpeg12_coef_image * head;	/* most recently used image */
+  jpeg12_coef_image * tail;	/* least recently used image */
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;		/* protects everything, incl. ref counts */
+#endif
+};
+
+
+#ifdef HAVE_PTHREAD_H
+#define LOCK_CACHE(cache)	pthread_mutex_lock(&(cache)->lock)
+#define UNLOCK_CACHE(cache)	pthread_mutex_unlock(&(cache)->lock)
+#else
+#define LOCK_CACHE(cache)
+#define UNLOCK_CACHE(cache)
+#endif
+
+
+/* IDCT for each output block size (index = size - 1) */
+
+static const inverse_DCT_method_ptr idct_methods[MAX_SCALE] = {
+  jpeg12_idct_1x1, jpeg12_idct_2x2, jpeg12_idct_3x3, jpeg12_idct_4x4,
+  jpeg12_idct_5x5, jpeg12_idct_6x6, jpeg12_idct_7x7, jpeg12_idct_islow,
+  jpeg12_idct_9x9, jpeg12_idct_10x10, jpeg12_idct_11x11, jpeg12_idct_12x12,
+  jpeg12_idct_13x13, jpeg12_idct_14x14, jpeg12_idct_15x15, jpeg12_idct_16x16
+};
+
+
+LOCAL(void)
+free_coef_image (jpeg12_coef_image * image)
+{
+  if (image->coefs != NULL)
+    free(image->coefs);
+  if (image->row_start != NULL)
+    free(image->row_start);
+  if (image->counts != NULL)
+    free(image->counts);
+  free(image);
+}
+
+
+/*
+ * Number of coefficients to keep of a block in compact form:
+ * up to and including the last nonzero one in zigzag order.
+ */
+
+LOCAL(int)
+coefs_needed (JCOEFPTR block)
+{
+  int k;
+
+  for (k = DCTSIZE2 - 1; k > 0; k--) {
+    if (block[jpeg12_natural_order[k]] != 0)
+      break;
+  }
+  return k + 1;			/* the DC term is always kept */
+}
+
+
+/*
+ * Read the whole image and return a copy of its coefficients, with a
+ * reference count of 1 (see jpeg12_release_coef_image).
+ * Call after jpeg12_read_header(), in place of jpeg12_start_decompress(),
+ * and finish with jpeg12_finish_decompress() or jpeg12_abort_decompress();
+ * the returned image does not depend on the decompression object.
+ * Only single-component (grayscale) images are supported.
+ * Returns NULL if the data source suspended; call again to resume.
+ */
+
+GLOBAL(jpeg12_coef_image *)
+jpeg12_save_coefficients (j12_decompress_ptr cinfo, boolean compact)
+{
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  jpeg12_coef_image * image;
+  JBLOCKARRAY buffer;
+  JBLOCKROW block;
+  JCOEFPTR outptr;
+  JDIMENSION blk_x, blk_y, by;
+  unsigned long num_blocks, num_coefs;
+  UINT8 * countptr;
+  int i, k, n, row, pass;
+
+  if (cinfo->num_components != 1)
+    ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+
+  coef_arrays = jpeg12_read_coefficients(cinfo);
+  if (coef_arrays == NULL)
+    return NULL;		/* suspended */
+
+  compptr = cinfo->comp_info;
+  if (compptr->quant_table == NULL)
+    ERREXIT1(cinfo, JERR_NO_QUANT_TABLE, compptr->quant_tbl_no);
+
+  image = (jpeg12_coef_image *) malloc(SIZEOF(jpeg12_coef_image));
+  if (image == NULL)
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 11);
+  MEMZERO(image, SIZEOF(jpeg12_coef_image));
+  image->image_width = cinfo->image_width;
+  image->image_height = cinfo->image_height;
+  image->width_in_blocks = compptr->width_in_blocks;
+  image->height_in_blocks = compptr->height_in_blocks;
+  image->compact = compact;
+  image->ref_count = 1;
+  for (i = 0; i < DCTSIZE2; i++)
+    image->quantval[i] = compptr->quant_table->quantval[i];
+
+  num_blocks = (unsigned long) image->width_in_blocks *
+	       image->height_in_blocks;
+  num_coefs = num_blocks * DCTSIZE2;
+  if (compact) {
+    image->row_start = (unsigned long *)
+      malloc(image->height_in_blocks * SIZEOF(unsigned long));
+    image->counts = (UINT8 *) malloc(num_blocks * SIZEOF(UINT8));
+    if (image->row_start == NULL || image->counts == NULL) {
+      free_coef_image(image);
+      ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 11);
+    }
+  }
+
+  /* In compact form, the first pass sizes the data and the second one
+   * copies it; otherwise the blocks are copied in one pass.
+   */
+  for (pass = compact ? 0 : 1; pass < 2; pass++) {
+    if (pass == 1) {
+      image->coefs = (JCOEF *) malloc(num_coefs * SIZEOF(JCOEF));
+      if (image->coefs == NULL) {
+	free_coef_image(image);
+	ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 11);
+      }
+    }
+    outptr = image->coefs;
+    countptr = image->counts;
+    num_coefs = 0;
+    for (blk_y = 0; blk_y < compptr->height_in_blocks;
+	 blk_y += (JDIMENSION) compptr->v_samp_factor) {
+      buffer = (*cinfo->mem->j12_access_virt_barray)
+	((j12_common_ptr) cinfo, coef_arrays[0], blk_y,
+	 (JDIMENSION) compptr->v_samp_factor, FALSE);
+      for (row = 0; row < compptr->v_samp_factor; row++) {
+	by = blk_y + (JDIMENSION) row;
+	if (by >= compptr->height_in_blocks)
+	  break;
+	block = buffer[row];
+	if (! compact) {
+	  MEMCOPY(outptr, block[0],
+		  compptr->width_in_blocks * SIZEOF(JBLOCK));
+	  outptr += (size_t) compptr->width_in_blocks * DCTSIZE2;
+	  continue;
+	}
+	image->row_start[by] = num_coefs;
+	for (blk_x = 0; blk_x < compptr->width_in_blocks; blk_x++) {
+	  if (pass == 0) {
+	    n = coefs_needed(block[blk_x]);
+	    *countptr++ = (UINT8) n;
+	  } else {
+	    n = *countptr++;
+	    for (k = 0; k < n; k++)
+	      *outptr++ = block[blk_x][jpeg12_natural_order[k]];
+	  }
+	  num_coefs += (unsigned long) n;
+	}
+      }
+    }
+  }
+
+  image->bytes = SIZEOF(jpeg12_coef_image) +
+		 (compact ? num_coefs : num_blocks * DCTSIZE2) * SIZEOF(JCOEF);
+  if (compact)
+    image->bytes += image->height_in_blocks * SIZEOF(unsigned long) +
+		    num_blocks * SIZEOF(UINT8);
+  return image;
+}
+
+
+/*
+ * Drop a reference to an image, freeing it with the last one.
+ */
+
+GLOBAL(void)
+jpeg12_release_coef_image (jpeg12_coef_image * image)
+{
+  jpeg12_coef_cache * cache = image->cache;
+  int remaining;
+
+  if (cache != NULL)
+    LOCK_CACHE(cache);
+  remaining = --image->ref_count;
+  if (cache != NULL)
+    UNLOCK_CACHE(cache);
+  if (remaining == 0)
+    free_coef_image(image);
+}
+
+
+/*
+ * Decode the region of width x height samples at (x, y) of the image
+ * scaled by scale/8 (scale = 1..16) into plane, whose rows are row_stride
+ * samples apart (0 = packed rows).  The scaled image is
+ * ceil(image_width * scale / 8) x ceil(image_height * scale / 8) samples,
+ * and the region must lie within it.  If stats is not NULL, the samples
+ * are added to it.
+ *
+ * cinfo must be a decompression object that is not in use (freshly
+ * created, or finished or aborted); only its error handler and memory
+ * manager are used.  Several threads can decode from the same image, each
+ * with its own decompression object.
+ */
+
+GLOBAL(void)
+jpeg12_read_coef_image (j12_decompress_ptr cinfo, jpeg12_coef_image * image,
+			int scale, JDIMENSION x, JDIMENSION y,
+			JDIMENSION width, JDIMENSION height,
+			JSAMPROW plane, JDIMENSION row_stride,
+			jpeg12_plane_stats * stats)
+{
+  inverse_DCT_method_ptr idct;
+  jpeg12_component_info comp;
+  ISLOW_MULT_TYPE multipliers[DCTSIZE2];
+  JBLOCK expanded;
+  JSAMPLE scratch_buf[MAX_SCALE][MAX_SCALE];
+  JSAMPROW scratch[MAX_SCALE], rows[MAX_SCALE];
+  JCOEFPTR block, inptr;
+  JSAMPROW outptr;
+  UINT8 * countptr;
+  boolean full_rows;
+  JDIMENSION bx, by, bx0, bx1, by0, by1;
+  JDIMENSION out_x, out_y, x0, x1, y0, y1;
+  long scaled_width, scaled_height;
+  int i, k, n;
+
+  if (cinfo->global_state != DSTATE_START)
+    ERREXIT1(cinfo, JERR_BAD_STATE, cinfo->global_state);
+  if (scale < 1 || scale > MAX_SCALE)
+    ERREXIT2(cinfo, JERR_BAD_DCTSIZE, scale, scale);
+
+  scaled_width = j12_div_round_up((long) image->image_width * scale,
+				  (long) DCTSIZE);
+  scaled_height = j12_div_round_up((long) image->image_height * scale,
+				   (long) DCTSIZE);
+  if (width == 0 || height == 0 ||
+      (long) x + (long) width > scaled_width ||
+      (long) y + (long) height > scaled_height)
+    ERREXIT(cinfo, JERR_BAD_CROP_SPEC);
+  if (row_stride == 0)
+    row_stride = width;
+  else if (row_stride < width)
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+
+  /* Set up what the IDCT routines look at */
+  idct = idct_methods[scale - 1];
+  for (i = 0; i < DCTSIZE2; i++)
+    multipliers[i] = (ISLOW_MULT_TYPE) image->quantval[i];
+  MEMZERO(&comp, SIZEOF(comp));
+  comp.dct_table = (void *) multipliers;
+  j12_prepare_idct_range_limit(cinfo);
+  for (i = 0; i < MAX_SCALE; i++)
+    scratch[i] = scratch_buf[i];
+
+  /* Blocks covering the region */
+  bx0 = x / (JDIMENSION) scale;
+  bx1 = (x + width - 1) / (JDIMENSION) scale;
+  by0 = y / (JDIMENSION) scale;
+  by1 = (y + height - 1) / (JDIMENSION) scale;
+
+  for (by = by0; by <= by1; by++) {
+    out_y = by * (JDIMENSION) scale;
+    y0 = out_y < y ? y : out_y;
+    y1 = out_y + (JDIMENSION) scale;
+    if (y1 > y + height)
+      y1 = y + height;
+    full_rows = (y0 == out_y && y1 - y0 == (JDIMENSION) scale);
+    if (full_rows) {
+      for (i = 0; i < scale; i++)
+	rows[i] = plane + (size_t) (out_y - y + (JDIMENSION) i) * row_stride;
+    }
+
+    if (image->compact) {
+      /* Walk the row's variable-length blocks up to the first one needed */
+      countptr = image->counts + (size_t) by * image->width_in_blocks;
+      inptr = image->coefs + image->row_start[by];
+      for (bx = 0; bx < bx0; bx++)
+	inptr += *countptr++;
+    } else {
+      countptr = NULL;
+      inptr = image->coefs +
+	      ((size_t) by * image->width_in_blocks + bx0) * DCTSIZE2;
+    }
+
+    for (bx = bx0; bx <= bx1; bx++) {
+      if (countptr != NULL) {
+	n = *countptr++;
+	MEMZERO(expanded, SIZEOF(JBLOCK));
+	for (k = 0; k < n; k++)
+	  expanded[jpeg12_natural_order[k]] = *inptr++;
+	block = expanded;
+      } else {
+	block = inptr;
+	inptr += DCTSIZE2;
+      }
+
+      out_x = bx * (JDIMENSION) scale;
+      x0 = out_x < x ? x : out_x;
+      x1 = out_x + (JDIMENSION) scale;
+      if (x1 > x + width)
+	x1 = x + width;
+      if (full_rows && x0 == out_x && x1 - x0 == (JDIMENSION) scale) {
+	/* Block lies entirely inside the region: decode in place */
+	(*idct) (cinfo, &comp, block, rows, out_x - x);
+      } else {
+	/* Edge block: decode into scratch, keep the part inside */
+	(*idct) (cinfo, &comp, block, scratch, (JDIMENSION) 0);
+	outptr = plane + (size_t) (y0 - y) * row_stride + (x0 - x);
+	for (i = (int) (y0 - out_y); i < (int) (y1 - out_y); i++) {
+	  MEMCOPY(outptr, scratch[i] + (x0 - out_x),
+		  (x1 - x0) * SIZEOF(JSAMPLE));
+	  outptr += row_stride;
+	}
+      }
+    }
+
+    if (stats != NULL)
+      jpeg12_count_plane_rows(stats, plane + (size_t) (y0 - y) * row_stride,
+			      row_stride, width, (int) (y1 - y0));
+  }
+
+  /* Release the range limit table */
+  (*cinfo->mem->j12_free_pool) ((j12_common_ptr) cinfo, JPOOL_IMAGE);
+}
+
+
+/*
+ * Create a cache that holds images of up to max_bytes in total.
+ * Returns NULL if out of memory.
+ */
+
+GLOBAL(jpeg12_coef_cache *)
+jpeg12_create_coef_cache (unsigned long max_bytes)
+{
+  jpeg12_coef_cache * cache;
+
+  cache = (jpeg12_coef_cache *) malloc(SIZEOF(jpeg12_coef_cache));
+  if (cache == NULL)
+    return NULL;
+  cache->max_bytes = max_bytes;
+  cache->bytes = 0;
+  cache->head = NULL;
+  cache->tail = NULL;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&cache->lock, NULL);
+#endif
+  return cache;
+}
+
+
+/*
+ * Unlink an image from the LRU list.  Caller holds the lock.
+ */
+
+LOCAL(void)
+unlink_image (jpeg12_coef_cache * cache, jpeg12_coef_image * image)
+{
+  if (image->prev != NULL)
+    image->prev->next = image->next;
+  else
+    cache->head = image->next;
+  if (image->next != NULL)
+    image->next->prev = image->prev;
+  else
+    cache->tail = image->prev;
+  image->prev = NULL;
+  image->next = NULL;
+}
+
+
+/*
+ * Link an image in as the most recently used one.  Caller holds the lock.
+ */
+
+LOCAL(void)
+link_image (jpeg12_coef_cache * cache, jpeg12_coef_image * image)
+{
+  image->prev = NULL;
+  image->next = cache->head;
+  if (cache->head != NULL)
+    cache->head->prev = image;
+  else
+    cache->tail = image;
+  cache->head = image;
+}
+
+
+LOCAL(boolean)
+is_cached (jpeg12_coef_cache * cache, jpeg12_coef_image * image)
+{
+  return image->cache == cache &&
+	 (image->prev != NULL || cache->head == image);
+}
+
+
+/*
+ * Remove an image from the cache and drop the cache's reference to it.
+ * Caller holds the lock.
+ */
+
+LOCAL(void)
+evict_image (jpeg12_coef_cache * cache, jpeg12_coef_image * image)
+{
+  unlink_image(cache, image);
+  cache->bytes -= image->bytes;
+  if (--image->ref_count == 0)
+    free_coef_image(image);
+}
+
+
+/*
+ * Destroy a cache and the images in it.  Every image that was looked up
+ * in or inserted into the cache must have been released before this.
+ */
+
+GLOBAL(void)
+jpeg12_destroy_coef_cache (jpeg12_coef_cache * cache)
+{
+  while (cache->head != NULL)
+    evict_image(cache, cache->head);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&cache->lock);
+#endif
+  free(cache);
+}
+
+
+/*
+ * Look up the image stored under key.  Returns NULL if there is none;
+ * otherwise the image gains a reference, which the caller must release.
+ * If id is not NULL, an image stored under key counts only if it was
+ * inserted with the same source id (see jpeg12_identify_source()), so a
+ * key that is not unique cannot return the wrong image; with id = NULL,
+ * the caller must make sure that each key stands for one image.
+ * The cache is searched linearly; it is meant to hold a modest number of
+ * large images.
+ */
+
+GLOBAL(jpeg12_coef_image *)
+jpeg12_coef_cache_lookup (jpeg12_coef_cache * cache, jpeg12_coef_key key,
+			  const jpeg12_source_id * id)
+{
+  jpeg12_coef_image * image;
+
+  LOCK_CACHE(cache);
+  for (image = cache->head; image != NULL; image = image->next) {
+    if (image->key == key)
+      break;
+  }
+  if (image != NULL && id != NULL &&
+      (image->source.size != id->size ||
+       memcmp(image->source.digest, id->digest, JPEG12_DIGEST_SIZE) != 0))
+    image = NULL;		/* same key, other data */
+  if (image != NULL) {
+    if (image != cache->head) {
+      unlink_image(cache, image);
+      link_image(cache, image);
+    }
+    image->ref_count++;
+  }
+  UNLOCK_CACHE(cache);
+  return image;
+}
+
+
+/*
+ * Store image under key, replacing any image stored under the same key,
+ * and evict the least recently used images until the cache is within its
+ * budget.  id identifies the data the image was decoded from, for lookups
+ * to check; it may be NULL, and then only lookups without an id find the
+ * image.  The cache takes a reference of its own; the caller keeps its
+ * reference.  Returns FALSE (and leaves the cache alone) if the image is
+ * larger than the whole budget or belongs to another cache.
+ */
+
+GLOBAL(boolean)
+jpeg12_coef_cache_insert (jpeg12_coef_cache * cache, jpeg12_coef_key key,
+			  const jpeg12_source_id * id,
+			  jpeg12_coef_image * image)
+{
+  jpeg12_coef_image * other;
+
+  if (image->bytes > cache->max_bytes ||
+      (image->cache != NULL && image->cache != cache))
+    return FALSE;
+
+  LOCK_CACHE(cache);
+  if (is_cached(cache, image)) {
+    /* Already in: just move it to the front under its new key */
+    unlink_image(cache, image);
+  } else {
+    image->cache = cache;
+    image->ref_count++;
+    cache->bytes += image->bytes;
+  }
+  for (other = cache->head; other != NULL; other = other->next) {
+    if (other->key == key) {
+      evict_image(cache, other);
+      break;
+    }
+  }
+  image->key = key;
+  if (id != NULL)
+    image->source = *id;
+  else				/* matches no id, not even an empty input's */
+    MEMZERO(&image->source, SIZEOF(jpeg12_source_id));
+  link_image(cache, image);
+  while (cache->bytes > cache->max_bytes && cache->tail != image)
+    evict_image(cache, cache->tail);
+  UNLOCK_CACHE(cache);
+  return TRUE;
+}
@@ -157,6 +157,9 @@ decompress_onepass (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
   jpeg12_component_info *compptr;
   inverse_DCT_method_ptr inverse_DCT;
 
+  /* Entropy decoding and IDCT alternate for each MCU */
+  TIMING_BEGIN(cinfo, JTIME_ENTROPY);
+
   /* Loop to process as much as one whole iMCU row */
   for (yoffset = coef->MCU_vert_offset; yoffset < coef->MCU_rows_per_iMCU_row;
        yoffset++) {
@@ -170,8 +173,12 @@ decompress_onepass (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
 	/* Suspension forced; update state counters and exit */
 	coef->MCU_vert_offset = yoffset;
 	coef->MCU_ctr = MCU_col_num;
+	TIMING_END(cinfo);
 	return JPEG12_SUSPENDED;
       }
+      TIMING_COUNT(cinfo, MCUs, 1);
+      TIMING_COUNT(cinfo, blocks, cinfo->blocks_in_MCU);
+      TIMING_SWITCH(cinfo, JTIME_IDCT);
       /* Determine where data should go in output_buf and do the IDCT thing.
        * We skip dummy blocks at the right and bottom edges (but blkn gets
        * incremented past them!).  Note the inner loop relies on having
@@ -201,15 +208,18 @@ decompress_onepass (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
 			      output_ptr, output_col);
 	      output_col += compptr->DCT_h_scaled_size;
 	    }
+	    TIMING_COUNT(cinfo, idct_blocks, useful_width);
 	  }
 	  blkn += compptr->MCU_width;
 	  output_ptr += compptr->DCT_v_scaled_size;
 	}
       }
+      TIMING_SWITCH(cinfo, JTIME_ENTROPY);
     }
     /* Completed an MCU row, but perhaps not an iMCU row */
     coef->MCU_ctr = 0;
   }
+  TIMING_END(cinfo);
   /* Completed the iMCU row, advance counters for next one */
   cinfo->output_iMCU_row++;
   if (++(cinfo->input_iMCU_row) < cinfo->total_iMCU_rows) {
@@ -266,6 +276,8 @@ j12_consume_data (j12_decompress_ptr cinfo)
      */
   }
 
+  TIMING_BEGIN(cinfo, JTIME_ENTROPY);
+
   /* Loop to process one whole iMCU row */
   for (yoffset = coef->MCU_vert_offset; yoffset < coef->MCU_rows_per_iMCU_row;
        yoffset++) {
@@ -288,12 +300,16 @@ j12_consume_data (j12_decompress_ptr cinfo)
 	/* Suspension forced; update state counters and exit */
 	coef->MCU_vert_offset = yoffset;
 	coef->MCU_ctr = MCU_col_num;
+	TIMING_END(cinfo);
 	return JPEG12_SUSPENDED;
       }
+      TIMING_COUNT(cinfo, MCUs, 1);
+      TIMING_COUNT(cinfo, blocks, cinfo->blocks_in_MCU);
     }
     /* Completed an MCU row, but perhaps not an iMCU row */
     coef->MCU_ctr = 0;
   }
+  TIMING_END(cinfo);
   /* Completed the iMCU row, advance counters for next one */
   if (++(cinfo->input_iMCU_row) < cinfo->total_iMCU_rows) {
     start_iMCU_row(cinfo);
@@ -356,6 +372,7 @@ dej12_compress_data (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
     }
     inverse_DCT = cinfo->idct->inverse_DCT[ci];
     output_ptr = output_buf[ci];
+    TIMING_BEGIN(cinfo, JTIME_IDCT);
     /* Loop over all DCT blocks to be processed. */
     for (block_row = 0; block_row < block_rows; block_row++) {
       buffer_ptr = buffer[block_row];
@@ -368,6 +385,9 @@ dej12_compress_data (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
       }
       output_ptr += compptr->DCT_v_scaled_size;
     }
+    TIMING_COUNT(cinfo, idct_blocks,
+		 (long) block_rows * (long) compptr->width_in_blocks);
+    TIMING_END(cinfo);
   }
 
   if (++(cinfo->output_iMCU_row) < cinfo->total_iMCU_rows)
@@ -541,6 +561,7 @@ decompress_smooth_data (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
     Q02 = quanttbl->quantval[Q02_POS];
     inverse_DCT = cinfo->idct->inverse_DCT[ci];
     output_ptr = output_buf[ci];
+    TIMING_BEGIN(cinfo, JTIME_IDCT);
     /* Loop over all DCT blocks to be processed. */
     for (block_row = 0; block_row < block_rows; block_row++) {
       buffer_ptr = buffer[block_row];
@@ -660,6 +681,9 @@ decompress_smooth_data (j12_decompress_ptr cinfo, JSAMPIMAGE output_buf)
       }
       output_ptr += compptr->DCT_v_scaled_size;
     }
+    TIMING_COUNT(cinfo, idct_blocks,
+		 (long) block_rows * (long) compptr->width_in_blocks);
+    TIMING_END(cinfo);
   }
 
   if (++(cinfo->output_iMCU_row) < cinfo->total_iMCU_rows)
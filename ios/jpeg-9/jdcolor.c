@@ -12,6 +12,7 @@
 #define JPEG12_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 
 /* Private subobject */
@@ -480,6 +481,207 @@ ycck_cmyk_convert (j12_decompress_ptr cinfo,
 }
 
 
+/**************** Windowed 8-bit output **************/
+
+
+/*
+ * These converters produce the final JOCTET samples in window_output mode.
+ * They do the same arithmetic as their JSAMPLE counterparts above, but the
+ * last step is a lookup in window_range_limit (see jdmaster.c), which
+ * range-limits and applies the output window at the same time.
+ * Output rows are JOCTET rows passed in by the application as JSAMPROWs.
+ * RGB output is written as RGBA with an opaque alpha byte.
+ */
+
+#define WINDOW_ALPHA	0xFF	/* alpha byte for RGBA output */
+
+
+/*
+ * Grayscale (or the Y component of YCbCr) to windowed grayscale.
+ */
+
+METHODDEF(void)
+gray_window_convert (j12_decompress_ptr cinfo,
+		     JSAMPIMAGE input_buf, JDIMENSION input_row,
+		     JSAMPARRAY output_buf, int num_rows)
+{
+  register JOCTET * outptr;
+  register JSAMPROW inptr;
+  register JDIMENSION col;
+  register JOCTET * range_limit = cinfo->window_range_limit;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  while (--num_rows >= 0) {
+    inptr = input_buf[0][input_row++];
+    outptr = (JOCTET *) *output_buf++;
+    for (col = 0; col < num_cols; col++)
+      outptr[col] = range_limit[GETJSAMPLE(inptr[col])];
+  }
+}
+
+
+/*
+ * Grayscale to windowed RGBA.
+ */
+
+METHODDEF(void)
+gray_rgba_window_convert (j12_decompress_ptr cinfo,
+			  JSAMPIMAGE input_buf, JDIMENSION input_row,
+			  JSAMPARRAY output_buf, int num_rows)
+{
+  register JOCTET * outptr;
+  register JSAMPROW inptr;
+  register JDIMENSION col;
+  register JOCTET * range_limit = cinfo->window_range_limit;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  while (--num_rows >= 0) {
+    inptr = input_buf[0][input_row++];
+    outptr = (JOCTET *) *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      outptr[0] = outptr[1] = outptr[2] = range_limit[GETJSAMPLE(inptr[col])];
+      outptr[3] = WINDOW_ALPHA;
+      outptr += 4;
+    }
+  }
+}
+
+
+/*
+ * YCbCr to windowed RGBA.
+ * We assume build_ycc_rgb_table has been called.
+ */
+
+METHODDEF(void)
+ycc_rgba_window_convert (j12_decompress_ptr cinfo,
+			 JSAMPIMAGE input_buf, JDIMENSION input_row,
+			 JSAMPARRAY output_buf, int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr) cinfo->cconvert;
+  register int y, cb, cr;
+  register JOCTET * outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+  /* copy these pointers into registers if possible */
+  register JOCTET * range_limit = cinfo->window_range_limit;
+  register int * Crrtab = cconvert->Cr_r_tab;
+  register int * Cbbtab = cconvert->Cb_b_tab;
+  register INT32 * Crgtab = cconvert->Cr_g_tab;
+  register INT32 * Cbgtab = cconvert->Cb_g_tab;
+  SHIFT_TEMPS
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = (JOCTET *) *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      y  = GETJSAMPLE(inptr0[col]);
+      cb = GETJSAMPLE(inptr1[col]);
+      cr = GETJSAMPLE(inptr2[col]);
+      outptr[0] = range_limit[y + Crrtab[cr]];
+      outptr[1] = range_limit[y +
+			      ((int) RIGHT_SHIFT(Cbgtab[cb] + Crgtab[cr],
+						 SCALEBITS))];
+      outptr[2] = range_limit[y + Cbbtab[cb]];
+      outptr[3] = WINDOW_ALPHA;
+      outptr += 4;
+    }
+  }
+}
+
+
+/*
+ * RGB, or [R-G,G,B-G] if color_transform is set, to windowed RGBA.
+ */
+
+METHODDEF(void)
+rgb_rgba_window_convert (j12_decompress_ptr cinfo,
+			 JSAMPIMAGE input_buf, JDIMENSION input_row,
+			 JSAMPARRAY output_buf, int num_rows)
+{
+  register int r, g, b;
+  register JOCTET * outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  register JDIMENSION col;
+  register JOCTET * range_limit = cinfo->window_range_limit;
+  JDIMENSION num_cols = cinfo->output_width;
+  boolean subtract_green = (cinfo->color_transform == JCT_SUBTRACT_GREEN);
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = (JOCTET *) *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      r = GETJSAMPLE(inptr0[col]);
+      g = GETJSAMPLE(inptr1[col]);
+      b = GETJSAMPLE(inptr2[col]);
+      if (subtract_green) {
+	r = (r + g - CENTERJSAMPLE) & MAXJSAMPLE;
+	b = (b + g - CENTERJSAMPLE) & MAXJSAMPLE;
+      }
+      outptr[0] = range_limit[r];
+      outptr[1] = range_limit[g];
+      outptr[2] = range_limit[b];
+      outptr[3] = WINDOW_ALPHA;
+      outptr += 4;
+    }
+  }
+}
+
+
+/*
+ * Select the converter for window_output mode.
+ * Only grayscale and RGB(A) output are provided.
+ */
+
+LOCAL(void)
+select_window_converter (j12_decompress_ptr cinfo)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr) cinfo->cconvert;
+  int ci;
+
+  switch (cinfo->out_color_space) {
+  case JCS_GRAYSCALE:
+    cinfo->out_color_components = 1;
+    cinfo->output_components = 1;
+    if (cinfo->jpeg12_color_space == JCS_GRAYSCALE ||
+	cinfo->jpeg12_color_space == JCS_YCbCr) {
+      cconvert->pub.j12_color_convert = gray_window_convert;
+      /* For color->grayscale conversion, only the Y (0) component is needed */
+      for (ci = 1; ci < cinfo->num_components; ci++)
+	cinfo->comp_info[ci].component_needed = FALSE;
+    } else
+      ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    break;
+
+  case JCS_RGB:
+    cinfo->out_color_components = RGB_PIXELSIZE;
+    cinfo->output_components = 4;
+    if (cinfo->jpeg12_color_space == JCS_YCbCr) {
+      cconvert->pub.j12_color_convert = ycc_rgba_window_convert;
+      build_ycc_rgb_table(cinfo);
+    } else if (cinfo->jpeg12_color_space == JCS_GRAYSCALE) {
+      cconvert->pub.j12_color_convert = gray_rgba_window_convert;
+    } else if (cinfo->jpeg12_color_space == JCS_RGB &&
+	       (cinfo->color_transform == JCT_NONE ||
+		cinfo->color_transform == JCT_SUBTRACT_GREEN)) {
+      cconvert->pub.j12_color_convert = rgb_rgba_window_convert;
+    } else
+      ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    break;
+
+  default:
+    ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    break;
+  }
+}
+
+
 /*
  * Empty method for j12_start_pass.
  */
@@ -536,6 +738,12 @@ j12_init_color_deconverter (j12_decompress_ptr cinfo)
   if (cinfo->color_transform && cinfo->jpeg12_color_space != JCS_RGB)
     ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
 
+  /* Windowed 8-bit output has its own set of converters. */
+  if (cinfo->window_output) {
+    select_window_converter(cinfo);
+    return;
+  }
+
   /* Set out_color_components and conversion method based on requested space.
    * Also clear the component_needed flags for any unused components,
    * so that earlier pipeline stages can avoid useless computation.
@@ -570,8 +778,12 @@ j12_init_color_deconverter (j12_decompress_ptr cinfo)
   case JCS_RGB:
     cinfo->out_color_components = RGB_PIXELSIZE;
     if (cinfo->jpeg12_color_space == JCS_YCbCr) {
-      cconvert->pub.j12_color_convert = ycc_rgb_convert;
-      build_ycc_rgb_table(cinfo);
+      if (j12_simd_can_ycc_rgb())
+	cconvert->pub.j12_color_convert = j12_simd_ycc_rgb_convert;
+      else {
+	cconvert->pub.j12_color_convert = ycc_rgb_convert;
+	build_ycc_rgb_table(cinfo);
+      }
     } else if (cinfo->jpeg12_color_space == JCS_GRAYSCALE) {
       cconvert->pub.j12_color_convert = gray_rgb_convert;
     } else if (cinfo->jpeg12_color_space == JCS_RGB) {
@@ -580,7 +792,10 @@ j12_init_color_deconverter (j12_decompress_ptr cinfo)
 	cconvert->pub.j12_color_convert = rgb_convert;
 	break;
       case JCT_SUBTRACT_GREEN:
-	cconvert->pub.j12_color_convert = rgb1_rgb_convert;
+	if (j12_simd_can_rgb1_rgb())
+	  cconvert->pub.j12_color_convert = j12_simd_rgb1_rgb_convert;
+	else
+	  cconvert->pub.j12_color_convert = rgb1_rgb_convert;
 	break;
       default:
 	ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
@@ -593,8 +808,12 @@ j12_init_color_deconverter (j12_decompress_ptr cinfo)
   case JCS_CMYK:
     cinfo->out_color_components = 4;
     if (cinfo->jpeg12_color_space == JCS_YCCK) {
-      cconvert->pub.j12_color_convert = ycck_cmyk_convert;
-      build_ycc_rgb_table(cinfo);
+      if (j12_simd_can_ycck_cmyk())
+	cconvert->pub.j12_color_convert = j12_simd_ycck_cmyk_convert;
+      else {
+	cconvert->pub.j12_color_convert = ycck_cmyk_convert;
+	build_ycc_rgb_table(cinfo);
+      }
     } else if (cinfo->jpeg12_color_space == JCS_CMYK) {
       cconvert->pub.j12_color_convert = null_convert;
     } else
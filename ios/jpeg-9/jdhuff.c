@@ -14,11 +14,19 @@
  * up to the start of the current MCU.  To do this, we copy state variables
  * into local working storage, and update them back to the permanent
  * storage only upon successful completion of an MCU.
+ *
+ * For jpeg12_read_coefficients(), a sequential scan without restart markers
+ * can also be decoded on several threads; see j12_huff_decode_parallel().
  */
 
 #define JPEG12_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jmemsys.h"		/* for jpeg12_mem_available */
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 
 /* Derived data constructed for each Huffman table */
@@ -66,14 +74,23 @@ typedef struct {
  * necessary.
  */
 
+#ifdef HAVE_LONG_LONG
+typedef unsigned long long bit_buf_type; /* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  64	/* size of buffer in bits */
+#else
 typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
 #define BIT_BUF_SIZE  32	/* size of buffer in bits */
+#endif
 
-/* If long is > 32 bits on your machine, and shifting/masking longs is
- * reasonably fast, making bit_buf_type be long and setting BIT_BUF_SIZE
- * appropriately should be a win.  Unfortunately we can't define the size
- * with something like  #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
+/* If the compiler has a 64-bit long long, we use it for the buffer, which
+ * halves the number of calls to jpeg12_fill_bit_buffer.  Unfortunately we
+ * can't define the size with something like
+ * #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
  * because not all machines measure sizeof in 8-bit bytes.
+ *
+ * With corrupt data, the count in an "extraneous bytes before marker"
+ * warning depends on how many bytes were prefetched when the marker was
+ * hit, so it may come out higher or lower than with a 32-bit buffer.
  */
 
 typedef struct {		/* Bitreading state saved across MCUs */
@@ -484,6 +501,7 @@ jpeg12_fill_bit_buffer (bitread_working_state * state,
       if (bytes_in_buffer == 0) {
 	if (! (*cinfo->src->j12_fill_input_buffer) (cinfo))
 	  return FALSE;
+	TIMING_FILLED(cinfo);
 	next_input_byte = cinfo->src->next_input_byte;
 	bytes_in_buffer = cinfo->src->bytes_in_buffer;
       }
@@ -501,6 +519,7 @@ jpeg12_fill_bit_buffer (bitread_working_state * state,
 	  if (bytes_in_buffer == 0) {
 	    if (! (*cinfo->src->j12_fill_input_buffer) (cinfo))
 	      return FALSE;
+	    TIMING_FILLED(cinfo);
 	    next_input_byte = cinfo->src->next_input_byte;
 	    bytes_in_buffer = cinfo->src->bytes_in_buffer;
 	  }
@@ -895,6 +914,202 @@ j12_decode_mcu_DC_refine (j12_decompress_ptr cinfo, JBLOCKROW *MCU_data)
 }
 
 
+#ifdef HAVE_LONG_LONG
+
+/*
+ * Fast path for AC successive approximation refinement.
+ *
+ * When the source buffer holds enough bytes for any one block, we can read
+ * straight from it without ever suspending.  We keep a bitmap of the block's
+ * nonzero coefficients (bit k for zigzag position k), so that the zero
+ * coefficients to skip and the nonzero ones that get a correction bit are
+ * found with bit operations instead of testing them one by one.
+ *
+ * The bitmap also replaces the undo list: if we run into a marker or into
+ * anything unusual (which the regular path has to warn about), we zero the
+ * newly nonzero coefficients and return FALSE without having changed any
+ * state, and the regular path decodes the block.  Correction bits already
+ * added need no undo; see j12_decode_mcu_AC_refine.
+ */
+
+typedef unsigned long long coef_map_type;
+
+/* Bytes of input that surely cover one block: 63 coefficients of at most
+ * 16+1+1 bits plus an EOB run, with every byte stuffed, plus a buffer fill.
+ */
+#define REFINE_FAST_BYTES  512
+
+/* Bits a..b of a coefficient map, a <= b <= 63 */
+#define COEF_MAP_RANGE(a,b) \
+	((((coef_map_type) 2) << (b)) - (((coef_map_type) 1) << (a)))
+
+#ifdef __GNUC__
+#define COEF_MAP_FIRST(m)  __builtin_ctzll(m)
+#else
+LOCAL(int)
+coef_map_first (coef_map_type m)
+{
+  int k = 0;
+
+  while ((m & 1) == 0) {
+    m >>= 1;
+    k++;
+  }
+  return k;
+}
+#define COEF_MAP_FIRST(m)  coef_map_first(m)
+#endif
+
+/* In-line bit fetching straight from the source buffer.  A marker (or an
+ * unusual FF FF sequence) makes us give up; see above.  The variables
+ * get_buffer, bits_left and next_input_byte must be locals.
+ */
+
+#define FAST_FILL_BIT_BUFFER(failaction) \
+	{ while (bits_left <= BIT_BUF_SIZE - 8) {  \
+	    register int c = GETJOCTET(*next_input_byte);  \
+	    if (c == 0xFF) {  \
+	      if (GETJOCTET(next_input_byte[1]) != 0) { failaction; }  \
+	      next_input_byte++;  \
+	    }  \
+	    next_input_byte++;  \
+	    get_buffer = (get_buffer << 8) | (bit_buf_type) c;  \
+	    bits_left += 8; } }
+
+#define FAST_HUFF_DECODE(result,htbl,failaction) \
+{ register int nb, look; register INT32 code; \
+  FAST_FILL_BIT_BUFFER(failaction); \
+  look = PEEK_BITS(HUFF_LOOKAHEAD); \
+  if ((nb = htbl->look_nbits[look]) != 0) { \
+    DROP_BITS(nb); \
+    result = htbl->look_sym[look]; \
+  } else { \
+    nb = HUFF_LOOKAHEAD+1; \
+    code = GET_BITS(nb); \
+    while (code > htbl->maxcode[nb]) { \
+      code = (code << 1) | GET_BITS(1); \
+      nb++; \
+    } \
+    if (nb > 16) { failaction; } \
+    result = htbl->pub->huffval[ (int) (code + htbl->valoffset[nb]) ]; \
+  } \
+}
+
+/* Append a correction bit to each nonzero coefficient in map m.
+ * A 1 bit increases the absolute value (unless already done), which we
+ * do without branching, since the bits are all but random.
+ */
+#define FAST_CORRECT(m,failaction) \
+	{ while (m) {  \
+	    thiscoef = *block + natural_order[COEF_MAP_FIRST(m)];  \
+	    m &= m - 1;  \
+	    if (bits_left < 1) FAST_FILL_BIT_BUFFER(failaction);  \
+	    *thiscoef += (JCOEF) ((*thiscoef >= 0 ? p1 : m1) &  \
+			-(GET_BITS(1) & ((*thiscoef & p1) == 0))); } }
+
+LOCAL(boolean)
+decode_AC_refine_fast (j12_decompress_ptr cinfo, JBLOCKROW block)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  register bit_buf_type get_buffer = entropy->bitstate.get_buffer;
+  register int bits_left = entropy->bitstate.bits_left;
+  register const JOCTET * next_input_byte = cinfo->src->next_input_byte;
+  register int s, k, r;
+  unsigned int EOBRUN = entropy->saved.EOBRUN;
+  int Ss = cinfo->Ss, Se = cinfo->Se;
+  int p1 = 1 << cinfo->Al;	/* 1 in the bit position being coded */
+  int m1 = (-1) << cinfo->Al;	/* -1 in the bit position being coded */
+  const int * natural_order = cinfo->natural_order;
+  d_derived_tbl * tbl = entropy->ac_derived_tbl;
+  coef_map_type nonzero, old_nonzero, m;
+  JCOEFPTR thiscoef;
+
+  /* Map the coefficients of the band that are already nonzero */
+  nonzero = 0;
+  for (k = Ss; k <= Se; k++)
+    nonzero |= ((coef_map_type) ((*block)[natural_order[k]] != 0)) << k;
+  old_nonzero = nonzero;
+
+  k = Ss;
+  if (EOBRUN == 0) {
+    do {
+      FAST_HUFF_DECODE(s, tbl, goto undoit);
+      r = s >> 4;
+      s &= 15;
+      if (s) {
+	if (s != 1)		/* leave the warning to the regular path */
+	  goto undoit;
+	if (GET_BITS(1))	/* (FAST_HUFF_DECODE left enough bits) */
+	  s = p1;		/* newly nonzero coef is positive */
+	else
+	  s = m1;		/* newly nonzero coef is negative */
+      } else if (r != 15) {
+	EOBRUN = 1 << r;	/* EOBr, run length is 2^r + appended bits */
+	if (r)
+	  EOBRUN += GET_BITS(r);
+	break;			/* rest of block is handled by EOB logic */
+      }
+      /* Skip to the zero coefficient r zeroes ahead, appending correction
+       * bits to the nonzeroes on the way.
+       */
+      m = ~nonzero & COEF_MAP_RANGE(k, Se);
+      for (; r > 0 && m; r--)
+	m &= m - 1;
+      if (m) {
+	r = COEF_MAP_FIRST(m);
+	m = nonzero & COEF_MAP_RANGE(k, r);
+      } else {
+	if (s)			/* no room for the new coefficient */
+	  goto undoit;
+	r = Se + 1;
+	m = nonzero & COEF_MAP_RANGE(k, Se);
+      }
+      FAST_CORRECT(m, goto undoit);
+      if (s) {
+	/* Output newly nonzero coefficient */
+	(*block)[natural_order[r]] = (JCOEF) s;
+	nonzero |= ((coef_map_type) 1) << r;
+      }
+      k = r + 1;
+    } while (k <= Se);
+  }
+
+  if (EOBRUN) {
+    /* Append a correction bit to each remaining nonzero coefficient */
+    m = nonzero & COEF_MAP_RANGE(k, Se);
+    FAST_CORRECT(m, goto undoit);
+    /* Count one block completed in EOB run */
+    EOBRUN--;
+  }
+
+  /* Completed MCU, so update state */
+  cinfo->src->bytes_in_buffer -=
+    (size_t) (next_input_byte - cinfo->src->next_input_byte);
+  cinfo->src->next_input_byte = next_input_byte;
+  entropy->bitstate.get_buffer = get_buffer;
+  entropy->bitstate.bits_left = bits_left;
+  entropy->saved.EOBRUN = EOBRUN;
+  return TRUE;
+
+undoit:
+  /* Re-zero any output coefficients that we made newly nonzero */
+  for (m = nonzero & ~old_nonzero; m; m &= m - 1)
+    (*block)[natural_order[COEF_MAP_FIRST(m)]] = 0;
+  return FALSE;
+}
+
+#define TRY_AC_REFINE_FAST(cinfo,block) \
+	((cinfo)->unread_marker == 0 &&  \
+	 (cinfo)->src->bytes_in_buffer >= REFINE_FAST_BYTES &&  \
+	 decode_AC_refine_fast(cinfo, block))
+
+#else
+
+#define TRY_AC_REFINE_FAST(cinfo,block)  FALSE
+
+#endif /* HAVE_LONG_LONG */
+
+
 /*
  * MCU decoding for AC successive approximation refinement scan.
  */
@@ -922,8 +1137,11 @@ j12_decode_mcu_AC_refine (j12_decompress_ptr cinfo, JBLOCKROW *MCU_data)
   }
 
   /* If we've run out of data, don't modify the MCU.
+   * Otherwise try the fast path first; this takes care of the MCU
+   * unless the source is short of data or we run into a marker.
    */
-  if (! entropy->insufficient_data) {
+  if (! entropy->insufficient_data &&
+      ! TRY_AC_REFINE_FAST(cinfo, MCU_data[0])) {
 
     Se = cinfo->Se;
     p1 = 1 << cinfo->Al;	/* 1 in the bit position being coded */
@@ -1303,6 +1521,710 @@ j12_decode_mcu (j12_decompress_ptr cinfo, JBLOCKROW *MCU_data)
 }
 
 
+/*
+ * Make a private copy of the entropy decoder as set up for the current
+ * scan, for jdscans.c, which decodes several scans at once.  The derived
+ * tables and the Huffman tables they refer to are copied too, since a
+ * later DHT marker may redefine a table before the scan is decoded.
+ */
+
+LOCAL(d_derived_tbl *)
+copy_derived_tbl (j12_decompress_ptr cinfo, d_derived_tbl * tbl)
+{
+  d_derived_tbl * copy;
+  JHUFF_TBL * htbl;
+
+  if (tbl == NULL)
+    return NULL;
+  copy = (d_derived_tbl *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+				SIZEOF(d_derived_tbl));
+  htbl = (JHUFF_TBL *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+				SIZEOF(JHUFF_TBL));
+  MEMCOPY(copy, tbl, SIZEOF(d_derived_tbl));
+  MEMCOPY(htbl, tbl->pub, SIZEOF(JHUFF_TBL));
+  copy->pub = htbl;
+  return copy;
+}
+
+GLOBAL(struct jpeg12_entropy_decoder *)
+j12_huff_copy_decoder (j12_decompress_ptr cinfo)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  huff_entropy_ptr copy;
+  int i;
+
+  copy = (huff_entropy_ptr)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+				SIZEOF(huff_entropy_decoder));
+  MEMCOPY(copy, entropy, SIZEOF(huff_entropy_decoder));
+
+  if (cinfo->progressive_mode) {
+    copy->ac_derived_tbl = NULL;
+    for (i = 0; i < NUM_HUFF_TBLS; i++) {
+      copy->derived_tbls[i] = copy_derived_tbl(cinfo, entropy->derived_tbls[i]);
+      if (entropy->ac_derived_tbl == entropy->derived_tbls[i])
+	copy->ac_derived_tbl = copy->derived_tbls[i];
+    }
+  } else {
+    for (i = 0; i < NUM_HUFF_TBLS; i++) {
+      copy->dc_derived_tbls[i] =
+	copy_derived_tbl(cinfo, entropy->dc_derived_tbls[i]);
+      copy->ac_derived_tbls[i] =
+	copy_derived_tbl(cinfo, entropy->ac_derived_tbls[i]);
+    }
+    for (i = 0; i < cinfo->blocks_in_MCU; i++) {
+      copy->dc_cur_tbls[i] = copy->dc_derived_tbls[
+	cinfo->cur_comp_info[cinfo->MCU_membership[i]]->dc_tbl_no];
+      copy->ac_cur_tbls[i] = copy->ac_derived_tbls[
+	cinfo->cur_comp_info[cinfo->MCU_membership[i]]->ac_tbl_no];
+    }
+  }
+
+  return &copy->pub;
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+/*
+ * Parallel decoding of a sequential scan without restart markers.
+ *
+ * Without restart markers, the only way to find where a block starts is to
+ * decode everything before it.  But Huffman-coded data tends to resync:
+ * a decoder started at an arbitrary bit position soon falls into step with
+ * the true block boundaries.  So we cut the scan data into chunks, and a
+ * thread per chunk decodes blocks speculatively from the start of its chunk
+ * (assuming it is the start of an MCU) to the end of it, noting the bit
+ * position where each block starts.  DC coefficients are kept as
+ * differences, since the predictors aren't known yet.
+ *
+ * A thread's decode is right from the first block where it falls into step
+ * with the true one: same bit position and same place within the MCU.  In a
+ * second parallel pass, each thread therefore goes on decoding into the next
+ * chunk until it reaches a block start seen by that chunk's thread.  The
+ * runs are then stitched together on the calling thread, following the true
+ * decode from run to run; where it meets no known block start (e.g. a run
+ * that never fell into step), we decode single blocks ourselves until it
+ * does.  Finally the blocks are placed in the coefficient buffer in MCU
+ * order, adding up the DC differences.
+ *
+ * The scan must be entirely in the source buffer (as with jpeg12_mem_src)
+ * and be followed by a marker.  If anything about the data is unusual (a
+ * bad Huffman code, running out of data, extra bytes before the marker),
+ * we give up before any state has been changed and let the normal path
+ * decode the scan, so the result and the warnings are always the same.
+ * Scratch memory (a copy of the scan data, and a block and a bit position
+ * for each block decoded) comes from malloc(), since the memory manager is
+ * not thread-safe; but we only go ahead if the coefficient arrays are in
+ * memory and the scratch fits within max_memory_to_use, if that is set.
+ */
+
+#define MAX_ENTROPY_THREADS	64	/* upper limit on threads per scan */
+#define MIN_CHUNK_BYTES		16384	/* don't cut the data finer than this */
+
+/* Enough bits for the longest code plus its lookahead (cf. MIN_GET_BITS) */
+#define MEM_GET_BITS  (BIT_BUF_SIZE-7)
+
+/* State shared by all the runs of one scan */
+
+typedef struct {
+  huff_entropy_ptr entropy;
+  int blocks_in_MCU;
+  const JOCTET * data;		/* entropy-coded data, FF/00 unstuffed */
+  size_t length;		/* # of bytes in data */
+} par_shared;
+
+/* A run of consecutively decoded blocks */
+
+typedef struct block_run_struct {
+  par_shared * shared;
+  size_t begin, limit;		/* decode the blocks starting in this range */
+  JBLOCKROW blocks;		/* the blocks, with DC as a difference */
+  size_t * start;		/* bit position where each block starts */
+  long num_blocks, max_blocks;	/* blocks in use, blocks allocated */
+  size_t end_pos;		/* bit position after the last block */
+  long block_limit;		/* never decode more blocks than this */
+  struct block_run_struct * next_run; /* run of the following chunk */
+  struct block_run_struct * tail; /* blocks decoded into the next chunk */
+} block_run;
+
+/* A part of the final block sequence, taken from one run */
+
+typedef struct {
+  block_run * run;
+  long first, num;
+} run_segment;
+
+/* Bridge, run and tail for each chunk, at most */
+#define MAX_SEGMENTS	(3 * MAX_ENTROPY_THREADS)
+
+/*
+ * In-line bit fetching from memory.  Past the end of the data, zero bits
+ * are supplied; the caller checks the bit position afterwards.  The
+ * variables get_buffer, bits_left, data, length and next must be locals.
+ */
+
+#define MEM_FILL_BIT_BUFFER \
+	{ while (bits_left < MEM_GET_BITS) {  \
+	    get_buffer = (get_buffer << 8) |  \
+	      (next < length ? (bit_buf_type) GETJOCTET(data[next]) : 0);  \
+	    next++; bits_left += 8; } }
+
+#define MEM_HUFF_DECODE(result,htbl,failaction) \
+{ register int nb, look; register INT32 code; \
+  MEM_FILL_BIT_BUFFER; \
+  look = PEEK_BITS(HUFF_LOOKAHEAD); \
+  if ((nb = htbl->look_nbits[look]) != 0) { \
+    DROP_BITS(nb); \
+    result = htbl->look_sym[look]; \
+  } else { \
+    nb = HUFF_LOOKAHEAD+1; \
+    code = GET_BITS(nb); \
+    while (code > htbl->maxcode[nb]) { \
+      code = (code << 1) | GET_BITS(1); \
+      nb++; \
+    } \
+    if (nb > 16) { failaction; } \
+    result = htbl->pub->huffval[ (int) (code + htbl->valoffset[nb]) ]; \
+  } \
+}
+
+
+LOCAL(boolean)
+grow_run (block_run * run)
+{
+  long max_blocks = run->max_blocks * 2 + 256;
+  JBLOCKROW blocks;
+  size_t * start;
+
+  blocks = (JBLOCKROW) realloc(run->blocks, max_blocks * SIZEOF(JBLOCK));
+  if (blocks == NULL)
+    return FALSE;
+  run->blocks = blocks;
+  start = (size_t *) realloc(run->start, max_blocks * SIZEOF(size_t));
+  if (start == NULL)
+    return FALSE;
+  run->start = start;
+  run->max_blocks = max_blocks;
+  return TRUE;
+}
+
+
+/*
+ * Append to the run the blocks that start in [pos,limit), decoding from
+ * bit position pos as block blkn of an MCU (cf. j12_decode_mcu).
+ * Stops early at a bad code, at the end of the data, or when out of memory;
+ * run->end_pos then is the position of the block that wasn't decoded.
+ */
+
+LOCAL(void)
+decode_run (block_run * run, size_t pos, int blkn, size_t limit)
+{
+  huff_entropy_ptr entropy = run->shared->entropy;
+  int blocks_in_MCU = run->shared->blocks_in_MCU;
+  const JOCTET * data = run->shared->data;
+  size_t length = run->shared->length;
+  size_t next, new_pos;
+  register bit_buf_type get_buffer = 0;
+  register int bits_left = 0;
+
+  next = pos >> 3;
+  MEM_FILL_BIT_BUFFER;
+  DROP_BITS((int) (pos & 7));
+
+  while (pos < limit && run->num_blocks < run->block_limit) {
+    JCOEFPTR block;
+    d_derived_tbl * htbl;
+    register int s, k, r;
+    int coef_limit;
+
+    if (run->num_blocks == run->max_blocks && ! grow_run(run))
+      break;
+    block = run->blocks[run->num_blocks];
+    MEMZERO(block, SIZEOF(JBLOCK));
+
+    /* Section F.2.2.1: decode the DC coefficient difference */
+    htbl = entropy->dc_cur_tbls[blkn];
+    MEM_HUFF_DECODE(s, htbl, goto BadBlock);
+
+    htbl = entropy->ac_cur_tbls[blkn];
+    k = 1;
+    coef_limit = entropy->coef_limit[blkn];
+    if (coef_limit) {
+      if (s) {
+	MEM_FILL_BIT_BUFFER;
+	r = GET_BITS(s);
+	s = HUFF_EXTEND(r, s);
+      }
+      /* Keep the difference; the predictor is added when stitching */
+      block[0] = (JCOEF) s;
+
+      /* Section F.2.2.2: decode the AC coefficients */
+      for (; k < coef_limit; k++) {
+	MEM_HUFF_DECODE(s, htbl, goto BadBlock);
+
+	r = s >> 4;
+	s &= 15;
+
+	if (s) {
+	  k += r;
+	  MEM_FILL_BIT_BUFFER;
+	  r = GET_BITS(s);
+	  s = HUFF_EXTEND(r, s);
+	  block[jpeg12_natural_order[k]] = (JCOEF) s;
+	} else {
+	  if (r != 15)
+	    goto EndOfBlock;
+	  k += 15;
+	}
+      }
+    } else {
+      if (s) {
+	MEM_FILL_BIT_BUFFER;
+	DROP_BITS(s);
+      }
+    }
+
+    /* In this path we just discard the values */
+    for (; k < DCTSIZE2; k++) {
+      MEM_HUFF_DECODE(s, htbl, goto BadBlock);
+
+      r = s >> 4;
+      s &= 15;
+
+      if (s) {
+	k += r;
+	MEM_FILL_BIT_BUFFER;
+	DROP_BITS(s);
+      } else {
+	if (r != 15)
+	  break;
+	k += 15;
+      }
+    }
+
+    EndOfBlock:
+    new_pos = (next << 3) - (size_t) bits_left;
+    if (new_pos > (length << 3))
+      break;			/* block runs past the end of the data */
+    run->start[run->num_blocks++] = pos;
+    pos = new_pos;
+    if (++blkn == blocks_in_MCU)
+      blkn = 0;
+  }
+
+  BadBlock:
+  run->end_pos = pos;
+}
+
+
+/*
+ * Find the block of the run that starts at bit position pos as block blkn
+ * of an MCU.  Returns its index, or -1 if the run never got in step there.
+ */
+
+LOCAL(long)
+find_block (block_run * run, size_t pos, int blkn)
+{
+  long lo = 0, hi = run->num_blocks - 1, mid;
+
+  while (lo <= hi) {
+    mid = (lo + hi) >> 1;
+    if (run->start[mid] < pos)
+      lo = mid + 1;
+    else if (run->start[mid] > pos)
+      hi = mid - 1;
+    else
+      return (mid % run->shared->blocks_in_MCU == blkn) ? mid : -1L;
+  }
+  return -1L;
+}
+
+
+/* First pass: decode the blocks that start in the run's own chunk */
+
+LOCAL(void *)
+decode_chunk (void * arg)
+{
+  block_run * run = (block_run *) arg;
+
+  decode_run(run, run->begin, 0, run->limit);
+  return NULL;
+}
+
+
+/*
+ * Second pass: go on decoding into the next chunk, in windows of growing
+ * size, until reaching a block start known to the next chunk's run (or the
+ * end of that chunk).  The blocks go to the tail, since the next run is
+ * being read by other threads.
+ */
+
+LOCAL(void *)
+extend_chunk (void * arg)
+{
+  block_run * run = (block_run *) arg;
+  block_run * next_run = run->next_run;
+  block_run * tail = run->tail;
+  int blocks_in_MCU = run->shared->blocks_in_MCU;
+  size_t pos = run->end_pos, limit, window = 4096;
+  long k, first = run->num_blocks;
+
+  if (next_run == NULL || pos < run->limit)
+    return NULL;		/* last chunk, or stopped by bad data */
+  tail->end_pos = pos;
+  for (;;) {
+    if (find_block(next_run, pos, (int) (first % blocks_in_MCU)) >= 0)
+      return NULL;		/* in step with the next run */
+    if (pos >= next_run->limit)
+      return NULL;		/* covered the whole next chunk */
+    limit = pos + window;
+    if (limit > next_run->limit)
+      limit = next_run->limit;
+    k = tail->num_blocks;
+    decode_run(tail, pos, (int) (first % blocks_in_MCU), limit);
+    if (tail->num_blocks == k)
+      return NULL;		/* bad data */
+    for (; k < tail->num_blocks; k++) {
+      if (find_block(next_run, tail->start[k],
+		     (int) ((run->num_blocks + k) % blocks_in_MCU)) >= 0) {
+	tail->num_blocks = k;
+	tail->end_pos = tail->start[k];
+	return NULL;
+      }
+    }
+    pos = tail->end_pos;
+    first = run->num_blocks + tail->num_blocks;
+    window <<= 1;
+  }
+}
+
+
+/*
+ * Run a pass over all the runs, the first one on the calling thread.
+ */
+
+LOCAL(void)
+run_pass (void * (*pass) (void * arg), block_run * runs, int num_runs)
+{
+  pthread_t threads[MAX_ENTROPY_THREADS];
+  boolean started[MAX_ENTROPY_THREADS];
+  int i;
+
+  for (i = 1; i < num_runs; i++)
+    started[i] = (pthread_create(&threads[i], NULL, pass, &runs[i]) == 0);
+  (*pass) (&runs[0]);
+  for (i = 1; i < num_runs; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      (*pass) (&runs[i]);
+  }
+}
+
+
+/*
+ * Append blocks [first, first+num) of a run to the final sequence.
+ * Returns FALSE if there are too many segments (which cannot happen).
+ */
+
+LOCAL(boolean)
+add_segment (run_segment * segs, int * num_segs, block_run * run,
+	     long first, long num)
+{
+  run_segment * seg;
+
+  if (*num_segs > 0) {
+    seg = &segs[*num_segs - 1];
+    if (seg->run == run && seg->first + seg->num == first) {
+      seg->num += num;
+      return TRUE;
+    }
+  }
+  if (*num_segs == MAX_SEGMENTS)
+    return FALSE;
+  seg = &segs[*num_segs];
+  seg->run = run;
+  seg->first = first;
+  seg->num = num;
+  (*num_segs)++;
+  return TRUE;
+}
+
+
+/*
+ * Copy the stitched blocks into the coefficient buffer, in the same order
+ * as j12_consume_data() in jdcoefct.c, turning DC differences into values.
+ */
+
+LOCAL(void)
+place_blocks (j12_decompress_ptr cinfo, run_segment * seg)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  jvirt_barray_ptr * coef_arrays = cinfo->coef->coef_arrays;
+  JBLOCKARRAY buffer[MAX_COMPS_IN_SCAN];
+  JBLOCKROW buffer_ptr, src_ptr;
+  jpeg12_component_info * compptr;
+  JDIMENSION iMCU_row, MCU_col_num, start_col;
+  int last_dc_val[MAX_COMPS_IN_SCAN];
+  int blkn, ci, xindex, yindex, yoffset, MCU_rows, s;
+  long left;
+
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++)
+    last_dc_val[ci] = 0;
+  src_ptr = seg->run->blocks + seg->first;
+  left = seg->num;
+
+  for (iMCU_row = 0; iMCU_row < cinfo->total_iMCU_rows; iMCU_row++) {
+    for (ci = 0; ci < cinfo->comps_in_scan; ci++) {
+      compptr = cinfo->cur_comp_info[ci];
+      buffer[ci] = (*cinfo->mem->j12_access_virt_barray)
+	((j12_common_ptr) cinfo, coef_arrays[compptr->component_index],
+	 iMCU_row * compptr->v_samp_factor,
+	 (JDIMENSION) compptr->v_samp_factor, TRUE);
+    }
+    /* See start_iMCU_row() in jdcoefct.c */
+    if (cinfo->comps_in_scan > 1)
+      MCU_rows = 1;
+    else if (iMCU_row < cinfo->total_iMCU_rows - 1)
+      MCU_rows = cinfo->cur_comp_info[0]->v_samp_factor;
+    else
+      MCU_rows = cinfo->cur_comp_info[0]->last_row_height;
+
+    for (yoffset = 0; yoffset < MCU_rows; yoffset++) {
+      for (MCU_col_num = 0; MCU_col_num < cinfo->MCUs_per_row; MCU_col_num++) {
+	blkn = 0;
+	for (ci = 0; ci < cinfo->comps_in_scan; ci++) {
+	  compptr = cinfo->cur_comp_info[ci];
+	  start_col = MCU_col_num * compptr->MCU_width;
+	  for (yindex = 0; yindex < compptr->MCU_height; yindex++) {
+	    buffer_ptr = buffer[ci][yindex+yoffset] + start_col;
+	    for (xindex = 0; xindex < compptr->MCU_width; xindex++) {
+	      while (left == 0) {
+		seg++;
+		src_ptr = seg->run->blocks + seg->first;
+		left = seg->num;
+	      }
+	      MEMCOPY(*buffer_ptr, *src_ptr, SIZEOF(JBLOCK));
+	      if (entropy->coef_limit[blkn]) {
+		s = (*src_ptr)[0] + last_dc_val[ci];
+		last_dc_val[ci] = s;
+		(*buffer_ptr)[0] = (JCOEF) s;
+	      }
+	      buffer_ptr++;
+	      src_ptr++;
+	      left--;
+	      blkn++;
+	    }
+	  }
+	}
+      }
+    }
+  }
+}
+
+
+/*
+ * Entropy decode the current scan with up to num_threads threads.
+ * Called by jpeg12_read_coefficients() right after the first scan's
+ * j12_start_input_pass.  Returns TRUE if the whole scan was decoded (the
+ * input controller then is ready to read the markers after it), or FALSE
+ * if the scan isn't suitable, in which case nothing has been changed.
+ */
+
+GLOBAL(boolean)
+j12_huff_decode_parallel (j12_decompress_ptr cinfo, int num_threads)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  struct jpeg12_source_mgr * src = cinfo->src;
+  const JOCTET * input = src->next_input_byte;
+  size_t in_bytes = src->bytes_in_buffer;
+  par_shared shared;
+  block_run runs[MAX_ENTROPY_THREADS];
+  block_run tails[MAX_ENTROPY_THREADS];
+  block_run bridge;
+  run_segment segs[MAX_SEGMENTS];
+  JOCTET * data;
+  block_run * run;
+  size_t i, length, pos, marker_end;
+  long total_blocks, count, j, take;
+  int c, marker, num_runs, num_segs, blkn;
+  boolean ok = FALSE;
+
+  /* Only a sequential Huffman scan that uses j12_decode_mcu, fresh */
+  if (cinfo->progressive_mode || cinfo->arith_code ||
+      cinfo->restart_interval != 0 ||
+      entropy->pub.j12_decode_mcu != j12_decode_mcu ||
+      cinfo->unread_marker != 0 || entropy->bitstate.bits_left != 0 ||
+      cinfo->input_iMCU_row != 0)
+    return FALSE;
+  if (num_threads > MAX_ENTROPY_THREADS)
+    num_threads = MAX_ENTROPY_THREADS;
+  num_runs = (int) (in_bytes / MIN_CHUNK_BYTES);
+  if (num_runs > num_threads)
+    num_runs = num_threads;
+  if (num_runs < 2)
+    return FALSE;
+
+  /* Keep to the memory budget.  The runs may grow to twice the blocks they
+   * hold; with the tails and the bridge, twice the blocks in all is ample.
+   */
+  for (c = 0; c < cinfo->num_components; c++)
+    if (cinfo->coef->coef_arrays == NULL ||
+	! j12_virt_barray_in_memory(cinfo->coef->coef_arrays[c]))
+      return FALSE;
+  total_blocks = (long) cinfo->MCUs_per_row * (long) cinfo->MCU_rows_in_scan *
+		 (long) cinfo->blocks_in_MCU;
+  if (cinfo->mem->max_memory_to_use > 0) {
+    jpeg12_memory_stats stats;
+    double scratch = (double) in_bytes + 2.0 * (double) total_blocks *
+		     (double) (SIZEOF(JBLOCK) + SIZEOF(size_t));
+    long needed = scratch < 1.0e9 ? (long) scratch : 1000000000L;
+
+    jpeg12_get_memory_stats((j12_common_ptr) cinfo, &stats);
+    if (scratch > (double) jpeg12_mem_available((j12_common_ptr) cinfo,
+			needed, needed, stats.total_bytes))
+      return FALSE;
+  }
+
+  /* Unstuff the scan data, and find the marker that ends it
+   * (the same way as jpeg12_fill_bit_buffer does).
+   */
+  data = (JOCTET *) malloc(in_bytes);
+  if (data == NULL)
+    return FALSE;
+  length = 0;
+  marker = 0;
+  for (i = 0; i < in_bytes; ) {
+    c = GETJOCTET(input[i++]);
+    if (c == 0xFF) {
+      while (i < in_bytes && GETJOCTET(input[i]) == 0xFF)
+	i++;
+      if (i == in_bytes)
+	break;
+      c = GETJOCTET(input[i++]);
+      if (c != 0) {
+	marker = c;
+	break;
+      }
+      c = 0xFF;
+    }
+    data[length++] = (JOCTET) c;
+  }
+  marker_end = i;
+  if (marker == 0) {		/* scan not all in memory */
+    free(data);
+    return FALSE;
+  }
+
+  shared.entropy = entropy;
+  shared.blocks_in_MCU = cinfo->blocks_in_MCU;
+  shared.data = data;
+  shared.length = length;
+  MEMZERO(runs, SIZEOF(runs));
+  MEMZERO(tails, SIZEOF(tails));
+  MEMZERO(&bridge, SIZEOF(bridge));
+  for (c = 0; c < num_runs; c++) {
+    run = &runs[c];
+    run->shared = &shared;
+    run->begin = ((length * (size_t) c) / (size_t) num_runs) << 3;
+    run->limit = ((length * (size_t) (c + 1)) / (size_t) num_runs) << 3;
+    run->block_limit = total_blocks;
+    run->next_run = (c < num_runs - 1) ? &runs[c + 1] : NULL;
+    run->tail = &tails[c];
+    tails[c].shared = &shared;
+    tails[c].block_limit = total_blocks;
+  }
+  bridge.shared = &shared;
+  bridge.block_limit = total_blocks;
+
+  run_pass(decode_chunk, runs, num_runs);
+  run_pass(extend_chunk, runs, num_runs);
+
+  /* Stitch the runs together */
+  pos = 0;
+  count = 0;
+  num_segs = 0;
+  while (count < total_blocks) {
+    for (c = num_runs - 1; pos < runs[c].begin; c--)
+      ;
+    run = &runs[c];
+    blkn = (int) (count % cinfo->blocks_in_MCU);
+    if ((j = find_block(run, pos, blkn)) >= 0) {
+      /* In step with this run: take the rest of it, and its tail */
+      take = run->num_blocks - j;
+      if (take > total_blocks - count)
+	take = total_blocks - count;
+      if (! add_segment(segs, &num_segs, run, j, take))
+	goto give_up;
+      count += take;
+      pos = (j + take < run->num_blocks) ? run->start[j + take] : run->end_pos;
+      if (j + take == run->num_blocks && run->tail->num_blocks > 0) {
+	run = run->tail;
+	take = run->num_blocks;
+	if (take > total_blocks - count)
+	  take = total_blocks - count;
+	if (! add_segment(segs, &num_segs, run, 0L, take))
+	  goto give_up;
+	count += take;
+	pos = (take < run->num_blocks) ? run->start[take] : run->end_pos;
+      }
+    } else {
+      /* Not yet: decode one more block ourselves */
+      j = bridge.num_blocks;
+      decode_run(&bridge, pos, blkn, pos + 1);
+      if (bridge.num_blocks == j ||
+	  ! add_segment(segs, &num_segs, &bridge, j, 1L))
+	goto give_up;		/* bad data; let the normal path warn */
+      count++;
+      pos = bridge.end_pos;
+    }
+  }
+  /* Everything up to the marker must have been used, by some blocks */
+  if (num_segs == 0 || ((pos + 7) >> 3) != length)
+    goto give_up;
+
+  place_blocks(cinfo, segs);
+  TIMING_COUNT(cinfo, MCUs,
+	       (long) cinfo->MCUs_per_row * (long) cinfo->MCU_rows_in_scan);
+  TIMING_COUNT(cinfo, blocks, total_blocks);
+
+  /* Leave the source positioned after the marker, as jpeg12_fill_bit_buffer
+   * would, and finish the scan as j12_consume_data() would.
+   */
+  cinfo->unread_marker = marker;
+  src->next_input_byte = input + marker_end;
+  src->bytes_in_buffer = in_bytes - marker_end;
+  cinfo->input_iMCU_row = cinfo->total_iMCU_rows;
+  (*cinfo->inputctl->j12_finish_input_pass) (cinfo);
+  ok = TRUE;
+
+ give_up:
+  for (c = 0; c < num_runs; c++) {
+    free(runs[c].blocks);
+    free(runs[c].start);
+    free(tails[c].blocks);
+    free(tails[c].start);
+  }
+  free(bridge.blocks);
+  free(bridge.start);
+  free(data);
+  return ok;
+}
+
+#else /* ! HAVE_PTHREAD_H */
+
+GLOBAL(boolean)
+j12_huff_decode_parallel (j12_decompress_ptr cinfo, int num_threads)
+{
+  return FALSE;			/* no threads: always decode serially */
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+
 /*
  * Initialize for a Huffman-compressed scan.
  */
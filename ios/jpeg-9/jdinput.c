@@ -520,6 +520,7 @@ latch_quant_tables (j12_decompress_ptr cinfo)
 METHODDEF(void)
 j12_start_input_pass (j12_decompress_ptr cinfo)
 {
+  TIMING_TRACE(cinfo, JTRACE_SCAN, TRUE);
   per_scan_setup(cinfo);
   latch_quant_tables(cinfo);
   (*cinfo->entropy->j12_start_pass) (cinfo);
@@ -537,6 +538,7 @@ j12_start_input_pass (j12_decompress_ptr cinfo)
 METHODDEF(void)
 j12_finish_input_pass (j12_decompress_ptr cinfo)
 {
+  TIMING_TRACE(cinfo, JTRACE_SCAN, FALSE);
   cinfo->inputctl->j12_consume_input = consume_markers;
 }
 
@@ -565,7 +567,9 @@ consume_markers (j12_decompress_ptr cinfo)
     return JPEG12_REACHED_EOI;
 
   for (;;) {			/* Loop to pass pseudo SOS marker */
+    TIMING_BEGIN(cinfo, JTIME_MARKERS);
     val = (*cinfo->marker->j12_read_markers) (cinfo);
+    TIMING_END(cinfo);
 
     switch (val) {
     case JPEG12_REACHED_SOS:	/* Found SOS */
@@ -141,6 +141,7 @@ typedef my_marker_reader * my_marker_ptr;
 	if (bytes_in_buffer == 0) {  \
 	  if (! (*datasrc->j12_fill_input_buffer) (cinfo))  \
 	    { action; }  \
+	  TIMING_FILLED(cinfo);  \
 	  INPUT_RELOAD(cinfo);  \
 	}
 
@@ -857,8 +858,11 @@ get_interesting_appn (j12_decompress_ptr cinfo)
 
   /* skip any remaining data -- could be lots */
   INPUT_SYNC(cinfo);
-  if (length > 0)
+  if (length > 0) {
+    TIMING_SKIP(cinfo, (long) length);
     (*cinfo->src->j12_skip_input_data) (cinfo, (long) length);
+    TIMING_FILLED(cinfo);
+  }
 
   return TRUE;
 }
@@ -963,8 +967,11 @@ save_marker (j12_decompress_ptr cinfo)
 
   /* skip any remaining data -- could be lots */
   INPUT_SYNC(cinfo);		/* do before j12_skip_input_data */
-  if (length > 0)
+  if (length > 0) {
+    TIMING_SKIP(cinfo, (long) length);
     (*cinfo->src->j12_skip_input_data) (cinfo, (long) length);
+    TIMING_FILLED(cinfo);
+  }
 
   return TRUE;
 }
@@ -985,8 +992,11 @@ skip_variable (j12_decompress_ptr cinfo)
   TRACEMS2(cinfo, 1, JTRC_MISC_MARKER, cinfo->unread_marker, (int) length);
 
   INPUT_SYNC(cinfo);		/* do before j12_skip_input_data */
-  if (length > 0)
+  if (length > 0) {
+    TIMING_SKIP(cinfo, (long) length);
     (*cinfo->src->j12_skip_input_data) (cinfo, (long) length);
+    TIMING_FILLED(cinfo);
+  }
 
   return TRUE;
 }
@@ -48,6 +48,9 @@ use_merged_j12_upsample (j12_decompress_ptr cinfo)
   /* Merging is the equivalent of plain box-filter upsampling */
   if (cinfo->do_fancy_upsampling || cinfo->CCIR601_sampling)
     return FALSE;
+  /* jdmerge.c doesn't produce windowed output */
+  if (cinfo->window_output)
+    return FALSE;
   /* jdmerge.c only supports YCC=>RGB color conversion */
   if (cinfo->jpeg12_color_space != JCS_YCbCr || cinfo->num_components != 3 ||
       cinfo->out_color_space != JCS_RGB ||
@@ -173,6 +176,9 @@ jpeg12_calc_output_dimensions (j12_decompress_ptr cinfo)
   }
   cinfo->output_components = (cinfo->quantize_colors ? 1 :
 			      cinfo->out_color_components);
+  /* Windowed RGB output carries an alpha byte */
+  if (cinfo->window_output && cinfo->out_color_space == JCS_RGB)
+    cinfo->output_components = 4;
 
   /* See if j12_upsampler will want to emit more than one row at a time */
   if (use_merged_j12_upsample(cinfo))
@@ -223,8 +229,52 @@ jpeg12_calc_output_dimensions (j12_decompress_ptr cinfo)
  *
  * Note that the table is allocated in near data space on PCs; it's small
  * enough and used often enough to justify this.
+ *
+ * For windowed output (window_output), a second table of JOCTETs is built
+ * with the same layout as the simple table, but with the output window or
+ * VOI LUT folded in:
+ *		x = window_range_limit[x];
+ * then range-limits and windows in a single lookup.  The color converters
+ * use it in place of sample_range_limit for their final step, so windowing
+ * costs no extra pass over the data.
  */
 
+LOCAL(void)
+prepare_window_table (j12_decompress_ptr cinfo)
+/* Allocate and fill in the window_range_limit table */
+{
+  JOCTET * table;
+  INT32 lo = cinfo->window_min;
+  INT32 width = (INT32) cinfo->window_max - lo;
+  INT32 x;
+  int i;
+
+  table = (JOCTET *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+		3 * (MAXJSAMPLE+1) * SIZEOF(JOCTET));
+  table += (MAXJSAMPLE+1);	/* allow negative subscripts of simple table */
+  cinfo->window_range_limit = table;
+  /* Main part of table: limit[x] = window(x) */
+  for (i = 0; i <= MAXJSAMPLE; i++) {
+    if (cinfo->voi_lut != NULL)
+      table[i] = cinfo->voi_lut[i];
+    else if (i <= lo)
+      table[i] = 0;
+    else if (i - lo >= width)	/* also handles an empty window */
+      table[i] = 255;
+    else {
+      x = (INT32) (i - lo) * 255;
+      table[i] = (JOCTET) ((x + (width >> 1)) / width);
+    }
+  }
+  /* Below and above the legal range: repeat the end values */
+  for (i = 1; i <= MAXJSAMPLE+1; i++) {
+    table[-i] = table[0];
+    table[MAXJSAMPLE + i] = table[MAXJSAMPLE];
+  }
+}
+
+
 LOCAL(void)
 prepare_range_limit_table (j12_decompress_ptr cinfo)
 /* Allocate and fill in the sample_range_limit table */
@@ -251,6 +301,9 @@ prepare_range_limit_table (j12_decompress_ptr cinfo)
 	  (2 * (MAXJSAMPLE+1) - CENTERJSAMPLE) * SIZEOF(JSAMPLE));
   MEMCOPY(table + (4 * (MAXJSAMPLE+1) - CENTERJSAMPLE),
 	  cinfo->sample_range_limit, CENTERJSAMPLE * SIZEOF(JSAMPLE));
+
+  if (cinfo->window_output)
+    prepare_window_table(cinfo);
 }
 
 
@@ -297,7 +350,7 @@ master_selection (j12_decompress_ptr cinfo)
     cinfo->enable_2pass_quant = FALSE;
   }
   if (cinfo->quantize_colors) {
-    if (cinfo->raw_data_out)
+    if (cinfo->raw_data_out || cinfo->window_output)
       ERREXIT(cinfo, JERR_NOTIMPL);
     /* 2-pass quantizer only works in 3-component color space. */
     if (cinfo->out_color_components != 3) {
@@ -461,6 +514,7 @@ j12_prepare_for_output_pass (j12_decompress_ptr cinfo)
       cinfo->progress->total_passes += (cinfo->enable_2pass_quant ? 2 : 1);
     }
   }
+  TIMING_TRACE(cinfo, JTRACE_OUTPUT, TRUE);
 }
 
 
@@ -473,6 +527,7 @@ j12_finish_output_pass (j12_decompress_ptr cinfo)
 {
   my_master_ptr master = (my_master_ptr) cinfo->master;
 
+  TIMING_TRACE(cinfo, JTRACE_OUTPUT, FALSE);
   if (cinfo->quantize_colors)
     (*cinfo->cquantize->j12_finish_pass) (cinfo);
   master->pass_number++;
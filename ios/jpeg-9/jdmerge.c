@@ -35,6 +35,7 @@
 #define JPEG12_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 #ifdef UPSAMPLE_MERGING_SUPPORTED
 
@@ -177,7 +178,9 @@ merged_2v_j12_upsample (j12_decompress_ptr cinfo,
       j12_upsample->spare_full = TRUE;
     }
     /* Now do the upsampling. */
+    TIMING_BEGIN(cinfo, JTIME_UPSAMPLE);
     (*j12_upsample->j12_upmethod) (cinfo, input_buf, *in_row_group_ctr, work_ptrs);
+    TIMING_END(cinfo);
   }
 
   /* Adjust counts */
@@ -200,8 +203,10 @@ merged_1v_j12_upsample (j12_decompress_ptr cinfo,
   my_j12_upsample_ptr j12_upsample = (my_j12_upsample_ptr) cinfo->j12_upsample;
 
   /* Just do the upsampling. */
+  TIMING_BEGIN(cinfo, JTIME_UPSAMPLE);
   (*j12_upsample->j12_upmethod) (cinfo, input_buf, *in_row_group_ctr,
 			 output_buf + *out_row_ctr);
+  TIMING_END(cinfo);
   /* Adjust counts */
   (*out_row_ctr)++;
   (*in_row_group_ctr)++;
@@ -382,19 +387,28 @@ jinit_merged_j12_upsampler (j12_decompress_ptr cinfo)
 
   if (cinfo->max_v_samp_factor == 2) {
     j12_upsample->pub.j12_upsample = merged_2v_j12_upsample;
-    j12_upsample->j12_upmethod = h2v2_merged_j12_upsample;
+    if (j12_simd_can_h2v2_merged_upsample())
+      j12_upsample->j12_upmethod = j12_simd_h2v2_merged_upsample;
+    else
+      j12_upsample->j12_upmethod = h2v2_merged_j12_upsample;
     /* Allocate a spare row buffer */
     j12_upsample->spare_row = (JSAMPROW)
       (*cinfo->mem->j12_alloc_large) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
 		(size_t) (j12_upsample->out_row_width * SIZEOF(JSAMPLE)));
   } else {
     j12_upsample->pub.j12_upsample = merged_1v_j12_upsample;
-    j12_upsample->j12_upmethod = h2v1_merged_j12_upsample;
+    if (j12_simd_can_h2v1_merged_upsample())
+      j12_upsample->j12_upmethod = j12_simd_h2v1_merged_upsample;
+    else
+      j12_upsample->j12_upmethod = h2v1_merged_j12_upsample;
     /* No spare row needed */
     j12_upsample->spare_row = NULL;
   }
 
-  build_ycc_rgb_table(cinfo);
+  /* The SIMD kernels compute the conversion directly, without tables. */
+  if (j12_upsample->j12_upmethod == h2v1_merged_j12_upsample ||
+      j12_upsample->j12_upmethod == h2v2_merged_j12_upsample)
+    build_ycc_rgb_table(cinfo);
 }
 
 #endif /* UPSAMPLE_MERGING_SUPPORTED */
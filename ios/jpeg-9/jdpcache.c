@@ -0,0 +1,694 @@
+/*
+ * jdpcache.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains application interface routines that keep decoded
+ * grayscale planes in files, so that an image seen before is read back
+ * instead of decoded again.  The files form a disk cache: the application
+ * names each one after a hash of the compressed data, and
+ * jpeg12_trim_plane_files() keeps the directory within a byte budget,
+ * dropping the least recently used files first.  Since a name hash can
+ * collide, each file also records the length and SHA-256 digest of the
+ * data it was decoded from (jpeg12_identify_source()), and is only used
+ * for data with the same ones.
+ *
+ * A plane file is a fixed header, the histogram of the full-scale plane and
+ * then the planes of up to JPEG12_PYRAMID_LEVELS levels, level k scaled by
+ * 1/2^k, as packed rows of JSAMPLEs in the byte order of the machine that
+ * wrote it.  Each plane starts on a 64-byte boundary, so once the file is
+ * mapped, jpeg12_map_plane_file() merely points at the planes; nothing is
+ * parsed or converted.  The smaller levels are 2x2 box averages of the
+ * next larger one (not the scaled IDCT of jpeg12_read_pyramid()).
+ *
+ * Header (all numbers are 32-bit little-endian):
+ *   0  "J12PLANE"
+ *   8  format version (2)
+ *  12  SIZEOF(JSAMPLE)
+ *  16  the JSAMPLE 0x0102, in native byte order, and 2 bytes of padding
+ *  20  number of levels
+ *  24  smallest and largest sample of the full-scale plane
+ *  32  width and height of each level
+ *  64  length of the compressed data, low and high 32 bits
+ *  72  SHA-256 digest of the compressed data (32 bytes)
+ * The histogram follows at offset 128, as MAXJSAMPLE+1 32-bit counts.
+ *
+ * A file is written under a temporary name and then renamed, so that
+ * readers never see half a file.  A file that doesn't check out (written
+ * by another build, truncated) is simply not used.
+ */
+
+/* this is not a core library module, so it doesn't define JPEG12_INTERNALS */
+#include "jinclude.h"
+#include "jpeglib.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <utime.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+#define FILE_MAGIC	"J12PLANE"
+#define FILE_VERSION	2
+#define FILE_SUFFIX	".j12p"
+#define HEADER_SIZE	128
+#define HISTOGRAM_SIZE	((MAXJSAMPLE+1) * 4)
+#define PLANE_ALIGN	64
+#define ORDER_MARK	0x0102	/* fits in any JSAMPLE, bytes differ */
+
+
+LOCAL(void)
+put_u32 (JOCTET * buf, unsigned long value)
+{
+  buf[0] = (JOCTET) (value & 0xFF);
+  buf[1] = (JOCTET) ((value >> 8) & 0xFF);
+  buf[2] = (JOCTET) ((value >> 16) & 0xFF);
+  buf[3] = (JOCTET) ((value >> 24) & 0xFF);
+}
+
+
+LOCAL(unsigned long)
+get_u32 (const JOCTET * buf)
+{
+  return (unsigned long) buf[0] | ((unsigned long) buf[1] << 8) |
+	 ((unsigned long) buf[2] << 16) | ((unsigned long) buf[3] << 24);
+}
+
+
+/*
+ * SHA-256, as specified in FIPS 180-4.  Words are kept in unsigned longs,
+ * which may be wider than 32 bits, so sums are masked.
+ */
+
+#define SHA_MASK	0xFFFFFFFFUL
+#define SHA_ROTR(x,n)	((((x) >> (n)) | ((x) << (32 - (n)))) & SHA_MASK)
+
+static const unsigned long sha_k[64] = {
+  0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+  0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+  0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+  0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+  0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+  0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+  0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+  0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+  0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+  0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+  0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+  0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+  0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+  0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+  0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+  0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+typedef struct {
+  unsigned long state[8];
+  unsigned long bytes_lo, bytes_hi; /* data hashed so far, in 32-bit words */
+  JOCTET block[64];		/* data not yet hashed */
+  int used;			/* bytes in block */
+} sha256_state;
+
+
+LOCAL(void)
+sha256_init (sha256_state * sha)
+{
+  sha->state[0] = 0x6a09e667UL;
+  sha->state[1] = 0xbb67ae85UL;
+  sha->state[2] = 0x3c6ef372UL;
+  sha->state[3] = 0xa54ff53aUL;
+  sha->state[4] = 0x510e527fUL;
+  sha->state[5] = 0x9b05688cUL;
+  sha->state[6] = 0x1f83d9abUL;
+  sha->state[7] = 0x5be0cd19UL;
+  sha->bytes_lo = sha->bytes_hi = 0;
+  sha->used = 0;
+}
+
+
+LOCAL(void)
+sha256_block (sha256_state * sha, const JOCTET * block)
+{
+  unsigned long w[64];
+  unsigned long a, b, c, d, e, f, g, h, t1, t2;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    w[i] = ((unsigned long) block[4*i] << 24) |
+	   ((unsigned long) block[4*i+1] << 16) |
+	   ((unsigned long) block[4*i+2] << 8) | (unsigned long) block[4*i+3];
+  for (; i < 64; i++) {
+    t1 = SHA_ROTR(w[i-2], 17) ^ SHA_ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+    t2 = SHA_ROTR(w[i-15], 7) ^ SHA_ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+    w[i] = (t1 + w[i-7] + t2 + w[i-16]) & SHA_MASK;
+  }
+
+  a = sha->state[0]; b = sha->state[1]; c = sha->state[2];
+  d = sha->state[3]; e = sha->state[4]; f = sha->state[5];
+  g = sha->state[6]; h = sha->state[7];
+  for (i = 0; i < 64; i++) {
+    t1 = h + (SHA_ROTR(e, 6) ^ SHA_ROTR(e, 11) ^ SHA_ROTR(e, 25)) +
+	 ((e & f) ^ (~e & g)) + sha_k[i] + w[i];
+    t2 = (SHA_ROTR(a, 2) ^ SHA_ROTR(a, 13) ^ SHA_ROTR(a, 22)) +
+	 ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e;
+    e = (d + t1) & SHA_MASK;
+    d = c; c = b; b = a;
+    a = (t1 + t2) & SHA_MASK;
+  }
+  sha->state[0] = (sha->state[0] + a) & SHA_MASK;
+  sha->state[1] = (sha->state[1] + b) & SHA_MASK;
+  sha->state[2] = (sha->state[2] + c) & SHA_MASK;
+  sha->state[3] = (sha->state[3] + d) & SHA_MASK;
+  sha->state[4] = (sha->state[4] + e) & SHA_MASK;
+  sha->state[5] = (sha->state[5] + f) & SHA_MASK;
+  sha->state[6] = (sha->state[6] + g) & SHA_MASK;
+  sha->state[7] = (sha->state[7] + h) & SHA_MASK;
+}
+
+
+LOCAL(void)
+sha256_update (sha256_state * sha, const JOCTET * data, size_t size)
+{
+  size_t take;
+
+  while (size > 0) {
+    if (sha->used == 0 && size >= 64) {
+      sha256_block(sha, data);
+      take = 64;
+    } else {
+      take = 64 - (size_t) sha->used;
+      if (take > size)
+	take = size;
+      MEMCOPY(sha->block + sha->used, data, take);
+      sha->used += (int) take;
+      if (sha->used == 64) {
+	sha256_block(sha, sha->block);
+	sha->used = 0;
+      }
+    }
+    data += take;
+    size -= take;
+    sha->bytes_lo += (unsigned long) take;
+    if (sha->bytes_lo > SHA_MASK) {
+      sha->bytes_hi += sha->bytes_lo >> 16 >> 16;
+      sha->bytes_lo &= SHA_MASK;
+    }
+  }
+}
+
+
+LOCAL(void)
+sha256_final (sha256_state * sha, JOCTET * digest)
+{
+  unsigned long bits_lo = (sha->bytes_lo << 3) & SHA_MASK;
+  unsigned long bits_hi = ((sha->bytes_hi << 3) | (sha->bytes_lo >> 29)) &
+			  SHA_MASK;
+  JOCTET pad[72];
+  size_t pad_bytes;
+  int i;
+
+  MEMZERO(pad, SIZEOF(pad));
+  pad[0] = 0x80;
+  pad_bytes = (size_t) (sha->used < 56 ? 56 - sha->used : 120 - sha->used);
+  for (i = 0; i < 4; i++) {
+    pad[pad_bytes + i] = (JOCTET) ((bits_hi >> (24 - 8 * i)) & 0xFF);
+    pad[pad_bytes + 4 + i] = (JOCTET) ((bits_lo >> (24 - 8 * i)) & 0xFF);
+  }
+  sha256_update(sha, pad, pad_bytes + 8);
+  for (i = 0; i < 32; i++)
+    digest[i] = (JOCTET) ((sha->state[i >> 2] >> (24 - 8 * (i & 3))) & 0xFF);
+}
+
+
+/*
+ * Identify the compressed data a plane is decoded from, given in one or
+ * more segments as for jpeg12_segments_src(), for jpeg12_write_plane_file()
+ * and jpeg12_map_plane_file().
+ */
+
+GLOBAL(void)
+jpeg12_identify_source (jpeg12_source_id * id,
+			const jpeg12_segment * segments, int num_segments)
+{
+  sha256_state sha;
+  int i;
+
+  sha256_init(&sha);
+  id->size = 0;
+  for (i = 0; i < num_segments; i++) {
+    sha256_update(&sha, segments[i].data, (size_t) segments[i].size);
+    id->size += segments[i].size;
+  }
+  sha256_final(&sha, id->digest);
+}
+
+
+LOCAL(void)
+put_source_id (JOCTET * header, const jpeg12_source_id * id)
+{
+  put_u32(header + 64, id->size & SHA_MASK);
+  put_u32(header + 68, (id->size >> 16 >> 16) & SHA_MASK);
+  MEMCOPY(header + 72, id->digest, JPEG12_DIGEST_SIZE);
+}
+
+
+/*
+ * Dimensions and file offsets of the levels.  Returns the file size.
+ */
+
+LOCAL(size_t)
+level_layout (JDIMENSION width, JDIMENSION height, int num_levels,
+	      JDIMENSION * widths, JDIMENSION * heights, size_t * offsets)
+{
+  size_t offset = HEADER_SIZE + HISTOGRAM_SIZE;
+  size_t bytes;
+  int k;
+
+  for (k = 0; k < num_levels; k++) {
+    widths[k] = width;
+    heights[k] = height;
+    offsets[k] = offset;
+    bytes = (size_t) width * (size_t) height * SIZEOF(JSAMPLE);
+    offset += (bytes + PLANE_ALIGN - 1) & ~((size_t) PLANE_ALIGN - 1);
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+  }
+  return offset;
+}
+
+
+/*
+ * Average 2x2 blocks of src into dest, repeating the last row and column
+ * of an odd-sized src.
+ */
+
+LOCAL(void)
+shrink_plane (const JSAMPLE * src, JDIMENSION src_stride,
+	      JDIMENSION src_width, JDIMENSION src_height,
+	      JSAMPLE * dest, JDIMENSION width, JDIMENSION height)
+{
+  const JSAMPLE * row0;
+  const JSAMPLE * row1;
+  JDIMENSION x, y, x0, x1;
+
+  for (y = 0; y < height; y++) {
+    row0 = src + (size_t) (2 * y) * src_stride;
+    row1 = 2 * y + 1 < src_height ? row0 + src_stride : row0;
+    for (x = 0; x < width; x++) {
+      x0 = 2 * x;
+      x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+      *dest++ = (JSAMPLE) ((GETJSAMPLE(row0[x0]) + GETJSAMPLE(row0[x1]) +
+			    GETJSAMPLE(row1[x0]) + GETJSAMPLE(row1[x1]) + 2)
+			   >> 2);
+    }
+  }
+}
+
+
+/*
+ * A name for the temporary file that no other writer uses.
+ */
+
+LOCAL(void)
+temp_name (char * buf, const char * path)
+{
+  static unsigned long counter = 0;
+  unsigned long serial;
+#ifdef HAVE_PTHREAD_H
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+  pthread_mutex_lock(&lock);
+  serial = ++counter;
+  pthread_mutex_unlock(&lock);
+#else
+  serial = ++counter;
+#endif
+#ifdef HAVE_SYS_MMAN_H
+  sprintf(buf, "%s.%lu.%lu.tmp", path, (unsigned long) getpid(), serial);
+#else
+  sprintf(buf, "%s.%lu.tmp", path, serial);
+#endif
+}
+
+
+/*
+ * Write a plane of width x height samples, and num_levels - 1 smaller
+ * levels of it, to a plane file, as decoded from the data identified by
+ * id.  Returns FALSE if the file could not be written; whatever file was
+ * at path before is then left as it was.
+ */
+
+GLOBAL(boolean)
+jpeg12_write_plane_file (const char * path, const jpeg12_source_id * id,
+			 const JSAMPLE * plane, JDIMENSION row_stride,
+			 JDIMENSION width, JDIMENSION height, int num_levels)
+{
+  JDIMENSION widths[JPEG12_PYRAMID_LEVELS], heights[JPEG12_PYRAMID_LEVELS];
+  size_t offsets[JPEG12_PYRAMID_LEVELS];
+  JSAMPLE * levels[JPEG12_PYRAMID_LEVELS];
+  JOCTET header[HEADER_SIZE];
+  JOCTET counts[HISTOGRAM_SIZE];
+  JOCTET padding[PLANE_ALIGN];
+  jpeg12_plane_stats * stats;
+  JSAMPLE mark = ORDER_MARK;
+  char * temp;
+  FILE * outfile = NULL;
+  boolean temp_made = FALSE;	/* is there a temporary file to remove? */
+  boolean ok = FALSE;
+  size_t bytes;
+  JDIMENSION y;
+  int i, k;
+
+  if (path == NULL || id == NULL || plane == NULL ||
+      width == 0 || height == 0 ||
+      num_levels < 1 || num_levels > JPEG12_PYRAMID_LEVELS)
+    return FALSE;
+  if (row_stride == 0)
+    row_stride = width;
+  (void) level_layout(width, height, num_levels, widths, heights, offsets);
+
+  MEMZERO(levels, SIZEOF(levels));
+  stats = (jpeg12_plane_stats *) malloc(SIZEOF(jpeg12_plane_stats));
+  temp = (char *) malloc(strlen(path) + 64);
+  if (stats == NULL || temp == NULL)
+    goto done;
+  for (k = 1; k < num_levels; k++) {
+    levels[k] = (JSAMPLE *) malloc((size_t) widths[k] * (size_t) heights[k] *
+				   SIZEOF(JSAMPLE));
+    if (levels[k] == NULL)
+      goto done;
+    if (k == 1)
+      shrink_plane(plane, row_stride, width, height,
+		   levels[1], widths[1], heights[1]);
+    else
+      shrink_plane(levels[k-1], widths[k-1], widths[k-1], heights[k-1],
+		   levels[k], widths[k], heights[k]);
+  }
+
+  jpeg12_init_plane_stats(stats);
+  jpeg12_count_plane_rows(stats, (JSAMPROW) plane, row_stride, width,
+			  (int) height);
+
+  MEMZERO(header, SIZEOF(header));
+  MEMCOPY(header, FILE_MAGIC, 8);
+  put_u32(header + 8, FILE_VERSION);
+  put_u32(header + 12, SIZEOF(JSAMPLE));
+  MEMCOPY(header + 16, &mark, SIZEOF(JSAMPLE));
+  put_u32(header + 20, (unsigned long) num_levels);
+  put_u32(header + 24, (unsigned long) stats->min_value);
+  put_u32(header + 28, (unsigned long) stats->max_value);
+  for (k = 0; k < num_levels; k++) {
+    put_u32(header + 32 + 8 * k, (unsigned long) widths[k]);
+    put_u32(header + 36 + 8 * k, (unsigned long) heights[k]);
+  }
+  put_source_id(header, id);
+  for (i = 0; i <= MAXJSAMPLE; i++)
+    put_u32(counts + 4 * i, stats->histogram[i]);
+  MEMZERO(padding, SIZEOF(padding));
+
+  temp_name(temp, path);
+  if ((outfile = fopen(temp, "wb")) == NULL)
+    goto done;
+  temp_made = TRUE;
+  if (JFWRITE(outfile, header, HEADER_SIZE) != HEADER_SIZE ||
+      JFWRITE(outfile, counts, HISTOGRAM_SIZE) != HISTOGRAM_SIZE)
+    goto done;
+  for (k = 0; k < num_levels; k++) {
+    bytes = (size_t) widths[k] * SIZEOF(JSAMPLE);
+    for (y = 0; y < heights[k]; y++) {
+      const JSAMPLE * row = k == 0 ? plane + (size_t) y * row_stride :
+			    levels[k] + (size_t) y * widths[k];
+      if (JFWRITE(outfile, row, bytes) != bytes)
+	goto done;
+    }
+    bytes = (bytes * heights[k]) % PLANE_ALIGN;
+    if (bytes != 0 && JFWRITE(outfile, padding, PLANE_ALIGN - bytes) !=
+		      PLANE_ALIGN - bytes)
+      goto done;
+  }
+  i = fclose(outfile);
+  outfile = NULL;
+  ok = (i == 0 && rename(temp, path) == 0);
+
+done:
+  if (outfile != NULL)
+    fclose(outfile);
+  if (! ok && temp_made)
+    remove(temp);
+  for (k = 1; k < num_levels; k++)
+    free(levels[k]);
+  free(temp);
+  free(stats);
+  return ok;
+}
+
+
+/*
+ * Map a plane file into memory and fill in file.  Returns FALSE if there
+ * is no usable file at path, or if the file was not decoded from the data
+ * identified by id.  Release the mapping with jpeg12_unmap_plane_file().
+ * A mapped file counts as recently used for jpeg12_trim_plane_files().
+ */
+
+GLOBAL(boolean)
+jpeg12_map_plane_file (const char * path, const jpeg12_source_id * id,
+		       jpeg12_plane_file * file)
+{
+  JDIMENSION widths[JPEG12_PYRAMID_LEVELS], heights[JPEG12_PYRAMID_LEVELS];
+  size_t offsets[JPEG12_PYRAMID_LEVELS];
+  JOCTET expected[HEADER_SIZE];
+  JSAMPLE mark = ORDER_MARK;
+  const JOCTET * base;
+  size_t size;
+  int k;
+
+  MEMZERO(file, SIZEOF(jpeg12_plane_file));
+
+#ifdef HAVE_SYS_MMAN_H
+  {
+    struct stat st;
+    void * map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+      return FALSE;
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE + HISTOGRAM_SIZE) {
+      close(fd);
+      return FALSE;
+    }
+    size = (size_t) st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);			/* the mapping keeps the file */
+    if (map == MAP_FAILED)
+      return FALSE;
+    file->map_base = map;
+    (void) utime(path, NULL);	/* most recently used now */
+  }
+#else
+  {
+    FILE * infile = fopen(path, "rb");
+    long length;
+
+    if (infile == NULL)
+      return FALSE;
+    if (fseek(infile, 0L, SEEK_END) != 0 || (length = ftell(infile)) <
+	HEADER_SIZE + HISTOGRAM_SIZE || fseek(infile, 0L, SEEK_SET) != 0) {
+      fclose(infile);
+      return FALSE;
+    }
+    size = (size_t) length;
+    file->map_base = malloc(size);
+    if (file->map_base == NULL ||
+	JFREAD(infile, file->map_base, size) != size) {
+      fclose(infile);
+      free(file->map_base);
+      file->map_base = NULL;
+      return FALSE;
+    }
+    fclose(infile);
+  }
+#endif
+  file->map_bytes = size;
+  base = (const JOCTET *) file->map_base;
+
+  file->num_levels = (int) get_u32(base + 20);
+  put_source_id(expected, id);
+  if (memcmp(base, FILE_MAGIC, 8) != 0 ||
+      get_u32(base + 8) != FILE_VERSION ||
+      get_u32(base + 12) != SIZEOF(JSAMPLE) ||
+      memcmp(base + 16, &mark, SIZEOF(JSAMPLE)) != 0 ||
+      memcmp(base + 64, expected + 64, 8 + JPEG12_DIGEST_SIZE) != 0 ||
+      file->num_levels < 1 || file->num_levels > JPEG12_PYRAMID_LEVELS ||
+      get_u32(base + 32) == 0 || get_u32(base + 36) == 0 ||
+      get_u32(base + 32) > JPEG12_MAX_DIMENSION ||
+      get_u32(base + 36) > JPEG12_MAX_DIMENSION ||
+      level_layout((JDIMENSION) get_u32(base + 32),
+		   (JDIMENSION) get_u32(base + 36), file->num_levels,
+		   widths, heights, offsets) > size) {
+    jpeg12_unmap_plane_file(file);
+    return FALSE;
+  }
+  file->min_value = (int) get_u32(base + 24);
+  file->max_value = (int) get_u32(base + 28);
+  for (k = 0; k < file->num_levels; k++) {
+    file->width[k] = widths[k];
+    file->height[k] = heights[k];
+    file->plane[k] = (const JSAMPLE *) (base + offsets[k]);
+  }
+  file->histogram = base + HEADER_SIZE;
+  return TRUE;
+}
+
+
+/*
+ * Add the statistics of the full-scale plane of a mapped file to stats.
+ */
+
+GLOBAL(void)
+jpeg12_plane_file_stats (const jpeg12_plane_file * file,
+			 jpeg12_plane_stats * stats)
+{
+  unsigned long count;
+  int i;
+
+  for (i = 0; i <= MAXJSAMPLE; i++) {
+    count = get_u32(file->histogram + 4 * i);
+    if (count == 0)
+      continue;
+    stats->histogram[i] += count;
+    stats->count += count;
+    if (i < stats->min_value)
+      stats->min_value = i;
+    if (i > stats->max_value)
+      stats->max_value = i;
+  }
+}
+
+
+GLOBAL(void)
+jpeg12_unmap_plane_file (jpeg12_plane_file * file)
+{
+  if (file->map_base != NULL) {
+#ifdef HAVE_SYS_MMAN_H
+    munmap(file->map_base, file->map_bytes);
+#else
+    free(file->map_base);
+#endif
+  }
+  MEMZERO(file, SIZEOF(jpeg12_plane_file));
+}
+
+
+/*
+ * Unmap a plane file whose jpeg12_plane_file was allocated with malloc(),
+ * and free that too.  Like jpeg12_free_plane(), this can be a finalizer,
+ * so that the mapped planes can be used in place for as long as needed.
+ */
+
+GLOBAL(void)
+jpeg12_free_plane_file (void * file)
+{
+  jpeg12_unmap_plane_file((jpeg12_plane_file *) file);
+  free(file);
+}
+
+
+#ifdef HAVE_DIRENT_H
+
+typedef struct {
+  char * path;
+  unsigned long bytes;
+  time_t used;
+} cache_file;
+
+
+METHODDEF(int)
+compare_used (const void * a, const void * b)
+{
+  time_t ua = ((const cache_file *) a)->used;
+  time_t ub = ((const cache_file *) b)->used;
+
+  return ua < ub ? -1 : ua > ub ? 1 : 0;
+}
+
+#endif
+
+
+/*
+ * Delete the least recently used plane files in directory until the rest
+ * take at most max_bytes.  Other files are left alone.  Returns the bytes
+ * taken by the remaining plane files.
+ */
+
+GLOBAL(unsigned long)
+jpeg12_trim_plane_files (const char * directory, unsigned long max_bytes)
+{
+#ifdef HAVE_DIRENT_H
+  DIR * dir;
+  struct dirent * entry;
+  struct stat st;
+  cache_file * files = NULL;
+  cache_file * grown;
+  size_t num_files = 0, max_files = 0, i, dirlen, namelen;
+  size_t suffixlen = strlen(FILE_SUFFIX);
+  unsigned long total = 0;
+  char * path;
+
+  if ((dir = opendir(directory)) == NULL)
+    return 0;
+  dirlen = strlen(directory);
+  while ((entry = readdir(dir)) != NULL) {
+    namelen = strlen(entry->d_name);
+    if (namelen <= suffixlen ||
+	strcmp(entry->d_name + namelen - suffixlen, FILE_SUFFIX) != 0)
+      continue;
+    if ((path = (char *) malloc(dirlen + namelen + 2)) == NULL)
+      break;
+    sprintf(path, "%s/%s", directory, entry->d_name);
+    if (stat(path, &st) != 0 || ! S_ISREG(st.st_mode)) {
+      free(path);
+      continue;
+    }
+    if (num_files == max_files) {
+      max_files = max_files ? 2 * max_files : 64;
+      grown = (cache_file *) realloc(files, max_files * SIZEOF(cache_file));
+      if (grown == NULL) {
+	free(path);
+	break;
+      }
+      files = grown;
+    }
+    files[num_files].path = path;
+    files[num_files].bytes = (unsigned long) st.st_size;
+    files[num_files].used = st.st_mtime;
+    num_files++;
+    total += (unsigned long) st.st_size;
+  }
+  closedir(dir);
+
+  if (total > max_bytes)
+    qsort(files, num_files, SIZEOF(cache_file), compare_used);
+  for (i = 0; i < num_files; i++) {
+    if (total > max_bytes && remove(files[i].path) == 0)
+      total -= files[i].bytes;
+    free(files[i].path);
+  }
+  free(files);
+  return total;
+#else
+  return 0;			/* can't list directories here */
+#endif
+}
@@ -0,0 +1,359 @@
+/*
+ * jdplane.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains application interface routines that decode a whole
+ * image into a caller-supplied sample plane, and gather sample statistics
+ * (histogram, min/max, percentiles) while doing so.
+ *
+ * Scanlines are decoded directly into their final place in the plane, and
+ * each group of rows is counted right after it has been written, while it
+ * is still in cache.  There is no separate pass over the image.
+ *
+ * The samples can also be passed through a lookup table on the way out,
+ * e.g. to apply a modality rescale (slope/intercept) and store 16-bit values
+ * in place of the 12-bit samples.  Again this is done per group of rows.
+ *
+ * For a first guess at the window, jpeg12_estimate_plane_stats() looks only
+ * at the DC coefficient of each block, i.e. at the block means.  This skips
+ * the IDCT and all later stages.
+ *
+ * Planes handed to a garbage-collected caller are released through
+ * jpeg12_free_plane(), so that they go back to the allocator that
+ * jpeg12_decode_batch() took them from.
+ */
+
+/* this is not a core library module, so it doesn't define JPEG12_INTERNALS */
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jerror.h"
+
+
+#define PLANE_ROWS	16	/* scanlines requested per jpeg12_read_scanlines */
+
+
+/*
+ * Reset a statistics record.
+ */
+
+GLOBAL(void)
+jpeg12_init_plane_stats (jpeg12_plane_stats * stats)
+{
+  MEMZERO(stats, SIZEOF(jpeg12_plane_stats));
+  stats->min_value = MAXJSAMPLE+1;
+  stats->max_value = -1;
+}
+
+
+/*
+ * Add the statistics in src to those in dest.
+ * This is how per-thread statistics are combined.
+ */
+
+GLOBAL(void)
+jpeg12_merge_plane_stats (jpeg12_plane_stats * dest,
+			  const jpeg12_plane_stats * src)
+{
+  int i;
+
+  dest->count += src->count;
+  if (src->min_value < dest->min_value)
+    dest->min_value = src->min_value;
+  if (src->max_value > dest->max_value)
+    dest->max_value = src->max_value;
+  for (i = 0; i <= MAXJSAMPLE; i++)
+    dest->histogram[i] += src->histogram[i];
+}
+
+
+/*
+ * Return the smallest sample value v such that at least percent % of the
+ * samples are <= v.  0 gives the minimum and 100 the maximum.
+ * Returns -1 if no samples have been counted.
+ */
+
+GLOBAL(int)
+jpeg12_plane_percentile (const jpeg12_plane_stats * stats, double percent)
+{
+  unsigned long target, sum;
+  double t;
+  int i;
+
+  if (stats->count == 0)
+    return -1;
+  if (percent <= 0.0)
+    return stats->min_value;
+  if (percent >= 100.0)
+    return stats->max_value;
+
+  t = percent * (double) stats->count / 100.0;
+  target = (unsigned long) t;
+  if ((double) target < t)
+    target++;			/* round up */
+  if (target == 0)
+    target = 1;
+
+  sum = 0;
+  for (i = stats->min_value; i < stats->max_value; i++) {
+    sum += stats->histogram[i];
+    if (sum >= target)
+      break;
+  }
+  return i;
+}
+
+
+/*
+ * Count the samples of some freshly decoded rows: num_rows rows of
+ * num_samples samples each, starting row_stride samples apart.
+ */
+
+GLOBAL(void)
+jpeg12_count_plane_rows (jpeg12_plane_stats * stats, JSAMPROW row,
+			 JDIMENSION row_stride, JDIMENSION num_samples,
+			 int num_rows)
+{
+  register JSAMPROW ptr;
+  register unsigned long * histogram = stats->histogram;
+  register JDIMENSION count;
+  register int val, minval, maxval;
+
+  minval = stats->min_value;
+  maxval = stats->max_value;
+  while (--num_rows >= 0) {
+    ptr = row;
+    for (count = num_samples; count > 0; count--) {
+      val = GETJSAMPLE(*ptr++);
+      histogram[val]++;
+      if (val < minval) minval = val;
+      if (val > maxval) maxval = val;
+    }
+    row += row_stride;
+    stats->count += num_samples;
+  }
+  stats->min_value = minval;
+  stats->max_value = maxval;
+}
+
+
+/*
+ * Pass some freshly decoded rows through a lookup table, in place.
+ * Plane samples and UINT16 values have the same size (see jpeg12_read_plane).
+ */
+
+LOCAL(void)
+map_rows (const UINT16 * lut, JSAMPROW row, JDIMENSION row_stride,
+	  JDIMENSION num_samples, int num_rows)
+{
+  register JSAMPROW inptr;
+  register UINT16 * outptr;
+  register JDIMENSION count;
+
+  while (--num_rows >= 0) {
+    inptr = row;
+    outptr = (UINT16 *) row;
+    for (count = num_samples; count > 0; count--)
+      *outptr++ = lut[GETJSAMPLE(*inptr++)];
+    row += row_stride;
+  }
+}
+
+
+/*
+ * Fill a table of MAXJSAMPLE+1 entries with round(v * slope + intercept)
+ * for each sample value v, clamped to 0..65535, for jpeg12_read_plane_mapped.
+ * Values that may come out negative (e.g. Hounsfield units) need an offset
+ * in the intercept.
+ */
+
+GLOBAL(void)
+jpeg12_build_rescale_lut (UINT16 * lut, double slope, double intercept)
+{
+  double val;
+  int i;
+
+  for (i = 0; i <= MAXJSAMPLE; i++) {
+    val = (double) i * slope + intercept + 0.5;
+    if (val < 0.0)
+      lut[i] = 0;
+    else if (val >= 65535.0)
+      lut[i] = 65535;
+    else
+      lut[i] = (UINT16) val;
+  }
+}
+
+
+/*
+ * Pack a plane of samples into 8-bit BGRA pixels for display: blue gets the
+ * low 8 bits of the sample, green the high 4, red 0 and alpha 255.  A color
+ * matrix puts the sample together again, and windows it, on the GPU.
+ * out must have room for width * height * 4 bytes.
+ */
+
+GLOBAL(void)
+jpeg12_pack_plane_bgra (const JSAMPLE * plane, JDIMENSION row_stride,
+			JDIMENSION width, JDIMENSION height, JOCTET * out)
+{
+  register const JSAMPLE * inptr;
+  register unsigned int val;
+  register JDIMENSION count;
+  JDIMENSION y;
+
+  for (y = 0; y < height; y++) {
+    inptr = plane + (size_t) y * row_stride;
+    for (count = width; count > 0; count--) {
+      val = (unsigned int) GETJSAMPLE(*inptr++);
+      *out++ = (JOCTET) (val & 0xFF);
+      *out++ = (JOCTET) (val >> 8);
+      *out++ = 0;
+      *out++ = 0xFF;
+    }
+  }
+}
+
+
+/*
+ * Release a plane allocated with malloc(), as by jpeg12_decode_batch().
+ * This has the signature of a finalizer, so that a garbage-collected
+ * caller can free the plane once it is no longer referenced.
+ */
+
+GLOBAL(void)
+jpeg12_free_plane (void * plane)
+{
+  free(plane);
+}
+
+
+/*
+ * Read all remaining scanlines into plane, which must have room for
+ * (output_height - output_scanline) rows of row_stride samples each.
+ * Row output_scanline is stored at the start of plane; each row holds
+ * output_width * output_components samples.
+ * If stats is not NULL, the samples are added to it (it is not reset,
+ * so that several images can be gathered into one record).
+ * Call after jpeg12_start_decompress; returns the number of rows read,
+ * which is less than requested only with a suspending data source.
+ */
+
+GLOBAL(JDIMENSION)
+jpeg12_read_plane (j12_decompress_ptr cinfo, JSAMPROW plane,
+		   JDIMENSION row_stride, jpeg12_plane_stats * stats)
+{
+  return jpeg12_read_plane_mapped(cinfo, plane, row_stride, stats,
+				  (const UINT16 *) NULL);
+}
+
+
+/*
+ * As jpeg12_read_plane, but if lut is not NULL, every sample v is replaced
+ * by lut[v] (a table of MAXJSAMPLE+1 entries) once it has been counted.
+ * The plane then holds UINT16 values; the statistics still describe the
+ * decoded samples.
+ */
+
+GLOBAL(JDIMENSION)
+jpeg12_read_plane_mapped (j12_decompress_ptr cinfo, JSAMPROW plane,
+			  JDIMENSION row_stride, jpeg12_plane_stats * stats,
+			  const UINT16 * lut)
+{
+  JSAMPROW rows[PLANE_ROWS];
+  JDIMENSION num_samples, total, want, got;
+  int i;
+
+  /* Windowed output is bytes, not samples; mapping is done in place */
+  if (cinfo->window_output ||
+      (lut != NULL && SIZEOF(UINT16) != SIZEOF(JSAMPLE)))
+    ERREXIT(cinfo, JERR_NOTIMPL);
+
+  num_samples = cinfo->output_width * (JDIMENSION) cinfo->output_components;
+  if (row_stride < num_samples)
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+
+  total = 0;
+  while (cinfo->output_scanline < cinfo->output_height) {
+    want = cinfo->output_height - cinfo->output_scanline;
+    if (want > PLANE_ROWS)
+      want = PLANE_ROWS;
+    for (i = 0; i < (int) want; i++)
+      rows[i] = plane + (size_t) (total + i) * row_stride;
+    got = jpeg12_read_scanlines(cinfo, rows, want);
+    if (got == 0)
+      break;			/* suspended */
+    if (cinfo->timing != NULL)
+      jpeg12_timing_begin(cinfo, JTIME_OUTPUT);
+    if (stats != NULL)
+      jpeg12_count_plane_rows(stats, rows[0], row_stride, num_samples,
+			      (int) got);
+    if (lut != NULL)
+      map_rows(lut, rows[0], row_stride, num_samples, (int) got);
+    if (cinfo->timing != NULL)
+      jpeg12_timing_end(cinfo);
+    total += got;
+  }
+  return total;
+}
+
+
+/*
+ * Estimate the statistics of the first component from its DC coefficients.
+ * Call after jpeg12_read_header(), in place of jpeg12_start_decompress();
+ * this reads the coefficients with jpeg12_read_coefficients(), so finish
+ * with jpeg12_finish_decompress() or jpeg12_abort_decompress() as usual.
+ * Each DC coefficient gives the mean of its block.  One histogram entry is
+ * counted per block.  The extremes are therefore smoothed.  Percentiles
+ * away from the ends come out close to those of the full image.
+ * The stats record is added to, not reset.
+ * Returns FALSE if the data source suspended.
+ */
+
+GLOBAL(boolean)
+jpeg12_estimate_plane_stats (j12_decompress_ptr cinfo,
+			     jpeg12_plane_stats * stats)
+{
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  JBLOCKARRAY buffer;
+  JBLOCKROW block;
+  JDIMENSION blk_x, blk_y;
+  register int val;
+  INT32 qval, dc;
+  int row;
+
+  coef_arrays = jpeg12_read_coefficients(cinfo);
+  if (coef_arrays == NULL)
+    return FALSE;		/* suspended */
+
+  compptr = cinfo->comp_info;
+  if (compptr->quant_table == NULL)
+    ERREXIT1(cinfo, JERR_NO_QUANT_TABLE, compptr->quant_tbl_no);
+  qval = (INT32) compptr->quant_table->quantval[0];
+
+  for (blk_y = 0; blk_y < compptr->height_in_blocks;
+       blk_y += (JDIMENSION) compptr->v_samp_factor) {
+    buffer = (*cinfo->mem->j12_access_virt_barray)
+      ((j12_common_ptr) cinfo, coef_arrays[0], blk_y,
+       (JDIMENSION) compptr->v_samp_factor, FALSE);
+    for (row = 0; row < compptr->v_samp_factor; row++) {
+      if (blk_y + (JDIMENSION) row >= compptr->height_in_blocks)
+	break;
+      block = buffer[row];
+      for (blk_x = 0; blk_x < compptr->width_in_blocks; blk_x++) {
+	/* The DC term is 8 times the mean, less CENTERJSAMPLE */
+	dc = (INT32) block[blk_x][0] * qval;
+	val = (int) ((dc + (dc >= 0 ? 4 : -4)) / 8) + CENTERJSAMPLE;
+	if (val < 0) val = 0;
+	else if (val > MAXJSAMPLE) val = MAXJSAMPLE;
+	stats->histogram[val]++;
+	if (val < stats->min_value) stats->min_value = val;
+	if (val > stats->max_value) stats->max_value = val;
+	stats->count++;
+      }
+    }
+  }
+  return TRUE;
+}
@@ -142,8 +142,10 @@ post_process_1pass (j12_decompress_ptr cinfo,
 		input_buf, in_row_group_ctr, in_row_groups_avail,
 		post->buffer, &num_rows, max_rows);
   /* Quantize and emit data. */
+  TIMING_BEGIN(cinfo, JTIME_POSTPROCESS);
   (*cinfo->cquantize->j12_color_quantize) (cinfo,
 		post->buffer, output_buf + *out_row_ctr, (int) num_rows);
+  TIMING_END(cinfo);
   *out_row_ctr += num_rows;
 }
 
@@ -181,8 +183,10 @@ post_process_prepass (j12_decompress_ptr cinfo,
   /* but we advance out_row_ctr so outer loop can tell when we're done. */
   if (post->next_row > old_next_row) {
     num_rows = post->next_row - old_next_row;
+    TIMING_BEGIN(cinfo, JTIME_POSTPROCESS);
     (*cinfo->cquantize->j12_color_quantize) (cinfo, post->buffer + old_next_row,
 					 (JSAMPARRAY) NULL, (int) num_rows);
+    TIMING_END(cinfo);
     *out_row_ctr += num_rows;
   }
 
@@ -226,9 +230,11 @@ post_process_2pass (j12_decompress_ptr cinfo,
     num_rows = max_rows;
 
   /* Quantize and emit data. */
+  TIMING_BEGIN(cinfo, JTIME_POSTPROCESS);
   (*cinfo->cquantize->j12_color_quantize) (cinfo,
 		post->buffer + post->next_row, output_buf + *out_row_ctr,
 		(int) num_rows);
+  TIMING_END(cinfo);
   *out_row_ctr += num_rows;
 
   /* Advance if we filled the strip. */
@@ -0,0 +1,226 @@
+/*
+ * jdpyram.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains application interface routines that decode a
+ * grayscale image at the scales 1/1, 1/2, 1/4 and 1/8 at once, each
+ * into its own sample plane (a resolution pyramid, as needed by a tiled
+ * viewer).
+ *
+ * The compressed data is entropy decoded only once, with
+ * jpeg12_read_coefficients().  Each block's coefficients are then fed to
+ * the full-size IDCT and to the reduced-size IDCTs of jidctint.c, which
+ * produce the 8x8, 4x4, 2x2 and 1x1 outputs of the block.  This is
+ * exactly what a separate decode with scale_num = 8, 4, 2 or 1 (and the
+ * default JDCT_ISLOW method) would produce for each level, without the
+ * cost of four decodes or of resampling the full plane.
+ */
+
+#define JPEG12_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+
+
+/* Working state for one output level */
+
+typedef struct {
+  inverse_DCT_method_ptr idct;	/* IDCT producing this level's blocks */
+  int size;			/* output block size (DCTSIZE >> level) */
+  JSAMPROW plane;
+  JDIMENSION row_stride;
+  JDIMENSION full_blocks;	/* blocks that fit entirely in a row */
+  jpeg12_pyramid_level * level;
+} level_state;
+
+
+/*
+ * Compute the dimensions of every pyramid level.
+ * Call after jpeg12_read_header(), e.g. to allocate the planes.
+ */
+
+GLOBAL(void)
+jpeg12_calc_pyramid (j12_decompress_ptr cinfo, jpeg12_pyramid_level * levels)
+{
+  int k;
+  long size;
+
+  if (cinfo->global_state < DSTATE_READY)
+    ERREXIT1(cinfo, JERR_BAD_STATE, cinfo->global_state);
+
+  for (k = 0; k < JPEG12_PYRAMID_LEVELS; k++) {
+    size = (long) (DCTSIZE >> k);
+    levels[k].width = (JDIMENSION)
+      j12_div_round_up((long) cinfo->image_width * size, (long) DCTSIZE);
+    levels[k].height = (JDIMENSION)
+      j12_div_round_up((long) cinfo->image_height * size, (long) DCTSIZE);
+  }
+}
+
+
+/*
+ * Allocate and fill in the sample_range_limit table used by the IDCTs,
+ * in the image pool.  The layout is the same as in jdmaster.c; the
+ * transcoding path used by jpeg12_read_coefficients() doesn't set it up.
+ * Also used by jdccache.c.
+ */
+
+GLOBAL(void)
+j12_prepare_idct_range_limit (j12_decompress_ptr cinfo)
+{
+  JSAMPLE * table;
+  int i;
+
+  table = (JSAMPLE *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+		(5 * (MAXJSAMPLE+1) + CENTERJSAMPLE) * SIZEOF(JSAMPLE));
+  table += (MAXJSAMPLE+1);	/* allow negative subscripts of simple table */
+  cinfo->sample_range_limit = table;
+  MEMZERO(table - (MAXJSAMPLE+1), (MAXJSAMPLE+1) * SIZEOF(JSAMPLE));
+  for (i = 0; i <= MAXJSAMPLE; i++)
+    table[i] = (JSAMPLE) i;
+  table += CENTERJSAMPLE;	/* Point to where post-IDCT table starts */
+  for (i = CENTERJSAMPLE; i < 2*(MAXJSAMPLE+1); i++)
+    table[i] = MAXJSAMPLE;
+  MEMZERO(table + (2 * (MAXJSAMPLE+1)),
+	  (2 * (MAXJSAMPLE+1) - CENTERJSAMPLE) * SIZEOF(JSAMPLE));
+  MEMCOPY(table + (4 * (MAXJSAMPLE+1) - CENTERJSAMPLE),
+	  cinfo->sample_range_limit, CENTERJSAMPLE * SIZEOF(JSAMPLE));
+}
+
+
+/*
+ * Copy the valid part of a block that was decoded into the scratch area.
+ */
+
+LOCAL(void)
+copy_partial_block (JSAMPARRAY scratch, JSAMPROW outptr,
+		    JDIMENSION row_stride, int num_rows, int num_cols)
+{
+  int row;
+
+  for (row = 0; row < num_rows; row++) {
+    MEMCOPY(outptr, scratch[row], num_cols * SIZEOF(JSAMPLE));
+    outptr += row_stride;
+  }
+}
+
+
+/*
+ * Read the whole image and write each level whose plane is not NULL.
+ * Level k's plane must have room for levels[k].height rows of row_stride
+ * samples (0 means packed rows of levels[k].width samples).  If a level's
+ * stats is not NULL, its samples are added to it.
+ *
+ * Call after jpeg12_read_header(), in place of jpeg12_start_decompress(),
+ * and finish with jpeg12_finish_decompress() or jpeg12_abort_decompress().
+ * Only single-component (grayscale) images are supported.
+ * Returns FALSE if the data source suspended; call again to resume.
+ */
+
+GLOBAL(boolean)
+jpeg12_read_pyramid (j12_decompress_ptr cinfo, jpeg12_pyramid_level * levels)
+{
+  static const inverse_DCT_method_ptr idct_methods[JPEG12_PYRAMID_LEVELS] = {
+    jpeg12_idct_islow, jpeg12_idct_4x4, jpeg12_idct_2x2, jpeg12_idct_1x1
+  };
+  level_state state[JPEG12_PYRAMID_LEVELS];
+  ISLOW_MULT_TYPE multipliers[DCTSIZE2];
+  JSAMPLE scratch_buf[DCTSIZE][DCTSIZE];
+  JSAMPROW scratch[DCTSIZE], rows[DCTSIZE];
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  level_state * lev;
+  JBLOCKARRAY buffer;
+  JBLOCKROW block;
+  JDIMENSION blk_x, blk_y, out_row, out_col;
+  void * saved_dct_table;
+  int num_levels, k, i, row, num_rows, num_cols;
+
+  if (cinfo->num_components != 1)
+    ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+
+  if (cinfo->global_state == DSTATE_READY)
+    jpeg12_calc_pyramid(cinfo, levels);
+
+  num_levels = 0;
+  for (k = 0; k < JPEG12_PYRAMID_LEVELS; k++) {
+    if (levels[k].plane == NULL)
+      continue;
+    lev = &state[num_levels++];
+    lev->idct = idct_methods[k];
+    lev->size = DCTSIZE >> k;
+    lev->plane = levels[k].plane;
+    lev->row_stride = levels[k].row_stride;
+    if (lev->row_stride == 0)
+      lev->row_stride = levels[k].width;
+    else if (lev->row_stride < levels[k].width)
+      ERREXIT(cinfo, JERR_BUFFER_SIZE);
+    lev->full_blocks = levels[k].width / (JDIMENSION) lev->size;
+    lev->level = &levels[k];
+  }
+
+  coef_arrays = jpeg12_read_coefficients(cinfo);
+  if (coef_arrays == NULL)
+    return FALSE;		/* suspended */
+
+  compptr = cinfo->comp_info;
+  if (compptr->quant_table == NULL)
+    ERREXIT1(cinfo, JERR_NO_QUANT_TABLE, compptr->quant_tbl_no);
+  /* All four IDCTs use the islow-style multiplier table (see jddctmgr.c) */
+  for (i = 0; i < DCTSIZE2; i++)
+    multipliers[i] = (ISLOW_MULT_TYPE) compptr->quant_table->quantval[i];
+  saved_dct_table = compptr->dct_table;
+  compptr->dct_table = (void *) multipliers;
+  j12_prepare_idct_range_limit(cinfo);
+
+  for (i = 0; i < DCTSIZE; i++)
+    scratch[i] = scratch_buf[i];
+
+  for (blk_y = 0; blk_y < compptr->height_in_blocks;
+       blk_y += (JDIMENSION) compptr->v_samp_factor) {
+    buffer = (*cinfo->mem->j12_access_virt_barray)
+      ((j12_common_ptr) cinfo, coef_arrays[0], blk_y,
+       (JDIMENSION) compptr->v_samp_factor, FALSE);
+    for (row = 0; row < compptr->v_samp_factor; row++) {
+      if (blk_y + (JDIMENSION) row >= compptr->height_in_blocks)
+	break;
+      block = buffer[row];
+      for (k = 0; k < num_levels; k++) {
+	lev = &state[k];
+	out_row = (blk_y + (JDIMENSION) row) * (JDIMENSION) lev->size;
+	num_rows = (int) (lev->level->height - out_row);
+	if (num_rows > lev->size)
+	  num_rows = lev->size;
+	for (i = 0; i < num_rows; i++)	/* no pointers past the plane */
+	  rows[i] = lev->plane + (size_t) (out_row + i) * lev->row_stride;
+	for (blk_x = 0; blk_x < compptr->width_in_blocks; blk_x++) {
+	  out_col = blk_x * (JDIMENSION) lev->size;
+	  if (num_rows == lev->size && blk_x < lev->full_blocks) {
+	    /* Block lies entirely inside the plane: decode in place */
+	    (*lev->idct) (cinfo, compptr, (JCOEFPTR) block[blk_x],
+			  rows, out_col);
+	  } else {
+	    /* Edge block: decode into scratch, keep the part that fits */
+	    (*lev->idct) (cinfo, compptr, (JCOEFPTR) block[blk_x],
+			  scratch, (JDIMENSION) 0);
+	    num_cols = (int) (lev->level->width - out_col);
+	    if (num_cols > lev->size)
+	      num_cols = lev->size;
+	    copy_partial_block(scratch, rows[0] + out_col, lev->row_stride,
+			       num_rows, num_cols);
+	  }
+	}
+	if (lev->level->stats != NULL)
+	  jpeg12_count_plane_rows(lev->level->stats, rows[0], lev->row_stride,
+				  lev->level->width, num_rows);
+      }
+    }
+  }
+
+  compptr->dct_table = saved_dct_table;
+  return TRUE;
+}
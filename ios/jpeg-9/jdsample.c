@@ -22,6 +22,7 @@
 #define JPEG12_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 
 /* Pointer to routine to j12_upsample a single component */
@@ -100,6 +101,7 @@ sep_j12_upsample (j12_decompress_ptr cinfo,
 
   /* Fill the conversion buffer, if it's empty */
   if (j12_upsample->next_row_out >= cinfo->max_v_samp_factor) {
+    TIMING_BEGIN(cinfo, JTIME_UPSAMPLE);
     for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
 	 ci++, compptr++) {
       /* Invoke per-component j12_upsample method.  Notice we pass a POINTER
@@ -109,6 +111,7 @@ sep_j12_upsample (j12_decompress_ptr cinfo,
 	input_buf[ci] + (*in_row_group_ctr * j12_upsample->rowgroup_height[ci]),
 	j12_upsample->color_buf + ci);
     }
+    TIMING_END(cinfo);
     j12_upsample->next_row_out = 0;
   }
 
@@ -126,10 +129,12 @@ sep_j12_upsample (j12_decompress_ptr cinfo,
   if (num_rows > out_rows_avail)
     num_rows = out_rows_avail;
 
+  TIMING_BEGIN(cinfo, JTIME_COLOR);
   (*cinfo->cconvert->j12_color_convert) (cinfo, j12_upsample->color_buf,
 				     (JDIMENSION) j12_upsample->next_row_out,
 				     output_buf + *out_row_ctr,
 				     (int) num_rows);
+  TIMING_END(cinfo);
 
   /* Adjust counts */
   *out_row_ctr += num_rows;
@@ -337,11 +342,17 @@ jinit_j12_upsampler (j12_decompress_ptr cinfo)
     } else if (h_in_group * 2 == h_out_group &&
 	       v_in_group == v_out_group) {
       /* Special case for 2h1v upsampling */
-      j12_upsample->methods[ci] = h2v1_j12_upsample;
+      if (j12_simd_can_h2v1_upsample())
+	j12_upsample->methods[ci] = j12_simd_h2v1_upsample;
+      else
+	j12_upsample->methods[ci] = h2v1_j12_upsample;
     } else if (h_in_group * 2 == h_out_group &&
 	       v_in_group * 2 == v_out_group) {
       /* Special case for 2h2v upsampling */
-      j12_upsample->methods[ci] = h2v2_j12_upsample;
+      if (j12_simd_can_h2v2_upsample())
+	j12_upsample->methods[ci] = j12_simd_h2v2_upsample;
+      else
+	j12_upsample->methods[ci] = h2v2_j12_upsample;
     } else if ((h_out_group % h_in_group) == 0 &&
 	       (v_out_group % v_in_group) == 0) {
       /* Generic integral-factors upsampling method */
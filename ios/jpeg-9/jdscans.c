@@ -0,0 +1,676 @@
+/*
+ * jdscans.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains the decoding of the scans of a multi-scan Huffman
+ * file (progressive, or sequential with one scan per component) on several
+ * threads, for jpeg12_read_coefficients().
+ *
+ * Normally each scan is entropy decoded into the whole-image coefficient
+ * buffer of jdcoefct.c before the next one is even looked at.  But scans
+ * that have no component in common, or that cover disjoint coefficient
+ * bands (Ss..Se), touch disjoint coefficients and can be decoded at the
+ * same time.  So we first index the file: each scan is set up as usual
+ * (which checks the progression and parses the markers in between), its
+ * parameters and a copy of the entropy decoder are saved, and its data is
+ * skipped.  Then a pool of threads decodes the scans, each one as soon as
+ * all earlier scans it overlaps with are done, every thread on a private
+ * copy of the decompression object.
+ *
+ * Messages are collected per scan and replayed in file order at the end,
+ * so warnings, traces and a fatal error come out as if decoding serially.
+ * (Only with corrupt data might the count of extraneous bytes skipped
+ * before a marker come out differently, higher or lower.)
+ *
+ * This requires the whole file to be in the source buffer (as with
+ * jpeg12_mem_src), the coefficient arrays to be held in memory, and POSIX
+ * threads.  Otherwise nothing is changed and the file is decoded serially.
+ */
+
+#define JPEG12_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include <setjmp.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+#ifdef HAVE_PTHREAD_H
+
+#define MAX_SCAN_THREADS	64	/* upper limit on threads per file */
+
+#define SAVED_ERROR	(-1000)	/* level of a message from j12_error_exit */
+
+
+/* A message saved for replay */
+
+typedef struct {
+  int msg_level;		/* as for j12_emit_message, or SAVED_ERROR */
+  int msg_code;
+  union {
+    int i[8];
+    char s[JMSG_STR_PARM_MAX];
+  } msg_parm;
+} saved_message;
+
+typedef struct {
+  saved_message * msgs;		/* malloc'd, since threads add to it */
+  int num_msgs, max_msgs;
+} message_list;
+
+
+/* Error manager that saves the messages instead of emitting them */
+
+typedef struct {
+  struct jpeg12_error_mgr pub;	/* "public" fields */
+  message_list * list;		/* where the messages go */
+  jmp_buf setjmp_buffer;	/* for return after an error */
+} saving_error_mgr;
+
+typedef saving_error_mgr * saving_error_ptr;
+
+
+/* A scan, as set up by j12_start_input_pass */
+
+typedef struct {
+  int comps_in_scan;
+  jpeg12_component_info comp_info[MAX_COMPS_IN_SCAN];
+  JDIMENSION MCUs_per_row;
+  JDIMENSION MCU_rows_in_scan;
+  int blocks_in_MCU;
+  int MCU_membership[D_MAX_BLOCKS_IN_MCU];
+  int Ss, Se, Ah, Al;
+  unsigned int restart_interval;
+  int next_restart_num;
+  struct jpeg12_entropy_decoder * entropy; /* private copy */
+
+  const JOCTET * data;		/* start of the entropy-coded data */
+  size_t bytes_in_buffer;	/* # of bytes from there to end of input */
+
+  message_list during;		/* messages from decoding the scan */
+  message_list after;		/* messages from the markers after it */
+  boolean started, done;
+} scan_job;
+
+
+/* State shared by the threads */
+
+typedef struct {
+  j12_decompress_ptr cinfo;
+  scan_job * scans;
+  int num_scans, max_scans;
+  int num_started;		/* scans handed out so far */
+  JBLOCKROW * rows[MAX_COMPONENTS]; /* every block row of each component */
+  pthread_mutex_t lock;		/* protects started, done and num_started */
+  pthread_cond_t scan_done;	/* signalled when a scan is done */
+} scan_queue;
+
+
+/*
+ * Methods of the saving error manager.
+ */
+
+LOCAL(void)
+save_message (j12_common_ptr cinfo, int msg_level)
+{
+  saving_error_ptr err = (saving_error_ptr) cinfo->err;
+  message_list * list = err->list;
+  saved_message * msgs;
+  int max_msgs;
+
+  if (list->num_msgs == list->max_msgs) {
+    max_msgs = list->max_msgs * 2 + 8;
+    msgs = (saved_message *) realloc(list->msgs,
+				     max_msgs * SIZEOF(saved_message));
+    if (msgs == NULL)
+      return;			/* lose the message rather than fail */
+    list->msgs = msgs;
+    list->max_msgs = max_msgs;
+  }
+  msgs = &list->msgs[list->num_msgs++];
+  msgs->msg_level = msg_level;
+  msgs->msg_code = err->pub.msg_code;
+  MEMCOPY(&msgs->msg_parm, &err->pub.msg_parm, SIZEOF(msgs->msg_parm));
+}
+
+METHODDEF(noreturn_t)
+saving_error_exit (j12_common_ptr cinfo)
+{
+  save_message(cinfo, SAVED_ERROR);
+  longjmp(((saving_error_ptr) cinfo->err)->setjmp_buffer, 1);
+}
+
+METHODDEF(void)
+saving_emit_message (j12_common_ptr cinfo, int msg_level)
+{
+  /* Keep what the standard j12_emit_message would show or count */
+  if (msg_level < 0 || msg_level <= cinfo->err->trace_level)
+    save_message(cinfo, msg_level);
+}
+
+LOCAL(void)
+init_saving_error_mgr (saving_error_ptr err, struct jpeg12_error_mgr * model,
+		       message_list * list)
+{
+  err->pub = *model;
+  err->pub.j12_error_exit = saving_error_exit;
+  err->pub.j12_emit_message = saving_emit_message;
+  err->list = list;
+}
+
+
+/*
+ * Data source for a thread: the whole input from the start of a scan's
+ * data, as the serial decoder would see it.
+ */
+
+METHODDEF(void)
+init_scan_source (j12_decompress_ptr cinfo)
+{
+  /* no work necessary here */
+}
+
+METHODDEF(boolean)
+fill_scan_input_buffer (j12_decompress_ptr cinfo)
+{
+  static const JOCTET mybuffer[4] = {
+    (JOCTET) 0xFF, (JOCTET) JPEG12_EOI, 0, 0
+  };
+
+  /* Can't happen, since the input ends with EOI; see jdatasrc.c */
+  WARNMS(cinfo, JWRN_JPEG12_EOF);
+  cinfo->src->next_input_byte = mybuffer;
+  cinfo->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+
+METHODDEF(void)
+skip_scan_input_data (j12_decompress_ptr cinfo, long num_bytes)
+{
+  struct jpeg12_source_mgr * src = cinfo->src;
+
+  if (num_bytes > 0) {
+    while (num_bytes > (long) src->bytes_in_buffer) {
+      num_bytes -= (long) src->bytes_in_buffer;
+      (void) (*src->j12_fill_input_buffer) (cinfo);
+    }
+    src->next_input_byte += (size_t) num_bytes;
+    src->bytes_in_buffer -= (size_t) num_bytes;
+  }
+}
+
+METHODDEF(void)
+term_scan_source (j12_decompress_ptr cinfo)
+{
+  /* no work necessary here */
+}
+
+
+/*
+ * Check that the rest of the file, up to and including EOI, is in the
+ * source buffer, and count its scans (the current one included).
+ * Returns 0 if EOI isn't there.
+ */
+
+LOCAL(int)
+count_scans (j12_decompress_ptr cinfo)
+{
+  const JOCTET * p = cinfo->src->next_input_byte;
+  const JOCTET * end = p + cinfo->src->bytes_in_buffer;
+  int c, num_scans = 1;
+
+  for (;;) {
+    /* Skip entropy-coded data up to a marker other than RSTn */
+    for (;;) {
+      while (p < end && GETJOCTET(*p) != 0xFF)
+	p++;
+      while (p < end && GETJOCTET(*p) == 0xFF)
+	p++;
+      if (p == end)
+	return 0;
+      c = GETJOCTET(*p++);
+      if (c != 0 && (c < (int) JPEG12_RST0 || c > (int) JPEG12_RST0 + 7))
+	break;
+    }
+    /* Skip marker segments up to the next SOS */
+    for (;;) {
+      if (c == (int) JPEG12_EOI)
+	return num_scans;
+      if (c != 0x01 && (c < (int) JPEG12_RST0 || c > (int) JPEG12_RST0 + 7)) {
+	if (end - p < 2)
+	  return 0;
+	if (end - p < ((GETJOCTET(p[0]) << 8) + GETJOCTET(p[1])))
+	  return 0;
+	p += (GETJOCTET(p[0]) << 8) + GETJOCTET(p[1]);
+      }
+      if (c == 0xDA) {		/* SOS */
+	num_scans++;
+	break;
+      }
+      while (p < end && GETJOCTET(*p) == 0xFF)
+	p++;
+      if (p == end)
+	return 0;
+      c = GETJOCTET(*p++);
+    }
+  }
+}
+
+
+/*
+ * Save the parameters of the scan that was just set up,
+ * and skip its data up to the marker that ends it.
+ */
+
+LOCAL(void)
+save_scan (j12_decompress_ptr cinfo, scan_job * scan)
+{
+  struct jpeg12_source_mgr * src = cinfo->src;
+  const JOCTET * p = src->next_input_byte;
+  const JOCTET * end = p + src->bytes_in_buffer;
+  int ci, c;
+
+  scan->comps_in_scan = cinfo->comps_in_scan;
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++)
+    scan->comp_info[ci] = *cinfo->cur_comp_info[ci];
+  scan->MCUs_per_row = cinfo->MCUs_per_row;
+  scan->MCU_rows_in_scan = cinfo->MCU_rows_in_scan;
+  scan->blocks_in_MCU = cinfo->blocks_in_MCU;
+  MEMCOPY(scan->MCU_membership, cinfo->MCU_membership,
+	  SIZEOF(scan->MCU_membership));
+  scan->Ss = cinfo->Ss;
+  scan->Se = cinfo->Se;
+  scan->Ah = cinfo->Ah;
+  scan->Al = cinfo->Al;
+  scan->restart_interval = cinfo->restart_interval;
+  scan->next_restart_num = cinfo->marker->next_restart_num;
+  scan->entropy = j12_huff_copy_decoder(cinfo);
+  scan->data = p;
+  scan->bytes_in_buffer = src->bytes_in_buffer;
+
+  /* Find the marker the entropy decoder would stop at.
+   * RSTn markers belong to the data only if restarts are enabled.
+   */
+  for (;;) {
+    while (p < end && GETJOCTET(*p) != 0xFF)
+      p++;
+    while (p < end && GETJOCTET(*p) == 0xFF)
+      p++;
+    if (p == end)
+      ERREXIT(cinfo, JERR_CANT_SUSPEND); /* count_scans made sure of it */
+    c = GETJOCTET(*p++);
+    if (c != 0 && (cinfo->restart_interval == 0 ||
+		   c < (int) JPEG12_RST0 || c > (int) JPEG12_RST0 + 7))
+      break;
+  }
+  cinfo->unread_marker = c;
+  src->bytes_in_buffer -= (size_t) (p - src->next_input_byte);
+  src->next_input_byte = p;
+}
+
+
+/*
+ * Decode a scan on a private copy of the decompression object,
+ * in the same order as j12_consume_data() in jdcoefct.c.
+ */
+
+LOCAL(void)
+decode_scan (scan_queue * queue, scan_job * scan)
+{
+  j12_decompress_ptr cinfo = queue->cinfo;
+  struct jpeg12_decompress_struct dinfo;
+  struct jpeg12_source_mgr src;
+  struct jpeg12_marker_reader marker;
+  saving_error_mgr err;
+  JBLOCKROW MCU_buffer[D_MAX_BLOCKS_IN_MCU];
+  jpeg12_component_info * compptr;
+  JDIMENSION iMCU_row, MCU_col_num, start_col, row;
+  int blkn, ci, xindex, yindex, yoffset, MCU_rows;
+  const JOCTET * p;
+  int c;
+
+  dinfo = *cinfo;
+  init_saving_error_mgr(&err, cinfo->err, &scan->during);
+  dinfo.err = &err.pub;
+  src.next_input_byte = scan->data;
+  src.bytes_in_buffer = scan->bytes_in_buffer;
+  src.j12_init_source = init_scan_source;
+  src.j12_fill_input_buffer = fill_scan_input_buffer;
+  src.j12_skip_input_data = skip_scan_input_data;
+  src.j12_resync_to_restart = cinfo->src->j12_resync_to_restart;
+  src.j12_term_source = term_scan_source;
+  dinfo.src = &src;
+  marker = *cinfo->marker;
+  marker.next_restart_num = scan->next_restart_num;
+  marker.discarded_bytes = 0;
+  dinfo.marker = &marker;
+  dinfo.progress = NULL;
+  dinfo.timing = NULL;		/* counted by the calling thread */
+  dinfo.unread_marker = 0;
+
+  dinfo.comps_in_scan = scan->comps_in_scan;
+  for (ci = 0; ci < scan->comps_in_scan; ci++)
+    dinfo.cur_comp_info[ci] = &scan->comp_info[ci];
+  dinfo.MCUs_per_row = scan->MCUs_per_row;
+  dinfo.MCU_rows_in_scan = scan->MCU_rows_in_scan;
+  dinfo.blocks_in_MCU = scan->blocks_in_MCU;
+  MEMCOPY(dinfo.MCU_membership, scan->MCU_membership,
+	  SIZEOF(dinfo.MCU_membership));
+  dinfo.Ss = scan->Ss;
+  dinfo.Se = scan->Se;
+  dinfo.Ah = scan->Ah;
+  dinfo.Al = scan->Al;
+  dinfo.restart_interval = scan->restart_interval;
+  dinfo.entropy = scan->entropy;
+
+  if (setjmp(err.setjmp_buffer))
+    return;			/* the error has been saved */
+
+  for (iMCU_row = 0; iMCU_row < dinfo.total_iMCU_rows; iMCU_row++) {
+    /* See start_iMCU_row() in jdcoefct.c */
+    if (dinfo.comps_in_scan > 1)
+      MCU_rows = 1;
+    else if (iMCU_row < dinfo.total_iMCU_rows - 1)
+      MCU_rows = dinfo.cur_comp_info[0]->v_samp_factor;
+    else
+      MCU_rows = dinfo.cur_comp_info[0]->last_row_height;
+
+    for (yoffset = 0; yoffset < MCU_rows; yoffset++) {
+      for (MCU_col_num = 0; MCU_col_num < dinfo.MCUs_per_row; MCU_col_num++) {
+	blkn = 0;
+	for (ci = 0; ci < dinfo.comps_in_scan; ci++) {
+	  compptr = dinfo.cur_comp_info[ci];
+	  start_col = MCU_col_num * compptr->MCU_width;
+	  row = iMCU_row * (JDIMENSION) compptr->v_samp_factor +
+		(JDIMENSION) yoffset;
+	  for (yindex = 0; yindex < compptr->MCU_height; yindex++) {
+	    for (xindex = 0; xindex < compptr->MCU_width; xindex++) {
+	      MCU_buffer[blkn++] = queue->rows[compptr->component_index]
+		[row + (JDIMENSION) yindex] + start_col + xindex;
+	    }
+	  }
+	}
+	if (! (*dinfo.entropy->j12_decode_mcu) (&dinfo, MCU_buffer))
+	  ERREXIT(&dinfo, JERR_CANT_SUSPEND);
+      }
+    }
+  }
+
+  /* If the decoder stopped short of the marker, the serial path would
+   * skip to it and complain about the bytes in between (see next_marker()
+   * in jdmarker.c).
+   */
+  if (dinfo.unread_marker == 0) {
+    p = src.next_input_byte;
+    for (;;) {
+      while (GETJOCTET(*p) != 0xFF) {
+	marker.discarded_bytes++;
+	p++;
+      }
+      do {
+	c = GETJOCTET(*++p);
+      } while (c == 0xFF);
+      p++;
+      if (c != 0)
+	break;
+      marker.discarded_bytes += 2;
+    }
+    if (marker.discarded_bytes != 0)
+      WARNMS2(&dinfo, JWRN_EXTRANEOUS_DATA, marker.discarded_bytes, c);
+  }
+}
+
+
+/*
+ * Tell whether scan a must be decoded before scan b (or vice versa).
+ */
+
+LOCAL(int)
+last_coef_written (scan_job * scan)
+{
+  /* With corrupt data, an AC first scan can run up to 15 coefficients
+   * past the end of its band (see j12_decode_mcu_AC_first in jdhuff.c).
+   */
+  if (scan->Ss != 0 && scan->Ah == 0)
+    return scan->Se + 15 < DCTSIZE2 ? scan->Se + 15 : DCTSIZE2 - 1;
+  return scan->Se;
+}
+
+LOCAL(boolean)
+scans_overlap (scan_job * a, scan_job * b)
+{
+  int i, j;
+
+  if (last_coef_written(a) < b->Ss || last_coef_written(b) < a->Ss)
+    return FALSE;		/* disjoint coefficient bands */
+  for (i = 0; i < a->comps_in_scan; i++)
+    for (j = 0; j < b->comps_in_scan; j++)
+      if (a->comp_info[i].component_index == b->comp_info[j].component_index)
+	return TRUE;
+  return FALSE;
+}
+
+
+/*
+ * Find the first scan that can be decoded now, or return -1.
+ * Call with the lock held.
+ */
+
+LOCAL(int)
+next_ready_scan (scan_queue * queue)
+{
+  int s, t;
+
+  for (s = 0; s < queue->num_scans; s++) {
+    if (queue->scans[s].started)
+      continue;
+    for (t = 0; t < s; t++)
+      if (! queue->scans[t].done &&
+	  scans_overlap(&queue->scans[t], &queue->scans[s]))
+	break;
+    if (t == s)
+      return s;
+  }
+  return -1;
+}
+
+
+LOCAL(void *)
+scan_worker (void * arg)
+{
+  scan_queue * queue = (scan_queue *) arg;
+  int s;
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->num_started < queue->num_scans) {
+    s = next_ready_scan(queue);
+    if (s < 0) {
+      pthread_cond_wait(&queue->scan_done, &queue->lock);
+      continue;
+    }
+    queue->scans[s].started = TRUE;
+    queue->num_started++;
+    pthread_mutex_unlock(&queue->lock);
+    decode_scan(queue, &queue->scans[s]);
+    pthread_mutex_lock(&queue->lock);
+    queue->scans[s].done = TRUE;
+    pthread_cond_broadcast(&queue->scan_done);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return NULL;
+}
+
+
+/*
+ * Emit the saved messages in file order, and release them.
+ * A saved error is raised (after releasing everything).
+ */
+
+LOCAL(void)
+replay_messages (j12_decompress_ptr cinfo, scan_queue * queue)
+{
+  struct jpeg12_error_mgr * err = cinfo->err;
+  message_list * list;
+  saved_message * msg;
+  int s, k, i;
+  boolean failed = FALSE;
+
+  for (s = 0; s < queue->num_scans && ! failed; s++) {
+    for (k = 0; k < 2 && ! failed; k++) {
+      list = k ? &queue->scans[s].after : &queue->scans[s].during;
+      for (i = 0; i < list->num_msgs; i++) {
+	msg = &list->msgs[i];
+	err->msg_code = msg->msg_code;
+	MEMCOPY(&err->msg_parm, &msg->msg_parm, SIZEOF(err->msg_parm));
+	if (msg->msg_level == SAVED_ERROR) {
+	  failed = TRUE;
+	  break;
+	}
+	(*err->j12_emit_message) ((j12_common_ptr) cinfo, msg->msg_level);
+      }
+    }
+  }
+
+  for (s = 0; s < queue->num_scans; s++) {
+    free(queue->scans[s].during.msgs);
+    free(queue->scans[s].after.msgs);
+  }
+  if (failed)
+    (*err->j12_error_exit) ((j12_common_ptr) cinfo);
+}
+
+
+/*
+ * Entropy decode all the scans of the file with up to num_threads threads.
+ * Called by jpeg12_read_coefficients() right after the first scan's
+ * j12_start_input_pass.  Returns TRUE if the whole file has been read
+ * (the input controller then has reached EOI), or FALSE if the file isn't
+ * suitable, in which case nothing has been changed.
+ */
+
+GLOBAL(boolean)
+j12_decode_scans_parallel (j12_decompress_ptr cinfo, int num_threads)
+{
+  jvirt_barray_ptr * coef_arrays = cinfo->coef->coef_arrays;
+  struct jpeg12_error_mgr * err = cinfo->err;
+  saving_error_mgr index_err;
+  message_list lost;
+  pthread_t threads[MAX_SCAN_THREADS];
+  jpeg12_component_info * compptr;
+  JBLOCKARRAY buffer;
+  JDIMENSION iMCU_row;
+  scan_queue * queue;
+  scan_job * scan;
+  int ci, i, max_scans, started, retcode;
+
+  if (cinfo->arith_code || cinfo->unread_marker != 0 ||
+      cinfo->input_iMCU_row != 0 || coef_arrays == NULL)
+    return FALSE;
+  for (ci = 0; ci < cinfo->num_components; ci++)
+    if (! j12_virt_barray_in_memory(coef_arrays[ci]))
+      return FALSE;
+  if ((max_scans = count_scans(cinfo)) == 0)
+    return FALSE;
+  if (num_threads > MAX_SCAN_THREADS)
+    num_threads = MAX_SCAN_THREADS;
+
+  queue = (scan_queue *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+				SIZEOF(scan_queue));
+  MEMZERO(queue, SIZEOF(scan_queue));
+  queue->cinfo = cinfo;
+  queue->max_scans = max_scans;
+  queue->scans = (scan_job *)
+    (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+				max_scans * SIZEOF(scan_job));
+  MEMZERO(queue->scans, max_scans * SIZEOF(scan_job));
+
+  /* Get pointers to all block rows, as j12_consume_data() would access them
+   * (this also zeroes the arrays).
+   */
+  for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
+       ci++, compptr++) {
+    queue->rows[ci] = (JBLOCKROW *)
+      (*cinfo->mem->j12_alloc_small) ((j12_common_ptr) cinfo, JPOOL_IMAGE,
+		cinfo->total_iMCU_rows * compptr->v_samp_factor *
+		SIZEOF(JBLOCKROW));
+    for (iMCU_row = 0; iMCU_row < cinfo->total_iMCU_rows; iMCU_row++) {
+      buffer = (*cinfo->mem->j12_access_virt_barray)
+	((j12_common_ptr) cinfo, coef_arrays[ci],
+	 iMCU_row * compptr->v_samp_factor,
+	 (JDIMENSION) compptr->v_samp_factor, TRUE);
+      for (i = 0; i < compptr->v_samp_factor; i++)
+	queue->rows[ci][iMCU_row * compptr->v_samp_factor + i] = buffer[i];
+    }
+  }
+
+  /* Index the scans, saving the messages this produces */
+  MEMZERO(&lost, SIZEOF(lost));
+  init_saving_error_mgr(&index_err, err, &lost);
+  cinfo->err = &index_err.pub;
+  if (setjmp(index_err.setjmp_buffer) == 0) {
+    for (;;) {
+      if (queue->num_scans == queue->max_scans)
+	ERREXIT(cinfo, JERR_CANT_SUSPEND); /* count_scans missed one */
+      scan = &queue->scans[queue->num_scans++];
+      save_scan(cinfo, scan);
+      TIMING_COUNT(cinfo, MCUs,
+		   (long) scan->MCUs_per_row * (long) scan->MCU_rows_in_scan);
+      TIMING_COUNT(cinfo, blocks,
+		   (long) scan->MCUs_per_row * (long) scan->MCU_rows_in_scan *
+		   (long) scan->blocks_in_MCU);
+      index_err.list = &scan->after;
+      /* Finish the scan as j12_consume_data() would */
+      cinfo->input_iMCU_row = cinfo->total_iMCU_rows;
+      (*cinfo->inputctl->j12_finish_input_pass) (cinfo);
+      retcode = (*cinfo->inputctl->j12_consume_input) (cinfo);
+      if (retcode == JPEG12_REACHED_EOI)
+	break;
+      if (retcode != JPEG12_REACHED_SOS)
+	ERREXIT(cinfo, JERR_CANT_SUSPEND);
+    }
+  }
+  cinfo->err = err;
+  free(lost.msgs);
+
+  /* Decode them, on this thread too; the lock is set up only if used */
+  if (num_threads > queue->num_scans)
+    num_threads = queue->num_scans;
+  if (num_threads > 1 && pthread_mutex_init(&queue->lock, NULL) != 0)
+    num_threads = 1;
+  if (num_threads > 1 && pthread_cond_init(&queue->scan_done, NULL) != 0) {
+    pthread_mutex_destroy(&queue->lock);
+    num_threads = 1;
+  }
+  if (num_threads > 1) {
+    for (started = 0; started < num_threads - 1; started++)
+      if (pthread_create(&threads[started], NULL, scan_worker, queue) != 0)
+	break;
+    scan_worker(queue);
+    for (i = 0; i < started; i++)
+      pthread_join(threads[i], NULL);
+    pthread_cond_destroy(&queue->scan_done);
+    pthread_mutex_destroy(&queue->lock);
+  } else {
+    for (i = 0; i < queue->num_scans; i++)
+      decode_scan(queue, &queue->scans[i]);
+  }
+
+  replay_messages(cinfo, queue);
+  return TRUE;
+}
+
+#else /* ! HAVE_PTHREAD_H */
+
+GLOBAL(boolean)
+j12_decode_scans_parallel (j12_decompress_ptr cinfo, int num_threads)
+{
+  return FALSE;			/* no threads: always decode serially */
+}
+
+#endif /* HAVE_PTHREAD_H */
@@ -0,0 +1,252 @@
+/*
+ * jdtiming.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains the per-stage timing of the decoder.  While
+ * cinfo->timing points to a jpeg12_decode_timing record, the decoder
+ * modules mark where each stage (marker reading, entropy decoding, IDCT,
+ * upsampling, color conversion, post-processing, output) begins and ends,
+ * and count the MCUs, blocks and rows they process.  The stages nest: time
+ * spent in an inner stage (say color conversion, called by the upsampler)
+ * is charged to that stage only.  Time outside all stages, e.g. in the
+ * application between calls, is not charged at all.
+ *
+ * The clock is read only when a stage changes, which happens a few times
+ * per MCU at most.  Without a record the hooks cost a pointer test, and
+ * building without D_TIMING_SUPPORTED (jmorecfg.h) removes them altogether;
+ * the entry points then do nothing.
+ *
+ * The compressed bytes consumed are counted without help from the data
+ * source: the decoder tells us whenever it refills or skips input, and the
+ * bytes consumed from the current buffer follow from bytes_in_buffer.
+ *
+ * Stages change far too often to be shown one by one in a profiler, so an
+ * application that wants to follow the decode as it happens gets coarser
+ * events instead: the header, each input scan and each output pass.  The
+ * record is up to date whenever its trace method is called, so the method
+ * can tell how the time of an event was spent by comparing the record at
+ * its beginning and end.  Time spent in the trace method is not charged.
+ */
+
+#define JPEG12_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+
+#ifdef D_TIMING_SUPPORTED
+#include <time.h>
+#endif
+
+
+/*
+ * Reset a timing record.
+ */
+
+GLOBAL(boolean)
+jpeg12_init_decode_timing (jpeg12_decode_timing * timing)
+{
+  MEMZERO(timing, SIZEOF(jpeg12_decode_timing));
+  timing->current_stage = -1;
+  timing->input_mark = -1;
+#ifdef D_TIMING_SUPPORTED
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+
+#ifdef D_TIMING_SUPPORTED
+
+/*
+ * Monotonic wall clock, in seconds.
+ */
+
+LOCAL(double)
+read_clock (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1.0e-9;
+#endif
+  return (double) clock() / (double) CLOCKS_PER_SEC;
+}
+
+
+/*
+ * Charge the time since the last stage change to the current stage,
+ * and bring input_bytes up to date.
+ */
+
+LOCAL(void)
+charge_stage (j12_decompress_ptr cinfo, jpeg12_decode_timing * timing)
+{
+  struct jpeg12_source_mgr * src = cinfo->src;
+  double now = read_clock();
+
+  if (timing->current_stage >= 0)
+    timing->seconds[timing->current_stage] += now - timing->stage_start;
+  timing->stage_start = now;
+
+  if (src != NULL) {
+    if (timing->input_mark < 0)	/* first look at this source */
+      timing->input_mark = (long) src->bytes_in_buffer;
+    if (timing->input_mark >= (long) src->bytes_in_buffer)
+      timing->input_bytes = timing->input_base + (unsigned long)
+	(timing->input_mark - (long) src->bytes_in_buffer);
+  }
+}
+
+
+/*
+ * Enter a stage, to be left with jpeg12_timing_end().
+ */
+
+GLOBAL(void)
+jpeg12_timing_begin (j12_decompress_ptr cinfo, int stage)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  if (timing == NULL || stage < 0 || stage >= JPEG12_TIMING_STAGES)
+    return;
+  charge_stage(cinfo, timing);
+  if (timing->depth < JPEG12_TIMING_DEPTH)
+    timing->outer_stage[timing->depth] = timing->current_stage;
+  timing->depth++;
+  timing->current_stage = stage;
+  timing->calls[stage]++;
+}
+
+
+/*
+ * Leave the current stage for another one at the same level;
+ * this is the same as jpeg12_timing_end() and jpeg12_timing_begin(),
+ * with one look at the clock.
+ */
+
+GLOBAL(void)
+jpeg12_timing_switch (j12_decompress_ptr cinfo, int stage)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  if (timing == NULL || stage < 0 || stage >= JPEG12_TIMING_STAGES)
+    return;
+  charge_stage(cinfo, timing);
+  timing->current_stage = stage;
+  timing->calls[stage]++;
+}
+
+
+/*
+ * Leave the current stage, returning to the one it was entered from.
+ */
+
+GLOBAL(void)
+jpeg12_timing_end (j12_decompress_ptr cinfo)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  if (timing == NULL)
+    return;
+  charge_stage(cinfo, timing);
+  if (timing->depth <= 0)
+    return;			/* unbalanced; ignore */
+  timing->depth--;
+  if (timing->depth < JPEG12_TIMING_DEPTH)
+    timing->current_stage = timing->outer_stage[timing->depth];
+}
+
+
+/*
+ * A new datastream has been started.  This also forgets any stages left
+ * open by an error exit.
+ */
+
+GLOBAL(void)
+j12_timing_start (j12_decompress_ptr cinfo)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  timing->current_stage = -1;
+  timing->depth = 0;
+  if (timing->input_mark >= 0)
+    timing->input_base = timing->input_bytes;
+  timing->input_mark = (long) cinfo->src->bytes_in_buffer;
+}
+
+
+/*
+ * The source buffer was empty and has just been refilled.
+ */
+
+GLOBAL(void)
+j12_timing_fill (j12_decompress_ptr cinfo)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  if (timing->input_mark > 0)
+    timing->input_base += (unsigned long) timing->input_mark;
+  timing->input_mark = (long) cinfo->src->bytes_in_buffer;
+}
+
+
+/*
+ * num_bytes are about to be skipped; TIMING_FILLED follows the skip.
+ */
+
+GLOBAL(void)
+j12_timing_skip (j12_decompress_ptr cinfo, long num_bytes)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+  long consumed = (long) cinfo->src->bytes_in_buffer;
+
+  if (timing->input_mark >= 0)
+    consumed = timing->input_mark - consumed;
+  else
+    consumed = 0;
+  if (num_bytes > 0)
+    consumed += num_bytes;
+  timing->input_base += (unsigned long) consumed;
+  timing->input_mark = 0;
+}
+
+
+/*
+ * A J_TRACE_EVENT begins or ends.
+ */
+
+GLOBAL(void)
+j12_timing_trace (j12_decompress_ptr cinfo, int event, boolean begin)
+{
+  jpeg12_decode_timing * timing = cinfo->timing;
+
+  charge_stage(cinfo, timing);
+  (*timing->trace) (timing->trace_data, event, begin);
+  timing->stage_start = read_clock();
+}
+
+#else /* ! D_TIMING_SUPPORTED */
+
+GLOBAL(void)
+jpeg12_timing_begin (j12_decompress_ptr cinfo, int stage)
+{
+  /* not built in */
+}
+
+GLOBAL(void)
+jpeg12_timing_switch (j12_decompress_ptr cinfo, int stage)
+{
+  /* not built in */
+}
+
+GLOBAL(void)
+jpeg12_timing_end (j12_decompress_ptr cinfo)
+{
+  /* not built in */
+}
+
+#endif /* D_TIMING_SUPPORTED */
@@ -49,6 +49,18 @@ jpeg12_read_coefficients (j12_decompress_ptr cinfo)
     /* First call: initialize active modules */
     transdecode_master_selection(cinfo);
     cinfo->global_state = DSTATE_RDCOEFS;
+    /* Try to entropy decode on several threads: the scans of a multi-scan
+     * file concurrently, or else the (only) scan in pieces.
+     */
+    if (cinfo->entropy_threads > 1 && ! cinfo->arith_code) {
+      TIMING_BEGIN(cinfo, JTIME_ENTROPY);
+      if ((cinfo->inputctl->has_multiple_scans ?
+	   j12_decode_scans_parallel(cinfo, cinfo->entropy_threads) :
+	   j12_huff_decode_parallel(cinfo, cinfo->entropy_threads)) &&
+	  cinfo->progress != NULL)
+	cinfo->progress->pass_counter = cinfo->progress->pass_limit;
+      TIMING_END(cinfo);
+    }
   }
   if (cinfo->global_state == DSTATE_RDCOEFS) {
     /* Absorb whole file into the coef buffer */
@@ -0,0 +1,237 @@
+/*
+ * jdtry.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains a recoverable error manager and "try" versions of the
+ * decompression calls, for applications that cannot use setjmp/longjmp
+ * themselves (the Dart side of the plugin calls the library through FFI,
+ * and a Dart frame cannot be the target of a longjmp).
+ *
+ * Each jpeg12_try_xxx() routine sets up a return point on its own stack
+ * and then calls jpeg12_xxx().  If the library errors out, control comes
+ * back there: the message code and text are left in the error manager,
+ * the decompression object is aborted (so it may be reused or destroyed),
+ * and the routine returns 0, FALSE or NULL.  The caller checks the status
+ * field after each call; it is 0 while all is well.  Warnings are not
+ * reported.
+ *
+ * An error outside of the try routines (none is armed) is handled like
+ * jpeg12_std_error() does: the message is printed and the program exits.
+ */
+
+/* this is not a core library module, so it doesn't define JPEG12_INTERNALS */
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jerror.h"
+#include <setjmp.h>
+
+#ifndef EXIT_FAILURE		/* define exit() codes if not provided */
+#define EXIT_FAILURE  1
+#endif
+
+
+METHODDEF(noreturn_t)
+try_error_exit (j12_common_ptr cinfo)
+{
+  jpeg12_try_error_mgr * err = (jpeg12_try_error_mgr *) cinfo->err;
+
+  if (err->jump == NULL) {
+    /* Not inside a try routine: do what jpeg12_std_error() would */
+    (*cinfo->err->j12_output_message) (cinfo);
+    jpeg12_destroy(cinfo);
+    exit(EXIT_FAILURE);
+  }
+
+  err->status = err->pub.msg_code;
+  (*cinfo->err->j12_format_message) (cinfo, err->message);
+  longjmp(*(jmp_buf *) err->jump, 1);
+}
+
+
+METHODDEF(void)
+try_emit_message (j12_common_ptr cinfo, int msg_level)
+{
+  jpeg12_try_error_mgr * err = (jpeg12_try_error_mgr *) cinfo->err;
+
+  /* Count warnings like the standard handler, but print nothing */
+  if (msg_level < 0)
+    err->pub.num_warnings++;
+}
+
+
+/*
+ * Fill in the error manager.  It is a jpeg12_std_error() manager with the
+ * error exit and warning output replaced.
+ */
+
+GLOBAL(struct jpeg12_error_mgr *)
+jpeg12_try_error (jpeg12_try_error_mgr * err)
+{
+  jpeg12_std_error(&err->pub);
+  err->pub.j12_error_exit = try_error_exit;
+  err->pub.j12_emit_message = try_emit_message;
+  err->jump = NULL;
+  err->status = 0;
+  err->message[0] = '\0';
+  return &err->pub;
+}
+
+
+/* Common prologue and epilogue of the try routines.  The jmp_buf lives in
+ * the routine's own frame, so each routine arms the manager for exactly
+ * the duration of its one call.  After an error, further calls on the
+ * same object do nothing until the application resets the status.
+ */
+
+#define TRY_ERR(cinfo)	((jpeg12_try_error_mgr *) (cinfo)->err)
+
+#define TRY_BEGIN(cinfo, fail)				\
+  jmp_buf jump;						\
+  if (TRY_ERR(cinfo)->status != 0)			\
+    fail;						\
+  if (setjmp(jump)) {					\
+    TRY_ERR(cinfo)->jump = NULL;			\
+    jpeg12_abort((j12_common_ptr) (cinfo));		\
+    fail;						\
+  }							\
+  TRY_ERR(cinfo)->jump = (void *) &jump
+
+#define TRY_END(cinfo)	(TRY_ERR(cinfo)->jump = NULL)
+
+
+GLOBAL(void)
+jpeg12_try_mem_src (j12_decompress_ptr cinfo,
+		    unsigned char * inbuffer, unsigned long insize)
+{
+  TRY_BEGIN(cinfo, return);
+  jpeg12_mem_src(cinfo, inbuffer, insize);
+  TRY_END(cinfo);
+}
+
+
+GLOBAL(int)
+jpeg12_try_read_header (j12_decompress_ptr cinfo, boolean require_image)
+{
+  int retcode;
+
+  TRY_BEGIN(cinfo, return JPEG12_SUSPENDED);
+  retcode = jpeg12_read_header(cinfo, require_image);
+  TRY_END(cinfo);
+  return retcode;
+}
+
+
+GLOBAL(boolean)
+jpeg12_try_start_decompress (j12_decompress_ptr cinfo)
+{
+  boolean started;
+
+  TRY_BEGIN(cinfo, return FALSE);
+  started = jpeg12_start_decompress(cinfo);
+  TRY_END(cinfo);
+  return started;
+}
+
+
+GLOBAL(JDIMENSION)
+jpeg12_try_read_scanlines (j12_decompress_ptr cinfo, JSAMPARRAY scanlines,
+			   JDIMENSION max_lines)
+{
+  JDIMENSION row_ctr;
+
+  TRY_BEGIN(cinfo, return 0);
+  row_ctr = jpeg12_read_scanlines(cinfo, scanlines, max_lines);
+  TRY_END(cinfo);
+  return row_ctr;
+}
+
+
+GLOBAL(boolean)
+jpeg12_try_finish_decompress (j12_decompress_ptr cinfo)
+{
+  boolean finished;
+
+  TRY_BEGIN(cinfo, return FALSE);
+  finished = jpeg12_finish_decompress(cinfo);
+  TRY_END(cinfo);
+  return finished;
+}
+
+
+GLOBAL(JDIMENSION)
+jpeg12_try_read_plane (j12_decompress_ptr cinfo, JSAMPROW plane,
+		       JDIMENSION row_stride, jpeg12_plane_stats * stats)
+{
+  JDIMENSION rows;
+
+  TRY_BEGIN(cinfo, return 0);
+  rows = jpeg12_read_plane(cinfo, plane, row_stride, stats);
+  TRY_END(cinfo);
+  return rows;
+}
+
+
+GLOBAL(boolean)
+jpeg12_try_estimate_plane_stats (j12_decompress_ptr cinfo,
+				 jpeg12_plane_stats * stats)
+{
+  boolean done;
+
+  TRY_BEGIN(cinfo, return FALSE);
+  done = jpeg12_estimate_plane_stats(cinfo, stats);
+  TRY_END(cinfo);
+  return done;
+}
+
+
+GLOBAL(void)
+jpeg12_try_calc_pyramid (j12_decompress_ptr cinfo,
+			 jpeg12_pyramid_level * levels)
+{
+  TRY_BEGIN(cinfo, return);
+  jpeg12_calc_pyramid(cinfo, levels);
+  TRY_END(cinfo);
+}
+
+
+GLOBAL(boolean)
+jpeg12_try_read_pyramid (j12_decompress_ptr cinfo,
+			 jpeg12_pyramid_level * levels)
+{
+  boolean done;
+
+  TRY_BEGIN(cinfo, return FALSE);
+  done = jpeg12_read_pyramid(cinfo, levels);
+  TRY_END(cinfo);
+  return done;
+}
+
+
+GLOBAL(jpeg12_coef_image *)
+jpeg12_try_save_coefficients (j12_decompress_ptr cinfo, boolean compact)
+{
+  jpeg12_coef_image * image;
+
+  TRY_BEGIN(cinfo, return NULL);
+  image = jpeg12_save_coefficients(cinfo, compact);
+  TRY_END(cinfo);
+  return image;
+}
+
+
+GLOBAL(void)
+jpeg12_try_read_coef_image (j12_decompress_ptr cinfo,
+			    jpeg12_coef_image * image, int scale,
+			    JDIMENSION x, JDIMENSION y,
+			    JDIMENSION width, JDIMENSION height,
+			    JSAMPROW plane, JDIMENSION row_stride,
+			    jpeg12_plane_stats * stats)
+{
+  TRY_BEGIN(cinfo, return);
+  jpeg12_read_coef_image(cinfo, image, scale, x, y, width, height,
+			 plane, row_stride, stats);
+  TRY_END(cinfo);
+}
@@ -1469,7 +1469,8 @@ jpeg12_fdct_12x12 (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
       DESCALE(MULTIPLY(tmp10 - tmp12, FIX(1.224744871)), /* c4 */
 	      CONST_BITS);
     dataptr[2] = (DCTELEM)
-      DESCALE(tmp14 - tmp15 + MULTIPLY(tmp13 + tmp15, FIX(1.366025404)), /* c2 */
+      DESCALE(((tmp14 - tmp15) << CONST_BITS) +
+	      MULTIPLY(tmp13 + tmp15, FIX(1.366025404)),   /* c2 */
 	      CONST_BITS);
 
     /* Odd part */
@@ -1871,7 +1872,7 @@ jpeg12_fdct_14x14 (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
 	      - MULTIPLY(tmp5, FIX(3.069855259)),         /* c1+c5+c11 */
 	      CONST_BITS);
     dataptr[1] = (DCTELEM)
-      DESCALE(tmp11 + tmp12 + tmp3 + tmp6 -
+      DESCALE(tmp11 + tmp12 + tmp3 + (tmp6 << CONST_BITS) -
 	      MULTIPLY(tmp0 + tmp6, FIX(1.126980169)),    /* c3+c5-c1 */
 	      CONST_BITS);
 
@@ -2641,7 +2642,7 @@ jpeg12_fdct_14x7 (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
 	      - MULTIPLY(tmp5, FIX(3.069855259)),         /* c1+c5+c11 */
 	      CONST_BITS-PASS1_BITS);
     dataptr[1] = (DCTELEM)
-      DESCALE(tmp11 + tmp12 + tmp3 + tmp6 -
+      DESCALE(tmp11 + tmp12 + tmp3 + (tmp6 << CONST_BITS) -
 	      MULTIPLY(tmp0 + tmp6, FIX(1.126980169)),    /* c3+c5-c1 */
 	      CONST_BITS-PASS1_BITS);
 
@@ -2767,7 +2768,8 @@ jpeg12_fdct_12x6 (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
       DESCALE(MULTIPLY(tmp10 - tmp12, FIX(1.224744871)), /* c4 */
 	      CONST_BITS-PASS1_BITS);
     dataptr[2] = (DCTELEM)
-      DESCALE(tmp14 - tmp15 + MULTIPLY(tmp13 + tmp15, FIX(1.366025404)), /* c2 */
+      DESCALE(((tmp14 - tmp15) << CONST_BITS) +
+	      MULTIPLY(tmp13 + tmp15, FIX(1.366025404)),   /* c2 */
 	      CONST_BITS-PASS1_BITS);
 
     /* Odd part */
@@ -23,6 +23,12 @@
  * memory so that backing storage will never be used, much of the virtual
  * array control logic could be removed.  (Of course, if you have that much
  * memory then you shouldn't care about a little bit of unused code...)
+ *
+ * For the jpeg12 plugin, the space obtained is also accounted per pool and
+ * for the whole process, so that jpeg12_get_memory_stats() and
+ * jpeg12_get_process_memory_stats() can report it at any time.  (The
+ * process totals may lag behind each object by less than
+ * PUBLISH_SPACE_STEP bytes; see add_pool_space.)
  */
 
 #define JPEG12_INTERNALS
@@ -31,6 +37,10 @@
 #include "jpeglib.h"
 #include "jmemsys.h"		/* import the system-dependent declarations */
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #ifndef NO_GETENV
 #ifndef HAVE_STDLIB_H		/* <stdlib.h> should declare getenv() */
 extern char * getenv JPP((const char * name));
@@ -131,6 +141,15 @@ typedef struct {
 
   /* This counts total space obtained from jpeg12_get_small/large */
   long total_space_allocated;
+  long peak_space_allocated;	/* its largest value so far */
+
+  /* The same per pool, for jpeg12_get_memory_stats() */
+  long small_space[JPOOL_NUMPOOLS];
+  long large_space[JPOOL_NUMPOOLS];
+  long peak_pool_space[JPOOL_NUMPOOLS];
+
+  /* Space obtained but not yet added to the process totals */
+  long unpublished_space;
 
   /* j12_alloc_sarray and j12_alloc_barray set this value for use by virtual
    * array routines.
@@ -181,6 +200,87 @@ struct jvirt_barray_control {
 };
 
 
+/*
+ * Process-wide totals over all live JPEG objects.
+ * These are shared between threads, so they are updated under a lock.
+ * To keep the lock off the allocation path, each object adds the space it
+ * obtains only once that reaches PUBLISH_SPACE_STEP bytes, when a pool is
+ * freed, and when it is created or destroyed.  So the totals (and the peak)
+ * may lag behind each live object by less than PUBLISH_SPACE_STEP bytes.
+ */
+
+#ifndef PUBLISH_SPACE_STEP	/* may be overridden in jconfig.h */
+#define PUBLISH_SPACE_STEP  1048576L
+#endif
+
+static jpeg12_process_memory_stats process_stats;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t process_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_PROCESS_STATS()	pthread_mutex_lock(&process_stats_lock)
+#define UNLOCK_PROCESS_STATS()	pthread_mutex_unlock(&process_stats_lock)
+#else
+#define LOCK_PROCESS_STATS()
+#define UNLOCK_PROCESS_STATS()
+#endif
+
+
+LOCAL(void)
+add_process_space (long space, long backing_store, long objects)
+{
+  LOCK_PROCESS_STATS();
+  process_stats.live_objects += objects;
+  process_stats.total_bytes += space;
+  if (process_stats.peak_total_bytes < process_stats.total_bytes)
+    process_stats.peak_total_bytes = process_stats.total_bytes;
+  process_stats.backing_store_bytes += backing_store;
+  UNLOCK_PROCESS_STATS();
+}
+
+
+/*
+ * Add the space an object has obtained since last time to the process
+ * totals.
+ */
+
+LOCAL(void)
+publish_space (my_mem_ptr mem)
+{
+  if (mem->unpublished_space != 0) {
+    add_process_space(mem->unpublished_space, 0L, 0L);
+    mem->unpublished_space = 0;
+  }
+}
+
+
+/*
+ * Account for space obtained (space > 0) or released (space < 0)
+ * in the given pool.
+ */
+
+LOCAL(void)
+add_pool_space (my_mem_ptr mem, int pool_id, long space, boolean large)
+{
+  long pool_space;
+
+  if (large)
+    mem->large_space[pool_id] += space;
+  else
+    mem->small_space[pool_id] += space;
+  mem->total_space_allocated += space;
+  if (mem->peak_space_allocated < mem->total_space_allocated)
+    mem->peak_space_allocated = mem->total_space_allocated;
+  pool_space = mem->small_space[pool_id] + mem->large_space[pool_id];
+  if (mem->peak_pool_space[pool_id] < pool_space)
+    mem->peak_pool_space[pool_id] = pool_space;
+  if (space > 0) {		/* frees are passed on by j12_free_pool */
+    mem->unpublished_space += space;
+    if (mem->unpublished_space >= PUBLISH_SPACE_STEP)
+      publish_space(mem);
+  }
+}
+
+
 #ifdef MEM_STATS		/* optional extra stuff for statistics */
 
 LOCAL(void)
@@ -304,7 +404,7 @@ j12_alloc_small (j12_common_ptr cinfo, int pool_id, size_t sizeofobject)
       if (slop < MIN_SLOP)	/* give up when it gets real small */
 	out_of_memory(cinfo, 2); /* jpeg12_get_small failed */
     }
-    mem->total_space_allocated += min_request + slop;
+    add_pool_space(mem, pool_id, (long) (min_request + slop), FALSE);
     /* Success, initialize the new pool header and add to end of list */
     hdr_ptr->hdr.next = NULL;
     hdr_ptr->hdr.bytes_used = 0;
@@ -364,7 +464,8 @@ j12_alloc_large (j12_common_ptr cinfo, int pool_id, size_t sizeofobject)
 					    SIZEOF(large_pool_hdr));
   if (hdr_ptr == NULL)
     out_of_memory(cinfo, 4);	/* jpeg12_get_large failed */
-  mem->total_space_allocated += sizeofobject + SIZEOF(large_pool_hdr);
+  add_pool_space(mem, pool_id, (long) (sizeofobject + SIZEOF(large_pool_hdr)),
+		 TRUE);
 
   /* Success, initialize the new pool header and add to list */
   hdr_ptr->hdr.next = mem->large_list[pool_id];
@@ -651,6 +752,8 @@ j12_realize_virt_arrays (j12_common_ptr cinfo)
 				(long) sptr->samplesperrow *
 				(long) SIZEOF(JSAMPLE));
 	sptr->b_s_open = TRUE;
+	add_process_space(0L, (long) sptr->rows_in_array *
+			  (long) sptr->samplesperrow * SIZEOF(JSAMPLE), 0L);
       }
       sptr->mem_buffer = j12_alloc_sarray(cinfo, JPOOL_IMAGE,
 				      sptr->samplesperrow, sptr->rows_in_mem);
@@ -675,6 +778,8 @@ j12_realize_virt_arrays (j12_common_ptr cinfo)
 				(long) bptr->blocksperrow *
 				(long) SIZEOF(JBLOCK));
 	bptr->b_s_open = TRUE;
+	add_process_space(0L, (long) bptr->rows_in_array *
+			  (long) bptr->blocksperrow * SIZEOF(JBLOCK), 0L);
       }
       bptr->mem_buffer = j12_alloc_barray(cinfo, JPOOL_IMAGE,
 				      bptr->blocksperrow, bptr->rows_in_mem);
@@ -934,6 +1039,7 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
   small_pool_ptr shdr_ptr;
   large_pool_ptr lhdr_ptr;
   size_t space_freed;
+  long backing_store_closed = 0;
 
   if (pool_id < 0 || pool_id >= JPOOL_NUMPOOLS)
     ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);	/* safety check */
@@ -943,6 +1049,9 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
     print_mem_stats(cinfo, pool_id); /* print pool's memory usage statistics */
 #endif
 
+  /* Count everything before taking this pool off, so the peak includes it */
+  publish_space(mem);
+
   /* If freeing IMAGE pool, close any virtual arrays first */
   if (pool_id == JPOOL_IMAGE) {
     jvirt_sarray_ptr sptr;
@@ -951,6 +1060,8 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
     for (sptr = mem->virt_sarray_list; sptr != NULL; sptr = sptr->next) {
       if (sptr->b_s_open) {	/* there may be no backing store */
 	sptr->b_s_open = FALSE;	/* prevent recursive close if error */
+	backing_store_closed += (long) sptr->rows_in_array *
+				(long) sptr->samplesperrow * SIZEOF(JSAMPLE);
 	(*sptr->b_s_info.j12_close_backing_store) (cinfo, & sptr->b_s_info);
       }
     }
@@ -958,6 +1069,8 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
     for (bptr = mem->virt_barray_list; bptr != NULL; bptr = bptr->next) {
       if (bptr->b_s_open) {	/* there may be no backing store */
 	bptr->b_s_open = FALSE;	/* prevent recursive close if error */
+	backing_store_closed += (long) bptr->rows_in_array *
+				(long) bptr->blocksperrow * SIZEOF(JBLOCK);
 	(*bptr->b_s_info.j12_close_backing_store) (cinfo, & bptr->b_s_info);
       }
     }
@@ -977,6 +1090,8 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
     mem->total_space_allocated -= space_freed;
     lhdr_ptr = next_lhdr_ptr;
   }
+  add_process_space(- mem->large_space[pool_id], 0L, 0L);
+  mem->large_space[pool_id] = 0;
 
   /* Release small objects */
   shdr_ptr = mem->small_list[pool_id];
@@ -991,6 +1106,21 @@ j12_free_pool (j12_common_ptr cinfo, int pool_id)
     mem->total_space_allocated -= space_freed;
     shdr_ptr = next_shdr_ptr;
   }
+  add_process_space(- mem->small_space[pool_id], - backing_store_closed, 0L);
+  mem->small_space[pool_id] = 0;
+}
+
+
+/*
+ * Tell whether a realized virtual array is held in memory as a whole,
+ * so that the row pointers returned by j12_access_virt_barray stay valid
+ * (jdscans.c relies on this to share the array between threads).
+ */
+
+GLOBAL(boolean)
+j12_virt_barray_in_memory (jvirt_barray_ptr ptr)
+{
+  return (ptr->mem_buffer != NULL && ptr->rows_in_mem >= ptr->rows_in_array);
 }
 
 
@@ -1013,6 +1143,7 @@ j12_self_destruct (j12_common_ptr cinfo)
   }
 
   /* Release the memory manager control block too. */
+  add_process_space(- (long) SIZEOF(my_memory_mgr), 0L, -1L);
   jpeg12_free_small(cinfo, (void *) cinfo->mem, SIZEOF(my_memory_mgr));
   cinfo->mem = NULL;		/* ensures I will be called only once */
 
@@ -1086,11 +1217,17 @@ j12_init_memory_mgr (j12_common_ptr cinfo)
   for (pool = JPOOL_NUMPOOLS-1; pool >= JPOOL_PERMANENT; pool--) {
     mem->small_list[pool] = NULL;
     mem->large_list[pool] = NULL;
+    mem->small_space[pool] = 0;
+    mem->large_space[pool] = 0;
+    mem->peak_pool_space[pool] = 0;
   }
+  mem->unpublished_space = 0;
   mem->virt_sarray_list = NULL;
   mem->virt_barray_list = NULL;
 
   mem->total_space_allocated = SIZEOF(my_memory_mgr);
+  mem->peak_space_allocated = mem->total_space_allocated;
+  add_process_space((long) SIZEOF(my_memory_mgr), 0L, 1L);
 
   /* Declare ourselves open for business */
   cinfo->mem = & mem->pub;
@@ -1117,3 +1254,75 @@ j12_init_memory_mgr (j12_common_ptr cinfo)
 #endif
 
 }
+
+
+/*
+ * Report the memory used by one JPEG object.
+ * The object's own totals are only changed by the thread using it,
+ * so call this from that thread (or while it is idle).
+ */
+
+GLOBAL(void)
+jpeg12_get_memory_stats (j12_common_ptr cinfo, jpeg12_memory_stats * stats)
+{
+  my_mem_ptr mem = (my_mem_ptr) cinfo->mem;
+  small_pool_ptr shdr_ptr;
+  jvirt_sarray_ptr sptr;
+  jvirt_barray_ptr bptr;
+  long array_bytes;
+  int pool;
+
+  MEMZERO(stats, SIZEOF(jpeg12_memory_stats));
+  if (mem == NULL)
+    return;			/* object already destroyed */
+
+  for (pool = 0; pool < JPOOL_NUMPOOLS; pool++) {
+    stats->small_bytes[pool] = mem->small_space[pool];
+    stats->large_bytes[pool] = mem->large_space[pool];
+    stats->peak_bytes[pool] = mem->peak_pool_space[pool];
+    for (shdr_ptr = mem->small_list[pool]; shdr_ptr != NULL;
+	 shdr_ptr = shdr_ptr->hdr.next)
+      stats->small_free_bytes += (long) shdr_ptr->hdr.bytes_left;
+  }
+  stats->total_bytes = mem->total_space_allocated;
+  stats->peak_total_bytes = mem->peak_space_allocated;
+
+  for (sptr = mem->virt_sarray_list; sptr != NULL; sptr = sptr->next) {
+    array_bytes = (long) sptr->samplesperrow * SIZEOF(JSAMPLE);
+    stats->virtual_arrays++;
+    stats->virtual_bytes += (long) sptr->rows_in_array * array_bytes;
+    if (sptr->mem_buffer != NULL)
+      stats->virtual_resident_bytes += (long) sptr->rows_in_mem * array_bytes;
+    if (sptr->b_s_open) {
+      stats->backing_stores++;
+      stats->backing_store_bytes += (long) sptr->rows_in_array * array_bytes;
+    }
+  }
+  for (bptr = mem->virt_barray_list; bptr != NULL; bptr = bptr->next) {
+    array_bytes = (long) bptr->blocksperrow * SIZEOF(JBLOCK);
+    stats->virtual_arrays++;
+    stats->virtual_bytes += (long) bptr->rows_in_array * array_bytes;
+    if (bptr->mem_buffer != NULL)
+      stats->virtual_resident_bytes += (long) bptr->rows_in_mem * array_bytes;
+    if (bptr->b_s_open) {
+      stats->backing_stores++;
+      stats->backing_store_bytes += (long) bptr->rows_in_array * array_bytes;
+    }
+  }
+}
+
+
+/*
+ * Report the memory used by all JPEG objects in the process.
+ */
+
+GLOBAL(void)
+jpeg12_get_process_memory_stats (jpeg12_process_memory_stats * stats,
+				 boolean reset_peak)
+{
+  LOCK_PROCESS_STATS();
+  *stats = process_stats;
+  if (reset_peak)
+    process_stats.peak_total_bytes = process_stats.total_bytes;
+  UNLOCK_PROCESS_STATS();
+}
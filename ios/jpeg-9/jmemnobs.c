@@ -6,13 +6,16 @@
  * For conditions of distribution and use, see the accompanying README file.
  *
  * This file provides a really simple implementation of the system-
- * dependent portion of the JPEG memory manager.  This implementation
- * assumes that no backing-store files are needed: all required space
- * can be obtained from malloc().
+ * dependent portion of the JPEG memory manager.  All required space is
+ * obtained from malloc().
  * This is very portable in the sense that it'll compile on almost anything,
  * but you'd better have lots of main memory (or virtual memory) if you want
  * to process big images.
- * Note that the max_memory_to_use option is ignored by this implementation.
+ *
+ * For the jpeg12 plugin, max_memory_to_use is honored on systems with
+ * mmap(): virtual arrays that don't fit are kept in memory-mapped temporary
+ * files, which the kernel can page out instead of running out of memory.
+ * By default there is no limit, as before; see jpeg12_set_backing_store().
  */
 
 #define JPEG12_INTERNALS
@@ -25,6 +28,32 @@ extern void * malloc JPP((size_t size));
 extern void free JPP((void *ptr));
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__) && (! defined(__ANDROID_API__) || __ANDROID_API__ >= 21)
+#include <fcntl.h>
+#include <errno.h>
+#define HAVE_POSIX_FALLOCATE
+#endif
+#endif
+
+
+/*
+ * Settings shared by all JPEG objects; see jpeg12_set_backing_store().
+ */
+
+#ifndef DEFAULT_MAX_MEM		/* so that jconfig.h may override it */
+#define DEFAULT_MAX_MEM		0L /* no limit */
+#endif
+
+#ifndef TEMP_DIRECTORY		/* so that jconfig.h may override it */
+#define TEMP_DIRECTORY		"/tmp"
+#endif
+
+static long default_max_memory = DEFAULT_MAX_MEM;
+static char temp_directory[TEMP_NAME_LENGTH]; /* empty: use TMPDIR */
+
 
 /*
  * Memory allocation and freeing are controlled by the regular library
@@ -66,17 +95,195 @@ jpeg12_free_large (j12_common_ptr cinfo, void FAR * object, size_t sizeofobject)
 
 /*
  * This routine computes the total memory space available for allocation.
- * Here we always say, "we got all you want bud!"
+ * Without a limit (or a way to store the rest), we always say,
+ * "we got all you want bud!"
  */
 
 GLOBAL(long)
 jpeg12_mem_available (j12_common_ptr cinfo, long min_bytes_needed,
 		    long max_bytes_needed, long already_allocated)
 {
+#ifdef HAVE_SYS_MMAN_H
+  if (cinfo->mem->max_memory_to_use > 0)
+    return cinfo->mem->max_memory_to_use - already_allocated;
+#endif
   return max_bytes_needed;
 }
 
 
+#ifdef HAVE_SYS_MMAN_H
+
+/*
+ * Backing store (temporary file) management.
+ * The file is mapped into memory as a whole, so reading and writing are
+ * just copies; the kernel moves the pages between file and memory.  As the
+ * virtual arrays are mostly accessed top to bottom, we tell the kernel to
+ * fetch the part after each one read, and to drop the pages we are done
+ * with from our working set.  If the file can't be mapped (say, for lack of
+ * address space), we read and write it directly instead.
+ */
+
+LOCAL(void)
+advise_pages (backing_store_ptr info, long file_offset, long byte_count,
+	      int advice)
+{
+  static long page_size = 0;
+  long start, end;
+
+  if (page_size <= 0 && (page_size = (long) sysconf(_SC_PAGESIZE)) <= 0)
+    page_size = 4096;
+  start = file_offset - file_offset % page_size;
+  end = file_offset + byte_count;
+  if (end > info->map_size)
+    end = info->map_size;
+  if (end > start)
+    (void) madvise((void *) (info->map_base + start), (size_t) (end - start),
+		   advice);
+}
+
+
+METHODDEF(void)
+read_mapped_store (j12_common_ptr cinfo, backing_store_ptr info,
+		   void FAR * buffer_address,
+		   long file_offset, long byte_count)
+{
+  if (file_offset < 0 || byte_count > info->map_size - file_offset)
+    ERREXIT(cinfo, JERR_TFILE_READ);
+  MEMCOPY(buffer_address, info->map_base + file_offset, byte_count);
+  advise_pages(info, file_offset, byte_count, MADV_DONTNEED);
+  advise_pages(info, file_offset + byte_count, byte_count, MADV_WILLNEED);
+}
+
+
+METHODDEF(void)
+write_mapped_store (j12_common_ptr cinfo, backing_store_ptr info,
+		    void FAR * buffer_address,
+		    long file_offset, long byte_count)
+{
+  if (file_offset < 0 || byte_count > info->map_size - file_offset)
+    ERREXIT(cinfo, JERR_TFILE_WRITE);
+  MEMCOPY(info->map_base + file_offset, buffer_address, byte_count);
+  /* The file keeps the data; it just needn't stay in our working set */
+  advise_pages(info, file_offset, byte_count, MADV_DONTNEED);
+}
+
+
+METHODDEF(void)
+read_file_store (j12_common_ptr cinfo, backing_store_ptr info,
+		 void FAR * buffer_address,
+		 long file_offset, long byte_count)
+{
+  if (pread(info->temp_fd, buffer_address, (size_t) byte_count,
+	    (off_t) file_offset) != (ssize_t) byte_count)
+    ERREXIT(cinfo, JERR_TFILE_READ);
+}
+
+
+METHODDEF(void)
+write_file_store (j12_common_ptr cinfo, backing_store_ptr info,
+		  void FAR * buffer_address,
+		  long file_offset, long byte_count)
+{
+  if (pwrite(info->temp_fd, buffer_address, (size_t) byte_count,
+	     (off_t) file_offset) != (ssize_t) byte_count)
+    ERREXIT(cinfo, JERR_TFILE_WRITE);
+}
+
+
+/*
+ * A path to put into a message: message string parameters are cut off at
+ * JMSG_STR_PARM_MAX bytes, so copy the end of a longer path, which says
+ * more about the file than its start, into a buffer of that size.
+ */
+
+LOCAL(const char *)
+path_tail (const char * path, char * buffer)
+{
+  size_t length = strlen(path);
+
+  if (length >= JMSG_STR_PARM_MAX)
+    path += length - (JMSG_STR_PARM_MAX - 1);
+  MEMCOPY(buffer, path, strlen(path) + 1);
+  return buffer;
+}
+
+
+METHODDEF(void)
+close_backing_store (j12_common_ptr cinfo, backing_store_ptr info)
+{
+  char name[JMSG_STR_PARM_MAX];
+
+  if (info->map_base != NULL)
+    (void) munmap((void *) info->map_base, (size_t) info->map_size);
+  close(info->temp_fd);
+  TRACEMSS(cinfo, 1, JTRC_TFILE_CLOSE, path_tail(info->temp_name, name));
+}
+
+
+/*
+ * Initial opening of a backing-store object.
+ * The file is unlinked right away, so that it disappears when it is closed,
+ * even if we never get to close it.
+ */
+
+GLOBAL(void)
+jpeg12_open_backing_store (j12_common_ptr cinfo, backing_store_ptr info,
+			 long total_bytes_needed)
+{
+  const char * dir = temp_directory;
+  char name[JMSG_STR_PARM_MAX];
+  void * map_base;
+  int failed;
+
+  if (*dir == '\0') {
+#ifndef NO_GETENV
+    if ((dir = getenv("TMPDIR")) == NULL || *dir == '\0')
+#endif
+      dir = TEMP_DIRECTORY;
+  }
+  if (strlen(dir) + 14 > TEMP_NAME_LENGTH)
+    ERREXITS(cinfo, JERR_TFILE_CREATE, path_tail(dir, name));
+  strcpy(info->temp_name, dir);
+  strcat(info->temp_name, "/jpeg12XXXXXX");
+  if ((info->temp_fd = mkstemp(info->temp_name)) < 0)
+    ERREXITS(cinfo, JERR_TFILE_CREATE, path_tail(info->temp_name, name));
+  unlink(info->temp_name);
+
+  /* Where we can, reserve the space now, so that running out of it is an
+   * error here rather than a crash when the kernel writes the pages.
+   * File systems that can't reserve space (EOPNOTSUPP, or EINVAL from
+   * some kernels) just get the file size set, as without fallocate.
+   */
+#ifdef HAVE_POSIX_FALLOCATE
+  failed = posix_fallocate(info->temp_fd, (off_t) 0,
+			   (off_t) total_bytes_needed);
+  if (failed == EOPNOTSUPP || failed == EINVAL)
+#endif
+    failed = ftruncate(info->temp_fd, (off_t) total_bytes_needed) != 0;
+  if (failed) {
+    close(info->temp_fd);
+    ERREXITS(cinfo, JERR_TFILE_CREATE, path_tail(info->temp_name, name));
+  }
+
+  map_base = mmap(NULL, (size_t) total_bytes_needed, PROT_READ | PROT_WRITE,
+		  MAP_SHARED, info->temp_fd, (off_t) 0);
+  info->temp_file = NULL;
+  info->map_size = total_bytes_needed;
+  if (map_base != MAP_FAILED) {
+    info->map_base = (char FAR *) map_base;
+    info->j12_read_backing_store = read_mapped_store;
+    info->j12_write_backing_store = write_mapped_store;
+  } else {
+    info->map_base = NULL;
+    info->j12_read_backing_store = read_file_store;
+    info->j12_write_backing_store = write_file_store;
+  }
+  info->j12_close_backing_store = close_backing_store;
+  TRACEMSS(cinfo, 1, JTRC_TFILE_OPEN, path_tail(info->temp_name, name));
+}
+
+#else /* ! HAVE_SYS_MMAN_H */
+
 /*
  * Backing store (temporary file) management.
  * Since jpeg12_mem_available always promised the moon,
@@ -90,6 +297,26 @@ jpeg12_open_backing_store (j12_common_ptr cinfo, backing_store_ptr info,
   ERREXIT(cinfo, JERR_NO_BACKING_STORE);
 }
 
+#endif /* HAVE_SYS_MMAN_H */
+
+
+/*
+ * Set the directory for temporary files (NULL: keep it) and the default
+ * max_memory_to_use (0: no limit) of JPEG objects created afterwards.
+ * Without a directory, $TMPDIR or else TEMP_DIRECTORY is used.
+ * This is not synchronized with objects being created on other threads.
+ */
+
+GLOBAL(void)
+jpeg12_set_backing_store (const char * temp_dir, long max_memory_to_use)
+{
+  if (temp_dir != NULL) {
+    strncpy(temp_directory, temp_dir, TEMP_NAME_LENGTH - 1);
+    temp_directory[TEMP_NAME_LENGTH - 1] = '\0';
+  }
+  default_max_memory = max_memory_to_use;
+}
+
 
 /*
  * These routines take care of any system-dependent initialization and
@@ -99,7 +326,7 @@ jpeg12_open_backing_store (j12_common_ptr cinfo, backing_store_ptr info,
 GLOBAL(long)
 jpeg12_mem_init (j12_common_ptr cinfo)
 {
-  return 0;			/* just set max_memory_to_use to 0 */
+  return default_max_memory;	/* default for max_memory_to_use */
 }
 
 GLOBAL(void)
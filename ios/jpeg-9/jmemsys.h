@@ -113,7 +113,7 @@ EXTERN(long) jpeg12_mem_available JPP((j12_common_ptr cinfo,
  * are private to the system-dependent backing store routines.
  */
 
-#define TEMP_NAME_LENGTH   64	/* max length of a temporary file's name */
+#define TEMP_NAME_LENGTH   256	/* max length of a temporary file's name */
 
 
 #ifdef USE_MSDOS_MEMMGR		/* DOS-specific junk */
@@ -164,6 +164,10 @@ typedef struct backing_store_struct {
   /* For a typical implementation with temp files, we need: */
   FILE * temp_file;		/* stdio reference to temp file */
   char temp_name[TEMP_NAME_LENGTH]; /* name of temp file */
+  /* For the memory-mapped temp files of jmemnobs.c, also: */
+  int temp_fd;			/* file descriptor of temp file */
+  char FAR * map_base;		/* where it is mapped, or NULL if not */
+  long map_size;		/* # of bytes in it */
 #endif
 #endif
 } backing_store_info;
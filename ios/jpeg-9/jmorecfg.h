@@ -296,6 +296,7 @@ typedef enum { FALSE_ = 0, TRUE_ = 1 } boolean;
 #define DCT_ISLOW_SUPPORTED	/* slow but accurate integer algorithm */
 #define DCT_IFAST_SUPPORTED	/* faster, less accurate integer method */
 #define DCT_FLOAT_SUPPORTED	/* floating-point: accurate, fast on fast HW */
+#define SIMD_SUPPORTED		/* Vectorized kernels where the CPU has them? */
 
 /* Encoder capability options: */
 
@@ -326,6 +327,7 @@ typedef enum { FALSE_ = 0, TRUE_ = 1 } boolean;
 #define UPSAMPLE_MERGING_SUPPORTED  /* Fast path for sloppy upsampling? */
 #define QUANT_1PASS_SUPPORTED	    /* 1-pass color quantization? */
 #define QUANT_2PASS_SUPPORTED	    /* 2-pass color quantization? */
+#define D_TIMING_SUPPORTED	    /* Per-stage timing via cinfo->timing? */
 
 /* more capability options later, no doubt */
 
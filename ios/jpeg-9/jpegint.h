@@ -311,6 +311,9 @@ struct jpeg12_j12_color_quantizer {
 #define j12_init_input_controller	jIInCtlr
 #define j12_init_marker_reader	jIMReader
 #define j12_init_huff_decoder	jIHDecoder
+#define j12_huff_decode_parallel	jHuffDecPar
+#define j12_huff_copy_decoder	jHuffCopyDec
+#define j12_decode_scans_parallel	jDecScansPar
 #define j12_init_arith_decoder	jIADecoder
 #define j12_init_inverse_dct	jIIDCT
 #define jinit_j12_upsampler		jIUpsampler
@@ -319,11 +322,17 @@ struct jpeg12_j12_color_quantizer {
 #define j12_init_2pass_quantizer	jI2Quant
 #define jinit_merged_j12_upsampler	jIMUpsampler
 #define j12_init_memory_mgr	jIMemMgr
+#define j12_virt_barray_in_memory	jVBArrInMem
 #define j12_div_round_up		jDivRound
 #define j12_round_up		jRound
 #define jzero_far		jZeroFar
 #define j12_copy_sample_rows	jCopySamples
 #define j12_copy_block_row		jCopyBlocks
+#define j12_prepare_idct_range_limit	jPrepIDCTRange
+#define j12_timing_start	jTimingStart
+#define j12_timing_fill		jTimingFill
+#define j12_timing_skip		jTimingSkip
+#define j12_timing_trace	jTimingTrace
 #define jpeg12_zigzag_order	jZIGTable
 #define jpeg12_natural_order	jZAGTable
 #define jpeg12_natural_order7	jZAG7Table
@@ -383,6 +392,12 @@ EXTERN(void) j12_init_d_post_controller JPP((j12_decompress_ptr cinfo,
 EXTERN(void) j12_init_input_controller JPP((j12_decompress_ptr cinfo));
 EXTERN(void) j12_init_marker_reader JPP((j12_decompress_ptr cinfo));
 EXTERN(void) j12_init_huff_decoder JPP((j12_decompress_ptr cinfo));
+EXTERN(boolean) j12_huff_decode_parallel JPP((j12_decompress_ptr cinfo,
+					    int num_threads));
+EXTERN(struct jpeg12_entropy_decoder *) j12_huff_copy_decoder
+	JPP((j12_decompress_ptr cinfo));
+EXTERN(boolean) j12_decode_scans_parallel JPP((j12_decompress_ptr cinfo,
+					     int num_threads));
 EXTERN(void) j12_init_arith_decoder JPP((j12_decompress_ptr cinfo));
 EXTERN(void) j12_init_inverse_dct JPP((j12_decompress_ptr cinfo));
 EXTERN(void) jinit_j12_upsampler JPP((j12_decompress_ptr cinfo));
@@ -392,6 +407,7 @@ EXTERN(void) j12_init_2pass_quantizer JPP((j12_decompress_ptr cinfo));
 EXTERN(void) jinit_merged_j12_upsampler JPP((j12_decompress_ptr cinfo));
 /* Memory manager initialization */
 EXTERN(void) j12_init_memory_mgr JPP((j12_common_ptr cinfo));
+EXTERN(boolean) j12_virt_barray_in_memory JPP((jvirt_barray_ptr ptr));
 
 /* Utility routines in jutils.c */
 EXTERN(long) j12_div_round_up JPP((long a, long b));
@@ -401,6 +417,14 @@ EXTERN(void) j12_copy_sample_rows JPP((JSAMPARRAY input_array, int source_row,
 				    int num_rows, JDIMENSION num_cols));
 EXTERN(void) j12_copy_block_row JPP((JBLOCKROW input_row, JBLOCKROW output_row,
 				  JDIMENSION num_blocks));
+/* Range limit table for IDCTs run outside the normal pipeline (jdpyram.c) */
+EXTERN(void) j12_prepare_idct_range_limit JPP((j12_decompress_ptr cinfo));
+/* Per-stage timing in jdtiming.c; see the TIMING_ macros below */
+EXTERN(void) j12_timing_start JPP((j12_decompress_ptr cinfo));
+EXTERN(void) j12_timing_fill JPP((j12_decompress_ptr cinfo));
+EXTERN(void) j12_timing_skip JPP((j12_decompress_ptr cinfo, long num_bytes));
+EXTERN(void) j12_timing_trace JPP((j12_decompress_ptr cinfo, int event,
+				   boolean begin));
 /* Constant tables in jutils.c */
 #if 0				/* This table is not actually needed in v6a */
 extern const int jpeg12_zigzag_order[]; /* natural coef order to zigzag order */
@@ -416,6 +440,46 @@ extern const int jpeg12_natural_order2[]; /* zz to natural order for 2x2 block *
 /* Arithmetic coding probability estimation tables in jaricom.c */
 extern const INT32 jpeg12_aritab[];
 
+/* Timing hooks for the decoder stages.  They cost a test of cinfo->timing
+ * when timing is not wanted, and nothing without D_TIMING_SUPPORTED.
+ * TIMING_START goes where a new datastream is started.  TIMING_FILLED goes
+ * after each call of the source's fill_input_buffer, TIMING_SKIP before
+ * each call of its skip_input_data (and TIMING_FILLED after), so that the
+ * compressed bytes consumed can be counted.  TIMING_TRACE marks where a
+ * J_TRACE_EVENT begins or ends, for the record's trace method.
+ */
+
+#ifdef D_TIMING_SUPPORTED
+#define TIMING_BEGIN(cinfo,stage)  \
+	((cinfo)->timing != NULL ? jpeg12_timing_begin(cinfo, stage) : (void) 0)
+#define TIMING_SWITCH(cinfo,stage)  \
+	((cinfo)->timing != NULL ? jpeg12_timing_switch(cinfo, stage) : (void) 0)
+#define TIMING_END(cinfo)  \
+	((cinfo)->timing != NULL ? jpeg12_timing_end(cinfo) : (void) 0)
+#define TIMING_COUNT(cinfo,counter,n)  \
+	((cinfo)->timing != NULL ?  \
+	 (void) ((cinfo)->timing->counter += (unsigned long) (n)) : (void) 0)
+#define TIMING_START(cinfo)  \
+	((cinfo)->timing != NULL ? j12_timing_start(cinfo) : (void) 0)
+#define TIMING_FILLED(cinfo)  \
+	((cinfo)->timing != NULL ? j12_timing_fill(cinfo) : (void) 0)
+#define TIMING_SKIP(cinfo,num_bytes)  \
+	((cinfo)->timing != NULL ? j12_timing_skip(cinfo, num_bytes) : (void) 0)
+#define TIMING_TRACE(cinfo,event,begin)  \
+	((cinfo)->timing != NULL && (cinfo)->timing->trace != NULL ?  \
+	 j12_timing_trace(cinfo, event, begin) : (void) 0)
+#else
+#define TIMING_BEGIN(cinfo,stage)	((void) 0)
+#define TIMING_SWITCH(cinfo,stage)	((void) 0)
+#define TIMING_END(cinfo)		((void) 0)
+#define TIMING_COUNT(cinfo,counter,n)	((void) 0)
+#define TIMING_START(cinfo)		((void) 0)
+#define TIMING_FILLED(cinfo)		((void) 0)
+#define TIMING_SKIP(cinfo,num_bytes)	((void) 0)
+#define TIMING_TRACE(cinfo,event,begin)	((void) 0)
+#endif
+
+
 /* Suppress undefined-structure complaints if necessary. */
 
 #ifdef INCOMPLETE_TYPES_BROKEN
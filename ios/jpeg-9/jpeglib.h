@@ -491,6 +491,26 @@ struct jpeg12_decompress_struct {
   boolean enable_external_quant;/* enable future use of external colormap */
   boolean enable_2pass_quant;	/* enable future use of 2-pass quantizer */
 
+  /* Windowed 8-bit output for display and export.  If window_output is TRUE,
+   * each output sample is mapped through the window (window_min => 0,
+   * window_max => 255, linear in between) or through voi_lut if that is not
+   * NULL, and returned as one JOCTET per component.  The rows passed to
+   * jpeg12_read_scanlines() are then really JOCTET rows, cast to JSAMPROW.
+   * RGB output gets a fourth, opaque alpha byte (RGBA order).
+   */
+  boolean window_output;	/* TRUE=windowed 8-bit output wanted */
+  int window_min;		/* sample value mapped to 0 */
+  int window_max;		/* sample value mapped to 255 */
+  JOCTET * voi_lut;		/* optional LUT with MAXJSAMPLE+1 entries */
+
+  /* Threads used to entropy decode a single-scan Huffman image without
+   * restart markers in jpeg12_read_coefficients() (0 or 1 = serial).
+   */
+  int entropy_threads;
+
+  /* Per-stage timing and counters to add to, or NULL (see jdtiming.c). */
+  struct jpeg12_decode_timing_struct * timing;
+
   /* Description of actual output image that will be returned to application.
    * These fields are computed by jpeg12_start_decompress().
    * You can also use jpeg12_calc_output_dimensions() to determine these values
@@ -501,7 +521,8 @@ struct jpeg12_decompress_struct {
   JDIMENSION output_height;	/* scaled image height */
   int out_color_components;	/* # of color components in out_color_space */
   int output_components;	/* # of color components returned */
-  /* output_components is 1 (a colormap index) when quantizing colors;
+  /* output_components is 1 (a colormap index) when quantizing colors,
+   * and 4 for windowed RGB (RGBA) output;
    * otherwise it equals out_color_components.
    */
   int rec_outbuf_height;	/* min recommended height of scanline buffer */
@@ -633,6 +654,7 @@ struct jpeg12_decompress_struct {
    */
 
   JSAMPLE * sample_range_limit; /* table for fast range-limiting */
+  JOCTET * window_range_limit;	/* same, mapped through the output window */
 
   /*
    * These fields are valid during any one scan.
@@ -759,6 +781,18 @@ struct jpeg12_progress_mgr {
   int total_passes;		/* total number of passes expected */
 };
 
+/* A progress monitor that cancels decompression (jpeg12_cancel_monitor()).
+ * Another thread may set *cancel at any time; the next call of the monitor,
+ * once per iMCU row or jpeg12_read_scanlines() call, then fails with
+ * JERR_CANCELLED.  A negative *cancel pauses decompression instead: the
+ * monitor waits until the flag is changed by jpeg12_set_cancel_flag().
+ */
+
+typedef struct {
+  struct jpeg12_progress_mgr pub; /* public fields */
+  volatile int * cancel;	/* the application's flag */
+} jpeg12_cancel_mgr;
+
 
 /* Data destination object for compression */
 
@@ -785,6 +819,15 @@ struct jpeg12_source_mgr {
   JMETHOD(void, j12_term_source, (j12_decompress_ptr cinfo));
 };
 
+/* One piece of a datastream that is not contiguous in memory, e.g. a
+ * fragment of DICOM encapsulated pixel data (see jpeg12_segments_src).
+ */
+
+typedef struct {
+  const JOCTET * data;		/* start of the segment */
+  unsigned long size;		/* its length in bytes */
+} jpeg12_segment;
+
 
 /* Memory manager object.
  * Allocates "small" objects (a few K total), "large" objects (tens of K),
@@ -861,6 +904,263 @@ struct jpeg12_memory_mgr {
 typedef JMETHOD(boolean, jpeg12_marker_parser_method, (j12_decompress_ptr cinfo));
 
 
+/* Sample statistics gathered by jpeg12_read_plane().
+ * Several of these (e.g. one per thread) can be combined with
+ * jpeg12_merge_plane_stats().
+ */
+
+typedef struct {
+  unsigned long count;		/* number of samples seen */
+  int min_value;		/* smallest sample seen (MAXJSAMPLE+1 if none) */
+  int max_value;		/* largest sample seen (-1 if none) */
+  unsigned long histogram[MAXJSAMPLE+1]; /* count of each sample value */
+} jpeg12_plane_stats;
+
+
+/* One image of a jpeg12_decode_batch() call. */
+
+typedef struct {
+  /* Supplied by the application: */
+  const JOCTET * data;		/* compressed image */
+  unsigned long size;		/* its length in bytes */
+  const jpeg12_segment * segments; /* or its pieces, if num_segments > 0 */
+  int num_segments;
+  JSAMPROW plane;		/* output plane, or NULL to have one malloc'd */
+  unsigned long plane_samples;	/* size of a supplied plane, in samples */
+  JDIMENSION row_stride;	/* samples per plane row (0 = packed rows) */
+  jpeg12_plane_stats * stats;	/* statistics to add to, or NULL */
+  JDIMENSION plane_width;	/* required samples per row (0 = any) */
+  JDIMENSION plane_height;	/* required number of rows (0 = any) */
+  boolean rescale;		/* TRUE to store v * slope + intercept */
+  double slope;			/* as UINT16 values, see */
+  double intercept;		/* jpeg12_build_rescale_lut() */
+  volatile int * cancel;	/* fail with JERR_CANCELLED once *cancel is
+				   positive, wait while negative; or NULL */
+  const char * cache_file;	/* plane file to read, or to write after
+				   decoding; NULL for none (jdpcache.c) */
+  int cache_levels;		/* pyramid levels to write (0 = 1) */
+  /* Filled in by jpeg12_decode_batch(): */
+  int status;			/* 0 if decoded, else the error message code */
+  JDIMENSION output_width;	/* dimensions of the decoded image */
+  JDIMENSION output_height;
+  int output_components;
+  char message[JMSG_LENGTH_MAX]; /* text of the error, if status != 0 */
+} jpeg12_batch_item;
+
+/* Completion callback for an asynchronous jpeg12_decode_batch(). */
+typedef JMETHOD(void, jpeg12_batch_done,
+		(void * context, jpeg12_batch_item * items, int num_items,
+		 int num_failed));
+
+
+/* Error manager of the jpeg12_try_xxx() routines (jdtry.c).  An error in
+ * one of them returns control to it, with the message left here.
+ */
+
+typedef struct {
+  struct jpeg12_error_mgr pub;	/* "public" fields */
+  void * jump;			/* return point of the active try routine */
+  int status;			/* 0 if all is well, else the error code */
+  char message[JMSG_LENGTH_MAX]; /* text of the error, if status != 0 */
+} jpeg12_try_error_mgr;
+
+
+/* A cine loop: the frames of a multi-frame series, decoded ahead of
+ * playback on worker threads (jdbatch.c).
+ */
+
+typedef struct jpeg12_cine_struct jpeg12_cine;
+
+/* A frame lent by jpeg12_cine_acquire(). */
+
+typedef struct {
+  long sequence;		/* position in playback order */
+  int frame;			/* sequence % number of frames */
+  int slot;			/* ring slot holding the plane */
+  const JSAMPLE * plane;	/* packed rows of the frame */
+  JDIMENSION width;		/* samples per row */
+  JDIMENSION height;		/* rows */
+  int min_value;		/* smallest sample of the frame */
+  int max_value;		/* largest sample of the frame */
+  int status;			/* 0 if decoded, else the error message code */
+  const char * message;		/* text of the error, if status != 0 */
+} jpeg12_cine_frame;
+
+/* What the workers of a cine have done so far. */
+
+typedef struct {
+  long frames_decoded;		/* frames put on offer, including failed ones */
+  long frames_failed;		/* frames that could not be decoded */
+  long frames_discarded;	/* frames passed by before they were taken */
+} jpeg12_cine_stats;
+
+
+/* One level of a jpeg12_read_pyramid() call.  Level k is the image scaled
+ * by 1/2^k, so the levels are 1/1, 1/2, 1/4 and 1/8.
+ */
+
+#define JPEG12_PYRAMID_LEVELS	4
+
+typedef struct {
+  /* Supplied by the application: */
+  JSAMPROW plane;		/* output plane, or NULL to skip this level */
+  JDIMENSION row_stride;	/* samples per plane row (0 = packed rows) */
+  jpeg12_plane_stats * stats;	/* statistics to add to, or NULL */
+  /* Filled in by jpeg12_calc_pyramid(): */
+  JDIMENSION width;		/* dimensions of this level */
+  JDIMENSION height;
+} jpeg12_pyramid_level;
+
+
+/* What a plane file was decoded from: the length and SHA-256 digest of the
+ * compressed data, see jpeg12_identify_source() (jdpcache.c).
+ */
+
+#define JPEG12_DIGEST_SIZE	32
+
+typedef struct {
+  unsigned long size;		/* length of the compressed data in bytes */
+  JOCTET digest[JPEG12_DIGEST_SIZE]; /* its SHA-256 digest */
+} jpeg12_source_id;
+
+
+/* A decoded grayscale plane in a file, mapped into memory (jdpcache.c).
+ * The file also holds num_levels - 1 smaller levels, level k scaled by
+ * 1/2^k, and the histogram of the full-scale plane.
+ */
+
+typedef struct {
+  /* Filled in by jpeg12_map_plane_file(): */
+  int num_levels;
+  JDIMENSION width[JPEG12_PYRAMID_LEVELS]; /* dimensions of each level */
+  JDIMENSION height[JPEG12_PYRAMID_LEVELS];
+  const JSAMPLE * plane[JPEG12_PYRAMID_LEVELS]; /* packed rows of each level */
+  int min_value;		/* smallest sample of the full-scale plane */
+  int max_value;		/* largest sample of the full-scale plane */
+  /* Private to jdpcache.c: */
+  const JOCTET * histogram;
+  void * map_base;
+  size_t map_bytes;
+} jpeg12_plane_file;
+
+
+/* Entropy-decoded coefficients of a grayscale image, kept so that the image
+ * can be decoded again at another scale or crop without the entropy decoder
+ * (jdccache.c).  Images are reference counted and can be shared through a
+ * jpeg12_coef_cache, which holds recently used images under a byte budget.
+ */
+
+typedef struct jpeg12_coef_cache_struct jpeg12_coef_cache;
+
+/* The key of an image in a cache is 64 bits wide on every platform. */
+
+typedef unsigned long long jpeg12_coef_key;
+
+typedef struct jpeg12_coef_image_struct {
+  /* Read-only for the application: */
+  JDIMENSION image_width;	/* dimensions of the full-scale image */
+  JDIMENSION image_height;
+  JDIMENSION width_in_blocks;
+  JDIMENSION height_in_blocks;
+  boolean compact;		/* TRUE if trailing zeros were dropped */
+  unsigned long bytes;		/* memory held by this image */
+  /* Private to jdccache.c: */
+  UINT16 quantval[DCTSIZE2];	/* quantization table, natural order */
+  JCOEF * coefs;		/* coefficient data */
+  unsigned long * row_start;	/* compact: start of each block row in coefs */
+  UINT8 * counts;		/* compact: coefficients stored per block */
+  int ref_count;
+  jpeg12_coef_cache * cache;	/* cache the image was inserted in, if any */
+  jpeg12_coef_key key;		/* its key there */
+  jpeg12_source_id source;	/* data it was decoded from, if given */
+  struct jpeg12_coef_image_struct * prev; /* links of the cache's LRU list */
+  struct jpeg12_coef_image_struct * next;
+} jpeg12_coef_image;
+
+
+/* Wall time and work done in each stage of the decoder, gathered while
+ * cinfo->timing points to one of these (jdtiming.c).  Like the statistics
+ * above, the record is added to, so that several decodes can be summed.
+ * Times are in seconds; time outside the stages below is not counted.
+ */
+
+typedef enum {
+	JTIME_MARKERS,		/* reading markers */
+	JTIME_ENTROPY,		/* Huffman or arithmetic decoding */
+	JTIME_IDCT,		/* dequantization and inverse DCT */
+	JTIME_UPSAMPLE,		/* upsampling (and merged color conversion) */
+	JTIME_COLOR,		/* color conversion and windowing */
+	JTIME_POSTPROCESS,	/* color quantization */
+	JTIME_OUTPUT		/* copying out, e.g. jpeg12_read_plane() */
+} J_TIMING_STAGE;
+
+#define JPEG12_TIMING_STAGES	7
+#define JPEG12_TIMING_DEPTH	8	/* max nesting of stages */
+
+/* Coarser events, each reported as it begins and ends to the optional
+ * trace method of the record, e.g. to show the decode in a profiler.
+ * An input scan and an output pass may overlap.
+ */
+
+typedef enum {
+	JTRACE_HEADER,		/* reading the markers up to the first SOS */
+	JTRACE_SCAN,		/* reading one scan of compressed data */
+	JTRACE_OUTPUT		/* one output pass */
+} J_TRACE_EVENT;
+
+typedef struct jpeg12_decode_timing_struct {
+  /* Filled in by the library: */
+  double seconds[JPEG12_TIMING_STAGES]; /* time spent in each stage */
+  unsigned long calls[JPEG12_TIMING_STAGES]; /* times each stage was entered */
+  unsigned long input_bytes;	/* compressed bytes consumed */
+  unsigned long MCUs;		/* MCUs entropy decoded */
+  unsigned long blocks;		/* DCT blocks entropy decoded */
+  unsigned long idct_blocks;	/* DCT blocks inverse transformed */
+  unsigned long output_rows;	/* scanlines returned */
+  /* May be set by the application after jpeg12_init_decode_timing(): */
+  JMETHOD(void, trace, (void * trace_data, int event, boolean begin));
+  void * trace_data;		/* passed to trace */
+  /* Private to jdtiming.c: */
+  double stage_start;		/* clock when the current stage was charged */
+  int current_stage;		/* stage being timed, or -1 */
+  int depth;			/* nesting level */
+  int outer_stage[JPEG12_TIMING_DEPTH]; /* stages to return to */
+  unsigned long input_base;	/* bytes consumed before the current buffer */
+  long input_mark;		/* bytes_in_buffer when it was filled, or -1 */
+} jpeg12_decode_timing;
+
+
+/* Memory accounting (jmemmgr.c).
+ * All sizes are in bytes obtained from jpeg12_get_small/large, including
+ * the memory manager's own overhead; peaks are since the object was created.
+ */
+
+typedef struct {
+  long small_bytes[JPOOL_NUMPOOLS]; /* "small" pool space, per pool */
+  long large_bytes[JPOOL_NUMPOOLS]; /* "large" object space, per pool */
+  long peak_bytes[JPOOL_NUMPOOLS]; /* peak of small + large, per pool */
+  long total_bytes;		/* all of the above, plus the control block */
+  long peak_total_bytes;	/* peak of total_bytes */
+  long small_free_bytes;	/* unused part of the small pools */
+  int virtual_arrays;		/* number of virtual arrays requested */
+  long virtual_bytes;		/* their full size */
+  long virtual_resident_bytes;	/* the part of them held in memory */
+  int backing_stores;		/* number of open backing stores */
+  long backing_store_bytes;	/* their size */
+} jpeg12_memory_stats;
+
+/* The same totals for all JPEG objects alive in the process
+ * (each object's share may lag by up to 1 MB, see jmemmgr.c).
+ */
+
+typedef struct {
+  long live_objects;		/* objects created and not yet destroyed */
+  long total_bytes;		/* their total_bytes */
+  long peak_total_bytes;	/* peak of total_bytes */
+  long backing_store_bytes;	/* size of their open backing stores */
+} jpeg12_process_memory_stats;
+
+
 /* Declarations for routines called by application.
  * The JPP macro hides prototype parameters from compilers that can't cope.
  * Note JPP requires double parentheses.
@@ -890,6 +1190,7 @@ typedef JMETHOD(boolean, jpeg12_marker_parser_method, (j12_decompress_ptr cinfo)
 #define jpeg12_stdio_src		jStdSrc
 #define jpeg12_mem_dest		jMemDest
 #define jpeg12_mem_src		jMemSrc
+#define jpeg12_segments_src	jSegSrc
 #define jpeg12_set_defaults	jSetDefaults
 #define jpeg12_set_colorspace	jSetColorspace
 #define jpeg12_default_colorspace	jDefColorspace
@@ -916,6 +1217,61 @@ typedef JMETHOD(boolean, jpeg12_marker_parser_method, (j12_decompress_ptr cinfo)
 #define jpeg12_read_scanlines	jReadScanlines
 #define jpeg12_finish_decompress	jFinDecompress
 #define jpeg12_read_raw_data	jReadRawData
+#define jpeg12_read_plane	jReadPlane
+#define jpeg12_read_plane_mapped	jReadPlaneMap
+#define jpeg12_build_rescale_lut	jBldRescLut
+#define jpeg12_pack_plane_bgra	jPackPlBgra
+#define jpeg12_free_plane	jFreePlane
+#define jpeg12_init_plane_stats	jInitPlStats
+#define jpeg12_merge_plane_stats	jMergePlStats
+#define jpeg12_plane_percentile	jPlPercentile
+#define jpeg12_count_plane_rows	jCntPlRows
+#define jpeg12_estimate_plane_stats	jEstPlStats
+#define jpeg12_decode_batch	jDecBatch
+#define jpeg12_decode_volume	jDecVolume
+#define jpeg12_cancel_monitor	jCancelMon
+#define jpeg12_set_cancel_flag	jSetCancel
+#define jpeg12_create_cine	jCreCine
+#define jpeg12_cine_acquire	jCineAcquire
+#define jpeg12_cine_release	jCineRelease
+#define jpeg12_cine_seek	jCineSeek
+#define jpeg12_cine_get_stats	jCineStats
+#define jpeg12_destroy_cine	jDesCine
+#define jpeg12_identify_source	jIdSource
+#define jpeg12_write_plane_file	jWrPlFile
+#define jpeg12_map_plane_file	jMapPlFile
+#define jpeg12_plane_file_stats	jPlFileStats
+#define jpeg12_unmap_plane_file	jUnmapPlFile
+#define jpeg12_free_plane_file	jFreePlFile
+#define jpeg12_trim_plane_files	jTrimPlFiles
+#define jpeg12_calc_pyramid	jCalcPyramid
+#define jpeg12_read_pyramid	jReadPyramid
+#define jpeg12_save_coefficients	jSaveCoefs
+#define jpeg12_release_coef_image	jRelCoefImg
+#define jpeg12_read_coef_image	jReadCoefImg
+#define jpeg12_create_coef_cache	jCreCoefCache
+#define jpeg12_destroy_coef_cache	jDesCoefCache
+#define jpeg12_coef_cache_lookup	jCoefCacheGet
+#define jpeg12_coef_cache_insert	jCoefCachePut
+#define jpeg12_set_backing_store	jSetBackStore
+#define jpeg12_get_memory_stats	jGetMemStats
+#define jpeg12_get_process_memory_stats	jGetProcMemStats
+#define jpeg12_init_decode_timing	jInitTiming
+#define jpeg12_timing_begin	jTimingBegin
+#define jpeg12_timing_switch	jTimingSwitch
+#define jpeg12_timing_end	jTimingEnd
+#define jpeg12_try_error	jTryError
+#define jpeg12_try_mem_src	jTryMemSrc
+#define jpeg12_try_read_header	jTryRdHeader
+#define jpeg12_try_start_decompress	jTryStrtDecomp
+#define jpeg12_try_read_scanlines	jTryRdScanlines
+#define jpeg12_try_finish_decompress	jTryFinDecomp
+#define jpeg12_try_read_plane	jTryRdPlane
+#define jpeg12_try_estimate_plane_stats	jTryEstPlStats
+#define jpeg12_try_calc_pyramid	jTryCalcPyr
+#define jpeg12_try_read_pyramid	jTryRdPyramid
+#define jpeg12_try_save_coefficients	jTrySaveCoefs
+#define jpeg12_try_read_coef_image	jTryRdCoefImg
 #define jpeg12_has_multiple_scans	jHasMultScn
 #define jpeg12_j12_start_output	jStrtOutput
 #define jpeg12_j12_finish_output	jFinOutput
@@ -974,6 +1330,9 @@ EXTERN(void) jpeg12_mem_dest JPP((j12_compress_ptr cinfo,
 EXTERN(void) jpeg12_mem_src JPP((j12_decompress_ptr cinfo,
 			      unsigned char * inbuffer,
 			      unsigned long insize));
+EXTERN(void) jpeg12_segments_src JPP((j12_decompress_ptr cinfo,
+				   const jpeg12_segment * segments,
+				   int num_segments));
 
 /* Default parameter setup for compression */
 EXTERN(void) jpeg12_set_defaults JPP((j12_compress_ptr cinfo));
@@ -1053,6 +1412,162 @@ EXTERN(JDIMENSION) jpeg12_read_raw_data JPP((j12_decompress_ptr cinfo,
 					   JSAMPIMAGE data,
 					   JDIMENSION max_lines));
 
+/* Reads all remaining scanlines into a caller-supplied plane (jdplane.c),
+ * accumulating sample statistics on the way if stats is not NULL.
+ */
+EXTERN(JDIMENSION) jpeg12_read_plane JPP((j12_decompress_ptr cinfo,
+					JSAMPROW plane, JDIMENSION row_stride,
+					jpeg12_plane_stats * stats));
+EXTERN(JDIMENSION) jpeg12_read_plane_mapped JPP((j12_decompress_ptr cinfo,
+					       JSAMPROW plane,
+					       JDIMENSION row_stride,
+					       jpeg12_plane_stats * stats,
+					       const UINT16 * lut));
+EXTERN(void) jpeg12_build_rescale_lut JPP((UINT16 * lut, double slope,
+					 double intercept));
+EXTERN(void) jpeg12_pack_plane_bgra JPP((const JSAMPLE * plane,
+				       JDIMENSION row_stride, JDIMENSION width,
+				       JDIMENSION height, JOCTET * out));
+EXTERN(void) jpeg12_free_plane JPP((void * plane));
+EXTERN(void) jpeg12_init_plane_stats JPP((jpeg12_plane_stats * stats));
+EXTERN(void) jpeg12_merge_plane_stats JPP((jpeg12_plane_stats * dest,
+					 const jpeg12_plane_stats * src));
+EXTERN(int) jpeg12_plane_percentile JPP((const jpeg12_plane_stats * stats,
+				       double percent));
+EXTERN(void) jpeg12_count_plane_rows JPP((jpeg12_plane_stats * stats,
+					JSAMPROW row, JDIMENSION row_stride,
+					JDIMENSION num_samples, int num_rows));
+/* Quick estimate of the statistics from the DC coefficients alone. */
+EXTERN(boolean) jpeg12_estimate_plane_stats JPP((j12_decompress_ptr cinfo,
+					       jpeg12_plane_stats * stats));
+
+/* Decodes independent images on a pool of worker threads (jdbatch.c). */
+EXTERN(int) jpeg12_decode_batch JPP((jpeg12_batch_item * items, int num_items,
+				   int num_threads, jpeg12_batch_done done,
+				   void * context));
+/* Decodes a series of slices into one contiguous volume (jdbatch.c). */
+EXTERN(int) jpeg12_decode_volume JPP((jpeg12_batch_item * items, int depth,
+				    UINT16 * volume, JDIMENSION width,
+				    JDIMENSION height, int num_threads));
+/* Installs a monitor that cancels decompression on request (jdbatch.c). */
+EXTERN(void) jpeg12_cancel_monitor JPP((j12_common_ptr cinfo,
+				      jpeg12_cancel_mgr * mgr,
+				      volatile int * cancel));
+/* Sets a cancel flag, waking the decodes paused on it (jdbatch.c). */
+EXTERN(void) jpeg12_set_cancel_flag JPP((volatile int * cancel, int value));
+/* Cine loops, decoded ahead on worker threads (jdbatch.c). */
+EXTERN(jpeg12_cine *) jpeg12_create_cine
+	JPP((const JOCTET * const * data, const unsigned long * sizes,
+	     int num_frames, int ring_size, int num_threads,
+	     JDIMENSION * width, JDIMENSION * height));
+EXTERN(boolean) jpeg12_cine_acquire JPP((jpeg12_cine * cine, long sequence,
+				       jpeg12_cine_frame * frame));
+EXTERN(void) jpeg12_cine_release JPP((jpeg12_cine * cine,
+				    jpeg12_cine_frame * frame));
+EXTERN(void) jpeg12_cine_seek JPP((jpeg12_cine * cine, long sequence));
+EXTERN(void) jpeg12_cine_get_stats JPP((jpeg12_cine * cine,
+				      jpeg12_cine_stats * stats));
+EXTERN(void) jpeg12_destroy_cine JPP((jpeg12_cine * cine));
+
+/* Decoded planes kept in files, e.g. as a disk cache (jdpcache.c). */
+EXTERN(void) jpeg12_identify_source JPP((jpeg12_source_id * id,
+					const jpeg12_segment * segments,
+					int num_segments));
+EXTERN(boolean) jpeg12_write_plane_file
+	JPP((const char * path, const jpeg12_source_id * id,
+	     const JSAMPLE * plane, JDIMENSION row_stride,
+	     JDIMENSION width, JDIMENSION height, int num_levels));
+EXTERN(boolean) jpeg12_map_plane_file JPP((const char * path,
+					 const jpeg12_source_id * id,
+					 jpeg12_plane_file * file));
+EXTERN(void) jpeg12_plane_file_stats JPP((const jpeg12_plane_file * file,
+					jpeg12_plane_stats * stats));
+EXTERN(void) jpeg12_unmap_plane_file JPP((jpeg12_plane_file * file));
+EXTERN(void) jpeg12_free_plane_file JPP((void * file));
+EXTERN(unsigned long) jpeg12_trim_plane_files JPP((const char * directory,
+						 unsigned long max_bytes));
+
+/* Decodes the 1/1, 1/2, 1/4 and 1/8 levels in one pass (jdpyram.c). */
+EXTERN(void) jpeg12_calc_pyramid JPP((j12_decompress_ptr cinfo,
+				    jpeg12_pyramid_level * levels));
+EXTERN(boolean) jpeg12_read_pyramid JPP((j12_decompress_ptr cinfo,
+				       jpeg12_pyramid_level * levels));
+
+/* Coefficient images and their cache (jdccache.c). */
+EXTERN(jpeg12_coef_image *) jpeg12_save_coefficients
+	JPP((j12_decompress_ptr cinfo, boolean compact));
+EXTERN(void) jpeg12_release_coef_image JPP((jpeg12_coef_image * image));
+EXTERN(void) jpeg12_read_coef_image
+	JPP((j12_decompress_ptr cinfo, jpeg12_coef_image * image, int scale,
+	     JDIMENSION x, JDIMENSION y, JDIMENSION width, JDIMENSION height,
+	     JSAMPROW plane, JDIMENSION row_stride,
+	     jpeg12_plane_stats * stats));
+EXTERN(jpeg12_coef_cache *) jpeg12_create_coef_cache
+	JPP((unsigned long max_bytes));
+EXTERN(void) jpeg12_destroy_coef_cache JPP((jpeg12_coef_cache * cache));
+EXTERN(jpeg12_coef_image *) jpeg12_coef_cache_lookup
+	JPP((jpeg12_coef_cache * cache, jpeg12_coef_key key,
+	     const jpeg12_source_id * id));
+EXTERN(boolean) jpeg12_coef_cache_insert
+	JPP((jpeg12_coef_cache * cache, jpeg12_coef_key key,
+	     const jpeg12_source_id * id, jpeg12_coef_image * image));
+
+/* Temporary-file directory and default max_memory_to_use of new objects,
+ * for the memory-mapped backing store (jmemnobs.c).
+ */
+EXTERN(void) jpeg12_set_backing_store JPP((const char * temp_dir,
+					 long max_memory_to_use));
+
+/* Memory accounting (jmemmgr.c).  The process totals may be read from any
+ * thread; reset_peak restarts the process peak from the current total.
+ */
+EXTERN(void) jpeg12_get_memory_stats JPP((j12_common_ptr cinfo,
+					jpeg12_memory_stats * stats));
+EXTERN(void) jpeg12_get_process_memory_stats
+	JPP((jpeg12_process_memory_stats * stats, boolean reset_peak));
+
+/* Per-stage decode timing (jdtiming.c).  jpeg12_init_decode_timing() returns
+ * FALSE if the library was built without D_TIMING_SUPPORTED.
+ * The stage routines let other modules charge their own work.
+ */
+EXTERN(boolean) jpeg12_init_decode_timing JPP((jpeg12_decode_timing * timing));
+EXTERN(void) jpeg12_timing_begin JPP((j12_decompress_ptr cinfo, int stage));
+EXTERN(void) jpeg12_timing_switch JPP((j12_decompress_ptr cinfo, int stage));
+EXTERN(void) jpeg12_timing_end JPP((j12_decompress_ptr cinfo));
+
+/* Decompression calls that return after an error instead of exiting;
+ * cinfo->err must have been set up by jpeg12_try_error() (jdtry.c).
+ */
+EXTERN(struct jpeg12_error_mgr *) jpeg12_try_error
+	JPP((jpeg12_try_error_mgr * err));
+EXTERN(void) jpeg12_try_mem_src JPP((j12_decompress_ptr cinfo,
+				   unsigned char * inbuffer,
+				   unsigned long insize));
+EXTERN(int) jpeg12_try_read_header JPP((j12_decompress_ptr cinfo,
+				      boolean require_image));
+EXTERN(boolean) jpeg12_try_start_decompress JPP((j12_decompress_ptr cinfo));
+EXTERN(JDIMENSION) jpeg12_try_read_scanlines JPP((j12_decompress_ptr cinfo,
+						JSAMPARRAY scanlines,
+						JDIMENSION max_lines));
+EXTERN(boolean) jpeg12_try_finish_decompress JPP((j12_decompress_ptr cinfo));
+EXTERN(JDIMENSION) jpeg12_try_read_plane JPP((j12_decompress_ptr cinfo,
+					    JSAMPROW plane,
+					    JDIMENSION row_stride,
+					    jpeg12_plane_stats * stats));
+EXTERN(boolean) jpeg12_try_estimate_plane_stats
+	JPP((j12_decompress_ptr cinfo, jpeg12_plane_stats * stats));
+EXTERN(void) jpeg12_try_calc_pyramid JPP((j12_decompress_ptr cinfo,
+					jpeg12_pyramid_level * levels));
+EXTERN(boolean) jpeg12_try_read_pyramid JPP((j12_decompress_ptr cinfo,
+					   jpeg12_pyramid_level * levels));
+EXTERN(jpeg12_coef_image *) jpeg12_try_save_coefficients
+	JPP((j12_decompress_ptr cinfo, boolean compact));
+EXTERN(void) jpeg12_try_read_coef_image
+	JPP((j12_decompress_ptr cinfo, jpeg12_coef_image * image, int scale,
+	     JDIMENSION x, JDIMENSION y, JDIMENSION width, JDIMENSION height,
+	     JSAMPROW plane, JDIMENSION row_stride,
+	     jpeg12_plane_stats * stats));
+
 /* Additional entry points for buffered-image mode. */
 EXTERN(boolean) jpeg12_has_multiple_scans JPP((j12_decompress_ptr cinfo));
 EXTERN(boolean) jpeg12_j12_start_output JPP((j12_decompress_ptr cinfo,
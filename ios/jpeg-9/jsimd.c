@@ -0,0 +1,1147 @@
+/*
+ * jsimd.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains vectorized versions of some decompressor inner loops
+ * (upsampling and output color conversion), together with the runtime
+ * selection logic.  See jsimd.h for the interface.
+ *
+ * All kernels work on 16-bit JSAMPLEs and are only compiled for the 12-bit
+ * build.  They are required to produce exactly the output of the C code they
+ * replace.  In particular, the YCC->RGB arithmetic below is the same
+ * fixed-point computation that jdcolor.c and jdmerge.c precompute into their
+ * tables, and clamping to 0..MAXJSAMPLE gives the same answer as the
+ * sample_range_limit[] lookup for every value that can occur here.
+ */
+
+#define JPEG12_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jsimd.h"
+
+
+/* Decide which instruction sets we can compile for.
+ * x86: SSE2 is part of the x86-64 baseline (and of the Android x86 ABI);
+ * AVX2 kernels are compiled via function target attributes and selected
+ * only when the CPU and OS support them.
+ * ARM: NEON is mandatory on AArch64 and on every armeabi-v7a device we care
+ * about; the compiler announces it with __ARM_NEON.
+ */
+
+#if defined(SIMD_SUPPORTED) && BITS_IN_JSAMPLE == 12
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSIMD_USE_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define JSIMD_USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSIMD_USE_AVX2
+#include <immintrin.h>
+#include <cpuid.h>
+#define AVX2_TARGET  __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+
+static unsigned int simd_support = ~0U;	/* ~0 until init_simd has run */
+static unsigned int simd_mask = ~0U;	/* see j12_simd_set_mask() */
+
+
+#ifdef JSIMD_USE_AVX2
+
+LOCAL(boolean)
+cpu_has_avx2 (void)
+{
+  unsigned int eax, ebx, ecx, edx;
+
+  if (! __get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return FALSE;
+  /* The OS must save the YMM state for us, too. */
+  if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0)
+    return FALSE;
+  __asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  if ((eax & 6) != 6)
+    return FALSE;
+  if (__get_cpuid_max(0, NULL) < 7)
+    return FALSE;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & bit_AVX2) != 0;
+}
+
+#endif /* JSIMD_USE_AVX2 */
+
+
+/*
+ * Determine the usable instruction sets, once per process.
+ * Racing initializations from several threads all store the same value.
+ */
+
+LOCAL(unsigned int)
+detect_simd (void)
+{
+  unsigned int support = 0;
+  char * env;
+
+  if (simd_support != ~0U)
+    return simd_support;
+
+#ifdef JSIMD_USE_NEON
+  support |= JSIMD_NEON;
+#endif
+#ifdef JSIMD_USE_SSE2
+  support |= JSIMD_SSE2;
+#endif
+#ifdef JSIMD_USE_AVX2
+  if (cpu_has_avx2())
+    support |= JSIMD_AVX2;
+#endif
+
+  /* Environment overrides, for testing against the C code */
+  if ((env = getenv("JSIMD_FORCESSE2")) != NULL && strcmp(env, "1") == 0)
+    support &= JSIMD_SSE2;
+  if ((env = getenv("JSIMD_FORCENONE")) != NULL && strcmp(env, "1") == 0)
+    support = 0;
+
+  simd_support = support;
+  return support;
+}
+
+
+/* The instruction sets to use now. */
+
+LOCAL(unsigned int)
+init_simd (void)
+{
+  return detect_simd() & simd_mask;
+}
+
+
+/*
+ * Fixed-point YCC->RGB constants; see jdcolor.c for the derivation.
+ */
+
+#define SCALEBITS	16
+#define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
+#define FIX(x)		((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
+
+#define FIX_1_40200	FIX(1.40200)	/* Cr => R */
+#define FIX_1_77200	FIX(1.77200)	/* Cb => B */
+#define FIX_0_71414	FIX(0.71414)	/* Cr => G (negated) */
+#define FIX_0_34414	FIX(0.34414)	/* Cb => G (negated) */
+
+/* Clamp to 0..MAXJSAMPLE */
+#define CLAMP_SAMPLE(x)  ((JSAMPLE) ((x) < 0 ? 0 : (x) > MAXJSAMPLE ? MAXJSAMPLE : (x)))
+
+
+/*
+ * Portable C code for the columns left over after the vector loops.
+ * YCC->RGB: emit output columns col..num_cols-1 of one row, using chroma
+ * sample col >> h_shift for each (h_shift is 1 for merged upsampling).
+ */
+
+LOCAL(void)
+ycc_rgb_tail (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION col, JDIMENSION num_cols,
+	      int h_shift)
+{
+  register int y, cb, cr;
+  INT32 cred, cgreen, cblue;
+  SHIFT_TEMPS
+
+  outptr += col * RGB_PIXELSIZE;
+  for (; col < num_cols; col++) {
+    cb = GETJSAMPLE(inptr1[col >> h_shift]) - CENTERJSAMPLE;
+    cr = GETJSAMPLE(inptr2[col >> h_shift]) - CENTERJSAMPLE;
+    cred = RIGHT_SHIFT(FIX_1_40200 * cr + ONE_HALF, SCALEBITS);
+    cgreen = RIGHT_SHIFT(- FIX_0_34414 * cb - FIX_0_71414 * cr + ONE_HALF,
+			 SCALEBITS);
+    cblue = RIGHT_SHIFT(FIX_1_77200 * cb + ONE_HALF, SCALEBITS);
+    y = GETJSAMPLE(inptr0[col]);
+    outptr[RGB_RED] =   CLAMP_SAMPLE(y + cred);
+    outptr[RGB_GREEN] = CLAMP_SAMPLE(y + cgreen);
+    outptr[RGB_BLUE] =  CLAMP_SAMPLE(y + cblue);
+    outptr += RGB_PIXELSIZE;
+  }
+}
+
+
+/*
+ * YCCK->CMYK: as above, but inverted, with K passed through.
+ */
+
+LOCAL(void)
+ycck_cmyk_tail (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW inptr3, JSAMPROW outptr,
+		JDIMENSION col, JDIMENSION num_cols)
+{
+  register int y, cb, cr;
+  INT32 cred, cgreen, cblue;
+  SHIFT_TEMPS
+
+  outptr += col * 4;
+  for (; col < num_cols; col++) {
+    cb = GETJSAMPLE(inptr1[col]) - CENTERJSAMPLE;
+    cr = GETJSAMPLE(inptr2[col]) - CENTERJSAMPLE;
+    cred = RIGHT_SHIFT(FIX_1_40200 * cr + ONE_HALF, SCALEBITS);
+    cgreen = RIGHT_SHIFT(- FIX_0_34414 * cb - FIX_0_71414 * cr + ONE_HALF,
+			 SCALEBITS);
+    cblue = RIGHT_SHIFT(FIX_1_77200 * cb + ONE_HALF, SCALEBITS);
+    y = GETJSAMPLE(inptr0[col]);
+    outptr[0] = CLAMP_SAMPLE(MAXJSAMPLE - (y + cred));
+    outptr[1] = CLAMP_SAMPLE(MAXJSAMPLE - (y + cgreen));
+    outptr[2] = CLAMP_SAMPLE(MAXJSAMPLE - (y + cblue));
+    outptr[3] = inptr3[col];
+    outptr += 4;
+  }
+}
+
+
+/*
+ * [R-G,G,B-G] to [R,G,B] (inverse color transform).
+ */
+
+LOCAL(void)
+rgb1_rgb_tail (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	       JSAMPROW outptr, JDIMENSION col, JDIMENSION num_cols)
+{
+  register int r, g, b;
+
+  outptr += col * RGB_PIXELSIZE;
+  for (; col < num_cols; col++) {
+    r = GETJSAMPLE(inptr0[col]);
+    g = GETJSAMPLE(inptr1[col]);
+    b = GETJSAMPLE(inptr2[col]);
+    outptr[RGB_RED]   = (JSAMPLE) ((r + g - CENTERJSAMPLE) & MAXJSAMPLE);
+    outptr[RGB_GREEN] = (JSAMPLE) g;
+    outptr[RGB_BLUE]  = (JSAMPLE) ((b + g - CENTERJSAMPLE) & MAXJSAMPLE);
+    outptr += RGB_PIXELSIZE;
+  }
+}
+
+
+/********************************* SSE2 *********************************/
+
+#ifdef JSIMD_USE_SSE2
+
+/* pmaddwd multiplies pairs of 16-bit lanes.  Constants wider than 15 bits
+ * are split across a lane pair whose inputs are x and 2*x:
+ *   x * 91881  = x * 26347 + 2x * 32767
+ *   x * 116130 = 2x * 29033 + 2x * 29032
+ *   -(cb * 22554) - (cr * 46802) = cb * -22554 + 2cr * -23401
+ */
+
+#define PAIR16(lo,hi)  \
+  ((int) (((unsigned int) (unsigned short) (hi) << 16) | \
+	  (unsigned short) (lo)))
+
+#define K_R_LO	(FIX_1_40200 - 2 * 32767)
+#define K_R_HI	32767
+#define K_B_LO	(FIX_1_77200 / 2 - FIX_1_77200 / 4)
+#define K_B_HI	(FIX_1_77200 / 4)
+#define K_G_LO	(- FIX_0_34414)
+#define K_G_HI	(- FIX_0_71414 / 2)
+
+INLINE
+LOCAL(__m128i)
+madd_descale_sse2 (__m128i a, __m128i b, __m128i k)
+/* Returns RIGHT_SHIFT(a*k0 + b*k1 + ONE_HALF, SCALEBITS) for 8 lanes */
+{
+  const __m128i half = _mm_set1_epi32(ONE_HALF);
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), k);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), k);
+
+  lo = _mm_srai_epi32(_mm_add_epi32(lo, half), SCALEBITS);
+  hi = _mm_srai_epi32(_mm_add_epi32(hi, half), SCALEBITS);
+  return _mm_packs_epi32(lo, hi);
+}
+
+INLINE
+LOCAL(void)
+ycc_terms_sse2 (__m128i cb, __m128i cr,
+		__m128i * cred, __m128i * cgreen, __m128i * cblue)
+/* cb and cr must already have CENTERJSAMPLE subtracted */
+{
+  __m128i cb2 = _mm_add_epi16(cb, cb);
+  __m128i cr2 = _mm_add_epi16(cr, cr);
+
+  *cred = madd_descale_sse2(cr, cr2, _mm_set1_epi32(PAIR16(K_R_LO, K_R_HI)));
+  *cgreen = madd_descale_sse2(cb, cr2, _mm_set1_epi32(PAIR16(K_G_LO, K_G_HI)));
+  *cblue = madd_descale_sse2(cb2, cb2, _mm_set1_epi32(PAIR16(K_B_LO, K_B_HI)));
+}
+
+INLINE
+LOCAL(__m128i)
+add_clamp_sse2 (__m128i y, __m128i c)
+{
+  return _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(y, c), _mm_setzero_si128()),
+		       _mm_set1_epi16(MAXJSAMPLE));
+}
+
+INLINE
+LOCAL(void)
+store_rgb_sse2 (JSAMPROW outptr, __m128i r, __m128i g, __m128i b)
+/* Interleave 8 RGB pixels.  SSE2 has no 3-way 16-bit interleave, but
+ * the output is a 3-way interleave of 32-bit pairs:
+ *   out0 = r0g0 b0r1 g1b1 r2g2    (A0 B0 C0 A1)
+ *   out1 = b2r3 g3b3 r4g4 b4r5    (B1 C1 A2 B2)
+ *   out2 = g5b5 r6g6 b6r7 g7b7    (C2 A3 B3 C3)
+ * where A holds the even RG pairs, B the pairs b(i),r(i+1) for even i,
+ * and C the odd GB pairs.  shufps picks two 32-bit lanes from each of
+ * two vectors, which is all both steps need.
+ */
+{
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+  __m128 rg_lo = _mm_castsi128_ps(_mm_unpacklo_epi16(r, g));
+  __m128 rg_hi = _mm_castsi128_ps(_mm_unpackhi_epi16(r, g));
+  __m128 gb_lo = _mm_castsi128_ps(_mm_unpacklo_epi16(g, b));
+  __m128 gb_hi = _mm_castsi128_ps(_mm_unpackhi_epi16(g, b));
+  __m128i r1 = _mm_srli_si128(r, 2);	/* r1 r2 ... r7 0 */
+  __m128 br_lo = _mm_castsi128_ps(_mm_unpacklo_epi16(b, r1));
+  __m128 br_hi = _mm_castsi128_ps(_mm_unpackhi_epi16(b, r1));
+  __m128 aa = _mm_shuffle_ps(rg_lo, rg_hi, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 bb = _mm_shuffle_ps(br_lo, br_hi, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 cc = _mm_shuffle_ps(gb_lo, gb_hi, _MM_SHUFFLE(3, 1, 3, 1));
+  __m128 ab_lo = _mm_unpacklo_ps(aa, bb);	/* A0 B0 A1 B1 */
+  __m128 ab_hi = _mm_unpackhi_ps(aa, bb);	/* A2 B2 A3 B3 */
+  __m128 ca_lo = _mm_unpacklo_ps(cc, aa);	/* C0 A0 C1 A1 */
+  __m128 ca_hi = _mm_unpackhi_ps(cc, aa);	/* C2 A2 C3 A3 */
+  __m128 bc_lo = _mm_unpacklo_ps(bb, cc);	/* B0 C0 B1 C1 */
+  __m128 bc_hi = _mm_unpackhi_ps(bb, cc);	/* B2 C2 B3 C3 */
+
+  _mm_storeu_ps((float *) outptr,
+		_mm_shuffle_ps(ab_lo, ca_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+  _mm_storeu_ps((float *) (outptr + 8),
+		_mm_shuffle_ps(bc_lo, ab_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+  _mm_storeu_ps((float *) (outptr + 16),
+		_mm_shuffle_ps(ca_hi, bc_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+#else
+  JSAMPLE rr[8], gg[8], bb[8];
+  int i;
+
+  _mm_storeu_si128((__m128i *) rr, r);
+  _mm_storeu_si128((__m128i *) gg, g);
+  _mm_storeu_si128((__m128i *) bb, b);
+  for (i = 0; i < 8; i++) {
+    outptr[RGB_RED] =   rr[i];
+    outptr[RGB_GREEN] = gg[i];
+    outptr[RGB_BLUE] =  bb[i];
+    outptr += RGB_PIXELSIZE;
+  }
+#endif
+}
+
+LOCAL(void)
+emit_rgb16_sse2 (JSAMPROW inptr0, JSAMPROW outptr,
+		 __m128i cred, __m128i cgreen, __m128i cblue)
+/* Emit 16 pixels sharing 8 chroma terms pairwise */
+{
+  __m128i y0 = _mm_loadu_si128((const __m128i *) inptr0);
+  __m128i y1 = _mm_loadu_si128((const __m128i *) (inptr0 + 8));
+
+  store_rgb_sse2(outptr,
+		 add_clamp_sse2(y0, _mm_unpacklo_epi16(cred, cred)),
+		 add_clamp_sse2(y0, _mm_unpacklo_epi16(cgreen, cgreen)),
+		 add_clamp_sse2(y0, _mm_unpacklo_epi16(cblue, cblue)));
+  store_rgb_sse2(outptr + 8 * RGB_PIXELSIZE,
+		 add_clamp_sse2(y1, _mm_unpackhi_epi16(cred, cred)),
+		 add_clamp_sse2(y1, _mm_unpackhi_epi16(cgreen, cgreen)),
+		 add_clamp_sse2(y1, _mm_unpackhi_epi16(cblue, cblue)));
+}
+
+LOCAL(JDIMENSION)
+h2_merged_sse2 (JSAMPROW inptr00, JSAMPROW inptr01,
+		JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW outptr0, JSAMPROW outptr1, JDIMENSION num_cols)
+{
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+  __m128i cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    cb = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr1 + (col >> 1))),
+		       center);
+    cr = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr2 + (col >> 1))),
+		       center);
+    ycc_terms_sse2(cb, cr, &cred, &cgreen, &cblue);
+    emit_rgb16_sse2(inptr00 + col, outptr0 + col * RGB_PIXELSIZE,
+		    cred, cgreen, cblue);
+    if (inptr01 != NULL)
+      emit_rgb16_sse2(inptr01 + col, outptr1 + col * RGB_PIXELSIZE,
+		      cred, cgreen, cblue);
+  }
+  return col;
+}
+
+LOCAL(JDIMENSION)
+ycc_rgb_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+  __m128i y, cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    y = _mm_loadu_si128((const __m128i *) (inptr0 + col));
+    cb = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr1 + col)), center);
+    cr = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr2 + col)), center);
+    ycc_terms_sse2(cb, cr, &cred, &cgreen, &cblue);
+    store_rgb_sse2(outptr + col * RGB_PIXELSIZE, add_clamp_sse2(y, cred),
+		   add_clamp_sse2(y, cgreen), add_clamp_sse2(y, cblue));
+  }
+  return col;
+}
+
+INLINE
+LOCAL(void)
+store_cmyk_sse2 (JSAMPROW outptr, __m128i c, __m128i m, __m128i y, __m128i k)
+/* Interleave 8 4-component pixels */
+{
+  __m128i cm_lo = _mm_unpacklo_epi16(c, m);
+  __m128i cm_hi = _mm_unpackhi_epi16(c, m);
+  __m128i yk_lo = _mm_unpacklo_epi16(y, k);
+  __m128i yk_hi = _mm_unpackhi_epi16(y, k);
+
+  _mm_storeu_si128((__m128i *) outptr, _mm_unpacklo_epi32(cm_lo, yk_lo));
+  _mm_storeu_si128((__m128i *) (outptr + 8), _mm_unpackhi_epi32(cm_lo, yk_lo));
+  _mm_storeu_si128((__m128i *) (outptr + 16), _mm_unpacklo_epi32(cm_hi, yk_hi));
+  _mm_storeu_si128((__m128i *) (outptr + 24), _mm_unpackhi_epi32(cm_hi, yk_hi));
+}
+
+INLINE
+LOCAL(__m128i)
+sub_clamp_sse2 (__m128i y, __m128i c)
+/* MAXJSAMPLE - (y + c), range-limited */
+{
+  return add_clamp_sse2(_mm_sub_epi16(_mm_set1_epi16(MAXJSAMPLE), y),
+			_mm_sub_epi16(_mm_setzero_si128(), c));
+}
+
+LOCAL(JDIMENSION)
+ycck_cmyk_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW inptr3, JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+  __m128i y, cb, cr, k, cred, cgreen, cblue;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    y = _mm_loadu_si128((const __m128i *) (inptr0 + col));
+    cb = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr1 + col)), center);
+    cr = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (inptr2 + col)), center);
+    k = _mm_loadu_si128((const __m128i *) (inptr3 + col));
+    ycc_terms_sse2(cb, cr, &cred, &cgreen, &cblue);
+    store_cmyk_sse2(outptr + col * 4, sub_clamp_sse2(y, cred),
+		    sub_clamp_sse2(y, cgreen), sub_clamp_sse2(y, cblue), k);
+  }
+  return col;
+}
+
+LOCAL(JDIMENSION)
+rgb1_rgb_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	       JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  const __m128i mask = _mm_set1_epi16(MAXJSAMPLE);
+  JDIMENSION col;
+  __m128i g, gc;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    g = _mm_loadu_si128((const __m128i *) (inptr1 + col));
+    gc = _mm_sub_epi16(g, center);
+    store_rgb_sse2(outptr + col * RGB_PIXELSIZE,
+      _mm_and_si128(mask, _mm_add_epi16(
+	_mm_loadu_si128((const __m128i *) (inptr0 + col)), gc)),
+      g,
+      _mm_and_si128(mask, _mm_add_epi16(
+	_mm_loadu_si128((const __m128i *) (inptr2 + col)), gc)));
+  }
+  return col;
+}
+
+#endif /* JSIMD_USE_SSE2 */
+
+
+/********************************* AVX2 *********************************/
+
+#ifdef JSIMD_USE_AVX2
+
+/* 256-bit unpack and pack instructions work within 128-bit lanes.
+ * Unpack-then-pack restores the original element order, but widening a
+ * vector by unpacking it with itself leaves the two halves interleaved
+ * across lanes; LANE_LO/LANE_HI put them back in order.
+ */
+#define LANE_LO(lo,hi)	_mm256_permute2x128_si256(lo, hi, 0x20)
+#define LANE_HI(lo,hi)	_mm256_permute2x128_si256(lo, hi, 0x31)
+
+INLINE
+AVX2_TARGET LOCAL(void)
+store_rgb_avx2 (JSAMPROW outptr, __m256i r, __m256i g, __m256i b)
+/* Interleave 16 RGB pixels; the 3-way interleave is done in 128-bit halves */
+{
+  store_rgb_sse2(outptr, _mm256_castsi256_si128(r),
+		 _mm256_castsi256_si128(g), _mm256_castsi256_si128(b));
+  store_rgb_sse2(outptr + 8 * RGB_PIXELSIZE, _mm256_extracti128_si256(r, 1),
+		 _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(b, 1));
+}
+
+INLINE
+AVX2_TARGET LOCAL(__m256i)
+madd_descale_avx2 (__m256i a, __m256i b, __m256i k)
+{
+  const __m256i half = _mm256_set1_epi32(ONE_HALF);
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), k);
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), k);
+
+  lo = _mm256_srai_epi32(_mm256_add_epi32(lo, half), SCALEBITS);
+  hi = _mm256_srai_epi32(_mm256_add_epi32(hi, half), SCALEBITS);
+  return _mm256_packs_epi32(lo, hi);
+}
+
+INLINE
+AVX2_TARGET LOCAL(void)
+ycc_terms_avx2 (__m256i cb, __m256i cr,
+		__m256i * cred, __m256i * cgreen, __m256i * cblue)
+{
+  __m256i cb2 = _mm256_add_epi16(cb, cb);
+  __m256i cr2 = _mm256_add_epi16(cr, cr);
+
+  *cred = madd_descale_avx2(cr, cr2,
+			    _mm256_set1_epi32(PAIR16(K_R_LO, K_R_HI)));
+  *cgreen = madd_descale_avx2(cb, cr2,
+			      _mm256_set1_epi32(PAIR16(K_G_LO, K_G_HI)));
+  *cblue = madd_descale_avx2(cb2, cb2,
+			     _mm256_set1_epi32(PAIR16(K_B_LO, K_B_HI)));
+}
+
+INLINE
+AVX2_TARGET LOCAL(__m256i)
+add_clamp_avx2 (__m256i y, __m256i c)
+{
+  return _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(y, c),
+					   _mm256_setzero_si256()),
+			  _mm256_set1_epi16(MAXJSAMPLE));
+}
+
+AVX2_TARGET LOCAL(void)
+emit_rgb32_avx2 (JSAMPROW inptr0, JSAMPROW outptr,
+		 __m256i cred, __m256i cgreen, __m256i cblue)
+/* Emit 32 pixels sharing 16 chroma terms pairwise */
+{
+  __m256i y0 = _mm256_loadu_si256((const __m256i *) inptr0);
+  __m256i y1 = _mm256_loadu_si256((const __m256i *) (inptr0 + 16));
+  __m256i r_lo = _mm256_unpacklo_epi16(cred, cred);
+  __m256i r_hi = _mm256_unpackhi_epi16(cred, cred);
+  __m256i g_lo = _mm256_unpacklo_epi16(cgreen, cgreen);
+  __m256i g_hi = _mm256_unpackhi_epi16(cgreen, cgreen);
+  __m256i b_lo = _mm256_unpacklo_epi16(cblue, cblue);
+  __m256i b_hi = _mm256_unpackhi_epi16(cblue, cblue);
+
+  store_rgb_avx2(outptr,
+		 add_clamp_avx2(y0, LANE_LO(r_lo, r_hi)),
+		 add_clamp_avx2(y0, LANE_LO(g_lo, g_hi)),
+		 add_clamp_avx2(y0, LANE_LO(b_lo, b_hi)));
+  store_rgb_avx2(outptr + 16 * RGB_PIXELSIZE,
+		 add_clamp_avx2(y1, LANE_HI(r_lo, r_hi)),
+		 add_clamp_avx2(y1, LANE_HI(g_lo, g_hi)),
+		 add_clamp_avx2(y1, LANE_HI(b_lo, b_hi)));
+}
+
+AVX2_TARGET LOCAL(JDIMENSION)
+h2_merged_avx2 (JSAMPROW inptr00, JSAMPROW inptr01,
+		JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW outptr0, JSAMPROW outptr1, JDIMENSION num_cols)
+{
+  const __m256i center = _mm256_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+  __m256i cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 32 <= num_cols; col += 32) {
+    cb = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr1 + (col >> 1))), center);
+    cr = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr2 + (col >> 1))), center);
+    ycc_terms_avx2(cb, cr, &cred, &cgreen, &cblue);
+    emit_rgb32_avx2(inptr00 + col, outptr0 + col * RGB_PIXELSIZE,
+		    cred, cgreen, cblue);
+    if (inptr01 != NULL)
+      emit_rgb32_avx2(inptr01 + col, outptr1 + col * RGB_PIXELSIZE,
+		      cred, cgreen, cblue);
+  }
+  return col;
+}
+
+
+AVX2_TARGET LOCAL(JDIMENSION)
+ycc_rgb_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m256i center = _mm256_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+  __m256i y, cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    y = _mm256_loadu_si256((const __m256i *) (inptr0 + col));
+    cb = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr1 + col)), center);
+    cr = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr2 + col)), center);
+    ycc_terms_avx2(cb, cr, &cred, &cgreen, &cblue);
+    store_rgb_avx2(outptr + col * RGB_PIXELSIZE, add_clamp_avx2(y, cred),
+		   add_clamp_avx2(y, cgreen), add_clamp_avx2(y, cblue));
+  }
+  return col;
+}
+
+AVX2_TARGET LOCAL(JDIMENSION)
+ycck_cmyk_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW inptr3, JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m256i center = _mm256_set1_epi16(CENTERJSAMPLE);
+  const __m256i maxval = _mm256_set1_epi16(MAXJSAMPLE);
+  const __m256i zero = _mm256_setzero_si256();
+  JDIMENSION col;
+  __m256i y, cb, cr, k, cred, cgreen, cblue, c, m, yy;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    y = _mm256_loadu_si256((const __m256i *) (inptr0 + col));
+    cb = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr1 + col)), center);
+    cr = _mm256_sub_epi16(
+	   _mm256_loadu_si256((const __m256i *) (inptr2 + col)), center);
+    k = _mm256_loadu_si256((const __m256i *) (inptr3 + col));
+    ycc_terms_avx2(cb, cr, &cred, &cgreen, &cblue);
+    y = _mm256_sub_epi16(maxval, y);
+    c = add_clamp_avx2(y, _mm256_sub_epi16(zero, cred));
+    m = add_clamp_avx2(y, _mm256_sub_epi16(zero, cgreen));
+    yy = add_clamp_avx2(y, _mm256_sub_epi16(zero, cblue));
+    /* The 4-way interleave is done in 128-bit halves */
+    store_cmyk_sse2(outptr + col * 4,
+		    _mm256_castsi256_si128(c), _mm256_castsi256_si128(m),
+		    _mm256_castsi256_si128(yy), _mm256_castsi256_si128(k));
+    store_cmyk_sse2(outptr + (col + 8) * 4,
+		    _mm256_extracti128_si256(c, 1), _mm256_extracti128_si256(m, 1),
+		    _mm256_extracti128_si256(yy, 1), _mm256_extracti128_si256(k, 1));
+  }
+  return col;
+}
+
+AVX2_TARGET LOCAL(JDIMENSION)
+rgb1_rgb_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	       JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m256i center = _mm256_set1_epi16(CENTERJSAMPLE);
+  const __m256i mask = _mm256_set1_epi16(MAXJSAMPLE);
+  JDIMENSION col;
+  __m256i g, gc;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    g = _mm256_loadu_si256((const __m256i *) (inptr1 + col));
+    gc = _mm256_sub_epi16(g, center);
+    store_rgb_avx2(outptr + col * RGB_PIXELSIZE,
+      _mm256_and_si256(mask, _mm256_add_epi16(
+	_mm256_loadu_si256((const __m256i *) (inptr0 + col)), gc)),
+      g,
+      _mm256_and_si256(mask, _mm256_add_epi16(
+	_mm256_loadu_si256((const __m256i *) (inptr2 + col)), gc)));
+  }
+  return col;
+}
+#endif /* JSIMD_USE_AVX2 */
+
+
+/********************************* NEON *********************************/
+
+#ifdef JSIMD_USE_NEON
+
+INLINE
+LOCAL(int16x8_t)
+descale_neon (int32x4_t lo, int32x4_t hi)
+{
+  return vcombine_s16(vmovn_s32(vshrq_n_s32(lo, SCALEBITS)),
+		      vmovn_s32(vshrq_n_s32(hi, SCALEBITS)));
+}
+
+INLINE
+LOCAL(void)
+ycc_terms_neon (int16x8_t cb, int16x8_t cr,
+		int16x8_t * cred, int16x8_t * cgreen, int16x8_t * cblue)
+/* cb and cr must already have CENTERJSAMPLE subtracted */
+{
+  const int32x4_t half = vdupq_n_s32(ONE_HALF);
+  int32x4_t cb_l = vmovl_s16(vget_low_s16(cb));
+  int32x4_t cb_h = vmovl_s16(vget_high_s16(cb));
+  int32x4_t cr_l = vmovl_s16(vget_low_s16(cr));
+  int32x4_t cr_h = vmovl_s16(vget_high_s16(cr));
+
+  *cred = descale_neon(vmlaq_n_s32(half, cr_l, FIX_1_40200),
+		       vmlaq_n_s32(half, cr_h, FIX_1_40200));
+  *cgreen = descale_neon(vmlaq_n_s32(vmlaq_n_s32(half, cb_l, - FIX_0_34414),
+				     cr_l, - FIX_0_71414),
+			 vmlaq_n_s32(vmlaq_n_s32(half, cb_h, - FIX_0_34414),
+				     cr_h, - FIX_0_71414));
+  *cblue = descale_neon(vmlaq_n_s32(half, cb_l, FIX_1_77200),
+			vmlaq_n_s32(half, cb_h, FIX_1_77200));
+}
+
+INLINE
+LOCAL(int16x8_t)
+add_clamp_neon (int16x8_t y, int16x8_t c)
+{
+  return vminq_s16(vmaxq_s16(vaddq_s16(y, c), vdupq_n_s16(0)),
+		   vdupq_n_s16(MAXJSAMPLE));
+}
+
+INLINE
+LOCAL(void)
+store_rgb_neon (JSAMPROW outptr, int16x8_t r, int16x8_t g, int16x8_t b)
+{
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+  int16x8x3_t rgb;
+
+  rgb.val[0] = r;
+  rgb.val[1] = g;
+  rgb.val[2] = b;
+  vst3q_s16(outptr, rgb);
+#else
+  JSAMPLE rr[8], gg[8], bb[8];
+  int i;
+
+  vst1q_s16(rr, r);
+  vst1q_s16(gg, g);
+  vst1q_s16(bb, b);
+  for (i = 0; i < 8; i++) {
+    outptr[RGB_RED] =   rr[i];
+    outptr[RGB_GREEN] = gg[i];
+    outptr[RGB_BLUE] =  bb[i];
+    outptr += RGB_PIXELSIZE;
+  }
+#endif
+}
+
+LOCAL(JDIMENSION)
+h2_upsample_neon (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+		  JDIMENSION num_cols)
+{
+  JDIMENSION col;
+  int16x8x2_t pair;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    pair.val[0] = pair.val[1] = vld1q_s16(inptr + (col >> 1));
+    vst2q_s16(outptr0 + col, pair);
+    if (outptr1 != NULL)
+      vst2q_s16(outptr1 + col, pair);
+  }
+  return col;
+}
+
+LOCAL(void)
+emit_rgb16_neon (JSAMPROW inptr0, JSAMPROW outptr,
+		 int16x8_t cred, int16x8_t cgreen, int16x8_t cblue)
+/* Emit 16 pixels sharing 8 chroma terms pairwise */
+{
+  int16x8_t y0 = vld1q_s16(inptr0);
+  int16x8_t y1 = vld1q_s16(inptr0 + 8);
+  int16x8x2_t r = vzipq_s16(cred, cred);
+  int16x8x2_t g = vzipq_s16(cgreen, cgreen);
+  int16x8x2_t b = vzipq_s16(cblue, cblue);
+
+  store_rgb_neon(outptr, add_clamp_neon(y0, r.val[0]),
+		 add_clamp_neon(y0, g.val[0]), add_clamp_neon(y0, b.val[0]));
+  store_rgb_neon(outptr + 8 * RGB_PIXELSIZE, add_clamp_neon(y1, r.val[1]),
+		 add_clamp_neon(y1, g.val[1]), add_clamp_neon(y1, b.val[1]));
+}
+
+LOCAL(JDIMENSION)
+h2_merged_neon (JSAMPROW inptr00, JSAMPROW inptr01,
+		JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW outptr0, JSAMPROW outptr1, JDIMENSION num_cols)
+{
+  const int16x8_t center = vdupq_n_s16(CENTERJSAMPLE);
+  JDIMENSION col;
+  int16x8_t cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    cb = vsubq_s16(vld1q_s16(inptr1 + (col >> 1)), center);
+    cr = vsubq_s16(vld1q_s16(inptr2 + (col >> 1)), center);
+    ycc_terms_neon(cb, cr, &cred, &cgreen, &cblue);
+    emit_rgb16_neon(inptr00 + col, outptr0 + col * RGB_PIXELSIZE,
+		    cred, cgreen, cblue);
+    if (inptr01 != NULL)
+      emit_rgb16_neon(inptr01 + col, outptr1 + col * RGB_PIXELSIZE,
+		      cred, cgreen, cblue);
+  }
+  return col;
+}
+
+LOCAL(JDIMENSION)
+ycc_rgb_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const int16x8_t center = vdupq_n_s16(CENTERJSAMPLE);
+  JDIMENSION col;
+  int16x8_t y, cb, cr, cred, cgreen, cblue;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    y = vld1q_s16(inptr0 + col);
+    cb = vsubq_s16(vld1q_s16(inptr1 + col), center);
+    cr = vsubq_s16(vld1q_s16(inptr2 + col), center);
+    ycc_terms_neon(cb, cr, &cred, &cgreen, &cblue);
+    store_rgb_neon(outptr + col * RGB_PIXELSIZE, add_clamp_neon(y, cred),
+		   add_clamp_neon(y, cgreen), add_clamp_neon(y, cblue));
+  }
+  return col;
+}
+
+LOCAL(JDIMENSION)
+ycck_cmyk_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW inptr3, JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const int16x8_t center = vdupq_n_s16(CENTERJSAMPLE);
+  const int16x8_t maxval = vdupq_n_s16(MAXJSAMPLE);
+  const int16x8_t zero = vdupq_n_s16(0);
+  JDIMENSION col;
+  int16x8_t y, cb, cr, cred, cgreen, cblue;
+  int16x8x4_t cmyk;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    y = vsubq_s16(maxval, vld1q_s16(inptr0 + col));
+    cb = vsubq_s16(vld1q_s16(inptr1 + col), center);
+    cr = vsubq_s16(vld1q_s16(inptr2 + col), center);
+    ycc_terms_neon(cb, cr, &cred, &cgreen, &cblue);
+    cmyk.val[0] = add_clamp_neon(y, vsubq_s16(zero, cred));
+    cmyk.val[1] = add_clamp_neon(y, vsubq_s16(zero, cgreen));
+    cmyk.val[2] = add_clamp_neon(y, vsubq_s16(zero, cblue));
+    cmyk.val[3] = vld1q_s16(inptr3 + col);
+    vst4q_s16(outptr + col * 4, cmyk);
+  }
+  return col;
+}
+
+LOCAL(JDIMENSION)
+rgb1_rgb_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	       JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const int16x8_t center = vdupq_n_s16(CENTERJSAMPLE);
+  const int16x8_t mask = vdupq_n_s16(MAXJSAMPLE);
+  JDIMENSION col;
+  int16x8_t g, gc;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    g = vld1q_s16(inptr1 + col);
+    gc = vsubq_s16(g, center);
+    store_rgb_neon(outptr + col * RGB_PIXELSIZE,
+		   vandq_s16(vaddq_s16(vld1q_s16(inptr0 + col), gc), mask), g,
+		   vandq_s16(vaddq_s16(vld1q_s16(inptr2 + col), gc), mask));
+  }
+  return col;
+}
+
+#endif /* JSIMD_USE_NEON */
+
+
+/******************************* Dispatch *******************************/
+
+/*
+ * Replicate each sample of one input row into two adjacent output columns,
+ * for one or (if outptr1 isn't NULL) two output rows.  Like the C code in
+ * jdsample.c, this fills the output up to an even number of columns;
+ * the output buffer is padded for that.
+ */
+
+LOCAL(void)
+h2_upsample_row (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+		 JDIMENSION num_cols)
+{
+  JDIMENSION col = 0;
+  register JSAMPLE invalue;
+
+#ifdef JSIMD_USE_NEON
+  if (init_simd() & JSIMD_NEON)
+    col = h2_upsample_neon(inptr, outptr0, outptr1, num_cols);
+#endif
+
+  for (; col < num_cols; col += 2) {
+    invalue = inptr[col >> 1];	/* don't need GETJSAMPLE() here */
+    outptr0[col] = outptr0[col + 1] = invalue;
+    if (outptr1 != NULL)
+      outptr1[col] = outptr1[col + 1] = invalue;
+  }
+}
+
+
+/*
+ * Merged upsampling and color conversion of one or two luma rows sharing
+ * a chroma row.
+ */
+
+LOCAL(void)
+h2_merged_rows (JSAMPROW inptr00, JSAMPROW inptr01,
+		JSAMPROW inptr1, JSAMPROW inptr2,
+		JSAMPROW outptr0, JSAMPROW outptr1, JDIMENSION num_cols)
+{
+  unsigned int support = init_simd();
+  JDIMENSION col = 0;
+
+#ifdef JSIMD_USE_AVX2
+  if (support & JSIMD_AVX2)
+    col = h2_merged_avx2(inptr00, inptr01, inptr1, inptr2,
+			 outptr0, outptr1, num_cols);
+  else
+#endif
+#ifdef JSIMD_USE_SSE2
+  if (support & JSIMD_SSE2)
+    col = h2_merged_sse2(inptr00, inptr01, inptr1, inptr2,
+			 outptr0, outptr1, num_cols);
+#endif
+#ifdef JSIMD_USE_NEON
+  if (support & JSIMD_NEON)
+    col = h2_merged_neon(inptr00, inptr01, inptr1, inptr2,
+			 outptr0, outptr1, num_cols);
+#endif
+
+  ycc_rgb_tail(inptr00, inptr1, inptr2, outptr0, col, num_cols, 1);
+  if (inptr01 != NULL)
+    ycc_rgb_tail(inptr01, inptr1, inptr2, outptr1, col, num_cols, 1);
+}
+
+
+/*
+ * Full-resolution color conversion of one row.
+ */
+
+LOCAL(void)
+ycc_rgb_row (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	     JSAMPROW outptr, JDIMENSION num_cols)
+{
+  unsigned int support = init_simd();
+  JDIMENSION col = 0;
+
+#ifdef JSIMD_USE_AVX2
+  if (support & JSIMD_AVX2)
+    col = ycc_rgb_avx2(inptr0, inptr1, inptr2, outptr, num_cols);
+  else
+#endif
+#ifdef JSIMD_USE_SSE2
+  if (support & JSIMD_SSE2)
+    col = ycc_rgb_sse2(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+#ifdef JSIMD_USE_NEON
+  if (support & JSIMD_NEON)
+    col = ycc_rgb_neon(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+
+  ycc_rgb_tail(inptr0, inptr1, inptr2, outptr, col, num_cols, 0);
+}
+
+LOCAL(void)
+ycck_cmyk_row (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	       JSAMPROW inptr3, JSAMPROW outptr, JDIMENSION num_cols)
+{
+  unsigned int support = init_simd();
+  JDIMENSION col = 0;
+
+#ifdef JSIMD_USE_AVX2
+  if (support & JSIMD_AVX2)
+    col = ycck_cmyk_avx2(inptr0, inptr1, inptr2, inptr3, outptr, num_cols);
+  else
+#endif
+#ifdef JSIMD_USE_SSE2
+  if (support & JSIMD_SSE2)
+    col = ycck_cmyk_sse2(inptr0, inptr1, inptr2, inptr3, outptr, num_cols);
+#endif
+#ifdef JSIMD_USE_NEON
+  if (support & JSIMD_NEON)
+    col = ycck_cmyk_neon(inptr0, inptr1, inptr2, inptr3, outptr, num_cols);
+#endif
+
+  ycck_cmyk_tail(inptr0, inptr1, inptr2, inptr3, outptr, col, num_cols);
+}
+
+LOCAL(void)
+rgb1_rgb_row (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  unsigned int support = init_simd();
+  JDIMENSION col = 0;
+
+#ifdef JSIMD_USE_AVX2
+  if (support & JSIMD_AVX2)
+    col = rgb1_rgb_avx2(inptr0, inptr1, inptr2, outptr, num_cols);
+  else
+#endif
+#ifdef JSIMD_USE_SSE2
+  if (support & JSIMD_SSE2)
+    col = rgb1_rgb_sse2(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+#ifdef JSIMD_USE_NEON
+  if (support & JSIMD_NEON)
+    col = rgb1_rgb_neon(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+
+  rgb1_rgb_tail(inptr0, inptr1, inptr2, outptr, col, num_cols);
+}
+
+
+/*
+ * Capability queries.
+ */
+
+GLOBAL(unsigned int)
+j12_simd_available (void)
+{
+  return detect_simd();
+}
+
+GLOBAL(void)
+j12_simd_set_mask (unsigned int mask)
+{
+  simd_mask = mask;
+}
+
+/* On x86 the compiler vectorizes the C replication loop as well as we
+ * could, so there are no x86 upsampling kernels.
+ */
+
+GLOBAL(boolean)
+j12_simd_can_h2v1_upsample (void)
+{
+  return (init_simd() & JSIMD_NEON) != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_h2v2_upsample (void)
+{
+  return (init_simd() & JSIMD_NEON) != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_h2v1_merged_upsample (void)
+{
+  return init_simd() != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_h2v2_merged_upsample (void)
+{
+  return init_simd() != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_ycc_rgb (void)
+{
+  return init_simd() != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_ycck_cmyk (void)
+{
+  return init_simd() != 0;
+}
+
+GLOBAL(boolean)
+j12_simd_can_rgb1_rgb (void)
+{
+  return init_simd() != 0;
+}
+
+
+/*
+ * Kernel entry points, as plug-in replacements for the C methods.
+ */
+
+GLOBAL(void)
+j12_simd_h2v1_upsample (j12_decompress_ptr cinfo,
+			jpeg12_component_info * compptr,
+			JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  /* compptr is unused, as in the C methods in jdsample.c */
+  JSAMPARRAY output_data = *output_data_ptr;
+  int outrow;
+
+  for (outrow = 0; outrow < cinfo->max_v_samp_factor; outrow++)
+    h2_upsample_row(input_data[outrow], output_data[outrow], NULL,
+		    cinfo->output_width);
+}
+
+GLOBAL(void)
+j12_simd_h2v2_upsample (j12_decompress_ptr cinfo,
+			jpeg12_component_info * compptr,
+			JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  /* compptr is unused, as in the C methods in jdsample.c */
+  JSAMPARRAY output_data = *output_data_ptr;
+  int inrow, outrow;
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    h2_upsample_row(input_data[inrow], output_data[outrow],
+		    output_data[outrow + 1], cinfo->output_width);
+    inrow++;
+    outrow += 2;
+  }
+}
+
+GLOBAL(void)
+j12_simd_h2v1_merged_upsample (j12_decompress_ptr cinfo,
+			       JSAMPIMAGE input_buf,
+			       JDIMENSION in_row_group_ctr,
+			       JSAMPARRAY output_buf)
+{
+  h2_merged_rows(input_buf[0][in_row_group_ctr], NULL,
+		 input_buf[1][in_row_group_ctr], input_buf[2][in_row_group_ctr],
+		 output_buf[0], NULL, cinfo->output_width);
+}
+
+GLOBAL(void)
+j12_simd_h2v2_merged_upsample (j12_decompress_ptr cinfo,
+			       JSAMPIMAGE input_buf,
+			       JDIMENSION in_row_group_ctr,
+			       JSAMPARRAY output_buf)
+{
+  h2_merged_rows(input_buf[0][in_row_group_ctr * 2],
+		 input_buf[0][in_row_group_ctr * 2 + 1],
+		 input_buf[1][in_row_group_ctr], input_buf[2][in_row_group_ctr],
+		 output_buf[0], output_buf[1], cinfo->output_width);
+}
+
+GLOBAL(void)
+j12_simd_ycc_rgb_convert (j12_decompress_ptr cinfo,
+			  JSAMPIMAGE input_buf, JDIMENSION input_row,
+			  JSAMPARRAY output_buf, int num_rows)
+{
+  while (--num_rows >= 0) {
+    ycc_rgb_row(input_buf[0][input_row], input_buf[1][input_row],
+		input_buf[2][input_row], *output_buf++, cinfo->output_width);
+    input_row++;
+  }
+}
+
+GLOBAL(void)
+j12_simd_ycck_cmyk_convert (j12_decompress_ptr cinfo,
+			    JSAMPIMAGE input_buf, JDIMENSION input_row,
+			    JSAMPARRAY output_buf, int num_rows)
+{
+  while (--num_rows >= 0) {
+    ycck_cmyk_row(input_buf[0][input_row], input_buf[1][input_row],
+		  input_buf[2][input_row], input_buf[3][input_row],
+		  *output_buf++, cinfo->output_width);
+    input_row++;
+  }
+}
+
+GLOBAL(void)
+j12_simd_rgb1_rgb_convert (j12_decompress_ptr cinfo,
+			   JSAMPIMAGE input_buf, JDIMENSION input_row,
+			   JSAMPARRAY output_buf, int num_rows)
+{
+  while (--num_rows >= 0) {
+    rgb1_rgb_row(input_buf[0][input_row], input_buf[1][input_row],
+		 input_buf[2][input_row], *output_buf++, cinfo->output_width);
+    input_row++;
+  }
+}
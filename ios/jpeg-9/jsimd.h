@@ -0,0 +1,109 @@
+/*
+ * jsimd.h
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This include file declares the vectorized (SIMD) versions of some of the
+ * decompressor's inner loops.  These declarations are private to the modules
+ * that can use them (jdsample.c, jdmerge.c, jdcolor.c).
+ *
+ * Each kernel comes with a j12_simd_can_xxx() query which the module calls
+ * at initialization time; if it returns TRUE, the kernel can be installed in
+ * place of the portable C method, which it matches bit for bit.  The kernels
+ * are written with compiler intrinsics for SSE2 and AVX2 (x86) and NEON (ARM);
+ * AVX2 is selected at runtime when the CPU supports it.  Setting the
+ * environment variable JSIMD_FORCENONE=1 disables all of them, which is
+ * handy for checking results against the C code; j12_simd_set_mask() does
+ * the same from within a program (bench/jpeg12kernels.c).
+ */
+
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define j12_simd_can_h2v1_upsample	jSCanH2V1Up
+#define j12_simd_can_h2v2_upsample	jSCanH2V2Up
+#define j12_simd_h2v1_upsample		jSH2V1Up
+#define j12_simd_h2v2_upsample		jSH2V2Up
+#define j12_simd_can_h2v1_merged_upsample	jSCanH2V1Merged
+#define j12_simd_can_h2v2_merged_upsample	jSCanH2V2Merged
+#define j12_simd_h2v1_merged_upsample	jSH2V1Merged
+#define j12_simd_h2v2_merged_upsample	jSH2V2Merged
+#define j12_simd_can_ycc_rgb		jSCanYCCRGB
+#define j12_simd_can_ycck_cmyk		jSCanYCCKCMYK
+#define j12_simd_can_rgb1_rgb		jSCanRGB1RGB
+#define j12_simd_ycc_rgb_convert	jSYCCRGB
+#define j12_simd_ycck_cmyk_convert	jSYCCKCMYK
+#define j12_simd_rgb1_rgb_convert	jSRGB1RGB
+#define j12_simd_available		jSAvailable
+#define j12_simd_set_mask		jSSetMask
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+
+/* Instruction sets, as reported by j12_simd_available(). */
+
+#define JSIMD_SSE2	0x01
+#define JSIMD_AVX2	0x02
+#define JSIMD_NEON	0x04
+
+/* The instruction sets usable here (after the environment overrides), and
+ * a mask to restrict the kernels to some of them: 0 selects the C code,
+ * ~0 everything available.  The capability queries, and so the modules
+ * initialized afterwards, follow the mask; so do the kernels already
+ * installed, from their next call.  This is meant for testing and is not
+ * synchronized with decoders running on other threads.
+ */
+
+EXTERN(unsigned int) j12_simd_available JPP((void));
+EXTERN(void) j12_simd_set_mask JPP((unsigned int mask));
+
+
+/* Upsampling (jdsample.c).  Same calling convention as the per-component
+ * methods there.
+ */
+
+EXTERN(boolean) j12_simd_can_h2v1_upsample JPP((void));
+EXTERN(boolean) j12_simd_can_h2v2_upsample JPP((void));
+
+EXTERN(void) j12_simd_h2v1_upsample
+	JPP((j12_decompress_ptr cinfo, jpeg12_component_info * compptr,
+	     JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) j12_simd_h2v2_upsample
+	JPP((j12_decompress_ptr cinfo, jpeg12_component_info * compptr,
+	     JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+
+/* Merged upsampling and YCC->RGB conversion (jdmerge.c).  Same calling
+ * convention as the j12_upmethod routines there.  These don't need the
+ * conversion tables built by jdmerge.c.
+ */
+
+EXTERN(boolean) j12_simd_can_h2v1_merged_upsample JPP((void));
+EXTERN(boolean) j12_simd_can_h2v2_merged_upsample JPP((void));
+
+EXTERN(void) j12_simd_h2v1_merged_upsample
+	JPP((j12_decompress_ptr cinfo, JSAMPIMAGE input_buf,
+	     JDIMENSION in_row_group_ctr, JSAMPARRAY output_buf));
+EXTERN(void) j12_simd_h2v2_merged_upsample
+	JPP((j12_decompress_ptr cinfo, JSAMPIMAGE input_buf,
+	     JDIMENSION in_row_group_ctr, JSAMPARRAY output_buf));
+
+/* Output color conversion (jdcolor.c).  Same calling convention as the
+ * j12_color_convert methods there.  The YCC kernels don't need the
+ * conversion tables built by jdcolor.c.
+ */
+
+EXTERN(boolean) j12_simd_can_ycc_rgb JPP((void));
+EXTERN(boolean) j12_simd_can_ycck_cmyk JPP((void));
+EXTERN(boolean) j12_simd_can_rgb1_rgb JPP((void));
+
+EXTERN(void) j12_simd_ycc_rgb_convert
+	JPP((j12_decompress_ptr cinfo, JSAMPIMAGE input_buf,
+	     JDIMENSION input_row, JSAMPARRAY output_buf, int num_rows));
+EXTERN(void) j12_simd_ycck_cmyk_convert
+	JPP((j12_decompress_ptr cinfo, JSAMPIMAGE input_buf,
+	     JDIMENSION input_row, JSAMPARRAY output_buf, int num_rows));
+EXTERN(void) j12_simd_rgb1_rgb_convert
+	JPP((j12_decompress_ptr cinfo, JSAMPIMAGE input_buf,
+	     JDIMENSION input_row, JSAMPARRAY output_buf, int num_rows));
@@ -0,0 +1,281 @@
+/*
+ * test_cancel.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for cancellation through the progress monitor
+ * (jpeg12_cancel_monitor() and the cancel flag of a batch item, jdbatch.c).
+ *
+ * A batch whose flag is set before it starts must fail every item with
+ * JERR_CANCELLED, free the planes it allocated and leave supplied ones
+ * alone; with the flag clear, the same items must decode exactly as a
+ * plain decode does.  Items that fail for other reasons must not report
+ * JERR_CANCELLED.  A decode cancelled halfway must stop at the next iMCU
+ * row with JERR_CANCELLED.  A batch paused with a negative flag must not
+ * get anywhere until jpeg12_set_cancel_flag() resumes it, and then decode
+ * as usual, or fail with JERR_CANCELLED if cancelled instead.
+ */
+
+#include "testutil.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+#define NUM_ITEMS	8
+
+
+LOCAL(void)
+setup_items (jpeg12_batch_item * items, const JOCTET * data,
+	     unsigned long size, volatile int * cancel)
+{
+  int i;
+
+  MEMZERO(items, NUM_ITEMS * SIZEOF(jpeg12_batch_item));
+  for (i = 0; i < NUM_ITEMS; i++) {
+    items[i].data = data;
+    items[i].size = size;
+    items[i].cancel = cancel;
+  }
+}
+
+
+LOCAL(void)
+test_cancelled_batch (const JOCTET * data, unsigned long size,
+		      const test_result * expected, int num_threads,
+		      const char * name)
+{
+  jpeg12_batch_item items[NUM_ITEMS];
+  JSAMPROW supplied;
+  volatile int cancel;
+  int i, num_failed;
+
+  /* Cancelled before it starts; the last item brings its own plane */
+  supplied = (JSAMPROW) malloc(expected->num_samples * SIZEOF(JSAMPLE));
+  cancel = 1;
+  setup_items(items, data, size, &cancel);
+  items[NUM_ITEMS - 1].plane = supplied;
+  items[NUM_ITEMS - 1].plane_samples = expected->num_samples;
+  num_failed = jpeg12_decode_batch(items, NUM_ITEMS, num_threads,
+				   NULL, NULL);
+  test_check(num_failed == NUM_ITEMS, "not all cancelled items failed", name);
+  for (i = 0; i < NUM_ITEMS; i++) {
+    test_check(items[i].status == JERR_CANCELLED,
+	       "cancelled item not failed with JERR_CANCELLED", name);
+    test_check(items[i].message[0] != '\0',
+	       "cancelled item has no message", name);
+  }
+  for (i = 0; i < NUM_ITEMS - 1; i++)
+    test_check(items[i].plane == NULL,
+	       "cancelled item kept an allocated plane", name);
+  test_check(items[NUM_ITEMS - 1].plane == supplied,
+	     "cancelled item dropped the supplied plane", name);
+
+  /* Not cancelled: all decoded as usual */
+  cancel = 0;
+  setup_items(items, data, size, &cancel);
+  items[NUM_ITEMS - 1].plane = supplied;
+  items[NUM_ITEMS - 1].plane_samples = expected->num_samples;
+  num_failed = jpeg12_decode_batch(items, NUM_ITEMS, num_threads,
+				   NULL, NULL);
+  test_check(num_failed == 0, "items failed without being cancelled", name);
+  for (i = 0; i < NUM_ITEMS; i++) {
+    test_check(items[i].status == 0 &&
+	       items[i].output_width == expected->width &&
+	       items[i].output_height == expected->height &&
+	       memcmp(items[i].plane, expected->samples,
+		      expected->num_samples * SIZEOF(JSAMPLE)) == 0,
+	       "uncancelled item differs from a plain decode", name);
+    if (items[i].plane != NULL && items[i].plane != supplied)
+      jpeg12_free_plane(items[i].plane);
+  }
+  free(supplied);
+}
+
+
+/*
+ * Items that are broken, with a cancel flag that is never set.
+ */
+
+LOCAL(void)
+test_broken_items (const JOCTET * data, unsigned long size)
+{
+  jpeg12_batch_item items[NUM_ITEMS];
+  JOCTET * damaged;
+  volatile int cancel = 0;
+  int i;
+
+  damaged = (JOCTET *) malloc(size);
+  MEMCOPY(damaged, data, size);
+  damaged[0] = 0;		/* no SOI */
+  setup_items(items, damaged, size, &cancel);
+  items[1].size = 0;		/* empty */
+  items[2].data = data;		/* plane of the wrong size */
+  items[2].plane_width = 1;
+  (void) jpeg12_decode_batch(items, 3, 1, NULL, NULL);
+  for (i = 0; i < 3; i++)
+    test_check(items[i].status != 0 && items[i].status != JERR_CANCELLED,
+	       "broken item reported as cancelled", "broken items");
+  free(damaged);
+}
+
+
+/*
+ * Cancel a decode after some rows have been read.
+ */
+
+LOCAL(void)
+test_cancel_halfway (const JOCTET * data, unsigned long size,
+		     const char * name)
+{
+  struct jpeg12_decompress_struct cinfo;
+  jpeg12_try_error_mgr jerr;
+  jpeg12_cancel_mgr canceller;
+  volatile int cancel = 0;
+  JSAMPROW row;
+  JDIMENSION half;
+
+  cinfo.err = jpeg12_try_error(&jerr);
+  jpeg12_create_decompress(&cinfo);
+  jpeg12_cancel_monitor((j12_common_ptr) &cinfo, &canceller, &cancel);
+  jpeg12_try_mem_src(&cinfo, (unsigned char *) data, size);
+  (void) jpeg12_try_read_header(&cinfo, TRUE);
+  (void) jpeg12_try_start_decompress(&cinfo);
+  test_check(jerr.status == 0, "decode failed before it was cancelled", name);
+
+  row = (JSAMPROW) malloc((size_t) cinfo.output_width *
+			  cinfo.output_components * SIZEOF(JSAMPLE));
+  half = cinfo.output_height / 2;
+  while (jerr.status == 0 && cinfo.output_scanline < half)
+    (void) jpeg12_try_read_scanlines(&cinfo, &row, 1);
+  cancel = 1;
+  while (jerr.status == 0 && cinfo.output_scanline < cinfo.output_height)
+    (void) jpeg12_try_read_scanlines(&cinfo, &row, 1);
+  test_check(jerr.status == JERR_CANCELLED,
+	     "decode cancelled halfway did not fail with JERR_CANCELLED",
+	     name);
+  test_check(cinfo.output_scanline <= half + cinfo.max_v_samp_factor * DCTSIZE,
+	     "decode cancelled halfway went on past the next iMCU row",
+	     name);
+
+  free(row);
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+/*
+ * Pause a batch before it starts, then resume or cancel it.
+ */
+
+typedef struct {
+  jpeg12_batch_item items[NUM_ITEMS];
+  int num_threads;
+  int num_failed;
+  volatile int finished;
+} paused_batch;
+
+
+LOCAL(void *)
+run_batch (void * arg)
+{
+  paused_batch * batch = (paused_batch *) arg;
+
+  batch->num_failed = jpeg12_decode_batch(batch->items, NUM_ITEMS,
+					  batch->num_threads, NULL, NULL);
+  batch->finished = 1;
+  return NULL;
+}
+
+
+LOCAL(void)
+test_paused_batch (const JOCTET * data, unsigned long size,
+		   const test_result * expected, boolean resume,
+		   const char * name)
+{
+  paused_batch batch;
+  pthread_t thread;
+  volatile int cancel = -1;
+  int i;
+
+  setup_items(batch.items, data, size, &cancel);
+  batch.num_threads = 2;
+  batch.num_failed = -1;
+  batch.finished = 0;
+  if (pthread_create(&thread, NULL, run_batch, &batch) != 0) {
+    test_check(FALSE, "could not start the batch thread", name);
+    return;
+  }
+  usleep(100000);
+  test_check(! batch.finished, "paused batch went on", name);
+  jpeg12_set_cancel_flag(&cancel, resume ? 0 : 1);
+  pthread_join(thread, NULL);
+
+  test_check(batch.num_failed == (resume ? 0 : NUM_ITEMS),
+	     resume ? "resumed items failed" : "cancelled paused items decoded",
+	     name);
+  for (i = 0; i < NUM_ITEMS; i++) {
+    if (resume)
+      test_check(batch.items[i].status == 0 &&
+		 memcmp(batch.items[i].plane, expected->samples,
+			expected->num_samples * SIZEOF(JSAMPLE)) == 0,
+		 "resumed item differs from a plain decode", name);
+    else
+      test_check(batch.items[i].status == JERR_CANCELLED,
+		 "cancelled paused item not failed with JERR_CANCELLED",
+		 name);
+    if (batch.items[i].plane != NULL)
+      jpeg12_free_plane(batch.items[i].plane);
+  }
+}
+
+#endif
+
+
+int
+main (int argc, char **argv)
+{
+  static const int scripts[] = { TEST_SEQUENTIAL, TEST_PROGRESSIVE };
+  test_decode_options options;
+  test_result expected;
+  test_image image;
+  char name[200];
+  JOCTET * data;
+  unsigned long size;
+  int sc;
+
+  MEMZERO(&image, SIZEOF(image));
+  image.width = 512;
+  image.height = 384;
+  image.components = 1;
+  image.quality = 90;
+  image.noise = 200;
+  for (sc = 0; sc < (int) (SIZEOF(scripts) / SIZEOF(int)); sc++) {
+    image.scans = scripts[sc];
+    image.seed = (unsigned long) (sc + 1);
+    test_describe(&image, name);
+    data = test_encode(&image, &size);
+
+    MEMZERO(&options, SIZEOF(options));
+    test_decode_samples(data, size, &options, &expected);
+    test_cancelled_batch(data, size, &expected, 1, name);
+    test_cancelled_batch(data, size, &expected, 4, name);
+    test_cancel_halfway(data, size, name);
+#ifdef HAVE_PTHREAD_H
+    test_paused_batch(data, size, &expected, TRUE, name);
+    test_paused_batch(data, size, &expected, FALSE, name);
+#endif
+    if (sc == 0)
+      test_broken_items(data, size);
+
+    test_free_result(&expected);
+    free(data);
+  }
+
+  return test_finish("cancel");
+}
@@ -0,0 +1,158 @@
+/*
+ * test_parallel_huffman.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for the parallel decoding of a sequential Huffman scan
+ * without restart markers (j12_huff_decode_parallel() in jdhuff.c).
+ *
+ * Every image is read with entropy_threads = 0 and then with 2, 5 and
+ * 16 threads; the coefficients and all messages must be the same.  Clean
+ * images large enough to be cut must actually take the parallel path;
+ * truncated and corrupt ones must fall back without a trace, as must one
+ * whose scratch memory would exceed max_memory_to_use.
+ */
+
+#include "testutil.h"
+
+
+#define MIN_PARALLEL_BYTES	65536L	/* surely enough for 2 chunks */
+
+/* Ways of spoiling the data */
+
+#define INTACT		0
+#define TRUNCATED	1
+#define CORRUPT		2
+
+
+LOCAL(void)
+test_image_variant (const test_image * image, int spoil)
+{
+  static const char * const spoil_names[] = { "", ", truncated", ", corrupt" };
+  static const int thread_counts[] = { 2, 5, 16 };
+  test_decode_options options;
+  test_result expected, actual;
+  char name[200], what[80];
+  JOCTET * data;
+  unsigned long size;
+  int ti;
+
+  test_describe(image, name);
+  strcat(name, spoil_names[spoil]);
+
+  data = test_encode(image, &size);
+  if (spoil == TRUNCATED)
+    size = size * 2 / 3;
+  else if (spoil == CORRUPT)
+    test_damage(data, size, 5, image->seed);
+
+  MEMZERO(&options, SIZEOF(options));
+  test_read_coefficients(data, size, &options, &expected);
+  test_check(! expected.parallel, "serial decode counted as parallel", name);
+  if (spoil == INTACT)
+    test_check(expected.msg_code == 0 && expected.num_warnings == 0,
+	       "clean image did not decode cleanly", name);
+
+  for (ti = 0; ti < (int) (SIZEOF(thread_counts) / SIZEOF(int)); ti++) {
+    options.entropy_threads = thread_counts[ti];
+    test_read_coefficients(data, size, &options, &actual);
+    sprintf(what, "result differs with %d threads", thread_counts[ti]);
+    test_check(test_same_result(&expected, &actual, TRUE), what, name);
+#ifdef HAVE_PTHREAD_H
+    if (spoil == INTACT && image->restart_rows == 0 &&
+	(long) size >= MIN_PARALLEL_BYTES)
+      test_check(actual.parallel, "parallel path not taken", name);
+#endif
+    if (spoil == TRUNCATED)
+      test_check(! actual.parallel, "truncated scan decoded in parallel",
+		 name);
+    test_free_result(&actual);
+  }
+
+  test_free_result(&expected);
+  free(data);
+}
+
+
+#ifdef HAVE_SYS_MMAN_H
+
+/*
+ * With a max_memory_to_use that holds the coefficients but not the scratch
+ * memory of the parallel decode, the scan is decoded serially.
+ */
+
+LOCAL(void)
+test_budget (const test_image * base)
+{
+  test_image image;
+  test_decode_options options;
+  test_result expected, actual;
+  char name[200];
+  JOCTET * data;
+  unsigned long size;
+
+  image = *base;
+  image.restart_rows = 0;
+  image.noise = MAXJSAMPLE;
+  test_describe(&image, name);
+  strcat(name, ", 3 MB budget");
+  data = test_encode(&image, &size);
+
+  MEMZERO(&options, SIZEOF(options));
+  test_read_coefficients(data, size, &options, &expected);
+  options.entropy_threads = 4;
+  jpeg12_set_backing_store(NULL, 3L * 1048576L);
+  test_read_coefficients(data, size, &options, &actual);
+  jpeg12_set_backing_store(NULL, 0L);
+  test_check(test_same_result(&expected, &actual, TRUE),
+	     "result differs under the budget", name);
+  test_check(! actual.parallel, "parallel scratch exceeded the budget", name);
+
+  test_free_result(&actual);
+  test_free_result(&expected);
+  free(data);
+}
+
+#endif
+
+
+int
+main (int argc, char **argv)
+{
+  static const JDIMENSION sizes[][2] = {
+    { 1024, 768 }, { 1999, 1001 }, { 300, 2000 }, { 64, 64 }
+  };
+  test_image image;
+  int si, v;
+
+  MEMZERO(&image, SIZEOF(image));
+  image.scans = TEST_SEQUENTIAL;
+  for (si = 0; si < (int) (SIZEOF(sizes) / SIZEOF(sizes[0])); si++) {
+    image.width = sizes[si][0];
+    image.height = sizes[si][1];
+    for (image.components = 1; image.components <= 3;
+	 image.components += 2) {
+      for (v = 0; v < 3; v++) {
+	image.quality = v == 0 ? 75 : 95;
+	image.noise = v == 0 ? 0 : v == 1 ? 200 : MAXJSAMPLE;
+	image.seed = (unsigned long) (si * 10 + v + 1);
+	test_image_variant(&image, INTACT);
+      }
+      test_image_variant(&image, TRUNCATED);
+      test_image_variant(&image, CORRUPT);
+    }
+  }
+  /* With restart markers the scan is decoded serially; still the same */
+  image.width = 1024;
+  image.height = 768;
+  image.components = 1;
+  image.restart_rows = 2;
+  test_image_variant(&image, INTACT);
+#ifdef HAVE_SYS_MMAN_H
+  test_budget(&image);
+#endif
+
+  return test_finish("parallel_huffman");
+}
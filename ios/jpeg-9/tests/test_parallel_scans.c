@@ -0,0 +1,117 @@
+/*
+ * test_parallel_scans.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for the concurrent decoding of the scans of a
+ * progressive or multi-scan file (j12_decode_scans_parallel() in
+ * jdscans.c).
+ *
+ * Every image is read with entropy_threads = 0 and then with 2 and 8
+ * threads; the coefficients must be the same, and so must the messages,
+ * which the parallel code replays in file order.  Only for corrupt data
+ * may the byte count in an "extraneous bytes" warning differ, so there
+ * just the number of warnings is compared.
+ */
+
+#include "testutil.h"
+
+
+/* Ways of spoiling the data */
+
+#define INTACT		0
+#define TRUNCATED	1
+#define CORRUPT		2
+
+
+LOCAL(void)
+test_image_variant (const test_image * image, int spoil, int trace_level)
+{
+  static const char * const spoil_names[] = { "", ", truncated", ", corrupt" };
+  static const int thread_counts[] = { 2, 8 };
+  test_decode_options options;
+  test_result expected, actual;
+  char name[200], what[80];
+  JOCTET * data;
+  unsigned long size;
+  int ti;
+
+  test_describe(image, name);
+  strcat(name, spoil_names[spoil]);
+  if (trace_level > 0)
+    strcat(name, ", traced");
+
+  data = test_encode(image, &size);
+  if (spoil == TRUNCATED)
+    size = size * 2 / 3;
+  else if (spoil == CORRUPT)
+    test_damage(data, size, 5, image->seed);
+
+  MEMZERO(&options, SIZEOF(options));
+  options.trace_level = trace_level;
+  test_read_coefficients(data, size, &options, &expected);
+  test_check(! expected.parallel, "serial decode counted as parallel", name);
+  if (spoil == INTACT)
+    test_check(expected.msg_code == 0 && expected.num_warnings == 0,
+	       "clean image did not decode cleanly", name);
+
+  for (ti = 0; ti < (int) (SIZEOF(thread_counts) / SIZEOF(int)); ti++) {
+    options.entropy_threads = thread_counts[ti];
+    test_read_coefficients(data, size, &options, &actual);
+    sprintf(what, "result differs with %d threads", thread_counts[ti]);
+    test_check(test_same_result(&expected, &actual, spoil != CORRUPT),
+	       what, name);
+#ifdef HAVE_PTHREAD_H
+    if (spoil == INTACT)
+      test_check(actual.parallel, "parallel path not taken", name);
+#endif
+    test_free_result(&actual);
+  }
+
+  test_free_result(&expected);
+  free(data);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  static const JDIMENSION sizes[][2] = {
+    { 1024, 768 }, { 333, 257 }, { 17, 9 }
+  };
+  static const int scripts[] = {
+    TEST_PROGRESSIVE, TEST_COMPONENT_SCANS, TEST_SPECTRAL_BANDS
+  };
+  test_image image;
+  int si, sc, v;
+
+  MEMZERO(&image, SIZEOF(image));
+  image.quality = 85;
+  for (si = 0; si < (int) (SIZEOF(sizes) / SIZEOF(sizes[0])); si++) {
+    image.width = sizes[si][0];
+    image.height = sizes[si][1];
+    for (image.components = 1; image.components <= 3;
+	 image.components += 2) {
+      for (sc = 0; sc < (int) (SIZEOF(scripts) / SIZEOF(int)); sc++) {
+	image.scans = scripts[sc];
+	/* one scan per component is just one scan for grayscale */
+	if (image.scans == TEST_COMPONENT_SCANS && image.components == 1)
+	  continue;
+	for (v = 0; v < 3; v++) {
+	  image.noise = v == 1 ? MAXJSAMPLE : 100;
+	  image.restart_rows = v == 2 ? 3 : 0;
+	  image.seed = (unsigned long) (si * 100 + sc * 10 + v + 1);
+	  test_image_variant(&image, INTACT, 0);
+	}
+	image.restart_rows = 0;
+	test_image_variant(&image, INTACT, 3);
+	test_image_variant(&image, TRUNCATED, 0);
+	test_image_variant(&image, CORRUPT, 0);
+      }
+    }
+  }
+
+  return test_finish("parallel_scans");
+}
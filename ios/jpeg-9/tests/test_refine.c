@@ -0,0 +1,116 @@
+/*
+ * test_refine.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for the fast path of progressive AC refinement
+ * (decode_AC_refine_fast() in jdhuff.c).
+ *
+ * The fast path is tried only while the source buffer holds at least
+ * REFINE_FAST_BYTES (512) bytes.  So the reference decode reads the data
+ * in 100-byte segments, which keeps every block on the regular path; it
+ * is then read with jpeg12_mem_src (fast path except at the very end) and
+ * in 4096-byte segments (switching between the two at every segment end).
+ * The coefficients and the messages must be the same; for corrupt data
+ * only the number of warnings is compared, since the byte count in an
+ * "extraneous bytes" warning depends on how far ahead the buffer was
+ * filled.
+ */
+
+#include "testutil.h"
+
+
+#define REGULAR_CHUNK	100	/* < REFINE_FAST_BYTES */
+#define MIXED_CHUNK	4096
+
+/* Ways of spoiling the data */
+
+#define INTACT		0
+#define TRUNCATED	1
+#define CORRUPT		2
+
+
+LOCAL(void)
+test_image_variant (const test_image * image, int spoil)
+{
+  static const char * const spoil_names[] = { "", ", truncated", ", corrupt" };
+  test_decode_options options;
+  test_result expected, actual;
+  jpeg12_segment * segments;
+  char name[200];
+  JOCTET * data;
+  unsigned long size;
+
+  test_describe(image, name);
+  strcat(name, spoil_names[spoil]);
+
+  data = test_encode(image, &size);
+  if (spoil == TRUNCATED)
+    size = size * 2 / 3;
+  else if (spoil == CORRUPT)
+    test_damage(data, size, 40, image->seed);
+
+  MEMZERO(&options, SIZEOF(options));
+  options.num_segments = test_split(data, size, REGULAR_CHUNK, 0L,
+				    &segments);
+  options.segments = segments;
+  test_read_coefficients(data, size, &options, &expected);
+  free(segments);
+  if (spoil == INTACT)
+    test_check(expected.msg_code == 0 && expected.num_warnings == 0,
+	       "clean image did not decode cleanly", name);
+
+  options.segments = NULL;
+  options.num_segments = 0;
+  test_read_coefficients(data, size, &options, &actual);
+  test_check(test_same_result(&expected, &actual, spoil != CORRUPT),
+	     "result differs with jpeg12_mem_src", name);
+  test_free_result(&actual);
+
+  options.num_segments = test_split(data, size, MIXED_CHUNK, 0L, &segments);
+  options.segments = segments;
+  test_read_coefficients(data, size, &options, &actual);
+  free(segments);
+  test_check(test_same_result(&expected, &actual, spoil != CORRUPT),
+	     "result differs with 4096-byte segments", name);
+  test_free_result(&actual);
+
+  test_free_result(&expected);
+  free(data);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  static const JDIMENSION sizes[][2] = {
+    { 1024, 768 }, { 333, 257 }
+  };
+  test_image image;
+  int si, v;
+
+  MEMZERO(&image, SIZEOF(image));
+  image.scans = TEST_PROGRESSIVE;	/* has AC refinement scans */
+  for (si = 0; si < (int) (SIZEOF(sizes) / SIZEOF(sizes[0])); si++) {
+    image.width = sizes[si][0];
+    image.height = sizes[si][1];
+    for (image.components = 1; image.components <= 3;
+	 image.components += 2) {
+      for (v = 0; v < 4; v++) {
+	/* quiet, noisy, nearly lossless, and with restart markers */
+	image.quality = v == 2 ? 98 : 85;
+	image.noise = v == 1 ? MAXJSAMPLE : v == 2 ? 200 : 64;
+	image.restart_rows = v == 3 ? 3 : 0;
+	image.seed = (unsigned long) (si * 10 + v + 1);
+	test_image_variant(&image, INTACT);
+      }
+      image.restart_rows = 0;
+      test_image_variant(&image, TRUNCATED);
+      test_image_variant(&image, CORRUPT);
+    }
+  }
+
+  return test_finish("refine");
+}
@@ -0,0 +1,208 @@
+/*
+ * test_scaled_encode.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for the scaled forward DCTs of the encoder (jfdctint.c),
+ * in particular jpeg12_fdct_12x12, 12x6, 14x14 and 14x7, whose row passes
+ * once added an unscaled term to a CONST_BITS-scaled sum.
+ *
+ * An image is encoded at quality 100 (all quantizers 1) with scale_num /
+ * scale_denom set so that the encoder uses the DCT under test: for
+ * grayscale directly, for YCbCr on the chroma components, which are
+ * subsampled through the DCT.  Samples and colorspace go in as they are.
+ * The coefficients are read back and compared with the exact DCT of the
+ * input blocks; they must be within rounding of it.
+ */
+
+#include "testutil.h"
+#include <math.h>
+
+
+#define WIDTH		336	/* multiple of all the block sizes below */
+#define HEIGHT		168
+#define TOLERANCE	2.0	/* max coefficient error of a correct DCT */
+
+
+typedef struct {
+  const char * name;		/* the DCT under test */
+  int components;		/* 1 = grayscale, 3 = YCbCr */
+  int h_samp, v_samp;		/* sampling factors of the luma component */
+  int scale_denom;		/* scale = 8 / scale_denom */
+  int first_comp;		/* components that use the DCT: this one on */
+  int block_width, block_height; /* their input block size */
+} scaled_case;
+
+static const scaled_case cases[] = {
+  { "fdct_12x12 (grayscale)", 1, 1, 1, 12, 0, 12, 12 },
+  { "fdct_14x14 (grayscale)", 1, 1, 1, 14, 0, 14, 14 },
+  { "fdct_12x12 (chroma, 2x2 sampling)", 3, 2, 2, 6, 1, 12, 12 },
+  { "fdct_12x6 (chroma, 2x1 sampling)", 3, 2, 1, 6, 1, 12, 6 },
+  { "fdct_14x14 (chroma, 2x2 sampling)", 3, 2, 2, 7, 1, 14, 14 },
+  { "fdct_14x7 (chroma, 2x1 sampling)", 3, 2, 1, 7, 1, 14, 7 }
+};
+
+
+/*
+ * A sample of the test image: waves in both directions, with other phases
+ * for each component.
+ */
+
+LOCAL(JSAMPLE)
+image_sample (JDIMENSION x, JDIMENSION y, int ci)
+{
+  double value;
+
+  value = 0.5 + 0.15 * cos(x * 0.25 + ci) + 0.1 * sin(x * 0.4 - 2 * ci) +
+	  0.1 * sin(y * 0.3 - ci) + 0.1 * cos((x + y) * 0.27 + 2 * ci);
+  return (JSAMPLE) (value * MAXJSAMPLE + 0.5);
+}
+
+
+/*
+ * C(u)/2 cos((2x+1)u pi / 2N), the N-point DCT basis with 8-point scaling.
+ */
+
+LOCAL(double)
+dct_basis (int n, int x, int u)
+{
+  return (u == 0 ? 0.5 / sqrt(2.0) : 0.5) *
+	 cos((2 * x + 1) * u * 3.14159265358979323846 / (2.0 * n));
+}
+
+
+LOCAL(JOCTET *)
+encode_case (const scaled_case * c, unsigned long * size)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  unsigned char * outbuffer = NULL;
+  JSAMPROW row;
+  JDIMENSION x;
+  int ci;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  *size = 0;
+  jpeg12_mem_dest(&cinfo, &outbuffer, size);
+
+  cinfo.image_width = WIDTH;
+  cinfo.image_height = HEIGHT;
+  cinfo.input_components = c->components;
+  cinfo.in_color_space = c->components == 1 ? JCS_GRAYSCALE : JCS_YCbCr;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_quality(&cinfo, 100, TRUE);
+  cinfo.comp_info[0].h_samp_factor = c->h_samp;
+  cinfo.comp_info[0].v_samp_factor = c->v_samp;
+  cinfo.scale_num = DCTSIZE;
+  cinfo.scale_denom = (unsigned int) c->scale_denom;
+  cinfo.dct_method = JDCT_ISLOW;
+
+  jpeg12_start_compress(&cinfo, TRUE);
+  row = (JSAMPROW) malloc(WIDTH * c->components * SIZEOF(JSAMPLE));
+  if (row == NULL)
+    ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 0);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    for (x = 0; x < WIDTH; x++)
+      for (ci = 0; ci < c->components; ci++)
+	row[x * c->components + ci] =
+	  image_sample(x, cinfo.next_scanline, ci);
+    (void) jpeg12_write_scanlines(&cinfo, &row, 1);
+  }
+  free(row);
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  return (JOCTET *) outbuffer;
+}
+
+
+/*
+ * Read the coefficients of the components under test and return their
+ * largest difference from the exact DCT, or -1 if the blocks do not cover
+ * the image as expected.
+ */
+
+LOCAL(double)
+check_case (const scaled_case * c, JOCTET * data, unsigned long size)
+{
+  struct jpeg12_decompress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  JQUANT_TBL * qtbl;
+  JBLOCKARRAY buffer;
+  JCOEFPTR block;
+  JDIMENSION bx, by, x, y;
+  double sample, sum, error, max_error = 0.0;
+  int ci, u, v, w = c->block_width, h = c->block_height;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_decompress(&cinfo);
+  jpeg12_mem_src(&cinfo, data, size);
+  (void) jpeg12_read_header(&cinfo, TRUE);
+  coef_arrays = jpeg12_read_coefficients(&cinfo);
+
+  for (ci = c->first_comp; ci < c->components; ci++) {
+    compptr = cinfo.comp_info + ci;
+    qtbl = compptr->quant_table;
+    if (compptr->width_in_blocks * (JDIMENSION) w != WIDTH ||
+	compptr->height_in_blocks * (JDIMENSION) h != HEIGHT) {
+      max_error = -1.0;
+      break;
+    }
+    for (by = 0; by < compptr->height_in_blocks; by++) {
+      buffer = (*cinfo.mem->j12_access_virt_barray)
+	((j12_common_ptr) &cinfo, coef_arrays[ci], by, (JDIMENSION) 1, FALSE);
+      for (bx = 0; bx < compptr->width_in_blocks; bx++) {
+	block = buffer[0][bx];
+	for (v = 0; v < DCTSIZE; v++) {
+	  for (u = 0; u < DCTSIZE; u++) {
+	    sum = 0.0;		/* a block under 8 long has no more */
+	    if (u < w && v < h) {
+	      for (y = 0; y < (JDIMENSION) h; y++) {
+		for (x = 0; x < (JDIMENSION) w; x++) {
+		  sample = image_sample(bx * w + x, by * h + y, ci);
+		  sum += (sample - CENTERJSAMPLE) *
+			 dct_basis(w, (int) x, u) * dct_basis(h, (int) y, v);
+		}
+	      }
+	      sum *= 64.0 / (w * h);
+	    }
+	    error = fabs((double) block[v * DCTSIZE + u] *
+			 qtbl->quantval[v * DCTSIZE + u] - sum);
+	    if (error > max_error)
+	      max_error = error;
+	  }
+	}
+      }
+    }
+  }
+
+  jpeg12_destroy_decompress(&cinfo);
+  return max_error;
+}
+
+
+int
+main (int argc, char **argv)
+{
+  JOCTET * data;
+  unsigned long size;
+  char what[80];
+  double max_error;
+  int i;
+
+  for (i = 0; i < (int) (SIZEOF(cases) / SIZEOF(cases[0])); i++) {
+    data = encode_case(&cases[i], &size);
+    max_error = check_case(&cases[i], data, size);
+    test_check(max_error >= 0.0, "blocks not laid out as expected",
+	       cases[i].name);
+    sprintf(what, "coefficients off by up to %.1f", max_error);
+    test_check(max_error <= TOLERANCE, what, cases[i].name);
+    free(data);
+  }
+
+  return test_finish("scaled_encode");
+}
@@ -0,0 +1,181 @@
+/*
+ * test_segments.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * Regression test for the segmented memory source (jpeg12_segments_src()
+ * in jdatasrc.c) and for batch items given as segments (jdbatch.c).
+ *
+ * Each image gets a large APP15 marker after SOI, so that the skip of its
+ * contents crosses segments.  The image is decoded from one buffer with
+ * jpeg12_mem_src, and then from the same bytes cut at random places into
+ * segments, some of them empty or only a few bytes long; the samples and
+ * the messages must be the same.  The same goes for the file cut short
+ * and for a jpeg12_decode_batch() item.
+ *
+ * If the file ends inside the APP15 marker, jpeg12_mem_src warns about
+ * every fake EOI it supplies to the skip, while the segments source
+ * supplies it once; there the error and a single warning are checked.
+ */
+
+#include "testutil.h"
+
+
+#define APP_LENGTH	30000	/* contents of the inserted APP15 marker */
+#define MAX_SEGMENT	20000	/* longest random segment */
+
+
+/*
+ * Insert an APP15 marker with APP_LENGTH bytes of contents after SOI.
+ * The result is malloc'd; free() it.
+ */
+
+LOCAL(JOCTET *)
+insert_marker (const JOCTET * data, unsigned long * size)
+{
+  JOCTET * result;
+
+  result = (JOCTET *) malloc(*size + 4 + APP_LENGTH);
+  if (result == NULL)
+    return NULL;
+  result[0] = data[0];		/* SOI */
+  result[1] = data[1];
+  result[2] = 0xFF;
+  result[3] = (JOCTET) JPEG12_APP0 + 15;
+  result[4] = (JOCTET) ((APP_LENGTH + 2) >> 8);
+  result[5] = (JOCTET) ((APP_LENGTH + 2) & 0xFF);
+  MEMZERO(result + 6, APP_LENGTH);
+  MEMCOPY(result + 6 + APP_LENGTH, data + 2, *size - 2);
+  *size += 4 + APP_LENGTH;
+  return result;
+}
+
+
+/*
+ * Decode size bytes of data from one buffer and from random segments,
+ * and compare.
+ */
+
+LOCAL(void)
+test_split_decodes (const JOCTET * data, unsigned long size,
+		    boolean in_marker, const char * name)
+{
+  test_decode_options options;
+  test_result expected, actual;
+  jpeg12_segment * segments;
+  char what[80];
+  unsigned long seed;
+
+  MEMZERO(&options, SIZEOF(options));
+  test_decode_samples(data, size, &options, &expected);
+
+  for (seed = 1; seed <= 3; seed++) {
+    options.num_segments = test_split(data, size, MAX_SEGMENT, seed,
+				      &segments);
+    options.segments = segments;
+    test_decode_samples(data, size, &options, &actual);
+    sprintf(what, "result differs with %d segments", options.num_segments);
+    if (in_marker)
+      test_check(actual.msg_code == expected.msg_code &&
+		 actual.num_warnings == 1, what, name);
+    else
+      test_check(test_same_result(&expected, &actual, TRUE), what, name);
+    test_free_result(&actual);
+    free(segments);
+  }
+
+  test_free_result(&expected);
+}
+
+
+/*
+ * Decode from segments as a batch item, and compare with the samples from
+ * one buffer.
+ */
+
+LOCAL(void)
+test_batch_item (const JOCTET * data, unsigned long size, const char * name)
+{
+  test_decode_options options;
+  test_result expected;
+  jpeg12_batch_item item;
+  jpeg12_segment * segments;
+
+  MEMZERO(&options, SIZEOF(options));
+  test_decode_samples(data, size, &options, &expected);
+
+  MEMZERO(&item, SIZEOF(item));
+  item.num_segments = test_split(data, size, MAX_SEGMENT, 5L, &segments);
+  item.segments = segments;
+  (void) jpeg12_decode_batch(&item, 1, 1, NULL, NULL);
+  test_check(item.status == 0, "batch item from segments failed", name);
+  test_check(item.status != 0 ||
+	     (item.output_width == expected.width &&
+	      item.output_height == expected.height &&
+	      memcmp(item.plane, expected.samples,
+		     expected.num_samples * SIZEOF(JSAMPLE)) == 0),
+	     "batch item from segments differs", name);
+  if (item.plane != NULL)
+    jpeg12_free_plane(item.plane);
+  free(segments);
+  test_free_result(&expected);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  static const int scripts[] = { TEST_SEQUENTIAL, TEST_PROGRESSIVE };
+  static const jpeg12_segment empty_segments[3] = {
+    { NULL, 0 }, { NULL, 0 }, { NULL, 0 }
+  };
+  test_decode_options options;
+  test_result result;
+  test_image image;
+  char name[200];
+  JOCTET * encoded;
+  JOCTET * data;
+  unsigned long size;
+  int sc;
+
+  MEMZERO(&image, SIZEOF(image));
+  image.quality = 90;
+  image.noise = 200;
+  for (image.components = 1; image.components <= 3; image.components += 2) {
+    for (sc = 0; sc < (int) (SIZEOF(scripts) / SIZEOF(int)); sc++) {
+      image.scans = scripts[sc];
+      image.width = 999;
+      image.height = 601;
+      image.seed = (unsigned long) (image.components * 10 + sc);
+      test_describe(&image, name);
+
+      encoded = test_encode(&image, &size);
+      data = insert_marker(encoded, &size);
+      free(encoded);
+
+      test_split_decodes(data, size, FALSE, name);
+      strcat(name, ", truncated");
+      test_split_decodes(data, size / 2, FALSE, name);
+      strcat(name, " in APP15");
+      test_split_decodes(data, APP_LENGTH / 2, TRUE, name);
+      if (image.components == 1) {
+	test_describe(&image, name);
+	test_batch_item(data, size, name);
+      }
+      free(data);
+    }
+  }
+
+  /* Segments without data are empty input, as for jpeg12_mem_src */
+  MEMZERO(&options, SIZEOF(options));
+  options.segments = empty_segments;
+  options.num_segments = 3;
+  test_decode_samples(NULL, 0L, &options, &result);
+  test_check(result.msg_code == JERR_INPUT_EMPTY,
+	     "empty segments not reported as empty input", "3 empty segments");
+  test_free_result(&result);
+
+  return test_finish("segments");
+}
@@ -0,0 +1,482 @@
+/*
+ * testutil.c
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains routines shared by the regression tests: making test
+ * images, decoding them with every message and error caught, and comparing
+ * the results.
+ */
+
+#include "testutil.h"
+#include <setjmp.h>
+
+
+int test_failures = 0;
+
+
+/*
+ * The random numbers come from our own generator, so that the test images
+ * are the same on every platform.
+ */
+
+LOCAL(unsigned long)
+next_random (unsigned long * state)
+{
+  *state = (*state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+  return *state >> 8;		/* 24 useful bits */
+}
+
+
+/*
+ * Fill one row of the image, with samples interleaved by component:
+ * a smooth ramp with a checkerboard of sharp edges, plus noise.
+ */
+
+LOCAL(void)
+make_row (const test_image * image, JSAMPROW row, JDIMENSION y,
+	  unsigned long * state)
+{
+  JDIMENSION x;
+  long sample;
+  int ci;
+
+  for (x = 0; x < image->width; x++) {
+    for (ci = 0; ci < image->components; ci++) {
+      sample = (long) ((x + 2 * y) * 3000L /
+		       (image->width + 2 * image->height)) + 300L * ci;
+      if (((x / 37 + y / 23) & 1) != 0)
+	sample += 700;
+      if (image->noise > 0)
+	sample += (long) (next_random(state) % (image->noise + 1)) -
+		  image->noise / 2;
+      if (sample < 0)
+	sample = 0;
+      else if (sample > MAXJSAMPLE)
+	sample = MAXJSAMPLE;
+      *row++ = (JSAMPLE) sample;
+    }
+  }
+}
+
+
+/*
+ * Encode a test image into memory.  The data is malloc'd; free() it.
+ */
+
+GLOBAL(JOCTET *)
+test_encode (const test_image * image, unsigned long * size)
+{
+  struct jpeg12_compress_struct cinfo;
+  struct jpeg12_error_mgr jerr;
+  jpeg12_scan_info scans[1 + 2 * MAX_COMPONENTS];
+  unsigned char * outbuffer = NULL;
+  unsigned long state = image->seed;
+  JSAMPROW row;
+  int ci, num_scans;
+
+  cinfo.err = jpeg12_std_error(&jerr);
+  jpeg12_create_compress(&cinfo);
+  *size = 0;
+  jpeg12_mem_dest(&cinfo, &outbuffer, size);
+
+  cinfo.image_width = image->width;
+  cinfo.image_height = image->height;
+  cinfo.input_components = image->components;
+  cinfo.in_color_space = image->components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg12_set_defaults(&cinfo);
+  jpeg12_set_quality(&cinfo, image->quality, TRUE);
+  cinfo.restart_in_rows = image->restart_rows;
+
+  switch (image->scans) {
+  case TEST_PROGRESSIVE:
+    jpeg12_simple_progression(&cinfo);
+    break;
+  case TEST_COMPONENT_SCANS:
+    for (ci = 0; ci < cinfo.num_components; ci++) {
+      scans[ci].comps_in_scan = 1;
+      scans[ci].component_index[0] = ci;
+      scans[ci].Ss = 0;
+      scans[ci].Se = DCTSIZE2 - 1;
+      scans[ci].Ah = scans[ci].Al = 0;
+    }
+    cinfo.scan_info = scans;
+    cinfo.num_scans = cinfo.num_components;
+    break;
+  case TEST_SPECTRAL_BANDS:
+    scans[0].comps_in_scan = cinfo.num_components;
+    for (ci = 0; ci < cinfo.num_components; ci++)
+      scans[0].component_index[ci] = ci;
+    scans[0].Ss = scans[0].Se = 0;
+    scans[0].Ah = scans[0].Al = 0;
+    num_scans = 1;
+    for (ci = 0; ci < cinfo.num_components; ci++) {
+      scans[num_scans].comps_in_scan = 1;
+      scans[num_scans].component_index[0] = ci;
+      scans[num_scans].Ss = 1;
+      scans[num_scans].Se = 20;
+      scans[num_scans].Ah = scans[num_scans].Al = 0;
+      num_scans++;
+      scans[num_scans] = scans[num_scans - 1];
+      scans[num_scans].Ss = 21;
+      scans[num_scans].Se = DCTSIZE2 - 1;
+      num_scans++;
+    }
+    cinfo.scan_info = scans;
+    cinfo.num_scans = num_scans;
+    break;
+  }
+
+  jpeg12_start_compress(&cinfo, TRUE);
+  row = (JSAMPROW) malloc((size_t) image->width * image->components *
+			  SIZEOF(JSAMPLE));
+  if (row == NULL)
+    ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 0);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    make_row(image, row, cinfo.next_scanline, &state);
+    (void) jpeg12_write_scanlines(&cinfo, &row, 1);
+  }
+  free(row);
+  jpeg12_finish_compress(&cinfo);
+  jpeg12_destroy_compress(&cinfo);
+  return (JOCTET *) outbuffer;
+}
+
+
+/*
+ * Corrupt count bytes of the compressed data, away from the headers.
+ */
+
+GLOBAL(void)
+test_damage (JOCTET * data, unsigned long size, int count, unsigned long seed)
+{
+  unsigned long state = seed;
+  unsigned long pos;
+
+  while (count-- > 0) {
+    pos = size / 4 + next_random(&state) % (size / 2);
+    data[pos] ^= (JOCTET) (0x55 + count);
+  }
+}
+
+
+/*
+ * Cut the data into segments for jpeg12_segments_src().  With seed 0, all
+ * segments but the last are chunk bytes long; otherwise their lengths are
+ * random up to chunk, and some are empty or only a few bytes long.
+ * The segment list is malloc'd; free() it.
+ */
+
+GLOBAL(int)
+test_split (const JOCTET * data, unsigned long size, unsigned long chunk,
+	    unsigned long seed, jpeg12_segment ** segments)
+{
+  unsigned long state = seed;
+  unsigned long offset, length;
+  int num_segments, max_segments;
+
+  max_segments = (int) (size / (seed == 0 ? chunk : 1) + 2);
+  *segments = (jpeg12_segment *)
+    malloc((size_t) max_segments * SIZEOF(jpeg12_segment));
+  if (*segments == NULL)
+    return 0;
+
+  num_segments = 0;
+  for (offset = 0; offset < size; offset += length) {
+    if (seed == 0)
+      length = chunk;
+    else
+      switch (next_random(&state) % 8) {
+      case 0:  length = 0; break;
+      case 1:  length = 1 + next_random(&state) % 3; break;
+      default: length = 1 + next_random(&state) % chunk; break;
+      }
+    if (length > size - offset || num_segments == max_segments - 1)
+      length = size - offset;
+    (*segments)[num_segments].data = data + offset;
+    (*segments)[num_segments].size = length;
+    num_segments++;
+  }
+  return num_segments;
+}
+
+
+/* Error manager that collects all messages and returns control on error */
+
+typedef struct {
+  struct jpeg12_error_mgr pub;	/* "public" fields */
+  jmp_buf setjmp_buffer;	/* for return to caller */
+  test_result * result;
+} test_error_mgr;
+
+/* Progress monitor that tells whether the entropy decoding was done
+ * before the first call, as after a parallel decode (see jdtrans.c).
+ */
+
+typedef struct {
+  struct jpeg12_progress_mgr pub; /* "public" fields */
+  test_result * result;
+  boolean called;
+} test_progress_mgr;
+
+
+LOCAL(void)
+add_to_log (test_result * result, int msg_level, const char * message)
+{
+  size_t length = strlen(message) + 16;
+  char * log;
+
+  log = (char *) realloc(result->log, result->log_length + length);
+  if (log == NULL)
+    return;
+  result->log = log;
+  sprintf(log + result->log_length, "%d %s\n", msg_level, message);
+  result->log_length += strlen(log + result->log_length);
+}
+
+
+METHODDEF(void)
+test_emit_message (j12_common_ptr cinfo, int msg_level)
+{
+  test_error_mgr * err = (test_error_mgr *) cinfo->err;
+  char buffer[JMSG_LENGTH_MAX];
+
+  if (msg_level < 0)
+    err->pub.num_warnings++;
+  if (msg_level < 0 || msg_level <= err->pub.trace_level) {
+    (*err->pub.j12_format_message) (cinfo, buffer);
+    add_to_log(err->result, msg_level, buffer);
+  }
+}
+
+
+METHODDEF(noreturn_t)
+test_error_exit (j12_common_ptr cinfo)
+{
+  test_error_mgr * err = (test_error_mgr *) cinfo->err;
+  char buffer[JMSG_LENGTH_MAX];
+
+  err->result->msg_code = err->pub.msg_code;
+  (*err->pub.j12_format_message) (cinfo, buffer);
+  add_to_log(err->result, -2, buffer);
+  longjmp(err->setjmp_buffer, 1);
+}
+
+
+METHODDEF(void)
+test_progress_monitor (j12_common_ptr cinfo)
+{
+  test_progress_mgr * progress = (test_progress_mgr *) cinfo->progress;
+
+  if (! progress->called) {
+    progress->called = TRUE;
+    progress->result->parallel = progress->pub.pass_limit > 0 &&
+      progress->pub.pass_counter == progress->pub.pass_limit;
+  }
+}
+
+
+LOCAL(void)
+start_decode (j12_decompress_ptr cinfo, test_error_mgr * jerr,
+	      test_progress_mgr * progress,
+	      const test_decode_options * options, test_result * result)
+{
+  MEMZERO(result, SIZEOF(test_result));
+  cinfo->err = jpeg12_std_error(&jerr->pub);
+  jerr->pub.j12_emit_message = test_emit_message;
+  jerr->pub.j12_error_exit = test_error_exit;
+  jerr->pub.trace_level = options->trace_level;
+  jerr->result = result;
+  progress->pub.j12_progress_monitor = test_progress_monitor;
+  progress->result = result;
+  progress->called = FALSE;
+  jpeg12_create_decompress(cinfo);
+  cinfo->progress = &progress->pub;
+}
+
+
+/*
+ * Read all coefficients of the image.
+ */
+
+GLOBAL(void)
+test_read_coefficients (const JOCTET * data, unsigned long size,
+			const test_decode_options * options,
+			test_result * result)
+{
+  struct jpeg12_decompress_struct cinfo;
+  test_error_mgr jerr;
+  test_progress_mgr progress;
+  jvirt_barray_ptr * coef_arrays;
+  jpeg12_component_info * compptr;
+  JBLOCKARRAY buffer;
+  JCOEFPTR outptr;
+  JDIMENSION blk_y;
+  int ci;
+
+  start_decode(&cinfo, &jerr, &progress, options, result);
+  if (setjmp(jerr.setjmp_buffer)) {
+    result->num_warnings = jerr.pub.num_warnings;
+    jpeg12_destroy_decompress(&cinfo);
+    return;
+  }
+
+  if (options->segments != NULL)
+    jpeg12_segments_src(&cinfo, options->segments, options->num_segments);
+  else
+    jpeg12_mem_src(&cinfo, (unsigned char *) data, size);
+  (void) jpeg12_read_header(&cinfo, TRUE);
+  cinfo.entropy_threads = options->entropy_threads;
+  coef_arrays = jpeg12_read_coefficients(&cinfo);
+
+  for (ci = 0, compptr = cinfo.comp_info; ci < cinfo.num_components;
+       ci++, compptr++)
+    result->num_coefs += (unsigned long) compptr->width_in_blocks *
+			 compptr->height_in_blocks * DCTSIZE2;
+  result->coefs = (JCOEF *) malloc(result->num_coefs * SIZEOF(JCOEF));
+  if (result->coefs == NULL)
+    ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 0);
+  outptr = result->coefs;
+  for (ci = 0, compptr = cinfo.comp_info; ci < cinfo.num_components;
+       ci++, compptr++) {
+    for (blk_y = 0; blk_y < compptr->height_in_blocks; blk_y++) {
+      buffer = (*cinfo.mem->j12_access_virt_barray)
+	((j12_common_ptr) &cinfo, coef_arrays[ci], blk_y, (JDIMENSION) 1,
+	 FALSE);
+      MEMCOPY(outptr, buffer[0], compptr->width_in_blocks * SIZEOF(JBLOCK));
+      outptr += (size_t) compptr->width_in_blocks * DCTSIZE2;
+    }
+  }
+  result->width = cinfo.image_width;
+  result->height = cinfo.image_height;
+
+  (void) jpeg12_finish_decompress(&cinfo);
+  result->num_warnings = jerr.pub.num_warnings;
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+/*
+ * Decode the image into samples.
+ */
+
+GLOBAL(void)
+test_decode_samples (const JOCTET * data, unsigned long size,
+		     const test_decode_options * options,
+		     test_result * result)
+{
+  struct jpeg12_decompress_struct cinfo;
+  test_error_mgr jerr;
+  test_progress_mgr progress;
+  size_t row_samples;
+  JSAMPROW row;
+
+  start_decode(&cinfo, &jerr, &progress, options, result);
+  if (setjmp(jerr.setjmp_buffer)) {
+    result->num_warnings = jerr.pub.num_warnings;
+    jpeg12_destroy_decompress(&cinfo);
+    return;
+  }
+
+  if (options->segments != NULL)
+    jpeg12_segments_src(&cinfo, options->segments, options->num_segments);
+  else
+    jpeg12_mem_src(&cinfo, (unsigned char *) data, size);
+  (void) jpeg12_read_header(&cinfo, TRUE);
+  cinfo.entropy_threads = options->entropy_threads;
+  (void) jpeg12_start_decompress(&cinfo);
+
+  row_samples = (size_t) cinfo.output_width * cinfo.output_components;
+  result->num_samples = (unsigned long) row_samples * cinfo.output_height;
+  result->samples = (JSAMPLE *) malloc(result->num_samples * SIZEOF(JSAMPLE));
+  if (result->samples == NULL)
+    ERREXIT1(&cinfo, JERR_OUT_OF_MEMORY, 0);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    row = result->samples + cinfo.output_scanline * row_samples;
+    (void) jpeg12_read_scanlines(&cinfo, &row, 1);
+  }
+  result->width = cinfo.output_width;
+  result->height = cinfo.output_height;
+
+  (void) jpeg12_finish_decompress(&cinfo);
+  result->num_warnings = jerr.pub.num_warnings;
+  jpeg12_destroy_decompress(&cinfo);
+}
+
+
+GLOBAL(void)
+test_free_result (test_result * result)
+{
+  free(result->coefs);
+  free(result->samples);
+  free(result->log);
+  MEMZERO(result, SIZEOF(test_result));
+}
+
+
+/*
+ * Compare two decodes.  The messages are compared only if compare_log;
+ * the number of warnings and the error always are.
+ */
+
+GLOBAL(boolean)
+test_same_result (const test_result * expected, const test_result * actual,
+		  boolean compare_log)
+{
+  if (expected->num_coefs != actual->num_coefs ||
+      expected->num_samples != actual->num_samples ||
+      expected->width != actual->width ||
+      expected->height != actual->height ||
+      expected->num_warnings != actual->num_warnings ||
+      expected->msg_code != actual->msg_code)
+    return FALSE;
+  if (expected->num_coefs > 0 &&
+      memcmp(expected->coefs, actual->coefs,
+	     expected->num_coefs * SIZEOF(JCOEF)) != 0)
+    return FALSE;
+  if (expected->num_samples > 0 &&
+      memcmp(expected->samples, actual->samples,
+	     expected->num_samples * SIZEOF(JSAMPLE)) != 0)
+    return FALSE;
+  if (compare_log &&
+      (expected->log_length != actual->log_length ||
+       (expected->log_length > 0 &&
+	memcmp(expected->log, actual->log, expected->log_length) != 0)))
+    return FALSE;
+  return TRUE;
+}
+
+
+GLOBAL(void)
+test_describe (const test_image * image, char * buffer)
+{
+  static const char * const scan_names[] = {
+    "sequential", "progressive", "component scans", "spectral bands"
+  };
+
+  sprintf(buffer, "%ux%u %s %s q%d noise %d restart %d",
+	  (unsigned int) image->width, (unsigned int) image->height,
+	  image->components == 1 ? "gray" : "color", scan_names[image->scans],
+	  image->quality, image->noise, image->restart_rows);
+}
+
+
+GLOBAL(void)
+test_check (boolean ok, const char * what, const char * case_name)
+{
+  if (! ok) {
+    printf("FAIL: %s: %s\n", case_name, what);
+    test_failures++;
+  }
+}
+
+
+GLOBAL(int)
+test_finish (const char * test_name)
+{
+  printf("%s: %d failure%s\n", test_name, test_failures,
+	 test_failures == 1 ? "" : "s");
+  return test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
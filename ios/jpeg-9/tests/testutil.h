@@ -0,0 +1,90 @@
+/*
+ * testutil.h
+ *
+ * This file is part of the 12-bit build of the Independent JPEG Group's
+ * software used by the jpeg12 plugin.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains common declarations for the regression tests.  It is
+ * NOT used by the core JPEG library.
+ *
+ * The tests encode synthetic images with the library itself, decode them
+ * once the plain way and once the way under test, and require the results
+ * (coefficients or samples, and the messages) to be identical.
+ */
+
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jerror.h"		/* get library error codes too */
+
+
+/* Scan scripts for test_encode() */
+
+#define TEST_SEQUENTIAL		0 /* one interleaved sequential scan */
+#define TEST_PROGRESSIVE	1 /* jpeg12_simple_progression() */
+#define TEST_COMPONENT_SCANS	2 /* one sequential scan per component */
+#define TEST_SPECTRAL_BANDS	3 /* DC, then AC bands in separate scans */
+
+/* A synthetic test image */
+
+typedef struct {
+  JDIMENSION width, height;
+  int components;		/* 1 = grayscale, 3 = color */
+  int quality;
+  int noise;			/* amplitude of random noise, 0..MAXJSAMPLE */
+  int scans;			/* one of the scan scripts above */
+  int restart_rows;		/* restart interval in MCU rows, or 0 */
+  unsigned long seed;		/* for the noise */
+} test_image;
+
+/* How to decode */
+
+typedef struct {
+  int entropy_threads;		/* cinfo->entropy_threads */
+  const jpeg12_segment * segments; /* read from these segments, */
+  int num_segments;		/* or with jpeg12_mem_src if NULL */
+  int trace_level;		/* trace messages to collect */
+} test_decode_options;
+
+/* What came out of a decode */
+
+typedef struct {
+  JCOEF * coefs;		/* all coefficients, component by component */
+  unsigned long num_coefs;
+  JSAMPLE * samples;		/* or all samples, in packed rows */
+  unsigned long num_samples;
+  JDIMENSION width, height;
+  long num_warnings;
+  int msg_code;			/* error that ended the decode, or 0 */
+  boolean parallel;		/* entropy decoded by the parallel code */
+  char * log;			/* all messages, one per line */
+  size_t log_length;
+} test_result;
+
+
+/* Number of failed checks so far */
+extern int test_failures;
+
+EXTERN(JOCTET *) test_encode JPP((const test_image * image,
+				  unsigned long * size));
+EXTERN(void) test_damage JPP((JOCTET * data, unsigned long size,
+			      int count, unsigned long seed));
+EXTERN(int) test_split JPP((const JOCTET * data, unsigned long size,
+			    unsigned long chunk, unsigned long seed,
+			    jpeg12_segment ** segments));
+EXTERN(void) test_read_coefficients JPP((const JOCTET * data,
+					 unsigned long size,
+					 const test_decode_options * options,
+					 test_result * result));
+EXTERN(void) test_decode_samples JPP((const JOCTET * data,
+				      unsigned long size,
+				      const test_decode_options * options,
+				      test_result * result));
+EXTERN(void) test_free_result JPP((test_result * result));
+EXTERN(boolean) test_same_result JPP((const test_result * expected,
+				      const test_result * actual,
+				      boolean compare_log));
+EXTERN(void) test_describe JPP((const test_image * image, char * buffer));
+EXTERN(void) test_check JPP((boolean ok, const char * what,
+			     const char * case_name));
+EXTERN(int) test_finish JPP((const char * test_name));
@@ -177,6 +177,25 @@ class Jpeg12Native {
   late final _jpeg12_mem_src = _jpeg12_mem_srcPtr.asFunction<
       void Function(j12_decompress_ptr, ffi.Pointer<ffi.UnsignedChar>, int)>();
 
+  void jpeg12_segments_src(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_segment> segments,
+    int num_segments,
+  ) {
+    return _jpeg12_segments_src(
+      cinfo,
+      segments,
+      num_segments,
+    );
+  }
+
+  late final _jpeg12_segments_srcPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_segment>,
+              ffi.Int)>>('jpeg12_segments_src');
+  late final _jpeg12_segments_src = _jpeg12_segments_srcPtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_segment>, int)>();
+
   void jpeg12_set_defaults(
     j12_compress_ptr cinfo,
   ) {
@@ -569,45 +588,1126 @@ class Jpeg12Native {
     );
   }
 
-  late final _jpeg12_read_scanlinesPtr = _lookup<
+  late final _jpeg12_read_scanlinesPtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(j12_decompress_ptr, JSAMPARRAY,
+              JDIMENSION)>>('jpeg12_read_scanlines');
+  late final _jpeg12_read_scanlines = _jpeg12_read_scanlinesPtr
+      .asFunction<int Function(j12_decompress_ptr, JSAMPARRAY, int)>();
+
+  int jpeg12_finish_decompress(
+    j12_decompress_ptr cinfo,
+  ) {
+    return _jpeg12_finish_decompress(
+      cinfo,
+    );
+  }
+
+  late final _jpeg12_finish_decompressPtr =
+      _lookup<ffi.NativeFunction<ffi.Int32 Function(j12_decompress_ptr)>>(
+          'jpeg12_finish_decompress');
+  late final _jpeg12_finish_decompress = _jpeg12_finish_decompressPtr
+      .asFunction<int Function(j12_decompress_ptr)>();
+
+  int jpeg12_read_raw_data(
+    j12_decompress_ptr cinfo,
+    JSAMPIMAGE data,
+    int max_lines,
+  ) {
+    return _jpeg12_read_raw_data(
+      cinfo,
+      data,
+      max_lines,
+    );
+  }
+
+  late final _jpeg12_read_raw_dataPtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(j12_decompress_ptr, JSAMPIMAGE,
+              JDIMENSION)>>('jpeg12_read_raw_data');
+  late final _jpeg12_read_raw_data = _jpeg12_read_raw_dataPtr
+      .asFunction<int Function(j12_decompress_ptr, JSAMPIMAGE, int)>();
+
+  int jpeg12_read_plane(
+    j12_decompress_ptr cinfo,
+    JSAMPROW plane,
+    int row_stride,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_read_plane(
+      cinfo,
+      plane,
+      row_stride,
+      stats,
+    );
+  }
+
+  late final _jpeg12_read_planePtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(j12_decompress_ptr, JSAMPROW, JDIMENSION,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_read_plane');
+  late final _jpeg12_read_plane = _jpeg12_read_planePtr.asFunction<
+      int Function(j12_decompress_ptr, JSAMPROW, int,
+          ffi.Pointer<jpeg12_plane_stats>)>();
+
+  int jpeg12_read_plane_mapped(
+    j12_decompress_ptr cinfo,
+    JSAMPROW plane,
+    int row_stride,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+    ffi.Pointer<UINT16> lut,
+  ) {
+    return _jpeg12_read_plane_mapped(
+      cinfo,
+      plane,
+      row_stride,
+      stats,
+      lut,
+    );
+  }
+
+  late final _jpeg12_read_plane_mappedPtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(
+              j12_decompress_ptr,
+              JSAMPROW,
+              JDIMENSION,
+              ffi.Pointer<jpeg12_plane_stats>,
+              ffi.Pointer<UINT16>)>>('jpeg12_read_plane_mapped');
+  late final _jpeg12_read_plane_mapped = _jpeg12_read_plane_mappedPtr.asFunction<
+      int Function(j12_decompress_ptr, JSAMPROW, int,
+          ffi.Pointer<jpeg12_plane_stats>, ffi.Pointer<UINT16>)>();
+
+  void jpeg12_build_rescale_lut(
+    ffi.Pointer<UINT16> lut,
+    double slope,
+    double intercept,
+  ) {
+    return _jpeg12_build_rescale_lut(
+      lut,
+      slope,
+      intercept,
+    );
+  }
+
+  late final _jpeg12_build_rescale_lutPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<UINT16>, ffi.Double,
+              ffi.Double)>>('jpeg12_build_rescale_lut');
+  late final _jpeg12_build_rescale_lut = _jpeg12_build_rescale_lutPtr
+      .asFunction<void Function(ffi.Pointer<UINT16>, double, double)>();
+
+  void jpeg12_pack_plane_bgra(
+    ffi.Pointer<JSAMPLE> plane,
+    int row_stride,
+    int width,
+    int height,
+    ffi.Pointer<JOCTET> out,
+  ) {
+    return _jpeg12_pack_plane_bgra(
+      plane,
+      row_stride,
+      width,
+      height,
+      out,
+    );
+  }
+
+  late final _jpeg12_pack_plane_bgraPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<JSAMPLE>, JDIMENSION, JDIMENSION,
+              JDIMENSION, ffi.Pointer<JOCTET>)>>('jpeg12_pack_plane_bgra');
+  late final _jpeg12_pack_plane_bgra = _jpeg12_pack_plane_bgraPtr.asFunction<
+      void Function(
+          ffi.Pointer<JSAMPLE>, int, int, int, ffi.Pointer<JOCTET>)>();
+
+  void jpeg12_free_plane(
+    ffi.Pointer<ffi.Void> plane,
+  ) {
+    return _jpeg12_free_plane(
+      plane,
+    );
+  }
+
+  late final _jpeg12_free_planePtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>)>>(
+          'jpeg12_free_plane');
+  late final _jpeg12_free_plane = _jpeg12_free_planePtr
+      .asFunction<void Function(ffi.Pointer<ffi.Void>)>();
+
+  void jpeg12_init_plane_stats(
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_init_plane_stats(
+      stats,
+    );
+  }
+
+  late final _jpeg12_init_plane_statsPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<jpeg12_plane_stats>)>>(
+      'jpeg12_init_plane_stats');
+  late final _jpeg12_init_plane_stats = _jpeg12_init_plane_statsPtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_plane_stats>)>();
+
+  void jpeg12_merge_plane_stats(
+    ffi.Pointer<jpeg12_plane_stats> dest,
+    ffi.Pointer<jpeg12_plane_stats> src,
+  ) {
+    return _jpeg12_merge_plane_stats(
+      dest,
+      src,
+    );
+  }
+
+  late final _jpeg12_merge_plane_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_plane_stats>,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_merge_plane_stats');
+  late final _jpeg12_merge_plane_stats =
+      _jpeg12_merge_plane_statsPtr.asFunction<
+          void Function(ffi.Pointer<jpeg12_plane_stats>,
+              ffi.Pointer<jpeg12_plane_stats>)>();
+
+  int jpeg12_plane_percentile(
+    ffi.Pointer<jpeg12_plane_stats> stats,
+    double percent,
+  ) {
+    return _jpeg12_plane_percentile(
+      stats,
+      percent,
+    );
+  }
+
+  late final _jpeg12_plane_percentilePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int Function(ffi.Pointer<jpeg12_plane_stats>,
+              ffi.Double)>>('jpeg12_plane_percentile');
+  late final _jpeg12_plane_percentile = _jpeg12_plane_percentilePtr
+      .asFunction<int Function(ffi.Pointer<jpeg12_plane_stats>, double)>();
+
+  void jpeg12_count_plane_rows(
+    ffi.Pointer<jpeg12_plane_stats> stats,
+    JSAMPROW row,
+    int row_stride,
+    int num_samples,
+    int num_rows,
+  ) {
+    return _jpeg12_count_plane_rows(
+      stats,
+      row,
+      row_stride,
+      num_samples,
+      num_rows,
+    );
+  }
+
+  late final _jpeg12_count_plane_rowsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_plane_stats>, JSAMPROW,
+              JDIMENSION, JDIMENSION, ffi.Int)>>('jpeg12_count_plane_rows');
+  late final _jpeg12_count_plane_rows = _jpeg12_count_plane_rowsPtr.asFunction<
+      void Function(
+          ffi.Pointer<jpeg12_plane_stats>, JSAMPROW, int, int, int)>();
+
+  int jpeg12_estimate_plane_stats(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_estimate_plane_stats(
+      cinfo,
+      stats,
+    );
+  }
+
+  late final _jpeg12_estimate_plane_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_estimate_plane_stats');
+  late final _jpeg12_estimate_plane_stats =
+      _jpeg12_estimate_plane_statsPtr.asFunction<
+          int Function(j12_decompress_ptr, ffi.Pointer<jpeg12_plane_stats>)>();
+
+  int jpeg12_decode_batch(
+    ffi.Pointer<jpeg12_batch_item> items,
+    int num_items,
+    int num_threads,
+    jpeg12_batch_done done,
+    ffi.Pointer<ffi.Void> context,
+  ) {
+    return _jpeg12_decode_batch(
+      items,
+      num_items,
+      num_threads,
+      done,
+      context,
+    );
+  }
+
+  late final _jpeg12_decode_batchPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int Function(ffi.Pointer<jpeg12_batch_item>, ffi.Int, ffi.Int,
+              jpeg12_batch_done, ffi.Pointer<ffi.Void>)>>('jpeg12_decode_batch');
+  late final _jpeg12_decode_batch = _jpeg12_decode_batchPtr.asFunction<
+      int Function(ffi.Pointer<jpeg12_batch_item>, int, int, jpeg12_batch_done,
+          ffi.Pointer<ffi.Void>)>();
+
+  int jpeg12_decode_volume(
+    ffi.Pointer<jpeg12_batch_item> items,
+    int depth,
+    ffi.Pointer<UINT16> volume,
+    int width,
+    int height,
+    int num_threads,
+  ) {
+    return _jpeg12_decode_volume(
+      items,
+      depth,
+      volume,
+      width,
+      height,
+      num_threads,
+    );
+  }
+
+  late final _jpeg12_decode_volumePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int Function(ffi.Pointer<jpeg12_batch_item>, ffi.Int,
+              ffi.Pointer<UINT16>, JDIMENSION, JDIMENSION, ffi.Int)>>(
+      'jpeg12_decode_volume');
+  late final _jpeg12_decode_volume = _jpeg12_decode_volumePtr.asFunction<
+      int Function(ffi.Pointer<jpeg12_batch_item>, int, ffi.Pointer<UINT16>,
+          int, int, int)>();
+
+  void jpeg12_cancel_monitor(
+    j12_common_ptr cinfo,
+    ffi.Pointer<jpeg12_cancel_mgr> mgr,
+    ffi.Pointer<ffi.Int> cancel,
+  ) {
+    return _jpeg12_cancel_monitor(
+      cinfo,
+      mgr,
+      cancel,
+    );
+  }
+
+  late final _jpeg12_cancel_monitorPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(j12_common_ptr, ffi.Pointer<jpeg12_cancel_mgr>,
+              ffi.Pointer<ffi.Int>)>>('jpeg12_cancel_monitor');
+  late final _jpeg12_cancel_monitor = _jpeg12_cancel_monitorPtr.asFunction<
+      void Function(j12_common_ptr, ffi.Pointer<jpeg12_cancel_mgr>,
+          ffi.Pointer<ffi.Int>)>();
+
+  void jpeg12_set_cancel_flag(
+    ffi.Pointer<ffi.Int> cancel,
+    int value,
+  ) {
+    return _jpeg12_set_cancel_flag(
+      cancel,
+      value,
+    );
+  }
+
+  late final _jpeg12_set_cancel_flagPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Int>, ffi.Int)>>(
+      'jpeg12_set_cancel_flag');
+  late final _jpeg12_set_cancel_flag = _jpeg12_set_cancel_flagPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Int>, int)>();
+
+  ffi.Pointer<jpeg12_cine> jpeg12_create_cine(
+    ffi.Pointer<ffi.Pointer<JOCTET>> data,
+    ffi.Pointer<ffi.UnsignedLong> sizes,
+    int num_frames,
+    int ring_size,
+    int num_threads,
+    ffi.Pointer<JDIMENSION> width,
+    ffi.Pointer<JDIMENSION> height,
+  ) {
+    return _jpeg12_create_cine(
+      data,
+      sizes,
+      num_frames,
+      ring_size,
+      num_threads,
+      width,
+      height,
+    );
+  }
+
+  late final _jpeg12_create_cinePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<jpeg12_cine> Function(
+              ffi.Pointer<ffi.Pointer<JOCTET>>,
+              ffi.Pointer<ffi.UnsignedLong>,
+              ffi.Int,
+              ffi.Int,
+              ffi.Int,
+              ffi.Pointer<JDIMENSION>,
+              ffi.Pointer<JDIMENSION>)>>('jpeg12_create_cine');
+  late final _jpeg12_create_cine = _jpeg12_create_cinePtr.asFunction<
+      ffi.Pointer<jpeg12_cine> Function(
+          ffi.Pointer<ffi.Pointer<JOCTET>>,
+          ffi.Pointer<ffi.UnsignedLong>,
+          int,
+          int,
+          int,
+          ffi.Pointer<JDIMENSION>,
+          ffi.Pointer<JDIMENSION>)>();
+
+  int jpeg12_cine_acquire(
+    ffi.Pointer<jpeg12_cine> cine,
+    int sequence,
+    ffi.Pointer<jpeg12_cine_frame> frame,
+  ) {
+    return _jpeg12_cine_acquire(
+      cine,
+      sequence,
+      frame,
+    );
+  }
+
+  late final _jpeg12_cine_acquirePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<jpeg12_cine>, ffi.Long,
+              ffi.Pointer<jpeg12_cine_frame>)>>('jpeg12_cine_acquire');
+  late final _jpeg12_cine_acquire = _jpeg12_cine_acquirePtr.asFunction<
+      int Function(
+          ffi.Pointer<jpeg12_cine>, int, ffi.Pointer<jpeg12_cine_frame>)>();
+
+  void jpeg12_cine_release(
+    ffi.Pointer<jpeg12_cine> cine,
+    ffi.Pointer<jpeg12_cine_frame> frame,
+  ) {
+    return _jpeg12_cine_release(
+      cine,
+      frame,
+    );
+  }
+
+  late final _jpeg12_cine_releasePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_cine>,
+              ffi.Pointer<jpeg12_cine_frame>)>>('jpeg12_cine_release');
+  late final _jpeg12_cine_release = _jpeg12_cine_releasePtr.asFunction<
+      void Function(ffi.Pointer<jpeg12_cine>, ffi.Pointer<jpeg12_cine_frame>)>();
+
+  void jpeg12_cine_seek(
+    ffi.Pointer<jpeg12_cine> cine,
+    int sequence,
+  ) {
+    return _jpeg12_cine_seek(
+      cine,
+      sequence,
+    );
+  }
+
+  late final _jpeg12_cine_seekPtr = _lookup<
+          ffi.NativeFunction<
+              ffi.Void Function(ffi.Pointer<jpeg12_cine>, ffi.Long)>>(
+      'jpeg12_cine_seek');
+  late final _jpeg12_cine_seek = _jpeg12_cine_seekPtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_cine>, int)>();
+
+  void jpeg12_cine_get_stats(
+    ffi.Pointer<jpeg12_cine> cine,
+    ffi.Pointer<jpeg12_cine_stats> stats,
+  ) {
+    return _jpeg12_cine_get_stats(
+      cine,
+      stats,
+    );
+  }
+
+  late final _jpeg12_cine_get_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_cine>,
+              ffi.Pointer<jpeg12_cine_stats>)>>('jpeg12_cine_get_stats');
+  late final _jpeg12_cine_get_stats = _jpeg12_cine_get_statsPtr.asFunction<
+      void Function(ffi.Pointer<jpeg12_cine>, ffi.Pointer<jpeg12_cine_stats>)>();
+
+  void jpeg12_destroy_cine(
+    ffi.Pointer<jpeg12_cine> cine,
+  ) {
+    return _jpeg12_destroy_cine(
+      cine,
+    );
+  }
+
+  late final _jpeg12_destroy_cinePtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<jpeg12_cine>)>>(
+          'jpeg12_destroy_cine');
+  late final _jpeg12_destroy_cine = _jpeg12_destroy_cinePtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_cine>)>();
+
+  void jpeg12_identify_source(
+    ffi.Pointer<jpeg12_source_id> id,
+    ffi.Pointer<jpeg12_segment> segments,
+    int num_segments,
+  ) {
+    return _jpeg12_identify_source(
+      id,
+      segments,
+      num_segments,
+    );
+  }
+
+  late final _jpeg12_identify_sourcePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_source_id>,
+              ffi.Pointer<jpeg12_segment>, ffi.Int)>>('jpeg12_identify_source');
+  late final _jpeg12_identify_source = _jpeg12_identify_sourcePtr.asFunction<
+      void Function(
+          ffi.Pointer<jpeg12_source_id>, ffi.Pointer<jpeg12_segment>, int)>();
+
+  int jpeg12_write_plane_file(
+    ffi.Pointer<ffi.Char> path,
+    ffi.Pointer<jpeg12_source_id> id,
+    ffi.Pointer<JSAMPLE> plane,
+    int row_stride,
+    int width,
+    int height,
+    int num_levels,
+  ) {
+    return _jpeg12_write_plane_file(
+      path,
+      id,
+      plane,
+      row_stride,
+      width,
+      height,
+      num_levels,
+    );
+  }
+
+  late final _jpeg12_write_plane_filePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Char>,
+              ffi.Pointer<jpeg12_source_id>,
+              ffi.Pointer<JSAMPLE>,
+              JDIMENSION,
+              JDIMENSION,
+              JDIMENSION,
+              ffi.Int)>>('jpeg12_write_plane_file');
+  late final _jpeg12_write_plane_file = _jpeg12_write_plane_filePtr.asFunction<
+      int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<jpeg12_source_id>,
+          ffi.Pointer<JSAMPLE>, int, int, int, int)>();
+
+  int jpeg12_map_plane_file(
+    ffi.Pointer<ffi.Char> path,
+    ffi.Pointer<jpeg12_source_id> id,
+    ffi.Pointer<jpeg12_plane_file> file,
+  ) {
+    return _jpeg12_map_plane_file(
+      path,
+      id,
+      file,
+    );
+  }
+
+  late final _jpeg12_map_plane_filePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Char>,
+              ffi.Pointer<jpeg12_source_id>,
+              ffi.Pointer<jpeg12_plane_file>)>>('jpeg12_map_plane_file');
+  late final _jpeg12_map_plane_file = _jpeg12_map_plane_filePtr.asFunction<
+      int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<jpeg12_source_id>,
+          ffi.Pointer<jpeg12_plane_file>)>();
+
+  void jpeg12_plane_file_stats(
+    ffi.Pointer<jpeg12_plane_file> file,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_plane_file_stats(
+      file,
+      stats,
+    );
+  }
+
+  late final _jpeg12_plane_file_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<jpeg12_plane_file>,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_plane_file_stats');
+  late final _jpeg12_plane_file_stats = _jpeg12_plane_file_statsPtr.asFunction<
+      void Function(
+          ffi.Pointer<jpeg12_plane_file>, ffi.Pointer<jpeg12_plane_stats>)>();
+
+  void jpeg12_unmap_plane_file(
+    ffi.Pointer<jpeg12_plane_file> file,
+  ) {
+    return _jpeg12_unmap_plane_file(
+      file,
+    );
+  }
+
+  late final _jpeg12_unmap_plane_filePtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<jpeg12_plane_file>)>>(
+      'jpeg12_unmap_plane_file');
+  late final _jpeg12_unmap_plane_file = _jpeg12_unmap_plane_filePtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_plane_file>)>();
+
+  void jpeg12_free_plane_file(
+    ffi.Pointer<ffi.Void> file,
+  ) {
+    return _jpeg12_free_plane_file(
+      file,
+    );
+  }
+
+  late final _jpeg12_free_plane_filePtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>)>>(
+          'jpeg12_free_plane_file');
+  late final _jpeg12_free_plane_file = _jpeg12_free_plane_filePtr
+      .asFunction<void Function(ffi.Pointer<ffi.Void>)>();
+
+  int jpeg12_trim_plane_files(
+    ffi.Pointer<ffi.Char> directory,
+    int max_bytes,
+  ) {
+    return _jpeg12_trim_plane_files(
+      directory,
+      max_bytes,
+    );
+  }
+
+  late final _jpeg12_trim_plane_filesPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.UnsignedLong Function(
+              ffi.Pointer<ffi.Char>, ffi.UnsignedLong)>>('jpeg12_trim_plane_files');
+  late final _jpeg12_trim_plane_files = _jpeg12_trim_plane_filesPtr
+      .asFunction<int Function(ffi.Pointer<ffi.Char>, int)>();
+
+  void jpeg12_calc_pyramid(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_pyramid_level> levels,
+  ) {
+    return _jpeg12_calc_pyramid(
+      cinfo,
+      levels,
+    );
+  }
+
+  late final _jpeg12_calc_pyramidPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_pyramid_level>)>>('jpeg12_calc_pyramid');
+  late final _jpeg12_calc_pyramid = _jpeg12_calc_pyramidPtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_pyramid_level>)>();
+
+  int jpeg12_read_pyramid(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_pyramid_level> levels,
+  ) {
+    return _jpeg12_read_pyramid(
+      cinfo,
+      levels,
+    );
+  }
+
+  late final _jpeg12_read_pyramidPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_pyramid_level>)>>('jpeg12_read_pyramid');
+  late final _jpeg12_read_pyramid = _jpeg12_read_pyramidPtr.asFunction<
+      int Function(j12_decompress_ptr, ffi.Pointer<jpeg12_pyramid_level>)>();
+
+  ffi.Pointer<jpeg12_coef_image> jpeg12_save_coefficients(
+    j12_decompress_ptr cinfo,
+    int compact,
+  ) {
+    return _jpeg12_save_coefficients(
+      cinfo,
+      compact,
+    );
+  }
+
+  late final _jpeg12_save_coefficientsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<jpeg12_coef_image> Function(
+              j12_decompress_ptr, ffi.Int32)>>('jpeg12_save_coefficients');
+  late final _jpeg12_save_coefficients =
+      _jpeg12_save_coefficientsPtr.asFunction<
+          ffi.Pointer<jpeg12_coef_image> Function(j12_decompress_ptr, int)>();
+
+  void jpeg12_release_coef_image(
+    ffi.Pointer<jpeg12_coef_image> image,
+  ) {
+    return _jpeg12_release_coef_image(
+      image,
+    );
+  }
+
+  late final _jpeg12_release_coef_imagePtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<jpeg12_coef_image>)>>(
+      'jpeg12_release_coef_image');
+  late final _jpeg12_release_coef_image = _jpeg12_release_coef_imagePtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_coef_image>)>();
+
+  void jpeg12_read_coef_image(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_coef_image> image,
+    int scale,
+    int x,
+    int y,
+    int width,
+    int height,
+    JSAMPROW plane,
+    int row_stride,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_read_coef_image(
+      cinfo,
+      image,
+      scale,
+      x,
+      y,
+      width,
+      height,
+      plane,
+      row_stride,
+      stats,
+    );
+  }
+
+  late final _jpeg12_read_coef_imagePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+              j12_decompress_ptr,
+              ffi.Pointer<jpeg12_coef_image>,
+              ffi.Int,
+              JDIMENSION,
+              JDIMENSION,
+              JDIMENSION,
+              JDIMENSION,
+              JSAMPROW,
+              JDIMENSION,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_read_coef_image');
+  late final _jpeg12_read_coef_image = _jpeg12_read_coef_imagePtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_coef_image>, int,
+          int, int, int, int, JSAMPROW, int, ffi.Pointer<jpeg12_plane_stats>)>();
+
+  ffi.Pointer<jpeg12_coef_cache> jpeg12_create_coef_cache(
+    int max_bytes,
+  ) {
+    return _jpeg12_create_coef_cache(
+      max_bytes,
+    );
+  }
+
+  late final _jpeg12_create_coef_cachePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<jpeg12_coef_cache> Function(
+              ffi.UnsignedLong)>>('jpeg12_create_coef_cache');
+  late final _jpeg12_create_coef_cache = _jpeg12_create_coef_cachePtr
+      .asFunction<ffi.Pointer<jpeg12_coef_cache> Function(int)>();
+
+  void jpeg12_destroy_coef_cache(
+    ffi.Pointer<jpeg12_coef_cache> cache,
+  ) {
+    return _jpeg12_destroy_coef_cache(
+      cache,
+    );
+  }
+
+  late final _jpeg12_destroy_coef_cachePtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<jpeg12_coef_cache>)>>(
+      'jpeg12_destroy_coef_cache');
+  late final _jpeg12_destroy_coef_cache = _jpeg12_destroy_coef_cachePtr
+      .asFunction<void Function(ffi.Pointer<jpeg12_coef_cache>)>();
+
+  ffi.Pointer<jpeg12_coef_image> jpeg12_coef_cache_lookup(
+    ffi.Pointer<jpeg12_coef_cache> cache,
+    int key,
+    ffi.Pointer<jpeg12_source_id> id,
+  ) {
+    return _jpeg12_coef_cache_lookup(
+      cache,
+      key,
+      id,
+    );
+  }
+
+  late final _jpeg12_coef_cache_lookupPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<jpeg12_coef_image> Function(
+              ffi.Pointer<jpeg12_coef_cache>,
+              jpeg12_coef_key,
+              ffi.Pointer<jpeg12_source_id>)>>('jpeg12_coef_cache_lookup');
+  late final _jpeg12_coef_cache_lookup = _jpeg12_coef_cache_lookupPtr.asFunction<
+      ffi.Pointer<jpeg12_coef_image> Function(ffi.Pointer<jpeg12_coef_cache>,
+          int, ffi.Pointer<jpeg12_source_id>)>();
+
+  int jpeg12_coef_cache_insert(
+    ffi.Pointer<jpeg12_coef_cache> cache,
+    int key,
+    ffi.Pointer<jpeg12_source_id> id,
+    ffi.Pointer<jpeg12_coef_image> image,
+  ) {
+    return _jpeg12_coef_cache_insert(
+      cache,
+      key,
+      id,
+      image,
+    );
+  }
+
+  late final _jpeg12_coef_cache_insertPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<jpeg12_coef_cache>,
+              jpeg12_coef_key,
+              ffi.Pointer<jpeg12_source_id>,
+              ffi.Pointer<jpeg12_coef_image>)>>('jpeg12_coef_cache_insert');
+  late final _jpeg12_coef_cache_insert = _jpeg12_coef_cache_insertPtr.asFunction<
+      int Function(ffi.Pointer<jpeg12_coef_cache>, int,
+          ffi.Pointer<jpeg12_source_id>, ffi.Pointer<jpeg12_coef_image>)>();
+
+  void jpeg12_set_backing_store(
+    ffi.Pointer<ffi.Char> temp_dir,
+    int max_memory_to_use,
+  ) {
+    return _jpeg12_set_backing_store(
+      temp_dir,
+      max_memory_to_use,
+    );
+  }
+
+  late final _jpeg12_set_backing_storePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+              ffi.Pointer<ffi.Char>, ffi.Long)>>('jpeg12_set_backing_store');
+  late final _jpeg12_set_backing_store = _jpeg12_set_backing_storePtr
+      .asFunction<void Function(ffi.Pointer<ffi.Char>, int)>();
+
+  int jpeg12_init_decode_timing(
+    ffi.Pointer<jpeg12_decode_timing> timing,
+  ) {
+    return _jpeg12_init_decode_timing(
+      timing,
+    );
+  }
+
+  late final _jpeg12_init_decode_timingPtr = _lookup<
+          ffi.NativeFunction<ffi.Int32 Function(ffi.Pointer<jpeg12_decode_timing>)>>(
+      'jpeg12_init_decode_timing');
+  late final _jpeg12_init_decode_timing = _jpeg12_init_decode_timingPtr
+      .asFunction<int Function(ffi.Pointer<jpeg12_decode_timing>)>();
+
+  void jpeg12_timing_begin(
+    j12_decompress_ptr cinfo,
+    int stage,
+  ) {
+    return _jpeg12_timing_begin(
+      cinfo,
+      stage,
+    );
+  }
+
+  late final _jpeg12_timing_beginPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(j12_decompress_ptr, ffi.Int)>>(
+      'jpeg12_timing_begin');
+  late final _jpeg12_timing_begin = _jpeg12_timing_beginPtr
+      .asFunction<void Function(j12_decompress_ptr, int)>();
+
+  void jpeg12_timing_switch(
+    j12_decompress_ptr cinfo,
+    int stage,
+  ) {
+    return _jpeg12_timing_switch(
+      cinfo,
+      stage,
+    );
+  }
+
+  late final _jpeg12_timing_switchPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(j12_decompress_ptr, ffi.Int)>>(
+      'jpeg12_timing_switch');
+  late final _jpeg12_timing_switch = _jpeg12_timing_switchPtr
+      .asFunction<void Function(j12_decompress_ptr, int)>();
+
+  void jpeg12_timing_end(
+    j12_decompress_ptr cinfo,
+  ) {
+    return _jpeg12_timing_end(
+      cinfo,
+    );
+  }
+
+  late final _jpeg12_timing_endPtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(j12_decompress_ptr)>>(
+          'jpeg12_timing_end');
+  late final _jpeg12_timing_end =
+      _jpeg12_timing_endPtr.asFunction<void Function(j12_decompress_ptr)>();
+
+  ffi.Pointer<jpeg12_error_mgr> jpeg12_try_error(
+    ffi.Pointer<jpeg12_try_error_mgr> err,
+  ) {
+    return _jpeg12_try_error(
+      err,
+    );
+  }
+
+  late final _jpeg12_try_errorPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<jpeg12_error_mgr> Function(
+              ffi.Pointer<jpeg12_try_error_mgr>)>>('jpeg12_try_error');
+  late final _jpeg12_try_error = _jpeg12_try_errorPtr.asFunction<
+      ffi.Pointer<jpeg12_error_mgr> Function(
+          ffi.Pointer<jpeg12_try_error_mgr>)>();
+
+  void jpeg12_try_mem_src(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<ffi.UnsignedChar> inbuffer,
+    int insize,
+  ) {
+    return _jpeg12_try_mem_src(
+      cinfo,
+      inbuffer,
+      insize,
+    );
+  }
+
+  late final _jpeg12_try_mem_srcPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(j12_decompress_ptr, ffi.Pointer<ffi.UnsignedChar>,
+              ffi.UnsignedLong)>>('jpeg12_try_mem_src');
+  late final _jpeg12_try_mem_src = _jpeg12_try_mem_srcPtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<ffi.UnsignedChar>, int)>();
+
+  int jpeg12_try_read_header(
+    j12_decompress_ptr cinfo,
+    int require_image,
+  ) {
+    return _jpeg12_try_read_header(
+      cinfo,
+      require_image,
+    );
+  }
+
+  late final _jpeg12_try_read_headerPtr = _lookup<
+          ffi.NativeFunction<ffi.Int Function(j12_decompress_ptr, ffi.Int32)>>(
+      'jpeg12_try_read_header');
+  late final _jpeg12_try_read_header = _jpeg12_try_read_headerPtr
+      .asFunction<int Function(j12_decompress_ptr, int)>();
+
+  int jpeg12_try_start_decompress(
+    j12_decompress_ptr cinfo,
+  ) {
+    return _jpeg12_try_start_decompress(
+      cinfo,
+    );
+  }
+
+  late final _jpeg12_try_start_decompressPtr =
+      _lookup<ffi.NativeFunction<ffi.Int32 Function(j12_decompress_ptr)>>(
+          'jpeg12_try_start_decompress');
+  late final _jpeg12_try_start_decompress = _jpeg12_try_start_decompressPtr
+      .asFunction<int Function(j12_decompress_ptr)>();
+
+  int jpeg12_try_read_scanlines(
+    j12_decompress_ptr cinfo,
+    JSAMPARRAY scanlines,
+    int max_lines,
+  ) {
+    return _jpeg12_try_read_scanlines(
+      cinfo,
+      scanlines,
+      max_lines,
+    );
+  }
+
+  late final _jpeg12_try_read_scanlinesPtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(j12_decompress_ptr, JSAMPARRAY,
+              JDIMENSION)>>('jpeg12_try_read_scanlines');
+  late final _jpeg12_try_read_scanlines = _jpeg12_try_read_scanlinesPtr
+      .asFunction<int Function(j12_decompress_ptr, JSAMPARRAY, int)>();
+
+  int jpeg12_try_finish_decompress(
+    j12_decompress_ptr cinfo,
+  ) {
+    return _jpeg12_try_finish_decompress(
+      cinfo,
+    );
+  }
+
+  late final _jpeg12_try_finish_decompressPtr =
+      _lookup<ffi.NativeFunction<ffi.Int32 Function(j12_decompress_ptr)>>(
+          'jpeg12_try_finish_decompress');
+  late final _jpeg12_try_finish_decompress = _jpeg12_try_finish_decompressPtr
+      .asFunction<int Function(j12_decompress_ptr)>();
+
+  int jpeg12_try_read_plane(
+    j12_decompress_ptr cinfo,
+    JSAMPROW plane,
+    int row_stride,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_try_read_plane(
+      cinfo,
+      plane,
+      row_stride,
+      stats,
+    );
+  }
+
+  late final _jpeg12_try_read_planePtr = _lookup<
+      ffi.NativeFunction<
+          JDIMENSION Function(j12_decompress_ptr, JSAMPROW, JDIMENSION,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_try_read_plane');
+  late final _jpeg12_try_read_plane = _jpeg12_try_read_planePtr.asFunction<
+      int Function(j12_decompress_ptr, JSAMPROW, int,
+          ffi.Pointer<jpeg12_plane_stats>)>();
+
+  int jpeg12_try_estimate_plane_stats(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_plane_stats> stats,
+  ) {
+    return _jpeg12_try_estimate_plane_stats(
+      cinfo,
+      stats,
+    );
+  }
+
+  late final _jpeg12_try_estimate_plane_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_try_estimate_plane_stats');
+  late final _jpeg12_try_estimate_plane_stats =
+      _jpeg12_try_estimate_plane_statsPtr.asFunction<
+          int Function(j12_decompress_ptr, ffi.Pointer<jpeg12_plane_stats>)>();
+
+  void jpeg12_try_calc_pyramid(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_pyramid_level> levels,
+  ) {
+    return _jpeg12_try_calc_pyramid(
+      cinfo,
+      levels,
+    );
+  }
+
+  late final _jpeg12_try_calc_pyramidPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_pyramid_level>)>>('jpeg12_try_calc_pyramid');
+  late final _jpeg12_try_calc_pyramid = _jpeg12_try_calc_pyramidPtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_pyramid_level>)>();
+
+  int jpeg12_try_read_pyramid(
+    j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_pyramid_level> levels,
+  ) {
+    return _jpeg12_try_read_pyramid(
+      cinfo,
+      levels,
+    );
+  }
+
+  late final _jpeg12_try_read_pyramidPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(j12_decompress_ptr,
+              ffi.Pointer<jpeg12_pyramid_level>)>>('jpeg12_try_read_pyramid');
+  late final _jpeg12_try_read_pyramid = _jpeg12_try_read_pyramidPtr.asFunction<
+      int Function(j12_decompress_ptr, ffi.Pointer<jpeg12_pyramid_level>)>();
+
+  ffi.Pointer<jpeg12_coef_image> jpeg12_try_save_coefficients(
+    j12_decompress_ptr cinfo,
+    int compact,
+  ) {
+    return _jpeg12_try_save_coefficients(
+      cinfo,
+      compact,
+    );
+  }
+
+  late final _jpeg12_try_save_coefficientsPtr = _lookup<
       ffi.NativeFunction<
-          JDIMENSION Function(j12_decompress_ptr, JSAMPARRAY,
-              JDIMENSION)>>('jpeg12_read_scanlines');
-  late final _jpeg12_read_scanlines = _jpeg12_read_scanlinesPtr
-      .asFunction<int Function(j12_decompress_ptr, JSAMPARRAY, int)>();
+          ffi.Pointer<jpeg12_coef_image> Function(
+              j12_decompress_ptr, ffi.Int32)>>('jpeg12_try_save_coefficients');
+  late final _jpeg12_try_save_coefficients =
+      _jpeg12_try_save_coefficientsPtr.asFunction<
+          ffi.Pointer<jpeg12_coef_image> Function(j12_decompress_ptr, int)>();
 
-  int jpeg12_finish_decompress(
+  void jpeg12_try_read_coef_image(
     j12_decompress_ptr cinfo,
+    ffi.Pointer<jpeg12_coef_image> image,
+    int scale,
+    int x,
+    int y,
+    int width,
+    int height,
+    JSAMPROW plane,
+    int row_stride,
+    ffi.Pointer<jpeg12_plane_stats> stats,
   ) {
-    return _jpeg12_finish_decompress(
+    return _jpeg12_try_read_coef_image(
       cinfo,
+      image,
+      scale,
+      x,
+      y,
+      width,
+      height,
+      plane,
+      row_stride,
+      stats,
     );
   }
 
-  late final _jpeg12_finish_decompressPtr =
-      _lookup<ffi.NativeFunction<ffi.Int32 Function(j12_decompress_ptr)>>(
-          'jpeg12_finish_decompress');
-  late final _jpeg12_finish_decompress = _jpeg12_finish_decompressPtr
-      .asFunction<int Function(j12_decompress_ptr)>();
-
-  int jpeg12_read_raw_data(
-    j12_decompress_ptr cinfo,
-    JSAMPIMAGE data,
-    int max_lines,
+  late final _jpeg12_try_read_coef_imagePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+              j12_decompress_ptr,
+              ffi.Pointer<jpeg12_coef_image>,
+              ffi.Int,
+              JDIMENSION,
+              JDIMENSION,
+              JDIMENSION,
+              JDIMENSION,
+              JSAMPROW,
+              JDIMENSION,
+              ffi.Pointer<jpeg12_plane_stats>)>>('jpeg12_try_read_coef_image');
+  late final _jpeg12_try_read_coef_image = _jpeg12_try_read_coef_imagePtr.asFunction<
+      void Function(j12_decompress_ptr, ffi.Pointer<jpeg12_coef_image>, int,
+          int, int, int, int, JSAMPROW, int, ffi.Pointer<jpeg12_plane_stats>)>();
+
+  void jpeg12_get_memory_stats(
+    j12_common_ptr cinfo,
+    ffi.Pointer<jpeg12_memory_stats> stats,
   ) {
-    return _jpeg12_read_raw_data(
+    return _jpeg12_get_memory_stats(
       cinfo,
-      data,
-      max_lines,
+      stats,
     );
   }
 
-  late final _jpeg12_read_raw_dataPtr = _lookup<
+  late final _jpeg12_get_memory_statsPtr = _lookup<
       ffi.NativeFunction<
-          JDIMENSION Function(j12_decompress_ptr, JSAMPIMAGE,
-              JDIMENSION)>>('jpeg12_read_raw_data');
-  late final _jpeg12_read_raw_data = _jpeg12_read_raw_dataPtr
-      .asFunction<int Function(j12_decompress_ptr, JSAMPIMAGE, int)>();
+          ffi.Void Function(j12_common_ptr,
+              ffi.Pointer<jpeg12_memory_stats>)>>('jpeg12_get_memory_stats');
+  late final _jpeg12_get_memory_stats = _jpeg12_get_memory_statsPtr.asFunction<
+      void Function(j12_common_ptr, ffi.Pointer<jpeg12_memory_stats>)>();
+
+  void jpeg12_get_process_memory_stats(
+    ffi.Pointer<jpeg12_process_memory_stats> stats,
+    int reset_peak,
+  ) {
+    return _jpeg12_get_process_memory_stats(
+      stats,
+      reset_peak,
+    );
+  }
+
+  late final _jpeg12_get_process_memory_statsPtr = _lookup<
+          ffi.NativeFunction<
+              ffi.Void Function(
+                  ffi.Pointer<jpeg12_process_memory_stats>, ffi.Int32)>>(
+      'jpeg12_get_process_memory_stats');
+  late final _jpeg12_get_process_memory_stats =
+      _jpeg12_get_process_memory_statsPtr.asFunction<
+          void Function(ffi.Pointer<jpeg12_process_memory_stats>, int)>();
 
   int jpeg12_has_multiple_scans(
     j12_decompress_ptr cinfo,
@@ -1047,6 +2147,155 @@ abstract class J_DITHER_MODE {
   static const int JDITHER_FS = 2;
 }
 
+abstract class J_TIMING_STAGE {
+  static const int JTIME_MARKERS = 0;
+  static const int JTIME_ENTROPY = 1;
+  static const int JTIME_IDCT = 2;
+  static const int JTIME_UPSAMPLE = 3;
+  static const int JTIME_COLOR = 4;
+  static const int JTIME_POSTPROCESS = 5;
+  static const int JTIME_OUTPUT = 6;
+}
+
+abstract class J_TRACE_EVENT {
+  static const int JTRACE_HEADER = 0;
+  static const int JTRACE_SCAN = 1;
+  static const int JTRACE_OUTPUT = 2;
+}
+
+abstract class J_MESSAGE_CODE {
+  static const int JMSG_NOMESSAGE = 0;
+  static const int JERR_BAD_ALIGN_TYPE = 1;
+  static const int JERR_BAD_ALLOC_CHUNK = 2;
+  static const int JERR_BAD_BUFFER_MODE = 3;
+  static const int JERR_BAD_COMPONENT_ID = 4;
+  static const int JERR_BAD_CROP_SPEC = 5;
+  static const int JERR_BAD_DCT_COEF = 6;
+  static const int JERR_BAD_DCTSIZE = 7;
+  static const int JERR_BAD_DROP_SAMPLING = 8;
+  static const int JERR_BAD_HUFF_TABLE = 9;
+  static const int JERR_BAD_IN_COLORSPACE = 10;
+  static const int JERR_BAD_J_COLORSPACE = 11;
+  static const int JERR_BAD_LENGTH = 12;
+  static const int JERR_BAD_LIB_VERSION = 13;
+  static const int JERR_BAD_MCU_SIZE = 14;
+  static const int JERR_BAD_PLANE_SIZE = 15;
+  static const int JERR_BAD_POOL_ID = 16;
+  static const int JERR_BAD_PRECISION = 17;
+  static const int JERR_BAD_PROGRESSION = 18;
+  static const int JERR_BAD_PROG_SCRIPT = 19;
+  static const int JERR_BAD_SAMPLING = 20;
+  static const int JERR_BAD_SCAN_SCRIPT = 21;
+  static const int JERR_BAD_STATE = 22;
+  static const int JERR_BAD_STRUCT_SIZE = 23;
+  static const int JERR_BAD_VIRTUAL_ACCESS = 24;
+  static const int JERR_BUFFER_SIZE = 25;
+  static const int JERR_CANCELLED = 26;
+  static const int JERR_CANT_SUSPEND = 27;
+  static const int JERR_CCIR601_NOTIMPL = 28;
+  static const int JERR_COMPONENT_COUNT = 29;
+  static const int JERR_CONVERSION_NOTIMPL = 30;
+  static const int JERR_DAC_INDEX = 31;
+  static const int JERR_DAC_VALUE = 32;
+  static const int JERR_DHT_INDEX = 33;
+  static const int JERR_DQT_INDEX = 34;
+  static const int JERR_EMPTY_IMAGE = 35;
+  static const int JERR_EMS_READ = 36;
+  static const int JERR_EMS_WRITE = 37;
+  static const int JERR_EOI_EXPECTED = 38;
+  static const int JERR_FILE_READ = 39;
+  static const int JERR_FILE_WRITE = 40;
+  static const int JERR_FRACT_SAMPLE_NOTIMPL = 41;
+  static const int JERR_HUFF_CLEN_OVERFLOW = 42;
+  static const int JERR_HUFF_MISSING_CODE = 43;
+  static const int JERR_IMAGE_TOO_BIG = 44;
+  static const int JERR_INPUT_EMPTY = 45;
+  static const int JERR_INPUT_EOF = 46;
+  static const int JERR_MISMATCHED_QUANT_TABLE = 47;
+  static const int JERR_MISSING_DATA = 48;
+  static const int JERR_MODE_CHANGE = 49;
+  static const int JERR_NOTIMPL = 50;
+  static const int JERR_NOT_COMPILED = 51;
+  static const int JERR_NO_ARITH_TABLE = 52;
+  static const int JERR_NO_BACKING_STORE = 53;
+  static const int JERR_NO_HUFF_TABLE = 54;
+  static const int JERR_NO_IMAGE = 55;
+  static const int JERR_NO_QUANT_TABLE = 56;
+  static const int JERR_NO_SOI = 57;
+  static const int JERR_OUT_OF_MEMORY = 58;
+  static const int JERR_QUANT_COMPONENTS = 59;
+  static const int JERR_QUANT_FEW_COLORS = 60;
+  static const int JERR_QUANT_MANY_COLORS = 61;
+  static const int JERR_SOF_BEFORE = 62;
+  static const int JERR_SOF_DUPLICATE = 63;
+  static const int JERR_SOF_NO_SOS = 64;
+  static const int JERR_SOF_UNSUPPORTED = 65;
+  static const int JERR_SOI_DUPLICATE = 66;
+  static const int JERR_TFILE_CREATE = 67;
+  static const int JERR_TFILE_READ = 68;
+  static const int JERR_TFILE_SEEK = 69;
+  static const int JERR_TFILE_WRITE = 70;
+  static const int JERR_TOO_LITTLE_DATA = 71;
+  static const int JERR_UNKNOWN_MARKER = 72;
+  static const int JERR_VIRTUAL_BUG = 73;
+  static const int JERR_WIDTH_OVERFLOW = 74;
+  static const int JERR_XMS_READ = 75;
+  static const int JERR_XMS_WRITE = 76;
+  static const int JMSG_COPYRIGHT = 77;
+  static const int JMSG_VERSION = 78;
+  static const int JTRC_16BIT_TABLES = 79;
+  static const int JTRC_ADOBE = 80;
+  static const int JTRC_APP0 = 81;
+  static const int JTRC_APP14 = 82;
+  static const int JTRC_DAC = 83;
+  static const int JTRC_DHT = 84;
+  static const int JTRC_DQT = 85;
+  static const int JTRC_DRI = 86;
+  static const int JTRC_EMS_CLOSE = 87;
+  static const int JTRC_EMS_OPEN = 88;
+  static const int JTRC_EOI = 89;
+  static const int JTRC_HUFFBITS = 90;
+  static const int JTRC_JFIF = 91;
+  static const int JTRC_JFIF_BADTHUMBNAILSIZE = 92;
+  static const int JTRC_JFIF_EXTENSION = 93;
+  static const int JTRC_JFIF_THUMBNAIL = 94;
+  static const int JTRC_MISC_MARKER = 95;
+  static const int JTRC_PARMLESS_MARKER = 96;
+  static const int JTRC_QUANTVALS = 97;
+  static const int JTRC_QUANT_3_NCOLORS = 98;
+  static const int JTRC_QUANT_NCOLORS = 99;
+  static const int JTRC_QUANT_SELECTED = 100;
+  static const int JTRC_RECOVERY_ACTION = 101;
+  static const int JTRC_RST = 102;
+  static const int JTRC_SMOOTH_NOTIMPL = 103;
+  static const int JTRC_SOF = 104;
+  static const int JTRC_SOF_COMPONENT = 105;
+  static const int JTRC_SOI = 106;
+  static const int JTRC_SOS = 107;
+  static const int JTRC_SOS_COMPONENT = 108;
+  static const int JTRC_SOS_PARAMS = 109;
+  static const int JTRC_TFILE_CLOSE = 110;
+  static const int JTRC_TFILE_OPEN = 111;
+  static const int JTRC_THUMB_JPEG = 112;
+  static const int JTRC_THUMB_PALETTE = 113;
+  static const int JTRC_THUMB_RGB = 114;
+  static const int JTRC_UNKNOWN_IDS = 115;
+  static const int JTRC_XMS_CLOSE = 116;
+  static const int JTRC_XMS_OPEN = 117;
+  static const int JWRN_ADOBE_XFORM = 118;
+  static const int JWRN_ARITH_BAD_CODE = 119;
+  static const int JWRN_BOGUS_PROGRESSION = 120;
+  static const int JWRN_EXTRANEOUS_DATA = 121;
+  static const int JWRN_HIT_MARKER = 122;
+  static const int JWRN_HUFF_BAD_CODE = 123;
+  static const int JWRN_JFIF_MAJOR = 124;
+  static const int JWRN_JPEG12_EOF = 125;
+  static const int JWRN_MUST_RESYNC = 126;
+  static const int JWRN_NOT_SEQUENTIAL = 127;
+  static const int JWRN_TOO_MUCH_DATA = 128;
+  static const int JMSG_LASTMSGCODE = 129;
+}
+
 class jpeg12_common_struct extends ffi.Struct {
   external ffi.Pointer<jpeg12_error_mgr> err;
 
@@ -1209,6 +2458,12 @@ class jpeg12_progress_mgr extends ffi.Struct {
   external int total_passes;
 }
 
+class jpeg12_cancel_mgr extends ffi.Struct {
+  external jpeg12_progress_mgr pub;
+
+  external ffi.Pointer<ffi.Int> cancel;
+}
+
 class jpeg12_compress_struct extends ffi.Struct {
   external ffi.Pointer<jpeg12_error_mgr> err;
 
@@ -1537,6 +2792,22 @@ class jpeg12_decompress_struct extends ffi.Struct {
   @ffi.Int32()
   external int enable_2pass_quant;
 
+  @ffi.Int32()
+  external int window_output;
+
+  @ffi.Int()
+  external int window_min;
+
+  @ffi.Int()
+  external int window_max;
+
+  external ffi.Pointer<JOCTET> voi_lut;
+
+  @ffi.Int()
+  external int entropy_threads;
+
+  external ffi.Pointer<jpeg12_decode_timing_struct> timing;
+
   @JDIMENSION()
   external int output_width;
 
@@ -1658,6 +2929,8 @@ class jpeg12_decompress_struct extends ffi.Struct {
 
   external ffi.Pointer<JSAMPLE> sample_range_limit;
 
+  external ffi.Pointer<JOCTET> window_range_limit;
+
   @ffi.Int()
   external int comps_in_scan;
 
@@ -1749,6 +3022,13 @@ class jpeg12_source_mgr extends ffi.Struct {
       j12_term_source;
 }
 
+class jpeg12_segment extends ffi.Struct {
+  external ffi.Pointer<JOCTET> data;
+
+  @ffi.UnsignedLong()
+  external int size;
+}
+
 typedef j12_decompress_ptr = ffi.Pointer<jpeg12_decompress_struct>;
 
 class jpeg12_decomp_master extends ffi.Opaque {}
@@ -1777,6 +3057,341 @@ typedef JSAMPIMAGE = ffi.Pointer<JSAMPARRAY>;
 typedef jpeg12_marker_parser_method
     = ffi.Pointer<ffi.NativeFunction<ffi.Int32 Function(j12_decompress_ptr)>>;
 
+class jpeg12_plane_stats extends ffi.Struct {
+  @ffi.UnsignedLong()
+  external int count;
+
+  @ffi.Int()
+  external int min_value;
+
+  @ffi.Int()
+  external int max_value;
+
+  @ffi.Array.multi([4096])
+  external ffi.Array<ffi.UnsignedLong> histogram;
+}
+
+class jpeg12_batch_item extends ffi.Struct {
+  external ffi.Pointer<JOCTET> data;
+
+  @ffi.UnsignedLong()
+  external int size;
+
+  external ffi.Pointer<jpeg12_segment> segments;
+
+  @ffi.Int()
+  external int num_segments;
+
+  external JSAMPROW plane;
+
+  @ffi.UnsignedLong()
+  external int plane_samples;
+
+  @JDIMENSION()
+  external int row_stride;
+
+  external ffi.Pointer<jpeg12_plane_stats> stats;
+
+  @JDIMENSION()
+  external int plane_width;
+
+  @JDIMENSION()
+  external int plane_height;
+
+  @ffi.Int32()
+  external int rescale;
+
+  @ffi.Double()
+  external double slope;
+
+  @ffi.Double()
+  external double intercept;
+
+  external ffi.Pointer<ffi.Int> cancel;
+
+  external ffi.Pointer<ffi.Char> cache_file;
+
+  @ffi.Int()
+  external int cache_levels;
+
+  @ffi.Int()
+  external int status;
+
+  @JDIMENSION()
+  external int output_width;
+
+  @JDIMENSION()
+  external int output_height;
+
+  @ffi.Int()
+  external int output_components;
+
+  @ffi.Array.multi([200])
+  external ffi.Array<ffi.Char> message;
+}
+
+typedef jpeg12_batch_done = ffi.Pointer<
+    ffi.NativeFunction<
+        ffi.Void Function(ffi.Pointer<ffi.Void> context,
+            ffi.Pointer<jpeg12_batch_item> items, ffi.Int num_items,
+            ffi.Int num_failed)>>;
+
+class jpeg12_try_error_mgr extends ffi.Struct {
+  external jpeg12_error_mgr pub;
+
+  external ffi.Pointer<ffi.Void> jump;
+
+  @ffi.Int()
+  external int status;
+
+  @ffi.Array.multi([200])
+  external ffi.Array<ffi.Char> message;
+}
+
+class jpeg12_cine_struct extends ffi.Opaque {}
+
+typedef jpeg12_cine = jpeg12_cine_struct;
+
+class jpeg12_cine_frame extends ffi.Struct {
+  @ffi.Long()
+  external int sequence;
+
+  @ffi.Int()
+  external int frame;
+
+  @ffi.Int()
+  external int slot;
+
+  external ffi.Pointer<JSAMPLE> plane;
+
+  @JDIMENSION()
+  external int width;
+
+  @JDIMENSION()
+  external int height;
+
+  @ffi.Int()
+  external int min_value;
+
+  @ffi.Int()
+  external int max_value;
+
+  @ffi.Int()
+  external int status;
+
+  external ffi.Pointer<ffi.Char> message;
+}
+
+class jpeg12_cine_stats extends ffi.Struct {
+  @ffi.Long()
+  external int frames_decoded;
+
+  @ffi.Long()
+  external int frames_failed;
+
+  @ffi.Long()
+  external int frames_discarded;
+}
+
+class jpeg12_pyramid_level extends ffi.Struct {
+  external JSAMPROW plane;
+
+  @JDIMENSION()
+  external int row_stride;
+
+  external ffi.Pointer<jpeg12_plane_stats> stats;
+
+  @JDIMENSION()
+  external int width;
+
+  @JDIMENSION()
+  external int height;
+}
+
+class jpeg12_source_id extends ffi.Struct {
+  @ffi.UnsignedLong()
+  external int size;
+
+  @ffi.Array.multi([32])
+  external ffi.Array<JOCTET> digest;
+}
+
+class jpeg12_plane_file extends ffi.Struct {
+  @ffi.Int()
+  external int num_levels;
+
+  @ffi.Array.multi([4])
+  external ffi.Array<JDIMENSION> width;
+
+  @ffi.Array.multi([4])
+  external ffi.Array<JDIMENSION> height;
+
+  @ffi.Array.multi([4])
+  external ffi.Array<ffi.Pointer<JSAMPLE>> plane;
+
+  @ffi.Int()
+  external int min_value;
+
+  @ffi.Int()
+  external int max_value;
+
+  external ffi.Pointer<JOCTET> histogram;
+
+  external ffi.Pointer<ffi.Void> map_base;
+
+  @ffi.Size()
+  external int map_bytes;
+}
+
+class jpeg12_coef_cache_struct extends ffi.Opaque {}
+
+typedef jpeg12_coef_cache = jpeg12_coef_cache_struct;
+typedef jpeg12_coef_key = ffi.UnsignedLongLong;
+
+class jpeg12_coef_image_struct extends ffi.Struct {
+  @JDIMENSION()
+  external int image_width;
+
+  @JDIMENSION()
+  external int image_height;
+
+  @JDIMENSION()
+  external int width_in_blocks;
+
+  @JDIMENSION()
+  external int height_in_blocks;
+
+  @ffi.Int32()
+  external int compact;
+
+  @ffi.UnsignedLong()
+  external int bytes;
+
+  @ffi.Array.multi([64])
+  external ffi.Array<UINT16> quantval;
+
+  external ffi.Pointer<JCOEF> coefs;
+
+  external ffi.Pointer<ffi.UnsignedLong> row_start;
+
+  external ffi.Pointer<UINT8> counts;
+
+  @ffi.Int()
+  external int ref_count;
+
+  external ffi.Pointer<jpeg12_coef_cache> cache;
+
+  @jpeg12_coef_key()
+  external int key;
+
+  external jpeg12_source_id source;
+
+  external ffi.Pointer<jpeg12_coef_image_struct> prev;
+
+  external ffi.Pointer<jpeg12_coef_image_struct> next;
+}
+
+typedef jpeg12_coef_image = jpeg12_coef_image_struct;
+
+class jpeg12_decode_timing_struct extends ffi.Struct {
+  @ffi.Array.multi([7])
+  external ffi.Array<ffi.Double> seconds;
+
+  @ffi.Array.multi([7])
+  external ffi.Array<ffi.UnsignedLong> calls;
+
+  @ffi.UnsignedLong()
+  external int input_bytes;
+
+  @ffi.UnsignedLong()
+  external int MCUs;
+
+  @ffi.UnsignedLong()
+  external int blocks;
+
+  @ffi.UnsignedLong()
+  external int idct_blocks;
+
+  @ffi.UnsignedLong()
+  external int output_rows;
+
+  external ffi.Pointer<
+          ffi.NativeFunction<
+              ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int, ffi.Int32)>>
+      trace;
+
+  external ffi.Pointer<ffi.Void> trace_data;
+
+  @ffi.Double()
+  external double stage_start;
+
+  @ffi.Int()
+  external int current_stage;
+
+  @ffi.Int()
+  external int depth;
+
+  @ffi.Array.multi([8])
+  external ffi.Array<ffi.Int> outer_stage;
+
+  @ffi.UnsignedLong()
+  external int input_base;
+
+  @ffi.Long()
+  external int input_mark;
+}
+
+typedef jpeg12_decode_timing = jpeg12_decode_timing_struct;
+
+class jpeg12_memory_stats extends ffi.Struct {
+  @ffi.Array.multi([2])
+  external ffi.Array<ffi.Long> small_bytes;
+
+  @ffi.Array.multi([2])
+  external ffi.Array<ffi.Long> large_bytes;
+
+  @ffi.Array.multi([2])
+  external ffi.Array<ffi.Long> peak_bytes;
+
+  @ffi.Long()
+  external int total_bytes;
+
+  @ffi.Long()
+  external int peak_total_bytes;
+
+  @ffi.Long()
+  external int small_free_bytes;
+
+  @ffi.Int()
+  external int virtual_arrays;
+
+  @ffi.Long()
+  external int virtual_bytes;
+
+  @ffi.Long()
+  external int virtual_resident_bytes;
+
+  @ffi.Int()
+  external int backing_stores;
+
+  @ffi.Long()
+  external int backing_store_bytes;
+}
+
+class jpeg12_process_memory_stats extends ffi.Struct {
+  @ffi.Long()
+  external int live_objects;
+
+  @ffi.Long()
+  external int total_bytes;
+
+  @ffi.Long()
+  external int peak_total_bytes;
+
+  @ffi.Long()
+  external int backing_store_bytes;
+}
+
 const int HAVE_PROTOTYPES = 1;
 
 const int HAVE_UNSIGNED_CHAR = 1;
@@ -1833,6 +3448,14 @@ const int JPOOL_IMAGE = 1;
 
 const int JPOOL_NUMPOOLS = 2;
 
+const int JPEG12_PYRAMID_LEVELS = 4;
+
+const int JPEG12_DIGEST_SIZE = 32;
+
+const int JPEG12_TIMING_STAGES = 7;
+
+const int JPEG12_TIMING_DEPTH = 8;
+
 const int JPEG12_SUSPENDED = 0;
 
 const int JPEG12_HEADER_OK = 1;
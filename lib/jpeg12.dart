@@ -1,63 +1,1685 @@
 library libjpeg12;
 
 import 'dart:async';
+import 'dart:collection';
+import 'dart:developer' show Timeline, TimelineTask;
 import 'dart:ffi';
 import 'dart:io';
+import 'dart:isolate';
 import 'dart:math';
 import 'dart:typed_data';
 import 'dart:ui' as ui;
 import 'package:ffi/ffi.dart';
 import 'package:flutter/material.dart';
+import 'package:flutter/scheduler.dart' show Ticker;
 
 import 'package:jpeg12/generated_bindings.dart';
 
-const _NUM_DECODE_ROWS = 16;
 const _NUM_BITS = 12;
 
-final Jpeg12Native _lib = Jpeg12Native(Platform.isAndroid
+final DynamicLibrary _dylib = Platform.isAndroid
     ? DynamicLibrary.open('liblibjpeg.so')
-    : DynamicLibrary.process());
+    : DynamicLibrary.process();
 
-class Jpeg12BitImage {
+final Jpeg12Native _lib = Jpeg12Native(_dylib);
+
+/// Frees the malloc'd plane of a [Jpeg12BitImage] once the image is gone.
+final _planeFinalizer = NativeFinalizer(
+    _dylib.lookup<NativeFinalizerFunction>('jpeg12_free_plane'));
+
+/// Unmaps the plane file a [Jpeg12BitImage] views once the image is gone.
+final _planeFileFinalizer = NativeFinalizer(
+    _dylib.lookup<NativeFinalizerFunction>('jpeg12_free_plane_file'));
+
+/// The smallest value such that at least [percent] % of the [count] entries
+/// in [histogram] are at or below it.
+int _percentile(
+  Uint32List histogram,
+  int count,
+  int minVal,
+  int maxVal,
+  double percent,
+) {
+  if (percent <= 0) return minVal;
+  if (percent >= 100) return maxVal;
+  final target = max(1, (percent * count / 100).ceil());
+  int sum = 0;
+  for (int i = minVal; i < maxVal; i++) {
+    sum += histogram[i];
+    if (sum >= target) return i;
+  }
+  return maxVal;
+}
+
+/// Copies the histogram out of a native [jpeg12_plane_stats].
+Uint32List _histogramFromStats(jpeg12_plane_stats stats) {
+  final histogram = Uint32List(1 << _NUM_BITS);
+  for (int i = 0; i < histogram.length; i++) {
+    histogram[i] = stats.histogram[i];
+  }
+  return histogram;
+}
+
+/// Reads a NUL-terminated message out of a fixed-size char array.
+String _messageFromChars(Array<Char> chars, int length) {
+  final codes = <int>[];
+  for (int i = 0; i < length && chars[i] != 0; i++) {
+    codes.add(chars[i] & 0xff);
+  }
+  return String.fromCharCodes(codes);
+}
+
+/// Throws the error a `jpeg12_try_` call left in [jerr], if there is one.
+void _throwIfFailed(Pointer<jpeg12_try_error_mgr> jerr) {
+  if (jerr.ref.status != 0) {
+    throw Exception(_messageFromChars(jerr.ref.message, JMSG_LENGTH_MAX));
+  }
+}
+
+/// Where the time of decoding goes, stage by stage, e.g. to compare devices.
+///
+/// Pass one to [Jpeg12BitImage.decode]; the native decoder adds the wall
+/// time of each stage and the work it did, so a record can sum several
+/// decodes. Time outside the stages (setup, allocation) is not counted.
+class Jpeg12DecodeTiming {
+  /// False if the native library was built without timing support; the
+  /// counters then stay at zero.
+  bool supported = true;
+
+  /// Short names of the stages, indexed by the [J_TIMING_STAGE] values.
+  static const stageNames = [
+    'markers', 'entropy', 'idct', 'upsample', 'color', 'quantize', 'output'
+  ];
+
+  /// Seconds spent in each stage, indexed by the [J_TIMING_STAGE] values:
+  /// markers, entropy decoding, IDCT, upsampling, color conversion,
+  /// color quantization and output (histogram, rescale).
+  final Float64List seconds = Float64List(JPEG12_TIMING_STAGES);
+
+  /// How often each stage was entered.
+  final List<int> calls = List<int>.filled(JPEG12_TIMING_STAGES, 0);
+
+  /// Compressed bytes consumed.
+  int inputBytes = 0;
+
+  /// MCUs and DCT blocks entropy decoded.
+  int mcus = 0;
+  int blocks = 0;
+
+  /// DCT blocks inverse transformed.
+  int idctBlocks = 0;
+
+  /// Rows of pixels produced.
+  int outputRows = 0;
+
+  /// Total time in all stages.
+  double get totalSeconds => seconds.fold(0.0, (a, b) => a + b);
+
+  /// Compressed megabytes decoded per second of stage time.
+  double get megabytesPerSecond =>
+      totalSeconds > 0 ? inputBytes / totalSeconds / 1e6 : 0;
+
+  void _add(jpeg12_decode_timing t) {
+    for (int i = 0; i < JPEG12_TIMING_STAGES; i++) {
+      seconds[i] += t.seconds[i];
+      calls[i] += t.calls[i];
+    }
+    inputBytes += t.input_bytes;
+    mcus += t.MCUs;
+    blocks += t.blocks;
+    idctBlocks += t.idct_blocks;
+    outputRows += t.output_rows;
+  }
+
+  @override
+  String toString() {
+    final ms = [
+      for (int i = 0; i < stageNames.length; i++)
+        '${stageNames[i]} ${(seconds[i] * 1e3).toStringAsFixed(2)} ms'
+    ];
+    return 'Jpeg12DecodeTiming(${ms.join(', ')}; $inputBytes bytes, '
+        '$mcus MCUs, $blocks blocks, $idctBlocks IDCT blocks, '
+        '$outputRows rows)';
+  }
+}
+
+/// Spans on the [Timeline] for a decode and what it leads to, so that
+/// DevTools shows where the time of a frame goes.
+///
+/// A decode running on the calling thread can hand its native timing record
+/// to [attach]; the native decoder then reports its header, each input scan
+/// and each output pass, which become child spans with the time of each
+/// decoder stage in them, and the bytes and rows they processed, as
+/// arguments. Release builds have no timeline, so nothing is traced there.
+class _Jpeg12Trace {
+  static const _eventNames = [
+    'jpeg12 header', 'jpeg12 scan', 'jpeg12 output pass'
+  ];
+
+  /// The trace the native decoder on this isolate reports to. Traced
+  /// decodes are synchronous, so there is at most one.
+  static _Jpeg12Trace? _attached;
+
+  static final _callback =
+      Pointer.fromFunction<Void Function(Pointer<Void>, Int, Int32)>(
+          _onNativeEvent);
+
+  final TimelineTask _task;
+  final _open = <int, TimelineTask>{};
+  final _openTiming = <int, Jpeg12DecodeTiming>{};
+  Pointer<jpeg12_decode_timing> _timing = nullptr;
+  int _scans = 0;
+  bool _finished = false;
+
+  _Jpeg12Trace._(String name, Map<String, Object> arguments)
+      : _task = TimelineTask()..start(name, arguments: arguments);
+
+  /// Starts a span, or returns null in release builds.
+  static _Jpeg12Trace? start(String name, Map<String, Object> arguments) =>
+      _releaseMode ? null : _Jpeg12Trace._(name, arguments);
+
+  static const _releaseMode = bool.fromEnvironment('dart.vm.product');
+
+  /// Starts a child span.
+  TimelineTask child(String name, Map<String, Object> arguments) =>
+      TimelineTask(parent: _task)..start(name, arguments: arguments);
+
+  /// Follows the native decoder through [timing], which must have been
+  /// set up with jpeg12_init_decode_timing().
+  void attach(Pointer<jpeg12_decode_timing> timing) {
+    _timing = timing;
+    timing.ref.trace = _callback;
+    _attached = this;
+  }
+
+  static void _onNativeEvent(Pointer<Void> data, int event, int begin) {
+    final trace = _attached;
+    if (trace == null || event < 0 || event >= _eventNames.length) return;
+    if (begin != 0) {
+      final arguments = <String, Object>{
+        if (event == J_TRACE_EVENT.JTRACE_SCAN) 'scan': ++trace._scans,
+      };
+      trace._open[event]?.finish();
+      trace._open[event] = trace.child(_eventNames[event], arguments);
+      trace._openTiming[event] = Jpeg12DecodeTiming().._add(trace._timing.ref);
+    } else {
+      final task = trace._open.remove(event);
+      final before = trace._openTiming.remove(event);
+      if (task == null || before == null) return;
+      final after = Jpeg12DecodeTiming().._add(trace._timing.ref);
+      task.finish(arguments: <String, Object>{
+        for (int i = 0; i < JPEG12_TIMING_STAGES; i++)
+          if (after.seconds[i] > before.seconds[i])
+            '${Jpeg12DecodeTiming.stageNames[i]}Ms':
+                (after.seconds[i] - before.seconds[i]) * 1e3,
+        'inputBytes': after.inputBytes - before.inputBytes,
+        'mcus': after.mcus - before.mcus,
+        'outputRows': after.outputRows - before.outputRows,
+      });
+    }
+  }
+
+  /// Ends the span, and any native spans an error left open. Calls after
+  /// the first do nothing, so this can also go in a `finally`.
+  void finish([Map<String, Object> arguments = const {}]) {
+    if (_finished) return;
+    _finished = true;
+    for (final task in _open.values) {
+      task.finish(arguments: const {'aborted': true});
+    }
+    _open.clear();
+    _openTiming.clear();
+    if (_timing != nullptr) _timing.ref.trace = nullptr;
+    if (identical(_attached, this)) _attached = null;
+    _task.finish(arguments: arguments);
+  }
+}
+
+/// Cancels decodes whose result is no longer wanted, e.g. the slice that
+/// was on screen before the user scrolled on.
+///
+/// Pass the token to [Jpeg12BitImage.decodeBatch] or [Jpeg12Volume.decode].
+/// After [cancel], the native decoders give up within one row of blocks,
+/// and images not yet finished fail with [Jpeg12BatchResult.cancelled] set.
+/// A token can be shared by several decodes and cannot be reset.
+class Jpeg12CancelToken {
+  bool _cancelled = false;
+  bool _paused = false;
+  final Set<Pointer<Int>> _flags = {};
+
+  bool get isCancelled => _cancelled;
+
+  void cancel() {
+    _cancelled = true;
+    _signal();
+  }
+
+  /// Holds the decodes at their next row of blocks, keeping their state,
+  /// or lets them go on; for [Jpeg12DecodeScheduler].
+  void _setPaused(bool paused) {
+    _paused = paused;
+    _signal();
+  }
+
+  int get _value => _cancelled ? 1 : (_paused ? -1 : 0);
+
+  void _signal() {
+    for (final flag in _flags) {
+      _lib.jpeg12_set_cancel_flag(flag, _value);
+    }
+  }
+
+  /// A native flag for one decode, set now and on [cancel]. The decoder
+  /// threads read it; [_release] it once the decode has returned.
+  Pointer<Int> _flag() {
+    final flag = calloc<Int>();
+    flag.value = _value;
+    _flags.add(flag);
+    return flag;
+  }
+
+  void _release(Pointer<Int> flag) {
+    _flags.remove(flag);
+    calloc.free(flag);
+  }
+}
+
+/// The outcome of decoding one image of [Jpeg12BitImage.decodeBatch].
+class Jpeg12BatchResult {
+  /// The decoded image, or null if decoding failed.
+  final Jpeg12BitImage? image;
+
+  /// 0 on success, otherwise the libjpeg message code of the error.
+  final int status;
+
+  /// Description of the error, if any.
+  final String? error;
+
+  /// Whether decoding was given up because of a [Jpeg12CancelToken].
+  final bool cancelled;
+
+  /// The decoded plane, until [image] is made of it in the calling isolate.
+  final _Jpeg12PlaneHandoff? _handoff;
+
+  Jpeg12BatchResult._({
+    required this.status,
+    this.image,
+    this.error,
+    this.cancelled = false,
+  }) : _handoff = null;
+
+  Jpeg12BatchResult._handOff(_Jpeg12PlaneHandoff handoff)
+      : status = 0,
+        image = null,
+        error = null,
+        cancelled = false,
+        _handoff = handoff;
+
+  /// The result with [image] adopted from a background isolate.
+  Jpeg12BatchResult _arrive() => _handoff == null
+      ? this
+      : Jpeg12BatchResult._(status: 0, image: _handoff!.adopt());
+}
+
+/// A native plane leaving the isolate that decoded it. The plane can't be
+/// sent along with its finalizer, so its address is sent instead, to be
+/// adopted by a [Jpeg12BitImage] on the other side.
+class _Jpeg12PlaneHandoff {
+  final int width;
+  final int height;
+  final int address;
+  final int minVal;
+  final int maxVal;
+  final Uint32List histogram;
+  final Map<double, int> percentiles;
+
+  _Jpeg12PlaneHandoff(this.width, this.height, JSAMPROW plane,
+      Pointer<jpeg12_plane_stats> stats, List<double> percentiles)
+      : address = plane.address,
+        minVal = stats.ref.min_value,
+        maxVal = stats.ref.max_value,
+        histogram = _histogramFromStats(stats.ref),
+        percentiles = <double, int>{
+          for (final p in percentiles) p: _lib.jpeg12_plane_percentile(stats, p)
+        };
+
+  Jpeg12BitImage adopt() => Jpeg12BitImage._(
+        height: height,
+        width: width,
+        plane: Pointer<JSAMPLE>.fromAddress(address),
+        minVal: minVal,
+        maxVal: maxVal,
+        histogram: histogram,
+        percentiles: percentiles,
+      );
+}
+
+/// A decoded 12 bit grayscale image.
+///
+/// The pixels stay in the native plane the decoder wrote them to, and are
+/// packed for display straight from there. The image owns the plane and
+/// frees it once it is no longer reachable.
+class Jpeg12BitImage implements Finalizable {
   final int height;
   final int width;
 
-  final Uint16List _pixelData;
+  final Pointer<JSAMPLE> _plane;
+
+  final int minVal;
+  final int maxVal;
+
+  /// Number of pixels for each of the 4096 sample values.
+  final Uint32List histogram;
+
+  /// The percentiles requested from [decode], keyed by percentage.
+  final Map<double, int> percentiles;
+
+  /// Takes over [plane], which came from malloc(), or with [finalizer], the
+  /// [owner] of the memory [plane] lies in.
+  Jpeg12BitImage._({
+    required this.height,
+    required this.width,
+    required Pointer<JSAMPLE> plane,
+    required this.minVal,
+    required this.maxVal,
+    required this.histogram,
+    required this.percentiles,
+    Pointer<Void>? owner,
+    NativeFinalizer? finalizer,
+  }) : _plane = plane {
+    (finalizer ?? _planeFinalizer).attach(this, owner ?? plane.cast(),
+        externalSize: _bytes);
+  }
+
+  /// Native memory held by the pixels.
+  int get _bytes => width * height * sizeOf<JSAMPLE>();
+
+  /// The smallest sample value such that at least [percent] % of the pixels
+  /// are at or below it. Computed from [histogram].
+  int percentile(double percent) =>
+      _percentile(histogram, width * height, minVal, maxVal, percent);
+
+  /// Takes over a decoded native plane (see [Jpeg12BitImage._]) and reads
+  /// its statistics.
+  static Jpeg12BitImage _fromPlane(
+    int width,
+    int height,
+    JSAMPROW plane,
+    Pointer<jpeg12_plane_stats> stats,
+    List<double> percentiles, {
+    Pointer<Void>? owner,
+    NativeFinalizer? finalizer,
+  }) {
+    return Jpeg12BitImage._(
+      height: height,
+      width: width,
+      plane: plane,
+      owner: owner,
+      finalizer: finalizer,
+      minVal: stats.ref.min_value,
+      maxVal: stats.ref.max_value,
+      histogram: _histogramFromStats(stats.ref),
+      percentiles: <double, int>{
+        for (final p in percentiles) p: _lib.jpeg12_plane_percentile(stats, p)
+      },
+    );
+  }
+
+  /// Decodes a whole series of images, e.g. the slices of a CT or MR scan.
+  ///
+  /// The images are decoded concurrently by a pool of native worker threads
+  /// ([threads], default one per CPU core), driven from a background isolate.
+  /// A broken image only fails its own entry of the result, and so does an
+  /// image that was not finished when [cancelToken] was cancelled. Images
+  /// in [diskCache] are read from there instead of decoded.
+  static Future<List<Jpeg12BatchResult>> decodeBatch(
+    List<Uint8List> inputs, {
+    int threads = 0,
+    List<double> percentiles = const [],
+    Jpeg12CancelToken? cancelToken,
+    Jpeg12DiskCache? diskCache,
+  }) async {
+    final cancel = cancelToken?._flag() ?? nullptr;
+    final address = cancel.address;
+    try {
+      final results = await Isolate.run(() => _decodeBatchSync(
+          inputs, threads, percentiles, address, diskCache));
+      return [for (final result in results) result._arrive()];
+    } finally {
+      cancelToken?._release(cancel);
+    }
+  }
+
+  static List<Jpeg12BatchResult> _decodeBatchSync(
+    List<Uint8List> inputs,
+    int threads,
+    List<double> percentiles,
+    int cancelAddress,
+    Jpeg12DiskCache? diskCache,
+  ) {
+    final n = inputs.length;
+    final cancel = Pointer<Int>.fromAddress(cancelAddress);
+    Pointer<jpeg12_batch_item> items = nullptr;
+    Pointer<jpeg12_plane_stats> stats = nullptr;
+    List<Pointer<Utf8>> cacheFiles = const [];
+
+    try {
+      items = calloc(n);
+      stats = calloc(n);
+      for (int i = 0; i < n; i++) {
+        final data = calloc<Uint8>(inputs[i].length);
+        data.asTypedList(inputs[i].length).setAll(0, inputs[i]);
+        _lib.jpeg12_init_plane_stats(stats.elementAt(i));
+        items[i].data = data.cast();
+        items[i].size = inputs[i].length;
+        items[i].stats = stats.elementAt(i);
+        items[i].cancel = cancel;
+      }
+      if (diskCache != null) cacheFiles = diskCache._attach(items, inputs);
+
+      _lib.jpeg12_decode_batch(items, n, threads, nullptr, nullptr);
+
+      final results = <Jpeg12BatchResult>[];
+      for (int i = 0; i < n; i++) {
+        final item = items[i];
+        if (item.status != 0) {
+          results.add(Jpeg12BatchResult._(
+            status: item.status,
+            error: _messageFromChars(item.message, JMSG_LENGTH_MAX),
+            cancelled: item.status == J_MESSAGE_CODE.JERR_CANCELLED,
+          ));
+        } else if (item.output_components != 1) {
+          results.add(Jpeg12BatchResult._(
+              status: -1, error: "Not a grayscale jpeg picture!"));
+        } else {
+          results.add(Jpeg12BatchResult._handOff(_Jpeg12PlaneHandoff(
+              item.output_width,
+              item.output_height,
+              item.plane,
+              stats.elementAt(i),
+              percentiles)));
+          item.plane = nullptr; // now owned by the result
+        }
+      }
+      return results;
+    } finally {
+      for (int i = 0; i < n; i++) {
+        calloc.free(items[i].data);
+        malloc.free(items[i].plane);
+      }
+      diskCache?._release(cacheFiles);
+      calloc.free(items);
+      calloc.free(stats);
+    }
+  }
+
+  /// Decodes [input]. The histogram and min/max are gathered by the decoder
+  /// as it writes the pixels; [percentiles] (0..100) are evaluated natively.
+  /// If [timing] is given, the time of each decoder stage is added to it.
+  static Jpeg12BitImage decode(
+    Uint8List input, {
+    List<double> percentiles = const [],
+    Jpeg12DecodeTiming? timing,
+  }) {
+    Pointer<jpeg12_decompress_struct> cinfo = nullptr;
+    Pointer<jpeg12_try_error_mgr> jerr = nullptr;
+    Pointer<jpeg12_plane_stats> stats = nullptr;
+    Pointer<jpeg12_decode_timing> nativeTiming = nullptr;
+    JSAMPROW plane = nullptr;
+    Pointer<UnsignedChar> inbuffer = nullptr;
+    final trace = _Jpeg12Trace.start(
+        'Jpeg12BitImage.decode', {'inputBytes': input.length});
+
+    try {
+      cinfo = calloc();
+      jerr = calloc();
+      stats = calloc();
+
+      _lib.jpeg12_CreateDecompress(
+          cinfo, JPEG12_LIB_VERSION, sizeOf<jpeg12_decompress_struct>());
+      cinfo.ref.err = _lib.jpeg12_try_error(jerr);
+      if (timing != null || trace != null) {
+        nativeTiming = calloc();
+        final supported = _lib.jpeg12_init_decode_timing(nativeTiming) != 0;
+        timing?.supported = supported;
+        if (supported) trace?.attach(nativeTiming);
+        cinfo.ref.timing = nativeTiming;
+      }
+
+      inbuffer = calloc.allocate(input.length);
+      inbuffer.cast<Uint8>().asTypedList(input.length).setAll(0, input);
+
+      _lib.jpeg12_try_mem_src(cinfo, inbuffer, input.length);
+      if (_lib.jpeg12_try_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+        _throwIfFailed(jerr);
+        throw Exception("Error reading JPEG header");
+      }
+
+      if (cinfo.ref.data_precision != _NUM_BITS) {
+        throw Exception("JPEG not using 12 bit precision!");
+      }
+
+      if (cinfo.ref.num_components != 1) {
+        throw Exception("Not a grayscale jpeg picture!");
+      }
+
+      _lib.jpeg12_try_start_decompress(cinfo);
+      _throwIfFailed(jerr);
+
+      final width = cinfo.ref.output_width;
+      final height = cinfo.ref.output_height;
+      plane = malloc.allocate(width * height * sizeOf<JSAMPLE>());
+      _lib.jpeg12_init_plane_stats(stats);
+      if (_lib.jpeg12_try_read_plane(cinfo, plane, width, stats) != height) {
+        _throwIfFailed(jerr);
+        throw Exception("Error decoding JPEG");
+      }
+
+      _lib.jpeg12_try_finish_decompress(cinfo);
+      _throwIfFailed(jerr);
+      timing?._add(nativeTiming.ref);
+      final image = Jpeg12BitImage._fromPlane(
+          width, height, plane, stats, percentiles);
+      plane = nullptr;
+      trace?.finish({
+        'width': width,
+        'height': height,
+        'pixelBytes': width * height * sizeOf<JSAMPLE>(),
+      });
+      return image;
+    } finally {
+      trace?.finish(const {'failed': true});
+      _lib.jpeg12_destroy_decompress(cinfo);
+      calloc.free(cinfo);
+      calloc.free(jerr);
+      calloc.free(stats);
+      calloc.free(nativeTiming);
+      malloc.free(plane);
+      calloc.free(inbuffer);
+    }
+  }
+
+  /// Decodes [input] at the scales 1/1, 1/2, 1/4 and 1/8, in that order,
+  /// e.g. for the levels of a tiled viewer.
+  ///
+  /// The compressed data is decoded once and every block is transformed
+  /// into all four levels, so this is much cheaper than four [decode]s.
+  /// Each level gets its own histogram and [percentiles].
+  ///
+  /// With [entropyThreads] > 1, a large baseline image without restart
+  /// markers is entropy decoded on that many native threads, and so are
+  /// the independent scans of a progressive or multi-scan image.
+  static List<Jpeg12BitImage> decodePyramid(
+    Uint8List input, {
+    List<double> percentiles = const [],
+    int entropyThreads = 0,
+  }) {
+    Pointer<jpeg12_decompress_struct> cinfo = nullptr;
+    Pointer<jpeg12_try_error_mgr> jerr = nullptr;
+    Pointer<jpeg12_pyramid_level> levels = nullptr;
+    Pointer<jpeg12_plane_stats> stats = nullptr;
+    Pointer<UnsignedChar> inbuffer = nullptr;
+
+    try {
+      cinfo = calloc();
+      jerr = calloc();
+      levels = calloc(JPEG12_PYRAMID_LEVELS);
+      stats = calloc(JPEG12_PYRAMID_LEVELS);
+
+      _lib.jpeg12_CreateDecompress(
+          cinfo, JPEG12_LIB_VERSION, sizeOf<jpeg12_decompress_struct>());
+      cinfo.ref.err = _lib.jpeg12_try_error(jerr);
+
+      inbuffer = calloc.allocate(input.length);
+      inbuffer.cast<Uint8>().asTypedList(input.length).setAll(0, input);
+
+      _lib.jpeg12_try_mem_src(cinfo, inbuffer, input.length);
+      if (_lib.jpeg12_try_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+        _throwIfFailed(jerr);
+        throw Exception("Error reading JPEG header");
+      }
+
+      if (cinfo.ref.data_precision != _NUM_BITS) {
+        throw Exception("JPEG not using 12 bit precision!");
+      }
+
+      if (cinfo.ref.num_components != 1) {
+        throw Exception("Not a grayscale jpeg picture!");
+      }
+
+      cinfo.ref.entropy_threads = entropyThreads;
+      _lib.jpeg12_try_calc_pyramid(cinfo, levels);
+      _throwIfFailed(jerr);
+      for (int k = 0; k < JPEG12_PYRAMID_LEVELS; k++) {
+        final level = levels[k];
+        level.plane = malloc.allocate(
+            level.width * level.height * sizeOf<JSAMPLE>());
+        _lib.jpeg12_init_plane_stats(stats.elementAt(k));
+        level.stats = stats.elementAt(k);
+      }
+      if (_lib.jpeg12_try_read_pyramid(cinfo, levels) == 0) {
+        _throwIfFailed(jerr);
+        throw Exception("Error decoding JPEG");
+      }
+
+      _lib.jpeg12_try_finish_decompress(cinfo);
+      _throwIfFailed(jerr);
+      final images = <Jpeg12BitImage>[];
+      for (int k = 0; k < JPEG12_PYRAMID_LEVELS; k++) {
+        images.add(Jpeg12BitImage._fromPlane(levels[k].width, levels[k].height,
+            levels[k].plane, stats.elementAt(k), percentiles));
+        levels[k].plane = nullptr;
+      }
+      return images;
+    } finally {
+      _lib.jpeg12_destroy_decompress(cinfo);
+      if (levels != nullptr) {
+        for (int k = 0; k < JPEG12_PYRAMID_LEVELS; k++) {
+          malloc.free(levels[k].plane);
+        }
+      }
+      calloc.free(cinfo);
+      calloc.free(jerr);
+      calloc.free(levels);
+      calloc.free(stats);
+      calloc.free(inbuffer);
+    }
+  }
+}
+
+/// How urgently a [Jpeg12DecodeScheduler] should decode an image, most
+/// urgent first.
+enum Jpeg12DecodePriority {
+  /// On screen now.
+  visible,
+
+  /// About to scroll into view.
+  nearVisible,
+
+  /// Wanted later, e.g. the next frames of a cine loop; may be preempted.
+  prefetch,
+}
+
+/// Thrown by [Jpeg12DecodeRequest.future] after [Jpeg12DecodeRequest.cancel].
+class Jpeg12DecodeCancelled implements Exception {
+  const Jpeg12DecodeCancelled();
+
+  @override
+  String toString() => 'Jpeg12DecodeCancelled';
+}
+
+/// One image asked of a [Jpeg12DecodeScheduler].
+class Jpeg12DecodeRequest {
+  final _Jpeg12DecodeJob _job;
+  final Completer<Jpeg12BitImage> _completer = Completer();
+  Jpeg12DecodePriority _priority;
+  final DateTime? deadline;
+  bool _cancelled = false;
+
+  Jpeg12DecodeRequest._(this._job, this._priority, this.deadline);
+
+  /// Completes with the image, or with an error if it cannot be decoded or
+  /// with [Jpeg12DecodeCancelled] once the request has been cancelled.
+  Future<Jpeg12BitImage> get future => _completer.future;
+
+  bool get isCancelled => _cancelled;
+
+  Jpeg12DecodePriority get priority => _priority;
+
+  /// Changes the priority, e.g. when a thumbnail scrolls into view.
+  set priority(Jpeg12DecodePriority value) {
+    if (value == _priority || _cancelled) return;
+    _priority = value;
+    _job.scheduler._pump();
+  }
+
+  /// Gives up on the image. Its decode stops within one row of blocks
+  /// unless other requests for the same input still want it.
+  void cancel() {
+    if (_cancelled || _completer.isCompleted) return;
+    _cancelled = true;
+    _job.requests.remove(this);
+    _completer.future.ignore();
+    _completer.completeError(const Jpeg12DecodeCancelled());
+    _job.scheduler._abandonIfUnwanted(_job);
+  }
+}
+
+/// All requests for one input, decoded once.
+class _Jpeg12DecodeJob {
+  final Jpeg12DecodeScheduler scheduler;
+  final Uint8List input;
+  final List<double> percentiles;
+  final int sequence;
+  final List<Jpeg12DecodeRequest> requests = [];
+  Jpeg12CancelToken? token; // while running or paused
+
+  _Jpeg12DecodeJob(this.scheduler, this.input, this.percentiles, this.sequence);
+
+  Jpeg12DecodePriority get priority => requests.fold(
+      Jpeg12DecodePriority.prefetch,
+      (p, r) => r.priority.index < p.index ? r.priority : p);
+
+  DateTime? get deadline {
+    DateTime? earliest;
+    for (final r in requests) {
+      final d = r.deadline;
+      if (d != null && (earliest == null || d.isBefore(earliest))) earliest = d;
+    }
+    return earliest;
+  }
+
+  /// Whether this job should be decoded before [other]: by priority, then
+  /// by deadline (none last), then first come first served.
+  bool precedes(_Jpeg12DecodeJob other) {
+    final p = priority.index - other.priority.index;
+    if (p != 0) return p < 0;
+    final d = deadline, od = other.deadline;
+    if (d != null && od != null && d != od) return d.isBefore(od);
+    if ((d == null) != (od == null)) return d != null;
+    return sequence < other.sequence;
+  }
+
+  bool decodes(Uint8List otherInput, List<double> otherPercentiles) {
+    if (percentiles.length != otherPercentiles.length ||
+        !Jpeg12ImageCache.sameContent(input, otherInput)) {
+      return false;
+    }
+    for (int i = 0; i < percentiles.length; i++) {
+      if (percentiles[i] != otherPercentiles[i]) return false;
+    }
+    return true;
+  }
+}
+
+/// Decides which of many wanted images is decoded next, e.g. for a grid of
+/// thumbnails or a cine loop.
+///
+/// Requests are served by [Jpeg12DecodePriority], then by deadline, then in
+/// order of arrival, with at most [maxConcurrent] decodes at a time. Requests
+/// for the same input (by content, see [Jpeg12ImageCache.sameContent]) and
+/// percentiles share one decode. A [Jpeg12DecodePriority.visible] request
+/// that finds every slot taken preempts a running
+/// [Jpeg12DecodePriority.prefetch] decode: that one is paused at the next
+/// row of blocks, keeping what it has decoded, and goes on once a slot is
+/// free again. A paused decode holds on to its memory and native thread.
+class Jpeg12DecodeScheduler {
+  /// The scheduler used by [Jpeg12BitWidget].
+  static final Jpeg12DecodeScheduler instance = Jpeg12DecodeScheduler();
+
+  final int maxConcurrent;
+
+  /// Where decoded images are kept across runs, if anywhere.
+  Jpeg12DiskCache? diskCache;
+
+  final List<_Jpeg12DecodeJob> _queued = [];
+  final List<_Jpeg12DecodeJob> _running = [];
+  final List<_Jpeg12DecodeJob> _paused = [];
+  int _sequence = 0;
+
+  /// [maxConcurrent] defaults to one decode per CPU core but one, which is
+  /// left to the UI.
+  Jpeg12DecodeScheduler({int maxConcurrent = 0, this.diskCache})
+      : maxConcurrent = maxConcurrent > 0
+            ? maxConcurrent
+            : max(1, Platform.numberOfProcessors - 1);
+
+  /// Decodes currently waiting for a slot.
+  int get queuedCount => _queued.length;
+
+  /// Decodes currently running.
+  int get runningCount => _running.length;
+
+  /// Decodes paused to make way for more urgent ones.
+  int get pausedCount => _paused.length;
+
+  /// Asks for [input] to be decoded, see [Jpeg12BitImage.decode].
+  Jpeg12DecodeRequest decode(
+    Uint8List input, {
+    Jpeg12DecodePriority priority = Jpeg12DecodePriority.visible,
+    DateTime? deadline,
+    List<double> percentiles = const [],
+  }) {
+    _Jpeg12DecodeJob? job;
+    for (final j in [..._running, ..._paused, ..._queued]) {
+      // A running job nobody wants any more has been cancelled already
+      if (j.requests.isNotEmpty && j.decodes(input, percentiles)) {
+        job = j;
+        break;
+      }
+    }
+    if (job == null) {
+      job = _Jpeg12DecodeJob(this, input, percentiles, _sequence++);
+      _queued.add(job);
+    }
+    final request = Jpeg12DecodeRequest._(job, priority, deadline);
+    job.requests.add(request);
+    _pump();
+    return request;
+  }
+
+  /// Drops [job] once nobody wants it any more.
+  void _abandonIfUnwanted(_Jpeg12DecodeJob job) {
+    if (job.requests.isNotEmpty) return;
+    if (_queued.remove(job)) return;
+    job.token?.cancel();
+  }
+
+  /// Starts or resumes the most urgent waiting jobs while slots are free,
+  /// and pauses prefetch work for visible images that find none.
+  void _pump() {
+    while (true) {
+      _Jpeg12DecodeJob? best;
+      for (final job in [..._paused, ..._queued]) {
+        if (job.requests.isEmpty) continue; // a paused one being cancelled
+        if (best == null || job.precedes(best)) best = job;
+      }
+      if (best == null) return;
+      if (_running.length >= maxConcurrent) {
+        if (best.priority != Jpeg12DecodePriority.visible) return;
+        final victim = _running.where((j) =>
+            j.requests.isNotEmpty &&
+            j.priority == Jpeg12DecodePriority.prefetch);
+        if (victim.isEmpty) return;
+        _running.remove(victim.first);
+        _paused.add(victim.first);
+        victim.first.token!._setPaused(true);
+      } else if (_paused.remove(best)) {
+        _running.add(best);
+        best.token!._setPaused(false);
+      } else {
+        _queued.remove(best);
+        _start(best);
+      }
+    }
+  }
+
+  void _start(_Jpeg12DecodeJob job) {
+    final token = job.token = Jpeg12CancelToken();
+    _running.add(job);
+    Jpeg12BitImage.decodeBatch([job.input],
+            threads: 1,
+            percentiles: job.percentiles,
+            cancelToken: token,
+            diskCache: diskCache)
+        .then((results) {
+      final result = results.single;
+      final image = result.image;
+      if (image != null) {
+        _finish(job, (c) => c.complete(image));
+      } else if (result.cancelled) {
+        _finish(job, (c) {});
+      } else {
+        final error = Exception(result.error ?? "Error decoding JPEG");
+        _finish(job, (c) => c.completeError(error));
+      }
+    }, onError: (Object error, StackTrace stack) {
+      _finish(job, (c) => c.completeError(error, stack));
+    });
+  }
+
+  void _finish(
+      _Jpeg12DecodeJob job, void Function(Completer<Jpeg12BitImage>) complete) {
+    _running.remove(job);
+    _paused.remove(job); // finished before it got to pause
+    job.token = null;
+    for (final request in job.requests) {
+      complete(request._completer);
+    }
+    job.requests.clear();
+    _pump();
+  }
+}
+
+/// A decoded image and its upload, as kept by [Jpeg12ImageCache], with the
+/// compressed bytes they were made from.
+class _Jpeg12CacheEntry {
+  final Uint8List input;
+  Jpeg12BitImage? image;
+  ui.Image? uploaded;
+
+  _Jpeg12CacheEntry(this.input);
+
+  int get bytes =>
+      input.lengthInBytes +
+      (image == null
+          ? 0
+          : image!._bytes + image!.histogram.lengthInBytes) +
+      (uploaded == null ? 0 : uploaded!.width * uploaded!.height * 4);
+}
+
+/// Decoded images and their uploaded [ui.Image]s, keyed by the content of
+/// the compressed bytes, so that scrolling back to a slice or rebuilding
+/// with an equal copy of its bytes doesn't decode and upload it again.
+///
+/// Least recently used entries are dropped once [maxBytes] is exceeded, and
+/// the whole cache on memory pressure (see [observeMemoryPressure]).
+/// [Jpeg12BitWidget] uses [instance]. The compressed bytes must not change
+/// once they have been looked up; the cache keeps a reference to them, to
+/// tell inputs with the same [keyOf] apart.
+class Jpeg12ImageCache with WidgetsBindingObserver {
+  static final Jpeg12ImageCache instance = Jpeg12ImageCache();
+
+  static final Expando<int> _keys = Expando('jpeg12 content hash');
+
+  final Map<int, _Jpeg12CacheEntry> _entries = {}; // oldest first
+  int _maxBytes;
+  int _currentBytes = 0;
+  bool _observing = false;
+
+  Jpeg12ImageCache({int maxBytes = 256 << 20}) : _maxBytes = maxBytes;
+
+  int get maxBytes => _maxBytes;
+
+  set maxBytes(int value) {
+    _maxBytes = value;
+    _trim();
+  }
+
+  /// Bytes held by the decoded planes, uploaded images and compressed inputs
+  /// in the cache.
+  int get currentBytes => _currentBytes;
+
+  int get length => _entries.length;
+
+  /// A 64 bit hash of the content of [input]. It is computed once per
+  /// buffer; reading 8 bytes at a time, that takes well under a millisecond
+  /// per megabyte.
+  static int keyOf(Uint8List input) {
+    final known = _keys[input];
+    if (known != null) return known;
+
+    const m = 0x9E3779B97F4A7C15;
+    final data = ByteData.sublistView(input);
+    final words = input.length >> 3;
+    var h = input.length * m;
+    for (int i = 0; i < words; i++) {
+      h = (h ^ data.getUint64(i << 3, Endian.little)) * m;
+      h ^= h >>> 29;
+    }
+    for (int i = words << 3; i < input.length; i++) {
+      h = (h ^ input[i]) * m;
+    }
+    h ^= h >>> 32;
+    _keys[input] = h;
+    return h;
+  }
+
+  /// Whether [a] and [b] hold the same bytes. Different contents can share
+  /// a [keyOf], so a matching key is confirmed byte by byte.
+  static bool sameContent(Uint8List a, Uint8List b) {
+    if (identical(a, b)) return true;
+    if (a.length != b.length || keyOf(a) != keyOf(b)) return false;
+    final da = ByteData.sublistView(a), db = ByteData.sublistView(b);
+    final words = a.length >> 3;
+    for (int i = 0; i < words; i++) {
+      if (da.getUint64(i << 3) != db.getUint64(i << 3)) return false;
+    }
+    for (int i = words << 3; i < a.length; i++) {
+      if (a[i] != b[i]) return false;
+    }
+    return true;
+  }
+
+  /// The decoded image of [input], if cached.
+  Jpeg12BitImage? image(Uint8List input) => _touch(input)?.image;
+
+  /// A new handle to the uploaded image of [input], if cached; the caller
+  /// disposes it.
+  ui.Image? uploaded(Uint8List input) => _touch(input)?.uploaded?.clone();
+
+  void putImage(Uint8List input, Jpeg12BitImage image) =>
+      _update(input, (entry) => entry.image = image);
+
+  /// Keeps a handle of its own to [image]; the caller keeps theirs.
+  void putUploaded(Uint8List input, ui.Image image) =>
+      _update(input, (entry) {
+        entry.uploaded?.dispose();
+        entry.uploaded = image.clone();
+      });
+
+  void remove(Uint8List input) {
+    final key = keyOf(input);
+    final entry = _entries[key];
+    if (entry != null && sameContent(entry.input, input)) {
+      _drop(_entries.remove(key)!);
+    }
+  }
+
+  void clear() {
+    for (final entry in _entries.values) {
+      _drop(entry);
+    }
+    _entries.clear();
+  }
+
+  /// Empties the cache whenever the system is low on memory.
+  void observeMemoryPressure() {
+    if (_observing) return;
+    _observing = true;
+    WidgetsBinding.instance.addObserver(this);
+  }
+
+  @override
+  void didHaveMemoryPressure() => clear();
+
+  /// The entry of [input], made the most recently used, if there is one.
+  _Jpeg12CacheEntry? _touch(Uint8List input) {
+    final key = keyOf(input);
+    final entry = _entries[key];
+    if (entry == null || !sameContent(entry.input, input)) return null;
+    _entries.remove(key);
+    _entries[key] = entry;
+    return entry;
+  }
+
+  void _update(Uint8List input, void Function(_Jpeg12CacheEntry) change) {
+    final key = keyOf(input);
+    var entry = _touch(input);
+    if (entry == null) {
+      // A different input with the same key makes way
+      final other = _entries.remove(key);
+      if (other != null) _drop(other);
+      entry = _entries[key] = _Jpeg12CacheEntry(input);
+      _currentBytes += entry.bytes;
+    }
+    _currentBytes -= entry.bytes;
+    change(entry);
+    _currentBytes += entry.bytes;
+    _trim();
+  }
+
+  void _drop(_Jpeg12CacheEntry entry) {
+    _currentBytes -= entry.bytes;
+    entry.uploaded?.dispose();
+  }
+
+  void _trim() {
+    while (_currentBytes > _maxBytes && _entries.isNotEmpty) {
+      final key = _entries.keys.first;
+      _drop(_entries.remove(key)!);
+    }
+  }
+}
+
+/// Decoded planes kept in files, so that reopening a study reads its images
+/// back instead of decoding them again.
+///
+/// Pass the cache to [Jpeg12BitImage.decodeBatch], [Jpeg12Volume.decode] or
+/// [Jpeg12DecodeScheduler.diskCache]: an image found in [directory] is
+/// copied from its file without touching the JPEG decoder, and an image
+/// that is not is decoded and then written there. Files are named after a
+/// hash of the compressed bytes ([Jpeg12ImageCache.keyOf]) and hold the raw
+/// 12 bit samples in a form that is mapped into memory as is, with
+/// [levels] - 1 downscaled levels (1/2, 1/4, 1/8) for [readLevel]. Each
+/// file also records the length and SHA-256 digest of the compressed bytes,
+/// and is only used for an input with the same ones.
+///
+/// With a [maxBytes] budget, the least recently used files are deleted
+/// after each batch. On Android, use a directory the
+/// app can write to, e.g. in its cache directory.
+class Jpeg12DiskCache {
+  final String directory;
+  final int maxBytes;
+  final int levels;
+
+  const Jpeg12DiskCache(this.directory, {this.maxBytes = 0, this.levels = 1})
+      : assert(levels >= 1 && levels <= JPEG12_PYRAMID_LEVELS);
+
+  /// The file that holds, or would hold, the plane of [input].
+  String fileFor(Uint8List input) {
+    final key = Jpeg12ImageCache.keyOf(input);
+    String half(int bits) =>
+        (bits & 0xFFFFFFFF).toRadixString(16).padLeft(8, '0');
+    return '$directory/${half(key >> 32)}${half(key)}.j12p';
+  }
+
+  bool contains(Uint8List input) => File(fileFor(input)).existsSync();
+
+  /// Level [level] of the cached plane of [input], scaled by 1 / 2^level,
+  /// or null if there is none. The image views the mapped file in place.
+  /// The histogram of level 0 comes from the file; that of a smaller level
+  /// is counted afresh.
+  Jpeg12BitImage? readLevel(
+    Uint8List input, {
+    int level = 0,
+    List<double> percentiles = const [],
+  }) {
+    final path = fileFor(input).toNativeUtf8();
+    var file = malloc<jpeg12_plane_file>(); // see jpeg12_free_plane_file
+    final stats = calloc<jpeg12_plane_stats>();
+    final id = calloc<jpeg12_source_id>();
+    final segment = calloc<jpeg12_segment>();
+    final data = calloc<Uint8>(max(input.length, 1));
+    try {
+      data.asTypedList(input.length).setAll(0, input);
+      segment.ref.data = data.cast();
+      segment.ref.size = input.length;
+      _lib.jpeg12_identify_source(id, segment, 1);
+      if (_lib.jpeg12_map_plane_file(path.cast(), id, file) == 0 ||
+          level >= file.ref.num_levels) {
+        return null;
+      }
+      final width = file.ref.width[level];
+      final height = file.ref.height[level];
+      final plane = file.ref.plane[level];
+      _lib.jpeg12_init_plane_stats(stats);
+      if (level == 0) {
+        _lib.jpeg12_plane_file_stats(file, stats);
+      } else {
+        _lib.jpeg12_count_plane_rows(stats, plane, width, width, height);
+      }
+      final image = Jpeg12BitImage._fromPlane(
+          width, height, plane, stats, percentiles,
+          owner: file.cast(), finalizer: _planeFileFinalizer);
+      file = nullptr; // the image views the mapping now
+      return image;
+    } finally {
+      if (file != nullptr) _lib.jpeg12_free_plane_file(file.cast());
+      malloc.free(path);
+      calloc.free(stats);
+      calloc.free(id);
+      calloc.free(segment);
+      calloc.free(data);
+    }
+  }
+
+  /// Deletes the least recently used files until the rest fit [maxBytes],
+  /// if that is set. Returns the bytes the remaining files take.
+  int trim() {
+    final path = directory.toNativeUtf8();
+    try {
+      // -1 is the largest unsigned long, i.e. no limit
+      return _lib.jpeg12_trim_plane_files(
+          path.cast(), maxBytes > 0 ? maxBytes : -1);
+    } finally {
+      malloc.free(path);
+    }
+  }
+
+  /// Points [items] at their files. Pass the result to [_release] once the
+  /// batch is done.
+  List<Pointer<Utf8>> _attach(
+      Pointer<jpeg12_batch_item> items, List<Uint8List> inputs) {
+    Directory(directory).createSync(recursive: true);
+    final paths = <Pointer<Utf8>>[];
+    for (int i = 0; i < inputs.length; i++) {
+      final path = fileFor(inputs[i]).toNativeUtf8();
+      paths.add(path);
+      items[i].cache_file = path.cast();
+      items[i].cache_levels = levels;
+    }
+    return paths;
+  }
+
+  void _release(List<Pointer<Utf8>> paths) {
+    for (final path in paths) {
+      malloc.free(path);
+    }
+    if (maxBytes > 0) trim();
+  }
+}
+
+/// Memory limit for decodes that keep a whole-image coefficient buffer
+/// (progressive and multi-scan images, coefficient access).
+///
+/// With a [maxBytes] limit, the part of that buffer which doesn't fit is
+/// kept in memory-mapped temporary files in [tempDirectory], so a large
+/// image decodes within a fixed RAM budget instead of running out of memory.
+/// On Android, pass a directory the app can write to, e.g. its cache
+/// directory; elsewhere it defaults to TMPDIR. A [maxBytes] of 0 means no
+/// limit. The settings apply to decodes started afterwards.
+class Jpeg12MemoryLimit {
+  static void configure({required int maxBytes, String? tempDirectory}) {
+    final Pointer<Utf8> dir =
+        tempDirectory != null ? tempDirectory.toNativeUtf8() : nullptr;
+    try {
+      _lib.jpeg12_set_backing_store(dir.cast<Char>(), maxBytes);
+    } finally {
+      if (dir != nullptr) malloc.free(dir);
+    }
+  }
+}
+
+/// Native memory held by the JPEG decoders and encoders of this process,
+/// e.g. to check a decode against [Jpeg12MemoryLimit].
+///
+/// [current] takes a snapshot of all live JPEG objects; with [resetPeak],
+/// [peakBytes] of later snapshots starts again from the current total.
+/// Each object reports its allocations in steps of up to 1 MB, so the
+/// totals may lag behind a running decode by less than that.
+class Jpeg12MemoryStats {
+  /// JPEG objects created and not yet destroyed.
+  final int liveObjects;
+
+  /// Bytes they have allocated, and the peak of that total.
+  final int totalBytes;
+  final int peakBytes;
+
+  /// Bytes of their virtual arrays kept in temporary files instead.
+  final int backingStoreBytes;
+
+  Jpeg12MemoryStats._(jpeg12_process_memory_stats s)
+      : liveObjects = s.live_objects,
+        totalBytes = s.total_bytes,
+        peakBytes = s.peak_total_bytes,
+        backingStoreBytes = s.backing_store_bytes;
+
+  static Jpeg12MemoryStats current({bool resetPeak = false}) {
+    final stats = calloc<jpeg12_process_memory_stats>();
+    try {
+      _lib.jpeg12_get_process_memory_stats(stats, resetPeak ? 1 : 0);
+      return Jpeg12MemoryStats._(stats.ref);
+    } finally {
+      calloc.free(stats);
+    }
+  }
+
+  @override
+  String toString() => 'Jpeg12MemoryStats($liveObjects objects, '
+      '$totalBytes bytes, peak $peakBytes, '
+      '$backingStoreBytes in temporary files)';
+}
+
+/// Keeps the entropy-decoded coefficients of recently viewed images, so that
+/// zooming or panning decodes only the blocks in view, at the new scale,
+/// instead of the whole file.
+///
+/// Images are kept natively, least recently used first out, within
+/// [maxBytes]. With [compact], trailing zero coefficients of each block are
+/// not stored, which saves a lot of memory on typical images. Call
+/// [dispose] when done.
+class Jpeg12CoefficientCache {
+  final int maxBytes;
+  final bool compact;
+
+  Pointer<jpeg12_coef_cache> _cache;
+
+  Jpeg12CoefficientCache({this.maxBytes = 256 << 20, this.compact = true})
+      : _cache = _lib.jpeg12_create_coef_cache(maxBytes) {
+    if (_cache == nullptr) {
+      throw Exception("Could not create coefficient cache");
+    }
+  }
+
+  /// Size of an image dimension [size] when scaled by [scale]/8.
+  static int scaledSize(int size, int scale) => (size * scale + 7) ~/ 8;
+
+  /// Decodes [region] of the image identified by [key], scaled by [scale]/8
+  /// (1..16). [region] is in pixels of the scaled image and defaults to all
+  /// of it; a region not inside the scaled image is a [RangeError]. [input]
+  /// is only decoded if [key] is not in the cache, in which case its
+  /// coefficients are added (see [decodePyramid] for [entropyThreads]).
+  /// A cached image is used only if it was decoded from the same bytes as
+  /// [input] (same length and SHA-256), so a [key] that is reused for
+  /// other data costs a decode, never a wrong image.
+  Jpeg12BitImage decode(
+    int key,
+    Uint8List input, {
+    int scale = 8,
+    Rectangle<int>? region,
+    List<double> percentiles = const [],
+    int entropyThreads = 0,
+  }) {
+    Pointer<jpeg12_decompress_struct> cinfo = nullptr;
+    Pointer<jpeg12_try_error_mgr> jerr = nullptr;
+    Pointer<jpeg12_coef_image> image = nullptr;
+    Pointer<jpeg12_plane_stats> stats = nullptr;
+    Pointer<jpeg12_source_id> id = nullptr;
+    Pointer<jpeg12_segment> segment = nullptr;
+    JSAMPROW plane = nullptr;
+    Pointer<UnsignedChar> inbuffer = nullptr;
+
+    if (_cache == nullptr) throw StateError("Cache has been disposed");
+    RangeError.checkValueInInterval(scale, 1, 16, 'scale');
+    try {
+      cinfo = calloc();
+      jerr = calloc();
+      stats = calloc();
+      id = calloc();
+      segment = calloc();
+
+      _lib.jpeg12_CreateDecompress(
+          cinfo, JPEG12_LIB_VERSION, sizeOf<jpeg12_decompress_struct>());
+      cinfo.ref.err = _lib.jpeg12_try_error(jerr);
+
+      inbuffer = calloc.allocate(max(input.length, 1));
+      inbuffer.cast<Uint8>().asTypedList(input.length).setAll(0, input);
+      segment.ref.data = inbuffer.cast();
+      segment.ref.size = input.length;
+      _lib.jpeg12_identify_source(id, segment, 1);
+
+      image = _lib.jpeg12_coef_cache_lookup(_cache, key, id);
+      if (image == nullptr) {
+        _lib.jpeg12_try_mem_src(cinfo, inbuffer, input.length);
+        if (_lib.jpeg12_try_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+          _throwIfFailed(jerr);
+          throw Exception("Error reading JPEG header");
+        }
+
+        if (cinfo.ref.data_precision != _NUM_BITS) {
+          throw Exception("JPEG not using 12 bit precision!");
+        }
+
+        if (cinfo.ref.num_components != 1) {
+          throw Exception("Not a grayscale jpeg picture!");
+        }
+
+        cinfo.ref.entropy_threads = entropyThreads;
+        image = _lib.jpeg12_try_save_coefficients(cinfo, compact ? 1 : 0);
+        if (image == nullptr) {
+          _throwIfFailed(jerr);
+          throw Exception("Error decoding JPEG");
+        }
+        _lib.jpeg12_try_finish_decompress(cinfo);
+        _throwIfFailed(jerr);
+        _lib.jpeg12_coef_cache_insert(_cache, key, id, image);
+      }
+
+      final scaledWidth = scaledSize(image.ref.image_width, scale);
+      final scaledHeight = scaledSize(image.ref.image_height, scale);
+      final r = region ?? Rectangle<int>(0, 0, scaledWidth, scaledHeight);
+      if (r.left < 0 ||
+          r.top < 0 ||
+          r.width <= 0 ||
+          r.height <= 0 ||
+          r.right > scaledWidth ||
+          r.bottom > scaledHeight) {
+        throw RangeError(
+            'Region $r is not inside the $scaledWidth x $scaledHeight image');
+      }
+      plane = malloc.allocate(r.width * r.height * sizeOf<JSAMPLE>());
+      _lib.jpeg12_init_plane_stats(stats);
+      _lib.jpeg12_try_read_coef_image(cinfo, image, scale, r.left, r.top,
+          r.width, r.height, plane, r.width, stats);
+      _throwIfFailed(jerr);
+      final result = Jpeg12BitImage._fromPlane(
+          r.width, r.height, plane, stats, percentiles);
+      plane = nullptr;
+      return result;
+    } finally {
+      if (image != nullptr) {
+        _lib.jpeg12_release_coef_image(image);
+      }
+      _lib.jpeg12_destroy_decompress(cinfo);
+      calloc.free(cinfo);
+      calloc.free(jerr);
+      calloc.free(stats);
+      calloc.free(id);
+      calloc.free(segment);
+      malloc.free(plane);
+      calloc.free(inbuffer);
+    }
+  }
+
+  /// Releases the cache and all coefficients in it.
+  void dispose() {
+    if (_cache != nullptr) {
+      _lib.jpeg12_destroy_coef_cache(_cache);
+      _cache = nullptr;
+    }
+  }
+}
+
+/// Modality rescale of one slice: stored value = sample * [slope] +
+/// [intercept], rounded and clamped to 0..65535.
+///
+/// Use an offset intercept for quantities that can be negative, e.g.
+/// `Jpeg12Rescale(1, 1024 + ctIntercept)` for Hounsfield units.
+class Jpeg12Rescale {
+  final double slope;
+  final double intercept;
+
+  const Jpeg12Rescale(this.slope, this.intercept);
+}
+
+/// A series of 12 bit slices decoded into one contiguous native buffer,
+/// e.g. for multi-planar viewing.
+///
+/// Slice z occupies [data] from `z * width * height` on. [data] is a view of
+/// the native buffer the decoder wrote into, not a copy, so call [dispose]
+/// when done with it; the view must not be used afterwards.
+class Jpeg12Volume {
+  final int width;
+  final int height;
+  final int depth;
+
+  /// Errors of the slices that could not be decoded, keyed by slice index.
+  /// The voxels of those slices are undefined.
+  final Map<int, String> failedSlices;
+
+  Pointer<Uint16> _voxels;
+
+  Jpeg12Volume._(
+      this.width, this.height, this.depth, this._voxels, this.failedSlices);
+
+  /// All voxels, slice after slice and row after row.
+  Uint16List get data {
+    if (_voxels == nullptr) throw StateError("Volume has been disposed");
+    return _voxels.asTypedList(width * height * depth);
+  }
+
+  /// The voxels of slice [z].
+  Uint16List slice(int z) {
+    final sliceSize = width * height;
+    return Uint16List.sublistView(data, z * sliceSize, (z + 1) * sliceSize);
+  }
+
+  /// Releases the native buffer.
+  void dispose() {
+    malloc.free(_voxels);
+    _voxels = nullptr;
+  }
+
+  /// Decodes [inputs] (one JPEG per slice, all [width] x [height] grayscale)
+  /// into a new volume.
+  ///
+  /// Every scanline is written by the decoder straight to its place in the
+  /// volume. Slices are decoded concurrently by native worker threads
+  /// ([threads], default one per CPU core). If [rescale] is given, it holds
+  /// one entry per slice (null for none) which is applied on output.
+  ///
+  /// Slices not finished when [cancelToken] is cancelled end up in
+  /// [failedSlices]. Slices in [diskCache] are read from there instead of
+  /// decoded.
+  static Future<Jpeg12Volume> decode(
+    List<Uint8List> inputs, {
+    required int width,
+    required int height,
+    List<Jpeg12Rescale?>? rescale,
+    int threads = 0,
+    Jpeg12CancelToken? cancelToken,
+    Jpeg12DiskCache? diskCache,
+  }) async {
+    final depth = inputs.length;
+    final voxels = malloc<Uint16>(max(1, width * height * depth));
+    final address = voxels.address;
+    final cancel = cancelToken?._flag() ?? nullptr;
+    final cancelAddress = cancel.address;
+    try {
+      final failed = await Isolate.run(() => _decodeSync(inputs, address,
+          width, height, rescale, threads, cancelAddress, diskCache));
+      return Jpeg12Volume._(width, height, depth, voxels, failed);
+    } catch (_) {
+      malloc.free(voxels);
+      rethrow;
+    } finally {
+      cancelToken?._release(cancel);
+    }
+  }
+
+  static Map<int, String> _decodeSync(
+    List<Uint8List> inputs,
+    int address,
+    int width,
+    int height,
+    List<Jpeg12Rescale?>? rescale,
+    int threads,
+    int cancelAddress,
+    Jpeg12DiskCache? diskCache,
+  ) {
+    final depth = inputs.length;
+    Pointer<jpeg12_batch_item> items = nullptr;
+    List<Pointer<Utf8>> cacheFiles = const [];
+
+    try {
+      items = calloc(depth);
+      for (int z = 0; z < depth; z++) {
+        final data = calloc<Uint8>(inputs[z].length);
+        data.asTypedList(inputs[z].length).setAll(0, inputs[z]);
+        items[z].data = data.cast();
+        items[z].size = inputs[z].length;
+        items[z].cancel = Pointer<Int>.fromAddress(cancelAddress);
+        final r = rescale?[z];
+        if (r != null) {
+          items[z].rescale = 1;
+          items[z].slope = r.slope;
+          items[z].intercept = r.intercept;
+        }
+      }
+
+      if (diskCache != null) cacheFiles = diskCache._attach(items, inputs);
+
+      _lib.jpeg12_decode_volume(items, depth,
+          Pointer<UINT16>.fromAddress(address), width, height, threads);
+
+      return <int, String>{
+        for (int z = 0; z < depth; z++)
+          if (items[z].status != 0)
+            z: _messageFromChars(items[z].message, JMSG_LENGTH_MAX)
+      };
+    } finally {
+      for (int z = 0; z < depth; z++) {
+        calloc.free(items[z].data);
+      }
+      diskCache?._release(cacheFiles);
+      calloc.free(items);
+    }
+  }
+}
 
+/// A rough idea of the pixel value distribution of a 12 bit JPEG, obtained
+/// without decoding the pixels.
+///
+/// Only the DC coefficients (block means) are looked at, so this is much
+/// cheaper than [Jpeg12BitImage.decode] and good enough for an initial
+/// window. The extremes are smoothed out; prefer percentiles like 1 and 99
+/// over [minVal] and [maxVal].
+class Jpeg12WindowEstimate {
   final int minVal;
   final int maxVal;
 
-  Jpeg12BitImage._({
-    required this.height,
-    required this.width,
-    required Uint16List data,
+  /// Number of 8x8 blocks for each of the 4096 mean values.
+  final Uint32List histogram;
+  final int blockCount;
+
+  Jpeg12WindowEstimate._({
     required this.minVal,
     required this.maxVal,
-  }) : _pixelData = data;
+    required this.histogram,
+    required this.blockCount,
+  });
 
-  static Jpeg12BitImage decode(Uint8List input) {
+  int percentile(double percent) =>
+      _percentile(histogram, blockCount, minVal, maxVal, percent);
+
+  static Jpeg12WindowEstimate estimate(Uint8List input) {
     Pointer<jpeg12_decompress_struct> cinfo = nullptr;
-    Pointer<jpeg12_error_mgr> jerr = nullptr;
-    Pointer<JSAMPROW> row_pointer = nullptr;
-    JSAMPROW rowptr = nullptr;
+    Pointer<jpeg12_try_error_mgr> jerr = nullptr;
+    Pointer<jpeg12_plane_stats> stats = nullptr;
     Pointer<UnsignedChar> inbuffer = nullptr;
 
     try {
       cinfo = calloc();
       jerr = calloc();
+      stats = calloc();
 
       _lib.jpeg12_CreateDecompress(
           cinfo, JPEG12_LIB_VERSION, sizeOf<jpeg12_decompress_struct>());
-      cinfo.ref.err = _lib.jpeg12_std_error(jerr);
+      cinfo.ref.err = _lib.jpeg12_try_error(jerr);
 
-      row_pointer = calloc.allocate(_NUM_DECODE_ROWS * sizeOf<JSAMPROW>());
       inbuffer = calloc.allocate(input.length);
       inbuffer.cast<Uint8>().asTypedList(input.length).setAll(0, input);
 
-      // TODO: Error function
+      _lib.jpeg12_try_mem_src(cinfo, inbuffer, input.length);
+      if (_lib.jpeg12_try_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+        _throwIfFailed(jerr);
+        throw Exception("Error reading JPEG header");
+      }
+
+      if (cinfo.ref.data_precision != _NUM_BITS) {
+        throw Exception("JPEG not using 12 bit precision!");
+      }
+
+      _lib.jpeg12_init_plane_stats(stats);
+      if (_lib.jpeg12_try_estimate_plane_stats(cinfo, stats) == 0) {
+        _throwIfFailed(jerr);
+        throw Exception("Error decoding JPEG");
+      }
+      _lib.jpeg12_try_finish_decompress(cinfo);
+      _throwIfFailed(jerr);
+
+      return Jpeg12WindowEstimate._(
+        minVal: stats.ref.min_value,
+        maxVal: stats.ref.max_value,
+        histogram: _histogramFromStats(stats.ref),
+        blockCount: stats.ref.count,
+      );
+    } finally {
+      _lib.jpeg12_destroy_decompress(cinfo);
+      calloc.free(cinfo);
+      calloc.free(jerr);
+      calloc.free(stats);
+      calloc.free(inbuffer);
+    }
+  }
+}
+
+/// An 8-bit RGBA rendering of a 12 bit JPEG through a fixed window.
+///
+/// The window is applied by the decoder itself, so this is the cheap way to
+/// get display pixels for export or printing. [pixels] can be passed to
+/// [ui.decodeImageFromPixels] with [ui.PixelFormat.rgba8888].
+class Jpeg12WindowedImage {
+  final int height;
+  final int width;
+  final Uint8List pixels;
+
+  Jpeg12WindowedImage._({
+    required this.height,
+    required this.width,
+    required this.pixels,
+  });
+
+  /// Decodes [input], mapping [windowMin] to black and [windowMax] to white.
+  /// If [voiLut] is given (4096 entries), it is used instead of the window.
+  static Jpeg12WindowedImage decode(
+    Uint8List input, {
+    int windowMin = 0,
+    int windowMax = 4095,
+    Uint8List? voiLut,
+  }) {
+    Pointer<jpeg12_decompress_struct> cinfo = nullptr;
+    Pointer<jpeg12_try_error_mgr> jerr = nullptr;
+    Pointer<JSAMPROW> row_pointer = nullptr;
+    Pointer<Uint8> outbuffer = nullptr;
+    Pointer<UnsignedChar> inbuffer = nullptr;
+    Pointer<UnsignedChar> lut = nullptr;
+
+    try {
+      cinfo = calloc();
+      jerr = calloc();
+
+      _lib.jpeg12_CreateDecompress(
+          cinfo, JPEG12_LIB_VERSION, sizeOf<jpeg12_decompress_struct>());
+      cinfo.ref.err = _lib.jpeg12_try_error(jerr);
+
+      inbuffer = calloc.allocate(input.length);
+      inbuffer.cast<Uint8>().asTypedList(input.length).setAll(0, input);
 
-      _lib.jpeg12_mem_src(cinfo, inbuffer, input.length);
-      if (_lib.jpeg12_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+      _lib.jpeg12_try_mem_src(cinfo, inbuffer, input.length);
+      if (_lib.jpeg12_try_read_header(cinfo, 1) != JPEG12_HEADER_OK) {
+        _throwIfFailed(jerr);
         throw Exception("Error reading JPEG header");
       }
 
@@ -65,55 +1687,378 @@ class Jpeg12BitImage {
         throw Exception("JPEG not using 12 bit precision!");
       }
 
-      if (cinfo.ref.num_components != 1) {
-        throw Exception("Not a grayscale jpeg picture!");
+      cinfo.ref.out_color_space = J_COLOR_SPACE.JCS_RGB;
+      cinfo.ref.window_output = 1;
+      cinfo.ref.window_min = windowMin;
+      cinfo.ref.window_max = windowMax;
+      if (voiLut != null) {
+        if (voiLut.length != 1 << _NUM_BITS) {
+          throw ArgumentError.value(voiLut.length, 'voiLut.length');
+        }
+        lut = calloc.allocate(voiLut.length);
+        lut.cast<Uint8>().asTypedList(voiLut.length).setAll(0, voiLut);
+        cinfo.ref.voi_lut = lut;
       }
 
-      _lib.jpeg12_start_decompress(cinfo);
+      _lib.jpeg12_try_start_decompress(cinfo);
+      _throwIfFailed(jerr);
 
-      int numPixels = cinfo.ref.output_width * cinfo.ref.output_height;
-      final res = Uint16List(numPixels);
-      final rowsize = cinfo.ref.output_width * sizeOf<JSAMPLE>();
-      rowptr = calloc.allocate(rowsize * _NUM_DECODE_ROWS);
-      for (int i = 0; i < _NUM_DECODE_ROWS; i++) {
-        row_pointer[i] = Pointer.fromAddress(rowptr.address + (i * rowsize));
+      // Rows are decoded straight into the final buffer.
+      final width = cinfo.ref.output_width;
+      final height = cinfo.ref.output_height;
+      final rowsize = width * cinfo.ref.output_components;
+      outbuffer = calloc.allocate(rowsize * height);
+      row_pointer = calloc.allocate(height * sizeOf<JSAMPROW>());
+      for (int i = 0; i < height; i++) {
+        row_pointer[i] = Pointer.fromAddress(outbuffer.address + i * rowsize);
       }
-      int minVal = 4095;
-      int maxVal = 0;
-      while (cinfo.ref.output_scanline < cinfo.ref.image_height) {
-        int currentRow = cinfo.ref.output_scanline;
-        int read =
-            _lib.jpeg12_read_scanlines(cinfo, row_pointer, _NUM_DECODE_ROWS);
+      while (cinfo.ref.output_scanline < height) {
+        final read = _lib.jpeg12_try_read_scanlines(
+            cinfo,
+            row_pointer.elementAt(cinfo.ref.output_scanline),
+            height - cinfo.ref.output_scanline);
         if (read == 0) {
+          _throwIfFailed(jerr);
           throw Exception("Error decoding JPEG");
         }
-        for (int i = 0; i < read; i++) {
-          for (int j = 0; j < cinfo.ref.output_width; j++) {
-            int p = (currentRow + i) * cinfo.ref.output_width + j;
-            int x = row_pointer[i][j];
-            minVal = min(minVal, x);
-            maxVal = max(maxVal, x);
-            res[p] = x;
-          }
-        }
       }
 
-      _lib.jpeg12_finish_decompress(cinfo);
-      return Jpeg12BitImage._(
-        height: cinfo.ref.image_height,
-        width: cinfo.ref.image_width,
-        data: res,
-        minVal: minVal,
-        maxVal: maxVal,
+      _lib.jpeg12_try_finish_decompress(cinfo);
+      _throwIfFailed(jerr);
+      return Jpeg12WindowedImage._(
+        height: height,
+        width: width,
+        pixels: Uint8List.fromList(outbuffer.asTypedList(rowsize * height)),
       );
     } finally {
       _lib.jpeg12_destroy_decompress(cinfo);
       calloc.free(cinfo);
       calloc.free(jerr);
       calloc.free(row_pointer);
+      calloc.free(outbuffer);
       calloc.free(inbuffer);
-      calloc.free(rowptr);
+      calloc.free(lut);
+    }
+  }
+}
+
+/// Frame counts of a [Jpeg12CineEngine] since it was created.
+class Jpeg12CineStats {
+  /// Frames put on screen.
+  final int shown;
+
+  /// Frames whose time passed before they were ready; playback skipped them
+  /// to keep in time.
+  final int dropped;
+
+  /// Frames that were not ready when due, so that the one before stayed on
+  /// screen for longer.
+  final int late;
+
+  /// Frames decoded by the native workers, including [failed] ones.
+  final int decoded;
+  final int failed;
+
+  /// Frames decoded (or begun) but passed by before they were uploaded,
+  /// e.g. after a seek.
+  final int discarded;
+
+  const Jpeg12CineStats._({
+    required this.shown,
+    required this.dropped,
+    required this.late,
+    required this.decoded,
+    required this.failed,
+    required this.discarded,
+  });
+
+  @override
+  String toString() => 'Jpeg12CineStats($shown shown, $dropped dropped, '
+      '$late late, $decoded decoded, $failed failed, $discarded discarded)';
+}
+
+class _Jpeg12CineFrame {
+  final int sequence;
+  final int frame;
+  ui.Image? image;
+
+  _Jpeg12CineFrame(this.sequence, this.frame);
+}
+
+/// Plays the frames of a multi-frame series, e.g. a cardiac or fluoroscopy
+/// cine, in a loop at [framesPerSecond].
+///
+/// Native worker threads ([threads], default one per CPU core) decode up to
+/// [ringSize] frames ahead of playback into planes that are allocated once.
+/// Up to [uploadAhead] of those are uploaded as [ui.Image]s ahead of their
+/// time, from pixel buffers that are reused as well. Decoding and uploading
+/// thus run at the pace of playback, however long the series.
+///
+/// Call [tick] on every display frame, as [Jpeg12BitCineWidget] does. It
+/// shows the latest frame that is both due and ready, skipping those whose
+/// time has passed, which [stats] counts. Listeners are notified whenever
+/// [image] changes. Call [dispose] when done.
+class Jpeg12CineEngine extends ChangeNotifier {
+  final int frameCount;
+  final int ringSize;
+  final int uploadAhead;
+
+  /// Dimensions of every frame; frames of another size fail to decode.
+  late final int width;
+  late final int height;
+
+  /// Errors of the frames that could not be decoded, keyed by frame index.
+  /// Playback skips these frames.
+  final Map<int, String> failedFrames = {};
+
+  /// The smallest and largest sample of the frames decoded so far, e.g. for
+  /// a window that doesn't change from frame to frame.
+  int get minVal => _minVal;
+  int get maxVal => _maxVal;
+  int _minVal = (1 << _NUM_BITS) - 1;
+  int _maxVal = 0;
+
+  Pointer<jpeg12_cine> _cine = nullptr;
+  late final Pointer<Uint8> _data;
+  late final Pointer<Pointer<JOCTET>> _frames;
+  late final Pointer<UnsignedLong> _sizes;
+  final Pointer<jpeg12_cine_frame> _frame = calloc();
+
+  /// Pixel buffers not in use; there are never more than [uploadAhead].
+  final List<Pointer<Uint8>> _pixelBuffers = [];
+  int _uploading = 0;
+
+  /// Frames uploaded and not shown yet, by sequence number. Sequence number
+  /// s shows frame s % [frameCount].
+  final SplayTreeMap<int, _Jpeg12CineFrame> _uploaded = SplayTreeMap();
+  int _nextUpload = 0;
+
+  /// Counts seeks, so that uploads started before one can be told apart.
+  int _epoch = 0;
+
+  _Jpeg12CineFrame? _current;
+  final Stopwatch _clock = Stopwatch();
+  double _framesPerSecond;
+  double _basePosition = 0;
+  int _baseMicros = 0;
+
+  int _shown = 0;
+  int _dropped = 0;
+  int _late = 0;
+  int _shownThrough = -1;
+  int _lateSequence = -1;
+
+  Jpeg12CineEngine(
+    List<Uint8List> frames, {
+    double framesPerSecond = 30,
+    this.ringSize = 8,
+    this.uploadAhead = 3,
+    int threads = 0,
+    bool play = true,
+  })  : frameCount = frames.length,
+        _framesPerSecond = framesPerSecond {
+    if (frames.isEmpty) {
+      throw ArgumentError.value(frames, 'frames', 'must not be empty');
+    }
+    final total = frames.fold<int>(0, (n, frame) => n + frame.length);
+    _data = malloc(max(1, total));
+    _frames = malloc(frameCount);
+    _sizes = malloc(frameCount);
+    final data = _data.asTypedList(max(1, total));
+    var offset = 0;
+    for (int i = 0; i < frameCount; i++) {
+      data.setAll(offset, frames[i]);
+      _frames[i] = _data.elementAt(offset).cast();
+      _sizes[i] = frames[i].length;
+      offset += frames[i].length;
+    }
+
+    final dimensions = malloc<JDIMENSION>(2);
+    _cine = _lib.jpeg12_create_cine(_frames, _sizes, frameCount, ringSize,
+        threads, dimensions, dimensions.elementAt(1));
+    width = dimensions[0];
+    height = dimensions[1];
+    malloc.free(dimensions);
+    if (_cine == nullptr) {
+      _free();
+      throw Exception("Error reading JPEG header");
+    }
+    if (play) _clock.start();
+  }
+
+  /// Index of the frame on screen, or -1 before the first one is ready.
+  int get frame => _current?.frame ?? -1;
+
+  /// The frame on screen, as uploaded for [Jpeg12BitCineWidget].
+  ui.Image? get image => _current?.image;
+
+  bool get playing => _clock.isRunning;
+
+  void play() => _clock.start();
+
+  void pause() => _clock.stop();
+
+  double get framesPerSecond => _framesPerSecond;
+
+  /// Changes the speed from the current position on.
+  set framesPerSecond(double value) {
+    _rebase(_position);
+    _framesPerSecond = value;
+  }
+
+  /// Goes on from [frame] in the current loop.
+  void seek(int frame) {
+    if (_cine == nullptr) return;
+    final sequence = _due ~/ frameCount * frameCount + frame % frameCount;
+    _rebase(sequence.toDouble());
+    _epoch++;
+    for (final uploaded in _uploaded.values) {
+      uploaded.image!.dispose();
+    }
+    _uploaded.clear();
+    _nextUpload = sequence;
+    _shownThrough = sequence - 1;
+    _lib.jpeg12_cine_seek(_cine, sequence);
+  }
+
+  Jpeg12CineStats get stats {
+    final native = calloc<jpeg12_cine_stats>();
+    try {
+      if (_cine != nullptr) _lib.jpeg12_cine_get_stats(_cine, native);
+      return Jpeg12CineStats._(
+        shown: _shown,
+        dropped: _dropped,
+        late: _late,
+        decoded: native.ref.frames_decoded,
+        failed: native.ref.frames_failed,
+        discarded: native.ref.frames_discarded,
+      );
+    } finally {
+      calloc.free(native);
+    }
+  }
+
+  double get _position =>
+      _basePosition +
+      (_clock.elapsedMicroseconds - _baseMicros) * _framesPerSecond / 1e6;
+
+  int get _due => _position.floor();
+
+  void _rebase(double position) {
+    _basePosition = position;
+    _baseMicros = _clock.elapsedMicroseconds;
+  }
+
+  /// Puts the frame due on screen if it is there, and starts uploading the
+  /// frames after it that the workers have ready.
+  void tick() {
+    if (_cine == nullptr) return;
+    final due = _due;
+    _show(due);
+    _upload(due);
+  }
+
+  void _show(int due) {
+    _Jpeg12CineFrame? next;
+    while (_uploaded.isNotEmpty && _uploaded.firstKey()! <= due) {
+      next?.image!.dispose(); // passed by while uploading
+      next = _uploaded.remove(_uploaded.firstKey())!;
+    }
+    if (next == null) {
+      if (due > _shownThrough && due != _lateSequence) {
+        _lateSequence = due;
+        _late++;
+      }
+      return;
+    }
+    _dropped += max(0, next.sequence - _shownThrough - 1);
+    _shownThrough = next.sequence;
+    _shown++;
+    _current?.image!.dispose();
+    _current = next;
+    notifyListeners();
+  }
+
+  void _upload(int due) {
+    // Frames before the one due are too late to be worth uploading
+    if (_nextUpload < due) _nextUpload = due;
+    while (_uploading + _uploaded.length < uploadAhead &&
+        _lib.jpeg12_cine_acquire(_cine, _nextUpload, _frame) != 0) {
+      final sequence = _nextUpload++;
+      final native = _frame.ref;
+      if (native.status != 0) {
+        failedFrames[native.frame] =
+            native.message.cast<Utf8>().toDartString();
+        _lib.jpeg12_cine_release(_cine, _frame);
+        continue;
+      }
+      _minVal = min(_minVal, native.min_value);
+      _maxVal = max(_maxVal, native.max_value);
+
+      final frame = _Jpeg12CineFrame(sequence, native.frame);
+      final bytes = width * height * 4;
+      final pixels = _pixelBuffers.isEmpty
+          ? malloc<Uint8>(bytes)
+          : _pixelBuffers.removeLast();
+      Timeline.timeSync('jpeg12 pack pixels', () {
+        _lib.jpeg12_pack_plane_bgra(
+            native.plane, width, width, height, pixels.cast());
+      }, arguments: {'width': width, 'height': height, 'bytes': bytes});
+      _lib.jpeg12_cine_release(_cine, _frame);
+
+      final epoch = _epoch;
+      _uploading++;
+      ui.decodeImageFromPixels(
+        pixels.asTypedList(bytes),
+        width,
+        height,
+        ui.PixelFormat.bgra8888,
+        (ui.Image img) {
+          _uploading--;
+          if (_cine == nullptr) {
+            malloc.free(pixels);
+            img.dispose();
+            return;
+          }
+          _pixelBuffers.add(pixels);
+          if (epoch != _epoch) {
+            img.dispose();
+            return;
+          }
+          frame.image = img;
+          _uploaded[sequence] = frame;
+        },
+      );
+    }
+  }
+
+  void _free() {
+    malloc.free(_data);
+    malloc.free(_frames);
+    malloc.free(_sizes);
+    calloc.free(_frame);
+  }
+
+  /// Stops the workers and releases all frames. Uploads still in flight
+  /// release their buffers when they complete.
+  @override
+  void dispose() {
+    if (_cine != nullptr) {
+      _lib.jpeg12_destroy_cine(_cine);
+      _cine = nullptr;
+      _free();
+      for (final pixels in _pixelBuffers) {
+        malloc.free(pixels);
+      }
+      _pixelBuffers.clear();
+      for (final uploaded in _uploaded.values) {
+        uploaded.image!.dispose();
+      }
+      _uploaded.clear();
+      _current?.image!.dispose();
+      _current = null;
     }
+    super.dispose();
   }
 }
 
@@ -154,17 +2099,27 @@ class _Jpeg12Painter extends CustomPainter {
   /// Use this function to extract the image data needed for this widget.
   static Future<ui.Image> _imageDataFromJpeg12(Jpeg12BitImage image) {
     final imageCompleter = Completer<ui.Image>();
-    final inputBuffer = Uint32List(image._pixelData.length);
-    for (int i = 0; i < image._pixelData.length; i++) {
-      final x = image._pixelData[i];
-      inputBuffer[i] = Color.fromRGBO(0, x >> 8, x, 1).value;
-    }
+    final size = {'width': image.width, 'height': image.height};
+    final trace = _Jpeg12Trace.start('_imageDataFromJpeg12', size);
+    // Packed natively from the image's own plane into a native buffer,
+    // which the engine copies from; no pixels pass through the Dart heap.
+    final bytes = image.width * image.height * 4;
+    final pixels = malloc<Uint8>(bytes);
+    Timeline.timeSync('jpeg12 pack pixels', () {
+      _lib.jpeg12_pack_plane_bgra(
+          image._plane, image.width, image.width, image.height, pixels.cast());
+    }, arguments: {...size, 'bytes': bytes});
+    final upload =
+        trace?.child('ui.decodeImageFromPixels', {...size, 'bytes': bytes});
     ui.decodeImageFromPixels(
-      inputBuffer.buffer.asUint8List(),
+      pixels.asTypedList(bytes),
       image.width,
       image.height,
-      ui.PixelFormat.bgra8888, // RGBA in Big-endian
+      ui.PixelFormat.bgra8888, // blue = low 8 bits, green = high 4 bits
       (ui.Image img) {
+        malloc.free(pixels);
+        upload?.finish();
+        trace?.finish();
         imageCompleter.complete(img);
       },
     );
@@ -201,12 +2156,18 @@ class Jpeg12BitWidget extends StatefulWidget {
   final double? windowMax;
   final ui.FilterQuality filterQuality;
 
+  /// How urgently [Jpeg12DecodeScheduler.instance] decodes [input] among the
+  /// images of all widgets, e.g. [Jpeg12DecodePriority.prefetch] for those
+  /// built ahead of scrolling into view.
+  final Jpeg12DecodePriority priority;
+
   const Jpeg12BitWidget({
     Key? key,
     required this.input,
     this.windowMin,
     this.windowMax,
     this.filterQuality = ui.FilterQuality.medium,
+    this.priority = Jpeg12DecodePriority.visible,
   }) : super(key: key);
 
   @override
@@ -214,19 +2175,71 @@ class Jpeg12BitWidget extends StatefulWidget {
 }
 
 class _Jpeg12BitWidgetState extends State<Jpeg12BitWidget> {
-  late Jpeg12BitImage _decoded;
+  Jpeg12BitImage? _decoded;
   ui.Image? _currentImage;
 
+  /// The decode in flight, if any. A newer input cancels it, so scrolling
+  /// quickly through slices doesn't decode every slice it passes; until the
+  /// new image is ready the previous one stays on screen.
+  Jpeg12DecodeRequest? _pending;
+
+  /// Counts the inputs asked for, so that late results can be told apart.
+  int _generation = 0;
+
   void _replaceCurrentImage() {
-    _decoded = Jpeg12BitImage.decode(widget.input);
-    _currentImage = null;
-    _Jpeg12Painter._imageDataFromJpeg12(_decoded).then((imageData) {
+    final generation = ++_generation;
+    _pending?.cancel();
+    _pending = null;
+
+    final input = widget.input;
+    final cache = Jpeg12ImageCache.instance..observeMemoryPressure();
+    final cached = cache.image(input);
+    final cachedUpload = cached == null ? null : cache.uploaded(input);
+    if (cached != null && cachedUpload != null) {
+      _show(cached, cachedUpload);
+      return;
+    }
+
+    final Future<Jpeg12BitImage> decoded;
+    if (cached != null) {
+      decoded = Future.value(cached);
+    } else {
+      final request = _pending = Jpeg12DecodeScheduler.instance
+          .decode(input, priority: widget.priority);
+      decoded = request.future.then((image) {
+        cache.putImage(input, image);
+        return image;
+      });
+    }
+    decoded.then((image) async {
+      if (generation != _generation) return;
+      final imageData = await _Jpeg12Painter._imageDataFromJpeg12(image);
+      cache.putUploaded(input, imageData);
+      if (generation != _generation || !mounted) {
+        imageData.dispose();
+        return;
+      }
       setState(() {
-        _currentImage = imageData;
+        _pending = null;
+        _show(image, imageData);
       });
+    }).catchError((Object error, StackTrace stack) {
+      if (error is Jpeg12DecodeCancelled) return;
+      FlutterError.reportError(FlutterErrorDetails(
+        exception: error,
+        stack: stack,
+        library: 'jpeg12',
+        context: ErrorDescription('while decoding a Jpeg12BitWidget image'),
+      ));
     });
   }
 
+  void _show(Jpeg12BitImage decoded, ui.Image imageData) {
+    _currentImage?.dispose();
+    _decoded = decoded;
+    _currentImage = imageData;
+  }
+
   @override
   void initState() {
     _replaceCurrentImage();
@@ -235,20 +2248,30 @@ class _Jpeg12BitWidgetState extends State<Jpeg12BitWidget> {
 
   @override
   void didUpdateWidget(covariant Jpeg12BitWidget oldWidget) {
-    if (oldWidget.input != widget.input) {
-      setState(() {
-        _replaceCurrentImage();
-      });
+    if (!Jpeg12ImageCache.sameContent(oldWidget.input, widget.input)) {
+      _replaceCurrentImage();
+    } else if (oldWidget.priority != widget.priority) {
+      _pending?.priority = widget.priority;
     }
     super.didUpdateWidget(oldWidget);
   }
 
+  @override
+  void dispose() {
+    _generation++;
+    _pending?.cancel();
+    _currentImage?.dispose();
+    super.dispose();
+  }
+
   @override
   Widget build(BuildContext context) {
+    final decoded = _decoded;
+    if (decoded == null) return const SizedBox.shrink();
     return LayoutBuilder(builder: (context, constraints) {
       final baseSize = ui.Size(
-        _decoded.width.toDouble(),
-        _decoded.height.toDouble(),
+        decoded.width.toDouble(),
+        decoded.height.toDouble(),
       );
       final size = constraints.constrainSizeAndAttemptToPreserveAspectRatio(
         baseSize,
@@ -257,8 +2280,87 @@ class _Jpeg12BitWidgetState extends State<Jpeg12BitWidget> {
         size: size,
         painter: _Jpeg12Painter(
           _currentImage,
-          widget.windowMin ?? _decoded.minVal.toDouble(),
-          widget.windowMax ?? _decoded.maxVal.toDouble(),
+          widget.windowMin ?? decoded.minVal.toDouble(),
+          widget.windowMax ?? decoded.maxVal.toDouble(),
+          widget.filterQuality,
+        ),
+      );
+    });
+  }
+}
+
+/// Shows the frames of a [Jpeg12CineEngine] as it plays them.
+///
+/// The engine is ticked on every display frame while the widget is on
+/// screen; the owner of the engine starts, pauses and seeks it, and
+/// disposes it. Without [windowMin] and [windowMax], the window spans the
+/// samples of the frames decoded so far.
+class Jpeg12BitCineWidget extends StatefulWidget {
+  final Jpeg12CineEngine engine;
+  final double? windowMin;
+  final double? windowMax;
+  final ui.FilterQuality filterQuality;
+
+  const Jpeg12BitCineWidget({
+    Key? key,
+    required this.engine,
+    this.windowMin,
+    this.windowMax,
+    this.filterQuality = ui.FilterQuality.medium,
+  }) : super(key: key);
+
+  @override
+  State<Jpeg12BitCineWidget> createState() => _Jpeg12BitCineWidgetState();
+}
+
+class _Jpeg12BitCineWidgetState extends State<Jpeg12BitCineWidget>
+    with SingleTickerProviderStateMixin {
+  late final Ticker _ticker;
+
+  void _frameChanged() => setState(() {});
+
+  @override
+  void initState() {
+    super.initState();
+    widget.engine.addListener(_frameChanged);
+    _ticker = createTicker((_) => widget.engine.tick())..start();
+  }
+
+  @override
+  void didUpdateWidget(covariant Jpeg12BitCineWidget oldWidget) {
+    if (oldWidget.engine != widget.engine) {
+      oldWidget.engine.removeListener(_frameChanged);
+      widget.engine.addListener(_frameChanged);
+    }
+    super.didUpdateWidget(oldWidget);
+  }
+
+  @override
+  void dispose() {
+    _ticker.dispose();
+    widget.engine.removeListener(_frameChanged);
+    super.dispose();
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final engine = widget.engine;
+    final image = engine.image;
+    if (image == null) return const SizedBox.shrink();
+    return LayoutBuilder(builder: (context, constraints) {
+      final baseSize = ui.Size(
+        engine.width.toDouble(),
+        engine.height.toDouble(),
+      );
+      final size = constraints.constrainSizeAndAttemptToPreserveAspectRatio(
+        baseSize,
+      );
+      return CustomPaint(
+        size: size,
+        painter: _Jpeg12Painter(
+          image,
+          widget.windowMin ?? engine.minVal.toDouble(),
+          widget.windowMax ?? engine.maxVal.toDouble(),
           widget.filterQuality,
         ),
       );